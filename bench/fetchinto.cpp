@@ -0,0 +1,70 @@
+/***************************************************************************
+ *   Copyright (C) 2006, IBM                                               *
+ *                                                                         *
+ *   Maintained By:                                                        *
+ *   Eric Munson and Brad Peters                                           *
+ *   munsone@us.ibm.com, bpeters@us.ibm.com                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the Lesser GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of the  *
+ *   License, or at your option) any later version.                        *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Lesser General Public License for more details.                   *
+ *                                                                         *
+ *   You should have received a copy of the Lesser GNU General Public      *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+ * fetch( ) against fetchInto( ) over every Component of a tree: time and
+ * operator new calls per Component.
+ */
+
+#include "../tests/testutil.hpp"
+
+using namespace vpdtest;
+
+int main( )
+{
+	TempDir dir;
+	vector<string> ids;
+
+	{
+		VpdDbEnv db( dir.path, "vpd.db", false );
+		ids = buildTree( db, 16, 3 );
+	}
+
+	VpdDbEnv db( dir.path, "vpd.db", true );
+	Component into;
+	size_t i = 0;
+	long news;
+
+	double fetchNs = bestOf( 5, ids.size( ), [ & ]( ) {
+		delete db.fetch( ids[ i++ % ids.size( ) ] );
+	} );
+	news = newCalls( );
+	for( i = 0; i < ids.size( ); i++ )
+		delete db.fetch( ids[ i ] );
+	double fetchNews = double( newCalls( ) - news ) / ids.size( );
+
+	double intoNs = bestOf( 5, ids.size( ), [ & ]( ) {
+		db.fetchInto( ids[ i++ % ids.size( ) ], into );
+	} );
+	news = newCalls( );
+	for( i = 0; i < ids.size( ); i++ )
+		db.fetchInto( ids[ i ], into );
+	double intoNews = double( newCalls( ) - news ) / ids.size( );
+
+	printf( "%zu components\n", ids.size( ) );
+	printf( "fetch( )      %8.0f ns %6.1f new per component\n", fetchNs,
+		fetchNews );
+	printf( "fetchInto( )  %8.0f ns %6.1f new per component\n", intoNs,
+		intoNews );
+	return 0;
+}
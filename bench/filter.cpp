@@ -0,0 +1,78 @@
+/***************************************************************************
+ *   Copyright (C) 2006, IBM                                               *
+ *                                                                         *
+ *   Maintained By:                                                        *
+ *   Eric Munson and Brad Peters                                           *
+ *   munsone@us.ibm.com, bpeters@us.ibm.com                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the Lesser GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of the  *
+ *   License, or at your option) any later version.                        *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Lesser General Public License for more details.                   *
+ *                                                                         *
+ *   You should have received a copy of the Lesser GNU General Public      *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+ * Loading part of a 4368 Component tree: the whole tree filtered after
+ * loading, against getComponentTree with a FieldFilter that matches a
+ * few Components all over the tree and with one on the parent that only
+ * reads the top level.
+ */
+
+#include "../tests/testutil.hpp"
+
+#include <libvpd-2/vpdretriever.hpp>
+#include <libvpd-2/componentfilter.hpp>
+
+using namespace vpdtest;
+
+static size_t countMatches( const vector<Component*>& leaves,
+	const ComponentFilter& f )
+{
+	size_t ret = 0;
+	for( size_t i = 0; i < leaves.size( ); i++ )
+		ret += f.matches( *leaves[ i ] ) +
+			countMatches( leaves[ i ]->getLeaves( ), f );
+	return ret;
+}
+
+int main( )
+{
+	TempDir dir;
+
+	{
+		VpdDbEnv db( dir.path, "vpd.db", false );
+		buildTree( db, 16, 3 );
+	}
+
+	VpdRetriever r( dir.path, "vpd.db" );
+	FieldFilter part( Component::FIELD_PART_NUMBER, "PN7" );
+	FieldFilter top( Component::FIELD_PARENT, System::ID );
+	double ns;
+
+	printf( "%-28s %10s\n", "", "ms/tree" );
+	ns = bestOf( 5, 5, [ & ]( ) {
+		System* s = r.getComponentTree( );
+		CHECK( countMatches( s->getLeaves( ), part ) > 0 );
+		delete s;
+	} );
+	printf( "%-28s %10.2f\n", "load, then filter", ns / 1e6 );
+	ns = bestOf( 5, 5, [ & ]( ) {
+		delete r.getComponentTree( part, Component::ALL_FIELDS );
+	} );
+	printf( "%-28s %10.2f\n", "filter by part number", ns / 1e6 );
+	ns = bestOf( 5, 5, [ & ]( ) {
+		delete r.getComponentTree( top, Component::ALL_FIELDS );
+	} );
+	printf( "%-28s %10.2f\n", "filter by parent, pruned", ns / 1e6 );
+	return 0;
+}
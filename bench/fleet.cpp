@@ -0,0 +1,83 @@
+/***************************************************************************
+ *   Copyright (C) 2006, IBM                                               *
+ *                                                                         *
+ *   Maintained By:                                                        *
+ *   Eric Munson and Brad Peters                                           *
+ *   munsone@us.ibm.com, bpeters@us.ibm.com                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the Lesser GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of the  *
+ *   License, or at your option) any later version.                        *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Lesser General Public License for more details.                   *
+ *                                                                         *
+ *   You should have received a copy of the Lesser GNU General Public      *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+ * FleetAggregator ingest rate: eight hosts of 4369 rows each that differ
+ * in a few rows, read into a new fleet database by 1, 2 and 4 threads.
+ */
+
+#include "../tests/testutil.hpp"
+
+#include <libvpd-2/fleetaggregator.hpp>
+
+using namespace vpdtest;
+
+static const int HOSTS = 8;
+
+int main( )
+{
+	TempDir dir;
+	vector<string> ids;
+	vector<FleetAggregator::Source> sources;
+
+	{
+		VpdDbEnv db( dir.path, "host0.db", false );
+		ids = buildTree( db, 16, 3 );
+	}
+	for( int h = 0; h < HOSTS; h++ )
+	{
+		FleetAggregator::Source s;
+		s.host = "host" + to_string( h );
+		s.path = dir.path + "/" + s.host + ".db";
+		if( h > 0 )
+		{
+			copyFile( dir.path + "/host0.db", s.path );
+			VpdDbEnv db( dir.path, s.host + ".db", false );
+			for( int i = 0; i < 10; i++ )
+			{
+				Component* c = db.fetch( ids[ h * 100 + i ] );
+				Gatherer::setSerial( c, s.host + "-" + to_string( i ) );
+				CHECK( db.upsert( c ) );
+				delete c;
+			}
+		}
+		sources.push_back( s );
+	}
+
+	const int threads[ ] = { 1, 2, 4 };
+
+	printf( "%7s %8s %8s %8s %12s\n", "threads", "rows", "blobs", "seconds",
+		"rows/second" );
+	for( size_t t = 0; t < sizeof( threads ) / sizeof( threads[ 0 ] ); t++ )
+	{
+		FleetAggregator agg( dir.path, "fleet" + to_string( t ) + ".db" );
+		FleetAggregator::Stats stats;
+
+		CHECK( agg.ingest( sources, threads[ t ], &stats ) );
+		CHECK( stats.failed == 0 );
+		printf( "%7d %8llu %8llu %8.3f %12.0f\n", threads[ t ],
+			(unsigned long long)stats.rows, (unsigned long long)stats.newBlobs,
+			stats.seconds, stats.rowsPerSecond( ) );
+	}
+	return 0;
+}
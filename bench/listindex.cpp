@@ -0,0 +1,76 @@
+/***************************************************************************
+ *   Copyright (C) 2006, IBM                                               *
+ *                                                                         *
+ *   Maintained By:                                                        *
+ *   Eric Munson and Brad Peters                                           *
+ *   munsone@us.ibm.com, bpeters@us.ibm.com                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the Lesser GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of the  *
+ *   License, or at your option) any later version.                        *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Lesser General Public License for more details.                   *
+ *                                                                         *
+ *   You should have received a copy of the Lesser GNU General Public      *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+ * Filling in the lists of a Component the way a collector does: n of
+ * each, then 2n updates or inserts by key, n lookups and n/2 removals
+ * of children, all through the Component's own methods.
+ */
+
+#include "../tests/testutil.hpp"
+
+using namespace vpdtest;
+
+static void fill( size_t n )
+{
+	Component* c = new Component( );
+
+	for( size_t i = 0; i < n; i++ )
+	{
+		string k = to_string( i );
+		Gatherer::addDeviceSpecific( c, "D" + k, k );
+		Gatherer::addUserData( c, "U" + k, k, false );
+		Gatherer::addAIXName( c, "hdisk" + k );
+		Gatherer::addChild( c, "/sys/devices/c" + k );
+	}
+	for( size_t i = 0; i < 2 * n; i++ )
+	{
+		string k = to_string( i );
+		Gatherer::updateDeviceSpecific( c, "D" + k, "new", 60 );
+		Gatherer::addUserData( c, "U" + k, "new", true );
+		Gatherer::addAIXName( c, "hdisk" + k );
+	}
+	for( size_t i = 0; i < n; i++ )
+	{
+		string k = to_string( i );
+		CHECK( c->getDeviceSpecific( "D" + k ) != NULL );
+		CHECK( Gatherer::isChild( c, "/sys/devices/c" + k ) );
+	}
+	for( size_t i = 0; i < n; i += 2 )
+		c->removeChild( "/sys/devices/c" + to_string( i ) );
+	delete c;
+}
+
+int main( )
+{
+	const size_t sizes[ ] = { 10, 100, 1000 };
+
+	printf( "%6s %14s\n", "n", "us/component" );
+	for( size_t s = 0; s < sizeof( sizes ) / sizeof( sizes[ 0 ] ); s++ )
+	{
+		size_t n = sizes[ s ];
+		double ns = bestOf( 5, 10000 / n, [ & ]( ) { fill( n ); } );
+		printf( "%6zu %14.1f\n", n, ns / 1000 );
+	}
+	return 0;
+}
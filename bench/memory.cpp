@@ -0,0 +1,80 @@
+/***************************************************************************
+ *   Copyright (C) 2006, IBM                                               *
+ *                                                                         *
+ *   Maintained By:                                                        *
+ *   Eric Munson and Brad Peters                                           *
+ *   munsone@us.ibm.com, bpeters@us.ibm.com                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the Lesser GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of the  *
+ *   License, or at your option) any later version.                        *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Lesser General Public License for more details.                   *
+ *                                                                         *
+ *   You should have received a copy of the Lesser GNU General Public      *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+ * What a loaded tree costs: the size of each class, the operator new
+ * calls and bytes per Component a full tree load makes, the heap it still
+ * holds once loaded, and how long the load takes.
+ */
+
+#include "../tests/testutil.hpp"
+
+#include <libvpd-2/vpdretriever.hpp>
+
+#include <malloc.h>
+
+using namespace vpdtest;
+
+int main( )
+{
+	TempDir dir;
+	size_t count;
+	const int runs = 5;
+
+	{
+		VpdDbEnv db( dir.path, "vpd.db", false );
+		count = buildTree( db, 16, 3 ).size( );
+	}
+
+	VpdRetriever ret( dir.path, "vpd.db" );
+
+	// Once to warm the statement and page caches, then counted.
+	delete ret.getComponentTree( );
+	long calls = newCalls( ), bytes = newBytes( );
+	size_t live = mallinfo2( ).uordblks;
+	System* sys = ret.getComponentTree( );
+	double newsPerNode = double( newCalls( ) - calls ) / count;
+	double bytesPerNode = double( newBytes( ) - bytes ) / count;
+	double livePerNode = double( mallinfo2( ).uordblks - live ) / count;
+	delete sys;
+
+	double load = 1e9;
+	for( int i = 0; i < runs; i++ )
+	{
+		chrono::steady_clock::time_point start = chrono::steady_clock::now( );
+		sys = ret.getComponentTree( );
+		load = min( load, chrono::duration<double, milli>(
+			chrono::steady_clock::now( ) - start ).count( ) );
+		delete sys;
+	}
+
+	printf( "sizeof( DataItem )   %6zu\n", sizeof( DataItem ) );
+	printf( "sizeof( Component )  %6zu\n", sizeof( Component ) );
+	printf( "sizeof( System )     %6zu\n", sizeof( System ) );
+	printf( "%zu components, per component:\n", count );
+	printf( "  operator new calls %8.1f\n", newsPerNode );
+	printf( "  bytes asked for    %8.0f\n", bytesPerNode );
+	printf( "  heap held          %8.0f\n", livePerNode );
+	printf( "full tree load, best of %d: %.2f ms\n", runs, load );
+	return 0;
+}
@@ -0,0 +1,114 @@
+/***************************************************************************
+ *   Copyright (C) 2006, IBM                                               *
+ *                                                                         *
+ *   Maintained By:                                                        *
+ *   Eric Munson and Brad Peters                                           *
+ *   munsone@us.ibm.com, bpeters@us.ibm.com                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the Lesser GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of the  *
+ *   License, or at your option) any later version.                        *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Lesser General Public License for more details.                   *
+ *                                                                         *
+ *   You should have received a copy of the Lesser GNU General Public      *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+ * Loading every Component of a tree with one lookup per ID against one
+ * query per batch of ID's, with both libraries, in an order that is not
+ * the order of the table.
+ */
+
+#include "../tests/testutil.hpp"
+
+#include <libvpd-2/vpdretriever.hpp>
+
+extern "C" {
+#include <libvpd-2/vpdretriever.h>
+}
+
+#include <algorithm>
+#include <random>
+
+using namespace vpdtest;
+
+static void freeAll( vector<struct component*>& out )
+{
+	for( size_t i = 0; i < out.size( ); i++ )
+	{
+		free_component( out[ i ] );
+		out[ i ] = NULL;
+	}
+}
+
+int main( )
+{
+	TempDir dir;
+	vector<string> ids;
+	const int runs = 5;
+
+	{
+		VpdDbEnv db( dir.path, "vpd.db", false );
+		ids = buildTree( db, 16, 3 );
+	}
+	shuffle( ids.begin( ), ids.end( ), mt19937( 1 ) );
+
+	VpdRetriever ret( dir.path, "vpd.db" );
+	struct vpdretriever* r = new_vpdretriever( dir.path.c_str( ), "vpd.db" );
+	CHECK( r != NULL );
+	vector<const char*> cids;
+	for( size_t i = 0; i < ids.size( ); i++ )
+		cids.push_back( ids[ i ].c_str( ) );
+	vector<struct component*> out( ids.size( ), NULL );
+
+	double cxxOne = bestOf( runs, 1, [ & ]( ) {
+		for( size_t i = 0; i < ids.size( ); i++ )
+			delete ret.getComponent( ids[ i ] );
+	} );
+	double cxxMany = bestOf( runs, 1, [ & ]( ) {
+		vector<Component*> got = ret.getComponents( ids );
+		CHECK( got.size( ) == ids.size( ) );
+		for( size_t i = 0; i < got.size( ); i++ )
+			delete got[ i ];
+	} );
+
+	double retOne = bestOf( runs, 1, [ & ]( ) {
+		for( size_t i = 0; i < ids.size( ); i++ )
+			free_component( get_component( r, cids[ i ] ) );
+	} );
+	double retMany = bestOf( runs, 1, [ & ]( ) {
+		CHECK( get_components( r, &cids[ 0 ], cids.size( ), &out[ 0 ] ) ==
+			(int)cids.size( ) );
+		freeAll( out );
+	} );
+
+	double dbOne = bestOf( runs, 1, [ & ]( ) {
+		for( size_t i = 0; i < ids.size( ); i++ )
+			free_component( fetch_component( r->dbenv, cids[ i ] ) );
+	} );
+	double dbMany = bestOf( runs, 1, [ & ]( ) {
+		CHECK( fetch_components( r->dbenv, &cids[ 0 ], cids.size( ),
+			&out[ 0 ] ) == (int)cids.size( ) );
+		freeAll( out );
+	} );
+	free_vpdretriever( r );
+
+	printf( "%zu components in a random order, best of %d, ms\n",
+		ids.size( ), runs );
+	printf( "%-20s %10s %10s\n", "", "one by one", "batched" );
+	printf( "%-20s %10.2f %10.2f\n", "getComponent(s)", cxxOne / 1e6,
+		cxxMany / 1e6 );
+	printf( "%-20s %10.2f %10.2f\n", "get_component(s)", retOne / 1e6,
+		retMany / 1e6 );
+	printf( "%-20s %10.2f %10.2f\n", "fetch_component(s)", dbOne / 1e6,
+		dbMany / 1e6 );
+	return 0;
+}
@@ -0,0 +1,72 @@
+/***************************************************************************
+ *   Copyright (C) 2006, IBM                                               *
+ *                                                                         *
+ *   Maintained By:                                                        *
+ *   Eric Munson and Brad Peters                                           *
+ *   munsone@us.ibm.com, bpeters@us.ibm.com                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the Lesser GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of the  *
+ *   License, or at your option) any later version.                        *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Lesser General Public License for more details.                   *
+ *                                                                         *
+ *   You should have received a copy of the Lesser GNU General Public      *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+ * DataItem::setValue on values of growing length, with nothing to drop
+ * and with a CR/LF at the end of every line of 64 bytes.
+ */
+
+#include "../tests/testutil.hpp"
+
+using namespace vpdtest;
+
+/*
+ * length bytes of text, cut into lines that end in CR/LF when crlf is
+ * set.
+ */
+static string makeValue( size_t length, bool crlf )
+{
+	size_t line = length < 64 ? length : 64;
+	string ret;
+
+	for( size_t i = 0; i < length; i++ )
+	{
+		if( crlf && i % line >= line - 2 )
+			ret += ( i % line == line - 2 ) ? '\r' : '\n';
+		else
+			ret += 'A' + i % 26;
+	}
+	return ret;
+}
+
+int main( )
+{
+	const size_t lengths[ ] = { 8, 64, 1024, 16384, 262144 };
+
+	printf( "%8s %8s %12s\n", "length", "input", "ns per call" );
+	for( size_t l = 0; l < sizeof( lengths ) / sizeof( lengths[ 0 ] ); l++ )
+	{
+		for( int crlf = 0; crlf < 2; crlf++ )
+		{
+			string value = makeValue( lengths[ l ], crlf );
+			DataItem d;
+			int calls = lengths[ l ] > 16384 ? 200 : 20000;
+			double ns = bestOf( 5, calls, [ & ]( ) {
+				Gatherer::setValue( d, value );
+			} );
+			printf( "%8zu %8s %12.0f\n", lengths[ l ],
+				crlf ? "CR/LF" : "clean", ns );
+		}
+	}
+	return 0;
+}
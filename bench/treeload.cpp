@@ -0,0 +1,107 @@
+/***************************************************************************
+ *   Copyright (C) 2006, IBM                                               *
+ *                                                                         *
+ *   Maintained By:                                                        *
+ *   Eric Munson and Brad Peters                                           *
+ *   munsone@us.ibm.com, bpeters@us.ibm.com                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the Lesser GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of the  *
+ *   License, or at your option) any later version.                        *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Lesser General Public License for more details.                   *
+ *                                                                         *
+ *   You should have received a copy of the Lesser GNU General Public      *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+ * Loading and freeing a whole tree: the C tree on the heap and in an
+ * arena, and the C++ tree.
+ */
+
+#include "../tests/testutil.hpp"
+
+#include <libvpd-2/vpdretriever.hpp>
+
+extern "C" {
+#include <libvpd-2/system.h>
+#include <libvpd-2/vpdretriever.h>
+}
+
+using namespace vpdtest;
+
+static double ms( chrono::steady_clock::time_point from )
+{
+	return chrono::duration<double, milli>(
+		chrono::steady_clock::now( ) - from ).count( );
+}
+
+int main( )
+{
+	TempDir dir;
+	size_t count;
+	const int runs = 5;
+	double heapLoad = 1e9, heapFree = 1e9, arenaLoad = 1e9, arenaFree = 1e9,
+		cxxLoad = 1e9, cxxFree = 1e9;
+
+	{
+		VpdDbEnv db( dir.path, "vpd.db", false );
+		count = buildTree( db, 16, 3 ).size( );
+	}
+
+	struct vpdretriever* r = new_vpdretriever( dir.path.c_str( ), "vpd.db" );
+	VpdRetriever ret( dir.path, "vpd.db" );
+	CHECK( r != NULL );
+
+	/*
+	 * Each loader has a loop of its own: malloc sorts what the one before
+	 * it free'd on a later call, and that work is charged to whichever
+	 * loader makes the call.
+	 */
+	for( int i = 0; i < runs; i++ )
+	{
+		chrono::steady_clock::time_point start = chrono::steady_clock::now( );
+		struct system* s = get_component_tree( r );
+		heapLoad = min( heapLoad, ms( start ) );
+		CHECK( s != NULL );
+		start = chrono::steady_clock::now( );
+		free_system( s );
+		heapFree = min( heapFree, ms( start ) );
+	}
+
+	for( int i = 0; i < runs; i++ )
+	{
+		chrono::steady_clock::time_point start = chrono::steady_clock::now( );
+		struct component_tree* t = load_component_tree( r, COMP_ALL_FIELDS );
+		arenaLoad = min( arenaLoad, ms( start ) );
+		CHECK( t != NULL );
+		start = chrono::steady_clock::now( );
+		free_component_tree( t );
+		arenaFree = min( arenaFree, ms( start ) );
+	}
+
+	for( int i = 0; i < runs; i++ )
+	{
+		chrono::steady_clock::time_point start = chrono::steady_clock::now( );
+		System* cxx = ret.getComponentTree( );
+		cxxLoad = min( cxxLoad, ms( start ) );
+		start = chrono::steady_clock::now( );
+		delete cxx;
+		cxxFree = min( cxxFree, ms( start ) );
+	}
+	free_vpdretriever( r );
+
+	printf( "%zu components, best of %d, ms\n", count, runs );
+	printf( "                  load     free\n" );
+	printf( "C heap        %8.2f %8.3f\n", heapLoad, heapFree );
+	printf( "C arena       %8.2f %8.3f\n", arenaLoad, arenaFree );
+	printf( "C++           %8.2f %8.3f\n", cxxLoad, cxxFree );
+	return 0;
+}
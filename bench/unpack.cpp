@@ -0,0 +1,88 @@
+/***************************************************************************
+ *   Copyright (C) 2006, IBM                                               *
+ *                                                                         *
+ *   Maintained By:                                                        *
+ *   Eric Munson and Brad Peters                                           *
+ *   munsone@us.ibm.com, bpeters@us.ibm.com                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the Lesser GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of the  *
+ *   License, or at your option) any later version.                        *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Lesser General Public License for more details.                   *
+ *                                                                         *
+ *   You should have received a copy of the Lesser GNU General Public      *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+ * Decode throughput of the packed Component format through the C++
+ * unpack, into a fresh and a reused Component, and the C unpack, on the
+ * heap and from an arena.
+ */
+
+#include "../tests/testutil.hpp"
+
+extern "C" {
+#include <libvpd-2/common.h>
+#include <libvpd-2/component.h>
+}
+
+using namespace vpdtest;
+
+static void report( const char* name, double ns, size_t bytes )
+{
+	printf( "%-22s %8.0f ns %8.1f MB/s\n", name, ns,
+		bytes / ns * 1000.0 );
+}
+
+int main( )
+{
+	vector<string> bufs;
+	size_t bytes = 0, i = 0;
+
+	for( int n = 0; n < 1000; n++ )
+	{
+		Component* c = Gatherer::make( "/sys/devices/n" + to_string( n ),
+			System::ID, n );
+		bufs.push_back( packed( *c ) );
+		bytes += bufs.back( ).size( );
+		delete c;
+	}
+	// The mean size of one packed Component.
+	bytes /= bufs.size( );
+
+	double newNs = bestOf( 5, bufs.size( ), [ & ]( ) {
+		delete new Component( bufs[ i++ % bufs.size( ) ].data( ) );
+	} );
+
+	Component into;
+	double intoNs = bestOf( 5, bufs.size( ), [ & ]( ) {
+		into.unpack( bufs[ i++ % bufs.size( ) ].data( ) );
+	} );
+
+	double cNs = bestOf( 5, bufs.size( ), [ & ]( ) {
+		free_component( unpack_component(
+			(void*)bufs[ i++ % bufs.size( ) ].data( ) ) );
+	} );
+
+	struct vpdarena* arena = new_arena( );
+	double arenaNs = bestOf( 5, bufs.size( ), [ & ]( ) {
+		unpack_component_arena( (void*)bufs[ i++ % bufs.size( ) ].data( ),
+			COMP_ALL_FIELDS, arena );
+	} );
+	free_arena( arena );
+
+	printf( "%zu bytes per packed component\n", bytes );
+	report( "C++ new Component", newNs, bytes );
+	report( "C++ unpack, reused", intoNs, bytes );
+	report( "C unpack_component", cNs, bytes );
+	report( "C arena", arenaNs, bytes );
+	return 0;
+}
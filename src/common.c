@@ -57,3 +57,100 @@ struct list* concat_list( struct list *head, const struct list *addme )
 
 	return ret;
 }
+
+/* Keeps every allocation, and the data after a block header, aligned. */
+#define ARENA_ALIGN 16
+#define ARENA_ROUND( n ) ( ( (n) + ARENA_ALIGN - 1 ) & ~( (size_t)ARENA_ALIGN - 1 ) )
+#define ARENA_HEADER ARENA_ROUND( sizeof( struct arena_block ) )
+
+struct vpdarena * new_arena( void )
+{
+	return calloc( 1, sizeof( struct vpdarena ) );
+}
+
+void free_arena( struct vpdarena *freeme )
+{
+	struct arena_block *next;
+
+	if( !freeme )
+		return;
+
+	while( freeme->head )
+	{
+		next = freeme->head->next;
+		free( freeme->head );
+		freeme->head = next;
+	}
+	free( freeme );
+}
+
+/*
+ * Takes size bytes from the current block, starting at a multiple of
+ * align, or from a new block when they do not fit.
+ */
+static char * arena_take( struct vpdarena *arena, size_t size, size_t align )
+{
+	struct arena_block *block = arena->head;
+	size_t start = 0;
+	char *ret;
+
+	if( block )
+		start = ( block->used + align - 1 ) & ~( align - 1 );
+	if( !block || start > block->size || block->size - start < size )
+	{
+		size_t blockSize = ARENA_BLOCK_SIZE;
+
+		if( size > ARENA_BLOCK_SIZE / 4 )
+			blockSize = ARENA_ROUND( size );
+
+		block = malloc( ARENA_HEADER + blockSize );
+		if( !block )
+			return NULL;
+		block->used = 0;
+		block->size = blockSize;
+		start = 0;
+
+		/*
+		 * An oversized block goes behind the current one so the space
+		 * left in the current block is not wasted.
+		 */
+		if( blockSize != ARENA_BLOCK_SIZE && arena->head )
+		{
+			block->next = arena->head->next;
+			arena->head->next = block;
+		}
+		else
+		{
+			block->next = arena->head;
+			arena->head = block;
+		}
+	}
+
+	ret = (char*)block + ARENA_HEADER + start;
+	block->used = start + size;
+	return ret;
+}
+
+void * arena_alloc( struct vpdarena *arena, size_t size )
+{
+	char *ret = arena_take( arena, size, ARENA_ALIGN );
+
+	if( ret )
+		memset( ret, 0, size );
+	return ret;
+}
+
+char * arena_alloc_text( struct vpdarena *arena, size_t size )
+{
+	return arena_take( arena, size, 1 );
+}
+
+char * arena_strdup( struct vpdarena *arena, const char *str )
+{
+	size_t len = strlen( str ) + 1;
+	char *ret = arena_alloc_text( arena, len );
+
+	if( ret )
+		memcpy( ret, str, len );
+	return ret;
+}
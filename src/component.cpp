@@ -30,8 +30,12 @@
 #include <libvpd-2/debug.hpp>
 #include <libvpd-2/logger.hpp>
 #include <libvpd-2/helper_functions.hpp>
+#include "fieldtable.hpp"
+#include "listindex.hpp"
+#include "tokenizer.h"
 
 #include <cstring>
+#include <type_traits>
 
 namespace lsvpd
 {
@@ -43,79 +47,16 @@ namespace lsvpd
 	string const Component::USER_END      ( "::userEnd::" );
 	string const Component::AX_START      ( "::axStart::" );
 	string const Component::AX_END        ( "::axEnd::" );
+	const Component::FieldMask Component::ALL_FIELDS;
 
-	Component::Component()
+	Component::Component() : mLoaded( ALL_FIELDS ),
+		mpIndex( NULL ), mpParent( NULL ), devMajor( 0 ), devMinor( 0 ),
+		devAccessMode( 0 )
 	{
-		idNode.ac = "None";
-		idNode.humanName = "Main Device Node, equals sysFsNode or deviceTreeNode";
-		deviceTreeNode.ac = "None";
-		deviceTreeNode.humanName = "/proc/device-tree Device Node";
-		sysFsNode.ac = "None";
-		sysFsNode.humanName = "/sys Device Node";
-		sysFsLinkTarget.ac = "None";
-		sysFsLinkTarget.humanName = "/sys/bus Device Node";
-		mDevClass.ac = "None";
-		mDevClass.humanName = "/sys/class - Device Node";
-		mFRU.ac = "FN";
-		mFRU.humanName = "Field Replaceable Unit Number";
-		mParent.ac = "Parent Node";
-		mParent.humanName = "Parent Node";
-		devSysName.humanName = "Device name from sysFS";
-		devDevTreeName = "Device name from /proc/device-tree";
-
-		scsiDetail.ac = "ZZ";
-		scsiDetail.humanName = "Device Details";
-		plantMfg.ac = "SE";
-		plantMfg.humanName = "Plant of manufacture";
-		mNetAddr.ac = "NA";
-		mNetAddr.humanName = "Network Address";
-		mDescription.ac = "DS";
-		mDescription.humanName = "Displayable Message";
-		mCDField.ac = "CD";
-		mCDField.humanName = "Card ID";
-		mSerialNumber.ac = "SN";
-		mSerialNumber.humanName = "Serial Number";
-		mPartNumber.ac = "PN";
-		mPartNumber.humanName = "Part Number of assembly";
-		// For RL: Special rule applies.  if devBus == "disk", is must be stored
-		// as Hex. See device_scsi_append_field() in lsvpd-0.16
-		mFirmwareLevel.ac = "RL";
-		mFirmwareLevel.humanName = "Non-alterable ROM level";
-		mFirmwareVersion.ac = "RM";
-		mFirmwareVersion.humanName = "Alterable ROM Level";
-		mManufacturer.ac = "MF";
-		mManufacturer.humanName = "Manufacturer Name";
-		mModel.ac = "TM";
-		mModel.humanName = "Machine Type-Model";
-		mManufacturerID.ac = "MN";
-		mManufacturerID.humanName = "Manufacturer ID";
-		mEngChangeLevel.ac = "EC";
-		mEngChangeLevel.humanName = "Engineering Change Level";
-		mFeatureCode.ac = "FC";
-		mFeatureCode.humanName = "Feature Code or Request for Price Quotation (RPQ) number";
-		devDriver.ac = "DD";
-		devDriver.humanName = "Device Driver Level";
-		mRecordType.ac = "RT";
-		mRecordType.humanName = "Record Type";
-		mKeywordVersion.ac = "VK";
-		mKeywordVersion.humanName = "Keyword Version";
-		mMicroCodeImage.ac = "MI";
-		mMicroCodeImage.humanName = "Micro Code Image";
-		mPhysicalLocation.ac = "YL";
-		mPhysicalLocation.humanName = "Location Code";
-		mSecondLocation.ac = "YL";
-		mSecondLocation.humanName = "Location Code";
-		n5.ac = "N5";
-		n5.humanName = "Processor CoD Capacity Card Info";
-		n6.ac = "N6";
-		n6.humanName = "Memory CoD Capacity Card Info";
+		FieldTable::init( *this, FIELDS );
 
 		devState = COMPONENT_STATE_LIVE;
 
-		devBus.humanName = "Device Bus";
-
-		mpParent = NULL;
-
 		mDeviceSpecific = vector<DataItem*>( );
 		mUserData = vector<DataItem*>( );
 		mAIXNames = vector<DataItem*>( );
@@ -123,18 +64,56 @@ namespace lsvpd
 		mLeaves = vector<Component*>( );
 	}
 
-	Component::Component( const Component& copyMe )
+	Component::Component( const Component& copyMe ) : mLoaded( ALL_FIELDS ),
+		mpIndex( NULL ), mpParent( NULL )
 	{
 		copyToMe( copyMe );
 	}
 
-	Component::Component( const void* packedData )
+	Component::Component( Component&& moveMe ) noexcept : mLoaded( ALL_FIELDS ),
+		mpIndex( NULL ), mpParent( NULL )
+	{
+		moveToMe( moveMe );
+	}
+
+	Component::Component( const void* packedData ) : mLoaded( ALL_FIELDS ),
+		mpIndex( NULL ), mpParent( NULL ), devMajor( 0 ),
+		devMinor( 0 ), devAccessMode( 0 )
 	{
-		unpack( packedData );
+		try
+		{
+			unpack( packedData );
+		}
+		catch( ... )
+		{
+			// The destructor will not run, drop what was unpacked.
+			freeLists( );
+			throw;
+		}
 		mLeaves = vector<Component*>( );
 	}
 
+	Component::Component( const void* packedData, FieldMask fields ) :
+		mLoaded( ALL_FIELDS ), mpIndex( NULL ), mpParent( NULL ), devMajor( 0 ), devMinor( 0 ),
+		devAccessMode( 0 )
+	{
+		try
+		{
+			unpack( packedData, fields );
+		}
+		catch( ... )
+		{
+			freeLists( );
+			throw;
+		}
+	}
+
 	Component::~Component( )
+	{
+		freeLists( );
+	}
+
+	void Component::freeLists( )
 	{
 		vector<Component*>::iterator i, end = mLeaves.end( );
 		for( i = mLeaves.begin( ); i != end; ++i )
@@ -157,11 +136,33 @@ namespace lsvpd
 		{
 			delete (*j);
 		}
+
+		for( j = mSpareItems.begin( ), dEnd = mSpareItems.end( ); j != dEnd; ++j )
+		{
+			delete (*j);
+		}
+
+		mLeaves.clear( );
+		mDeviceSpecific.clear( );
+		mUserData.clear( );
+		mAIXNames.clear( );
+		mSpareItems.clear( );
+
+		delete mpIndex;
+		mpIndex = NULL;
 	}
 
 	Component& Component::operator=( const Component& rhs )
 	{
-		copyToMe( rhs );
+		if( this != &rhs )
+			copyToMe( rhs );
+		return (*this);
+	}
+
+	Component& Component::operator=( Component&& rhs ) noexcept
+	{
+		if( this != &rhs )
+			moveToMe( rhs );
 		return (*this);
 	}
 
@@ -169,45 +170,7 @@ namespace lsvpd
 	{
 		unsigned int ret = INIT_BUF_SIZE;
 
-		ret += idNode.getPackedLength( );
-		ret += deviceTreeNode.getPackedLength( );
-		ret += sysFsNode.getPackedLength( );
-		ret += sysFsLinkTarget.getPackedLength( );
-		ret += halUDI.getPackedLength( );
-		ret += mNetAddr.getPackedLength( );
-		ret += mDevClass.getPackedLength( );
-		ret += mDescription.getPackedLength( );
-		ret += mCDField.getPackedLength( );
-		ret += mSerialNumber.getPackedLength( );
-		ret += mPartNumber.getPackedLength( );
-		ret += mFirmwareLevel.getPackedLength( );
-		ret += mFirmwareVersion.getPackedLength( );
-		ret += mFRU.getPackedLength( );
-		ret += mManufacturer.getPackedLength( );
-		ret += mModel.getPackedLength( );
-		ret += mManufacturerID.getPackedLength( );
-		ret += mEngChangeLevel.getPackedLength( );
-		ret += mParent.getPackedLength( );
-		ret += devSubsystem.getPackedLength( );
-		ret += devDriver.getPackedLength( );
-		ret += devKernel.getPackedLength( );
-		ret += devKernelNumber.getPackedLength( );
-		ret += devSysName.getPackedLength( );
-		ret += devDevTreeName.getPackedLength( );
-		ret += devBus.getPackedLength( );
-		ret += devBusAddr.getPackedLength( );
-		ret += mRecordType.getPackedLength( );
-		ret += scsiDetail.getPackedLength( );
-		ret += plantMfg.getPackedLength( );
-		ret += mFeatureCode.getPackedLength( );
-		ret += mKeywordVersion.getPackedLength( );
-		ret += mMicroCodeImage.getPackedLength( );
-		ret += mSecondLocation.getPackedLength( );
-		ret += n5.getPackedLength( );
-		ret += n6.getPackedLength( );
-
-		/* Must be last single item packed */
-		ret += mPhysicalLocation.getPackedLength( );
+		ret += FieldTable::packedSize( *this, FIELDS );
 
 		ret += mDeviceSpecific.size( );
 		ret += mUserData.size( );
@@ -257,9 +220,20 @@ namespace lsvpd
 	 */
 	unsigned int Component::pack( void** buffer )
 	{
-		u32 ret = getPackedSize( ), length;
+		u32 ret, length;
 		char* buf;
 
+		if( mLoaded != ALL_FIELDS )
+		{
+			string message( "Component.pack( ): Component was only partially "
+				"loaded, refusing to pack it." );
+			Logger l;
+			l.log( message, LOG_ERR );
+			VpdException ve( message );
+			throw ve;
+		}
+
+		ret = getPackedSize( );
 		buf = new char[ ret ];
 		if( buf == NULL )
 		{
@@ -283,48 +257,7 @@ namespace lsvpd
 		memcpy( buf, &netOrder, sizeof( u32 ) );
 		buf += sizeof( u32 );
 		// Pack the individual data items.
-		buf += idNode.pack( buf );
-		buf += deviceTreeNode.pack( buf );
-		buf += sysFsNode.pack( buf );
-		buf += sysFsLinkTarget.pack( buf );
-		buf += halUDI.pack( buf );
-		buf += mNetAddr.pack( buf );
-		buf += mDevClass.pack( buf );
-		buf += mDescription.pack( buf );
-		buf += mCDField.pack( buf );
-		buf += mSerialNumber.pack( buf );
-		buf += mPartNumber.pack( buf );
-		buf += mFirmwareLevel.pack( buf );
-		buf += mFirmwareVersion.pack( buf );
-		buf += mFRU.pack( buf );
-		buf += mManufacturer.pack( buf );
-		buf += mModel.pack( buf );
-		buf += mManufacturerID.pack( buf );
-		buf += mEngChangeLevel.pack( buf );
-		buf += mParent.pack( buf );
-		buf += devSubsystem.pack( buf );
-		buf += devDriver.pack( buf );
-		buf += devKernel.pack( buf );
-		buf += devKernelNumber.pack( buf );
-		buf += devSysName.pack( buf );
-		buf += devDevTreeName.pack( buf );
-		buf += devBus.pack( buf );
-		buf += devBusAddr.pack( buf );
-		buf += mRecordType.pack( buf );
-		buf += scsiDetail.pack( buf );
-		buf += n5.pack( buf );
-		buf += n6.pack( buf );
-
-		// Added - SCSI fill
-		buf += plantMfg.pack( buf );
-		buf += mFeatureCode.pack( buf );
-
-		buf += mKeywordVersion.pack( buf );
-		buf += mMicroCodeImage.pack( buf );
-		buf += mSecondLocation.pack( buf );
-
-		// Must be last single item to be packed
-		buf += mPhysicalLocation.pack( buf );
+		buf = FieldTable::pack( *this, FIELDS, buf );
 
 		// Pack the child vector.
 		memcpy( buf, CHILD_START.c_str( ), CHILD_START.length( ) );
@@ -398,17 +331,133 @@ namespace lsvpd
 	}
 
 	/**
-	 * unpack does exactly the opposite from pack, it will take a data buffer
-	 * and load this object with the contents.  If we need more data than the
-	 * size claims that we have, then we have a corrupt buffer and we will
-	 * throw an exception.
+	 * The single DataItems in the order that pack writes them, generated
+	 * from fields.h so it is always in step with the Field enum.
+	 */
+#define LSVPD_FIELD_DESC( name, member, slot, ac, humanName ) \
+		{ FIELD_##name, ac, humanName, &Component::member },
+	constexpr Component::FieldDesc Component::FIELDS[ NUM_PACKED_ITEMS ] = {
+		VPD_COMPONENT_FIELDS( LSVPD_FIELD_DESC )
+	};
+#undef LSVPD_FIELD_DESC
+
+	static inline bool tokenIs( const char* base, const struct vpdtoken& tok,
+		const string& marker )
+	{
+		return token_equals( base, &tok, marker.c_str( ), marker.length( ) );
+	}
+
+	static inline void unpackItem( DataItem& d, const char* base,
+		const struct vpdtoken* tok )
+	{
+		d.unpack( base + tok[ 0 ].offset, tok[ 0 ].length,
+			base + tok[ 1 ].offset, tok[ 1 ].length,
+			base + tok[ 2 ].offset, tok[ 2 ].length );
+	}
+
+	/**
+	 * Builds one list section of a packed Component from its tokens.  t
+	 * must index the start marker and is left after the end marker.  If
+	 * out is NULL the entries are stepped over, otherwise they are
+	 * unpacked into out, reusing the DataItems already there or in spare,
+	 * and used is set to the number of entries.  Returns false if the
+	 * tokens are corrupt.
 	 */
+	static bool unpackList( const char* base, const struct vpdtoken* tok,
+		int count, int& t, const string& endMarker, vector<DataItem*>* out,
+		size_t& used, vector<DataItem*>& spare )
+	{
+		for( t++; t < count && !tokenIs( base, tok[ t ], endMarker ); t += 3 )
+		{
+			if( t + 3 > count )
+				return false;
+			if( out == NULL )
+				continue;
+
+			if( used == out->size( ) )
+			{
+				if( spare.empty( ) )
+					out->push_back( new DataItem( ) );
+				else
+				{
+					out->push_back( spare.back( ) );
+					spare.pop_back( );
+				}
+			}
+			unpackItem( *( *out )[ used++ ], base, &tok[ t ] );
+		}
+		if( t >= count )
+			return false;
+		t++;
+		return true;
+	}
+
+	/**
+	 * Moves the entries of list past the first used into spare.
+	 */
+	static void trimList( vector<DataItem*>& list, size_t used,
+		vector<DataItem*>& spare )
+	{
+		for( size_t i = used; i < list.size( ); i++ )
+			spare.push_back( list[ i ] );
+		list.resize( used );
+	}
+
+	const DataItem* Component::getField( Field f ) const
+	{
+		if( f < 0 || f >= NUM_PACKED_ITEMS )
+			return NULL;
+		return &( this->*FIELDS[ f ].member );
+	}
+
+	Component::FieldMask Component::diffFields( const Component& other ) const
+	{
+		return FieldTable::diff( *this, other, FIELDS );
+	}
+
+	u64 Component::contentHash( ) const
+	{
+		u64 h = FieldTable::hash( *this, FIELDS, 0xcbf29ce484222325ULL );
+		vector<DataItem*>::const_iterator i, end;
+		vector<string>::const_iterator j, cEnd;
+
+		for( j = mChildren.begin( ), cEnd = mChildren.end( ); j != cEnd; ++j )
+			h = FieldTable::hash( *j, h );
+		h = FieldTable::hash( CHILD_END, h );
+		for( i = mDeviceSpecific.begin( ), end = mDeviceSpecific.end( );
+			i != end; ++i )
+			h = FieldTable::hash( **i, h );
+		h = FieldTable::hash( DEVICE_END, h );
+		for( i = mUserData.begin( ), end = mUserData.end( ); i != end; ++i )
+			h = FieldTable::hash( **i, h );
+		h = FieldTable::hash( USER_END, h );
+		for( i = mAIXNames.begin( ), end = mAIXNames.end( ); i != end; ++i )
+			h = FieldTable::hash( **i, h );
+		return h;
+	}
+
 	void Component::unpack( const void* payload )
+	{
+		unpack( payload, ALL_FIELDS );
+	}
+
+	/**
+	 * unpack does exactly the opposite from pack, it will take a data buffer
+	 * and load this object with the contents.  The buffer is split into
+	 * tokens first (see tokenizer.h) and the fields are built from them, if
+	 * the tokens run out before the Component is complete then we have a
+	 * corrupt buffer and we will throw an exception.  Fields that are not in
+	 * the mask are stepped over, nothing is allocated for them.
+	 */
+	void Component::unpack( const void* payload, FieldMask fields )
 	{
 		u32 size = 0, netOrder;
-		char* packed = (char*) payload;
-		char* next;
-		string item;
+		const char* packed = (const char*) payload;
+		const char* base;
+		struct vpdtoken stack[ TOKENIZER_STACK_TOKENS ];
+		struct vpdtoken* tok = NULL;
+		size_t children = 0, device = 0, user = 0, aix = 0;
+		int t, count;
 
 		if( payload == NULL )
 		{
@@ -422,354 +471,99 @@ namespace lsvpd
 		// Load the size of the payload. (It is packed in network order)
 		memcpy( &netOrder, payload, sizeof( u32 ) );
 		size = ntohl( netOrder );
-
-		next = packed + sizeof( u32 );
-		mChildren = vector<string>( );
-		mDeviceSpecific = vector<DataItem*>( );
-
-		idNode = DataItem( next );
-		next += idNode.getPackedLength( );
-		if( next > packed + size )
-		{
-			goto lderr;
-		}
-		deviceTreeNode = DataItem( next );
-		next += deviceTreeNode.getPackedLength( );
-		if( next > packed + size )
-		{
-			goto lderr;
-		}
-		sysFsNode = DataItem( next );
-		next += sysFsNode.getPackedLength( );
-		if( next > packed + size )
-		{
-			goto lderr;
-		}
-		sysFsLinkTarget = DataItem( next );
-		next += sysFsLinkTarget.getPackedLength( );
-		if( next > packed + size )
-		{
-			goto lderr;
-		}
-		halUDI = DataItem( next );
-		next += halUDI.getPackedLength( );
-		if( next > packed + size )
+		mLoaded = fields & ALL_FIELDS;
+		// The lists are overwritten in place below.
+		if( mpIndex != NULL )
+			mpIndex->clear( );
+		if( size < sizeof( u32 ) )
 		{
 			goto lderr;
 		}
 
-		mNetAddr = DataItem( next );
-		next += mNetAddr.getPackedLength( );
-		if( next > packed + size )
-		{
-			goto lderr;
-		}
-		mDevClass = DataItem( next );
-		next += mDevClass.getPackedLength( );
-		if( next > packed + size )
-		{
-			goto lderr;
-		}
-		mDescription = DataItem( next );
-		next += mDescription.getPackedLength( );
-		if( next > packed + size )
-		{
-			goto lderr;
-		}
-		mCDField = DataItem( next );
-		next += mCDField.getPackedLength( );
-		if( next > packed + size )
+		base = packed + sizeof( u32 );
+		tok = tokenize( base, size - sizeof( u32 ), stack,
+			TOKENIZER_STACK_TOKENS, &count );
+		if( tok == NULL || count < NUM_PACKED_ITEMS * 3 )
 		{
 			goto lderr;
 		}
 
-		mSerialNumber = DataItem( next );
-		next += mSerialNumber.getPackedLength( );
-		if( next > packed + size )
-		{
-			goto lderr;
-		}
-		mPartNumber = DataItem( next );
-		next += mPartNumber.getPackedLength( );
-		if( next > packed + size )
-		{
-			goto lderr;
-		}
-		mFirmwareLevel = DataItem( next );
-		next += mFirmwareLevel.getPackedLength( );
-		if( next > packed + size )
-		{
-			goto lderr;
-		}
-		mFirmwareVersion = DataItem( next );
-		next += mFirmwareVersion.getPackedLength( );
-		if( next > packed + size )
-		{
-			goto lderr;
-		}
-		mFRU = DataItem( next );
-		next += mFRU.getPackedLength( );
-		if( next > packed + size )
-		{
-			goto lderr;
-		}
-		mManufacturer = DataItem( next );
-		next += mManufacturer.getPackedLength( );
-		if( next > packed + size )
-		{
-			goto lderr;
-		}
-		mModel = DataItem( next );
-		next += mModel.getPackedLength( );
-		if( next > packed + size )
-		{
-			goto lderr;
-		}
-		mManufacturerID = DataItem( next );
-		next += mManufacturerID.getPackedLength( );
-		if( next > packed + size )
-		{
-			goto lderr;
-		}
-		mEngChangeLevel = DataItem( next );
-		next += mEngChangeLevel.getPackedLength( );
-		if( next > packed + size )
-		{
-			goto lderr;
-		}
-		mParent = DataItem( next );
-		next += mParent.getPackedLength( );
-		if( next > packed + size )
-		{
-			goto lderr;
-		}
-		devSubsystem = DataItem( next );
-		next += devSubsystem.getPackedLength( );
-		if( next > packed + size )
-		{
-			goto lderr;
-		}
-		devDriver = DataItem( next );
-		next += devDriver.getPackedLength( );
-		if( next > packed + size )
-		{
-			goto lderr;
-		}
-		devKernel = DataItem( next );
-		next += devKernel.getPackedLength( );
-		if( next > packed + size )
-		{
-			goto lderr;
-		}
-		devKernelNumber = DataItem( next );
-		next += devKernelNumber.getPackedLength( );
-		if( next > packed + size )
-		{
-			goto lderr;
-		}
-		devSysName = DataItem( next );
-		next += devSysName.getPackedLength( );
-		if( next > packed + size )
-		{
-			goto lderr;
-		}
-		devDevTreeName = DataItem( next );
-		next += devDevTreeName.getPackedLength( );
-		if( next > packed + size )
-		{
-			goto lderr;
-		}
-		devBus = DataItem( next );
-		next += devBus.getPackedLength( );
-		if( next > packed + size )
-		{
-			goto lderr;
-		}
-		devBusAddr = DataItem( next );
-		next += devBusAddr.getPackedLength( );
-		if( next > packed + size )
-		{
-			goto lderr;
-		}
-		mRecordType = DataItem( next );
-		next += mRecordType.getPackedLength( );
-		if( next > packed + size )
-		{
-			goto lderr;
-		}
-		scsiDetail = DataItem( next );
-		next += scsiDetail.getPackedLength( );
-		if( next > packed + size )
-		{
-			goto lderr;
-		}
-		n5 = DataItem( next );
-		next += n5.getPackedLength( );
-		if( next > packed + size )
-		{
-			goto lderr;
-		}
-		n6 = DataItem( next );
-		next += n6.getPackedLength( );
-		if( next > packed + size )
-		{
-			goto lderr;
-		}
-		/* Added - From SCSI fill */
-		plantMfg = DataItem( next );
-		next += plantMfg.getPackedLength( );
-		if( next > packed + size )
-		{
-			goto lderr;
-		}
-		mFeatureCode = DataItem( next );
-		next += mFeatureCode.getPackedLength( );
-		if( next > packed + size )
-		{
-			goto lderr;
-		}
-		mKeywordVersion = DataItem( next );
-		next += mKeywordVersion.getPackedLength( );
-		if( next > packed + size )
-		{
-			goto lderr;
-		}
-		mMicroCodeImage = DataItem( next );
-		next += mMicroCodeImage.getPackedLength( );
-		if( next > packed + size )
-		{
-			goto lderr;
-		}
-		mSecondLocation = DataItem( next );
-		next += mSecondLocation.getPackedLength( );
-		if( next > packed + size )
-		{
-			goto lderr;
-		}
-		mPhysicalLocation = DataItem( next );
-		next += mPhysicalLocation.getPackedLength( );
-		if( next > packed + size )
-		{
-			goto lderr;
-		}
+		FieldTable::unpack( *this, FIELDS, base, tok, fields );
+		t = NUM_PACKED_ITEMS * 3;
 
 		// Now onto the vectors, these should go much the same way that the
 		//  packing did.
-		while( next != CHILD_START )
+		while( t < count && !tokenIs( base, tok[ t ], CHILD_START ) )
 		{
-			next++;
-			if( next > packed + size )
-			{
-				goto lderr;
-			}
+			t++;
 		}
 
-		if( next == CHILD_START )
+		for( t++; t < count && !tokenIs( base, tok[ t ], CHILD_END ); t++ )
 		{
-			next += CHILD_START.length( ) + 1;
-			if( next > packed + size )
+			if( tok[ t ].length != 0 &&
+				( fields & fieldMask( FIELD_CHILDREN ) ) )
 			{
-				goto lderr;
-			}
-			item = string( (char*)next );
-			while( CHILD_END != item )
-			{
-				if( item != string( "" ) )
+				if( children == mChildren.size( ) )
 				{
-					string child = string( (char*)next );
-					mChildren.push_back( child );
-					next += item.length( );
+					if( mSpareChildren.empty( ) )
+						mChildren.push_back( string( ) );
+					else
+					{
+						mChildren.push_back( std::move( mSpareChildren.back( ) ) );
+						mSpareChildren.pop_back( );
+					}
 				}
-				next++;
-				item = string( (char*)next );
+				mChildren[ children++ ].assign( base + tok[ t ].offset,
+					tok[ t ].length );
 			}
-			next += CHILD_END.length( ) + 1;
 		}
-
-		if( DEVICE_START == next )
+		if( t >= count )
 		{
-			next += DEVICE_START.length( ) + 1;
-			if( next > packed + size )
-			{
-				goto lderr;
-			}
-			item = string( (char*) next );
-			while( DEVICE_END != item )
-			{
-				DataItem* d = new DataItem( next );
-				if ( d == NULL ) {
-					VpdException ve( "Out of memory." );
-					throw ve;
-				}
-				next += d->getPackedLength( );
-				if( next > packed + size )
-				{
-					delete ( d );
-					goto lderr;
-				}
-				mDeviceSpecific.push_back( d );
-				item = string( (char*)next );
-			}
+			goto lderr;
+		}
+		t++;
 
-			next += DEVICE_END.length( ) + 1;
+		if( t < count && tokenIs( base, tok[ t ], DEVICE_START ) &&
+			!unpackList( base, tok, count, t, DEVICE_END,
+				( fields & fieldMask( FIELD_DEVICE_SPECIFIC ) ) ?
+				&mDeviceSpecific : NULL, device, mSpareItems ) )
+		{
+			goto lderr;
 		}
 
-		if( USER_START == next )
+		if( t < count && tokenIs( base, tok[ t ], USER_START ) &&
+			!unpackList( base, tok, count, t, USER_END,
+				( fields & fieldMask( FIELD_USER_DATA ) ) ?
+				&mUserData : NULL, user, mSpareItems ) )
 		{
-			next += USER_START.length( ) + 1;
-			if( next > packed + size )
-			{
-				goto lderr;
-			}
-			item = string( (char*) next );
-			while( USER_END != item )
-			{
-				DataItem* d = new DataItem( next );
-				if ( d == NULL ) {
-					VpdException ve( "Out of memory." );
-					throw ve;
-				}
-				next += d->getPackedLength( );
-				if( next > packed + size )
-				{
-					delete ( d );
-					goto lderr;
-				}
-				mUserData.push_back( d );
-				item = string( (char*)next );
-			}
-			next += USER_END.length( ) + 1;
+			goto lderr;
 		}
 
-		if( AX_START == next )
+		if( t < count && tokenIs( base, tok[ t ], AX_START ) &&
+			!unpackList( base, tok, count, t, AX_END,
+				( fields & fieldMask( FIELD_AIX_NAMES ) ) ?
+				&mAIXNames : NULL, aix, mSpareItems ) )
 		{
-			next += AX_START.length( ) + 1;
-			if( next > packed + size )
-			{
-				goto lderr;
-			}
-			item = string( (char*) next );
-			while( AX_END != item )
-			{
-				DataItem* d = new DataItem( next );
-				if ( d == NULL ) {
-					VpdException ve( "Out of memory." );
-					throw ve;
-                                }
-				next += d->getPackedLength( );
-				if( next > packed + size )
-				{
-					delete ( d );
-					goto lderr;
-				}
-				mAIXNames.push_back( d );
-				item = string( (char*)next );
-			}
+			goto lderr;
 		}
 
+		if( tok != stack )
+			free( tok );
+
+		// Anything left over from a previous unpack is kept for the next.
+		while( mChildren.size( ) > children )
+		{
+			mSpareChildren.push_back( std::move( mChildren.back( ) ) );
+			mChildren.pop_back( );
+		}
+		trimList( mDeviceSpecific, device, mSpareItems );
+		trimList( mUserData, user, mSpareItems );
+		trimList( mAIXNames, aix, mSpareItems );
 		return;
 
 lderr:
+		if( tok != NULL && tok != stack )
+			free( tok );
 		string message(
 			"Component.unpack( ): Attempting to unpack corrupt buffer." );
 		Logger l;
@@ -778,6 +572,22 @@ lderr:
 		throw ve;
 	}
 
+	/**
+	 * Appends a copy of each DataItem in from to to.
+	 */
+	static void copyList( const vector<DataItem*>& from, vector<DataItem*>& to )
+	{
+		vector<DataItem*>::const_iterator i, end;
+
+		to.reserve( from.size( ) );
+		for( i = from.begin( ), end = from.end( ); i != end; ++i )
+		{
+			DataItem* d = new DataItem( );
+			*d = **i;
+			to.push_back( d );
+		}
+	}
+
 	/**
 	 * Internal use method only.  This method houses the logic that would
 	 * otherwise be repeated in the copy constructor and the operator=
@@ -785,52 +595,106 @@ lderr:
 	 */
 	void Component::copyToMe( const Component& copyMe )
 	{
-		mChildren = vector<string>( copyMe.mChildren );
+		freeLists( );
 
-		vector<DataItem*>::const_iterator i, dEnd;
-		vector<Component*>::const_iterator j, cEnd;
+		FieldTable::copy( *this, copyMe, FIELDS );
+		devType = copyMe.devType;
+		devState = copyMe.devState;
+		devMajor = copyMe.devMajor;
+		devMinor = copyMe.devMinor;
+		devAccessMode = copyMe.devAccessMode;
+		mLoaded = copyMe.mLoaded;
+		mChildren = copyMe.mChildren;
 
-		for( i = copyMe.mDeviceSpecific.begin( ),
-			dEnd = copyMe.mDeviceSpecific.end( ); i != dEnd; ++i )
-		{
-			mDeviceSpecific.push_back( (*i) );
-		}
+		copyList( copyMe.mDeviceSpecific, mDeviceSpecific );
+		copyList( copyMe.mUserData, mUserData );
+		copyList( copyMe.mAIXNames, mAIXNames );
 
-		for( i = copyMe.mUserData.begin( ),
-			dEnd = copyMe.mUserData.end( ); i != dEnd; ++i )
+		vector<Component*>::const_iterator j, cEnd;
+		mLeaves.reserve( copyMe.mLeaves.size( ) );
+		for( j = copyMe.mLeaves.begin( ),
+			cEnd = copyMe.mLeaves.end( ); j != cEnd; ++j )
 		{
-			mUserData.push_back( (*i) );
+			Component* leaf = new Component( **j );
+			leaf->mpParent = this;
+			mLeaves.push_back( leaf );
 		}
+	}
 
-		for( i = copyMe.mAIXNames.begin( ),
-			dEnd = copyMe.mAIXNames.end( ); i != dEnd; ++i )
-		{
-			mAIXNames.push_back( (*i) );
+	// moveToMe only hands pointers over, so every member it moves must be
+	// nothrow movable for the noexcept on it to hold.
+	static_assert( is_nothrow_move_assignable<DataItem>::value &&
+		is_nothrow_move_assignable<Label>::value &&
+		is_nothrow_move_assignable<string>::value,
+		"Component::moveToMe must not allocate" );
+
+	void Component::moveToMe( Component& moveMe ) noexcept
+	{
+		freeLists( );
+
+		FieldTable::move( *this, moveMe, FIELDS );
+		devType = std::move( moveMe.devType );
+		devState = moveMe.devState;
+		devMajor = moveMe.devMajor;
+		devMinor = moveMe.devMinor;
+		devAccessMode = moveMe.devAccessMode;
+		mLoaded = moveMe.mLoaded;
+		mChildren.swap( moveMe.mChildren );
+		mDeviceSpecific.swap( moveMe.mDeviceSpecific );
+		mUserData.swap( moveMe.mUserData );
+		mAIXNames.swap( moveMe.mAIXNames );
+		mLeaves.swap( moveMe.mLeaves );
+		mSpareItems.swap( moveMe.mSpareItems );
+		mSpareChildren.swap( moveMe.mSpareChildren );
+		std::swap( mpIndex, moveMe.mpIndex );
+
+		vector<Component*>::iterator j, cEnd;
+		for( j = mLeaves.begin( ), cEnd = mLeaves.end( ); j != cEnd; ++j )
+		{
+			(*j)->mpParent = this;
 		}
+	}
 
-		for( j = copyMe.mLeaves.begin( ),
-			cEnd = copyMe.mLeaves.end( ); j != cEnd; ++j )
+	/**
+	 * Finds the first entry of list whose AC (or value, if byValue) is key,
+	 * using the index in *mpIndex selected by which once the list is long
+	 * enough to have one.
+	 *
+	 * @return
+	 *   The position of the entry, or -1.
+	 */
+	int Component::findItem( KeyIndex ListIndex::* which,
+		const vector<DataItem*>& list, const string& key, bool byValue )
+	{
+		if( list.size( ) >= KeyIndex::MIN_INDEXED && mpIndex == NULL )
+			mpIndex = new ListIndex( );
+
+		if( byValue )
 		{
-			mLeaves.push_back( (*j) );
+			auto keyOf = [ &list ]( size_t i ) -> const string&
+				{ return list[ i ]->dataValue; };
+			if( mpIndex == NULL )
+				return KeyIndex::scan( key, list.size( ), keyOf );
+			return ( mpIndex->*which ).find( key, list.size( ), keyOf );
 		}
 
-		mDescription = DataItem( copyMe.mDescription );
-		mSerialNumber = DataItem( copyMe.mSerialNumber );
-		mPartNumber = DataItem( copyMe.mPartNumber );
-		mFRU = DataItem( copyMe.mFRU );
-		mFirmwareLevel = DataItem( copyMe.mFirmwareLevel );
-		mFirmwareVersion = DataItem( copyMe.mFirmwareVersion );
-		mManufacturer = DataItem( copyMe.mManufacturer );
-		mModel = DataItem( copyMe.mModel );
-		mEngChangeLevel = DataItem( copyMe.mEngChangeLevel );
-		mParent = DataItem( copyMe.mParent );
-		idNode = DataItem( copyMe.idNode );
-		mPhysicalLocation = DataItem( copyMe.mPhysicalLocation );
-		mSecondLocation = DataItem( copyMe.mSecondLocation );
-		mFeatureCode = DataItem( copyMe.mFeatureCode );
-		/*
-		 * plantMfg = DataItem( copyMe.plantMfg );
-		 */
+		auto keyOf = [ &list ]( size_t i ) -> const string&
+			{ return list[ i ]->ac.str( ); };
+		if( mpIndex == NULL )
+			return KeyIndex::scan( key, list.size( ), keyOf );
+		return ( mpIndex->*which ).find( key, list.size( ), keyOf );
+	}
+
+	int Component::findChild( const string& id )
+	{
+		auto keyOf = [ this ]( size_t i ) -> const string&
+			{ return mChildren[ i ]; };
+
+		if( mChildren.size( ) < KeyIndex::MIN_INDEXED )
+			return KeyIndex::scan( id, mChildren.size( ), keyOf );
+		if( mpIndex == NULL )
+			mpIndex = new ListIndex( );
+		return mpIndex->children.find( id, mChildren.size( ), keyOf );
 	}
 
 	/* Children Manipulation Section */
@@ -849,10 +713,7 @@ lderr:
 	 */
 	bool Component::isChild(Component *child)
 	{
-		for (unsigned int i = 0; i < mChildren.size(); i++)
-			if (mChildren[i] == child->idNode.getValue())
-				return true;
-		return false;
+		return findChild( child->idNode.getValue( ) ) >= 0;
 	}
 
 	/**
@@ -864,10 +725,7 @@ lderr:
 	 */
 	bool Component::isChild(const string& child)
 	{
-		for (unsigned int i = 0; i < mChildren.size(); i++)
-			if (mChildren[i] == child)
-				return true;
-		return false;
+		return findChild( child ) >= 0;
 	}
 
 	/**
@@ -886,15 +744,14 @@ lderr:
 
 	void Component::removeChild( const string& id )
 	{
-		vector<string>::iterator i, end;
+		int i = findChild( id );
 
-		for( i = mChildren.begin( ), end = mChildren.end( ); i != end; ++i )
+		if( i >= 0 )
 		{
-			if( id == *i )
-			{
-				mChildren.erase(i);
-				return;
-			}
+			// id may be the entry itself, drop it from the index first.
+			if( mpIndex != NULL )
+				mpIndex->children.erase( i, id );
+			mChildren.erase( mChildren.begin( ) + i );
 		}
 	}
 
@@ -911,16 +768,10 @@ lderr:
 	/* Finds and returns the DataItem specified by the acronym field, AC */
 	const DataItem * Component::getDeviceSpecific(const string& itemAC )
 	{
-		vector<DataItem*>::iterator i, end;
+		int i = findItem( &ListIndex::deviceSpecific, mDeviceSpecific, itemAC,
+			false );
 
-		for( i = mDeviceSpecific.begin( ), end = mDeviceSpecific.end( ); i != end; ++i )
-		{
-			if( (*i)->ac == itemAC ) {
-				return *i;
-			}
-		}
-
-		return NULL;
+		return i >= 0 ? mDeviceSpecific[ i ] : NULL;
 	}
 
 	void Component::addDeviceSpecific( const string& ac,
@@ -960,15 +811,13 @@ lderr:
 	void Component::updateDeviceSpecific( const string& ac,
 		const string& humanName, const string& val, int lvl = 0 )
 	{
-		vector<DataItem*>::iterator i, end;
+		int i = findItem( &ListIndex::deviceSpecific, mDeviceSpecific, ac,
+			false );
 
-		for ( i = mDeviceSpecific.begin( ), end = mDeviceSpecific.end( );
-			i != end; ++i )
+		if( i >= 0 )
 		{
-			if ( (*i)->ac == ac ) {
-				(*i)->setValue(val, lvl, __FILE__, __LINE__ );
-				return;
-			}
+			mDeviceSpecific[ i ]->setValue( val, lvl, __FILE__, __LINE__ );
+			return;
 		}
 
 		/* We didn't find the entry, so add it */
@@ -988,18 +837,16 @@ lderr:
 	void Component::addUserData( const string& ac, const string& humanName,
 		const string& val, int prefLvl = 1, bool clobber = false )
 	{
-		vector<DataItem*>::iterator i, end;
-		for( i = mUserData.begin( ), end = mUserData.end( ); i != end; ++i )
+		int i = findItem( &ListIndex::userData, mUserData, ac, false );
+		if( i >= 0 )
 		{
-			if( (*i)->ac == ac )
+			if( clobber )
 			{
-				if( clobber )
-				{
-					(*i)->dataValue = val;
-				}
-				return;
+				mUserData[ i ]->dataValue = val;
 			}
+			return;
 		}
+
 		DataItem *d = new DataItem( );
 		if( d == NULL )
 		{
@@ -1015,15 +862,9 @@ lderr:
 
 	void Component::addAIXName( const string& val, int prefLvl = 1 )
 	{
-		vector<DataItem*>::const_iterator j, stop;
-		j = getAIXNames().begin();
-		stop =getAIXNames().end();
-
-		/* Already present - remove */
-		for (;j != stop; j++) {
-			if (val == (*j)->getValue())
-				return;
-		}
+		/* Already present */
+		if( findItem( &ListIndex::aixNames, mAIXNames, val, true ) >= 0 )
+			return;
 
 		DataItem *d = new DataItem( );
 		if( d == NULL )
@@ -22,177 +22,74 @@
  ***************************************************************************/
 
 #include "libvpd-2/component.h"
+#include "tokenizer.h"
 
 #include <arpa/inet.h>
 #include <netinet/in.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 
+/*
+ * Where each packed dataitem is kept in struct component and the labels a
+ * new one starts with, in packed order.  n5 and n6 have no member and are
+ * always stepped over.
+ */
+#define COMP_NO_SLOT ((size_t)-1)
+struct comp_field_desc
+{
+	size_t slot;
+	const char *ac;
+	const char *humanName;
+};
+
+#define CSLOT( member ) offsetof( struct component, member )
+#define CNONE COMP_NO_SLOT
+#define COMP_FIELD_DESC( name, member, slot, ac, humanName ) \
+	{ slot, ac, humanName },
+static const struct comp_field_desc comp_fields[ COMP_FIELD_CHILDREN ] = {
+	VPD_COMPONENT_FIELDS( COMP_FIELD_DESC )
+};
+#undef COMP_FIELD_DESC
+#undef CNONE
+#undef CSLOT
+
 struct component* new_component( int init )
 {
 	struct component *ret;
+	struct dataitem **slot;
+	int i;
 
 	ret = calloc( 1, sizeof( struct component ) );
 	if( !ret )
 		return NULL;
+	ret->loaded = COMP_ALL_FIELDS;
 
 	if( init )
 	{
-		ret->id = new_dataitem( );
-		if( !ret->id )
-			goto outerr;
-		ret->id->humanName = strdup( "Main Device Node, equals sysFsNode or deviceTreeNode" );
-
-		ret->deviceTreeNode = new_dataitem( );
-		if( !ret->deviceTreeNode )
-			goto outerr;
-		ret->deviceTreeNode->humanName = strdup( "/proc/device-tree Device Node" );
-
-		ret->sysFsNode = new_dataitem( );
-		if( !ret->sysFsNode )
-			goto outerr;
-		ret->sysFsNode->humanName = strdup( "/sys Device Node" );
-
-		ret->sysFsLinkTarget = new_dataitem( );
-		if( !ret->sysFsLinkTarget )
-			goto outerr;
-		ret->sysFsLinkTarget->humanName = strdup( "/sys/bus Device Node" );
-
-		ret->devClass = new_dataitem( );
-		if( !ret->devClass )
-			goto outerr;
-		ret->devClass->humanName = strdup( "/sys/bus/XXX - Device Class" );
-
-		ret->fru = new_dataitem( );
-		if( !ret->fru )
-			goto outerr;
-		ret->fru->ac = strdup( "FN" );
-		ret->fru->humanName = strdup( "Field Replaceable Unit Number" );
-
-		ret->scsiDetail = new_dataitem( );
-		if( !ret->scsiDetail )
-			goto outerr;
-		ret->scsiDetail->ac = strdup( "ZZ" );
-		ret->scsiDetail->humanName = strdup( "Device Details" );
-
-		ret->plantMfg = new_dataitem( );
-		if( !ret->plantMfg )
-			goto outerr;
-		ret->plantMfg->ac = strdup( "SE" );
-		ret->plantMfg->humanName = strdup( "Plant of manufacture" );
-
-		ret->netAddr = new_dataitem( );
-		if( !ret->netAddr )
-			goto outerr;
-		ret->netAddr->ac = strdup( "NA" );
-		ret->netAddr->humanName = strdup( "Network Address" );
-
-		ret->description = new_dataitem( );
-		if( !ret->description )
-			goto outerr;
-		ret->description->ac = strdup( "DS" );
-		ret->description->humanName = strdup( "Displayable Message" );
-
-		ret->cdField = new_dataitem( );
-		if( !ret->cdField )
-			goto outerr;
-		ret->cdField->ac = strdup( "CD" );
-		ret->cdField->humanName = strdup( "Card ID" );
-
-		ret->serialNumber = new_dataitem( );
-		if( !ret->serialNumber )
-			goto outerr;
-		ret->serialNumber->ac = strdup( "SN" );
-		ret->serialNumber->humanName = strdup( "Serial Number" );
-
-		ret->partNumber = new_dataitem( );
-		if( !ret->partNumber )
-			goto outerr;
-		ret->partNumber->ac = strdup( "PN" );
-		ret->partNumber->humanName = strdup( "Part Number of Assembly" );
-
-		ret->firmwareLevel = new_dataitem( );
-		if( !ret->firmwareLevel )
-			goto outerr;
-		ret->firmwareLevel->ac = strdup( "RL" );
-		ret->firmwareLevel->humanName = strdup( "Non-alterable ROM level" );
-
-		ret->firmwareVersion = new_dataitem( );
-		if( !ret->firmwareVersion )
-			goto outerr;
-		ret->firmwareVersion->ac = strdup( "RM" );
-		ret->firmwareVersion->humanName = strdup( "Alterable ROM level" );
-
-		ret->manufacturer = new_dataitem( );
-		if( !ret->manufacturer )
-			goto outerr;
-		ret->manufacturer->ac = strdup( "MF" );
-		ret->manufacturer->humanName = strdup( "Manufacturer Name" );
-
-		ret->model = new_dataitem( );
-		if( !ret->model )
-			goto outerr;
-		ret->model->ac = strdup( "TM" );
-		ret->model->humanName = strdup( "Machine Type-Model" );
-
-		ret->manufacturerID = new_dataitem( );
-		if( !ret->manufacturerID )
-			goto outerr;
-		ret->manufacturerID->ac = strdup( "MN" );
-		ret->manufacturerID->humanName = strdup( "Manufacturer ID" );
-
-		ret->engChangeLevel = new_dataitem( );
-		if( !ret->engChangeLevel )
-			goto outerr;
-		ret->engChangeLevel->ac = strdup( "EC" );
-		ret->engChangeLevel->humanName = strdup( "Engineering Change Level" );
-
-		ret->featureCode = new_dataitem( );
-		if( !ret->featureCode )
-			goto outerr;
-		ret->featureCode->ac = strdup( "FC" );
-		ret->featureCode->humanName = strdup( "Feature Code or Request for Price Quotation (RPQ) number" );
-
-		ret->devDriver = new_dataitem( );
-		if( !ret->devDriver )
-			goto outerr;
-		ret->devDriver->ac = strdup( "DD" );
-		ret->devDriver->humanName = strdup( "Device Driver Level" );
-
-		ret->recordType = new_dataitem( );
-		if( !ret->recordType )
-			goto outerr;
-		ret->recordType->ac = strdup( "RT" );
-		ret->recordType->humanName = strdup( "Record Type" );
-
-		ret->keywordVersion = new_dataitem( );
-		if( !ret->keywordVersion )
-			goto outerr;
-		ret->keywordVersion->ac = strdup( "VK" );
-		ret->keywordVersion->humanName = strdup( "Keyword Version" );
-
-		ret->microCodeImage = new_dataitem( );
-		if( !ret->microCodeImage )
-			goto outerr;
-		ret->microCodeImage->ac = strdup( "MI" );
-		ret->microCodeImage->humanName = strdup( "Keyword Version" );
-
-		ret->physicalLocation = new_dataitem( );
-		if( !ret->physicalLocation )
-			goto outerr;
-		ret->physicalLocation->ac = strdup( "YL" );
-		ret->physicalLocation->humanName = strdup( "Location Code" );
-
-		ret->secondLocation = new_dataitem( );
-		if( !ret->secondLocation )
-			goto outerr;
-		ret->secondLocation->ac = strdup( "YL" );
-		ret->secondLocation->humanName = strdup( "Location Code" );
-
-		ret->devBus = new_dataitem( );
-		if( !ret->devBus )
-			goto outerr;
-		ret->devBus->humanName = strdup( "Device Bus" );
+		for( i = 0; i < COMP_FIELD_CHILDREN; i++ )
+		{
+			if( comp_fields[ i ].slot == COMP_NO_SLOT ||
+				( !*comp_fields[ i ].ac && !*comp_fields[ i ].humanName ) )
+				continue;
+
+			slot = (struct dataitem **)( (char*)ret + comp_fields[ i ].slot );
+			*slot = new_dataitem( );
+			if( !*slot )
+				goto outerr;
+			if( *comp_fields[ i ].ac )
+			{
+				(*slot)->ac = strdup( comp_fields[ i ].ac );
+				if( !(*slot)->ac )
+					goto outerr;
+			}
+			if( *comp_fields[ i ].humanName )
+			{
+				(*slot)->humanName = strdup( comp_fields[ i ].humanName );
+				if( !(*slot)->humanName )
+					goto outerr;
+			}
+		}
 	}
 
 	return ret;
@@ -260,316 +157,132 @@ void free_component( struct component *freeme )
 	free( freeme );
 }
 
+struct component * unpack_component( void *buffer )
+{
+	return unpack_component_fields( buffer, COMP_ALL_FIELDS );
+}
+
 /**
  * Code adapted from component.cpp, dataitems are unpacked in the same
  * order as the Component::unpack( void* ) method to maintain consistency.
+ * Fields that are not in the fields mask are stepped over without being
+ * copied and stay NULL.
  */
-struct component * unpack_component( void *buffer )
+struct component * unpack_component_fields( void *buffer, u64 fields )
+{
+	return unpack_component_arena( buffer, fields, NULL );
+}
+
+/*
+ * The buffer is split into tokens first (see tokenizer.h) and the
+ * component is built from them.  When arena is not NULL everything, the
+ * component included, is taken from it and nothing needs to be free'd on
+ * error.
+ */
+struct component * unpack_component_arena( void *buffer, u64 fields,
+		struct vpdarena *arena )
 {
 	struct component *ret = NULL;
 	u32 size = 0, netOrder;
 	char *packed = (char*)buffer;
-	char * next;
-	struct list *item;
-	struct dataitem *data;
+	const char *base;
+	struct vpdtoken stack[ TOKENIZER_STACK_TOKENS ], *tok = NULL;
+	struct list *item, **child;
+	struct dataitem **slot;
+	int i, t, count;
 
 	if( !buffer )
 		return ret;
 
-	ret = new_component( 0 );
+	if( arena )
+		ret = arena_alloc( arena, sizeof( struct component ) );
+	else
+		ret = new_component( 0 );
 	if( !ret )
 		return ret;
 
 	memcpy( &netOrder, packed, sizeof( u32 ) );
 	size = ntohl( netOrder );
-	next = packed + sizeof( u32 );
-
-	ret->id = unpack_dataitem( next );
-	if( !ret->id )
-		goto unpackerr;
-	next += calc_packed_length_dataitem( ret->id );
-
-	ret->deviceTreeNode = unpack_dataitem( next );
-	if( !ret->deviceTreeNode )
-		goto unpackerr;
-	next += calc_packed_length_dataitem( ret->deviceTreeNode );
-
-	ret->sysFsNode = unpack_dataitem( next );
-	if( !ret->sysFsNode )
-		goto unpackerr;
-	next += calc_packed_length_dataitem( ret->sysFsNode );
-
-	ret->sysFsLinkTarget = unpack_dataitem( next );
-	if( !ret->sysFsLinkTarget )
-		goto unpackerr;
-	next += calc_packed_length_dataitem( ret->sysFsLinkTarget );
-
-	ret->halUDI = unpack_dataitem( next );
-	if( !ret->halUDI )
-		goto unpackerr;
-	next += calc_packed_length_dataitem( ret->halUDI );
-
-	ret->netAddr = unpack_dataitem( next );
-	if( !ret->netAddr )
-		goto unpackerr;
-	next += calc_packed_length_dataitem( ret->netAddr );
-
-	ret->devClass = unpack_dataitem( next );
-	if( !ret->devClass )
-		goto unpackerr;
-	next += calc_packed_length_dataitem( ret->devClass );
-
-	ret->description = unpack_dataitem( next );
-	if( !ret->description )
-		goto unpackerr;
-	next += calc_packed_length_dataitem( ret->description );
-
-	ret->cdField = unpack_dataitem( next );
-	if( !ret->cdField )
-		goto unpackerr;
-	next += calc_packed_length_dataitem( ret->cdField );
-
-	ret->serialNumber = unpack_dataitem( next );
-	if( !ret->serialNumber )
-		goto unpackerr;
-	next += calc_packed_length_dataitem( ret->serialNumber );
-
-	ret->partNumber = unpack_dataitem( next );
-	if( !ret->partNumber )
-		goto unpackerr;
-	next += calc_packed_length_dataitem( ret->partNumber );
-
-	ret->firmwareLevel = unpack_dataitem( next );
-	if( !ret->firmwareLevel )
-		goto unpackerr;
-	next += calc_packed_length_dataitem( ret->firmwareLevel );
-
-	ret->firmwareVersion = unpack_dataitem( next );
-	if( !ret->firmwareVersion )
-		goto unpackerr;
-	next += calc_packed_length_dataitem( ret->firmwareVersion );
-
-	ret->fru = unpack_dataitem( next );
-	if( !ret->fru )
-		goto unpackerr;
-	next += calc_packed_length_dataitem( ret->fru );
-
-	ret->manufacturer = unpack_dataitem( next );
-	if( !ret->manufacturer )
-		goto unpackerr;
-	next += calc_packed_length_dataitem( ret->manufacturer );
-
-	ret->model = unpack_dataitem( next );
-	if( !ret->model )
-		goto unpackerr;
-	next += calc_packed_length_dataitem( ret->model );
-
-	ret->manufacturerID = unpack_dataitem( next );
-	if( !ret->manufacturerID )
-		goto unpackerr;
-	next += calc_packed_length_dataitem( ret->manufacturerID );
-
-	ret->engChangeLevel = unpack_dataitem( next );
-	if( !ret->engChangeLevel )
-		goto unpackerr;
-	next += calc_packed_length_dataitem( ret->engChangeLevel );
-
-	ret->parent = unpack_dataitem( next );
-	if( !ret->parent )
-		goto unpackerr;
-	next += calc_packed_length_dataitem( ret->parent );
-
-	ret->devSubSystem = unpack_dataitem( next );
-	if( !ret->devSubSystem )
-		goto unpackerr;
-	next += calc_packed_length_dataitem( ret->devSubSystem );
-
-	ret->devDriver = unpack_dataitem( next );
-	if( !ret->devDriver )
-		goto unpackerr;
-	next += calc_packed_length_dataitem( ret->devDriver );
-
-	ret->devKernel = unpack_dataitem( next );
-	if( !ret->devKernel )
-		goto unpackerr;
-	next += calc_packed_length_dataitem( ret->devKernel );
-
-	ret->devKernelNumber = unpack_dataitem( next );
-	if( !ret->devKernelNumber )
-		goto unpackerr;
-	next += calc_packed_length_dataitem( ret->devKernelNumber );
-
-	ret->devSysName = unpack_dataitem( next );
-	if( !ret->devSysName )
-		goto unpackerr;
-	next += calc_packed_length_dataitem( ret->devSysName );
-
-	ret->devDevTreeName = unpack_dataitem( next );
-	if( !ret->devDevTreeName )
-		goto unpackerr;
-	next += calc_packed_length_dataitem( ret->devDevTreeName );
-
-	ret->devBus = unpack_dataitem( next );
-	if( !ret->devBus )
-		goto unpackerr;
-	next += calc_packed_length_dataitem( ret->devBus );
-
-	ret->devBusAddr = unpack_dataitem( next );
-	if( !ret->devBusAddr )
-		goto unpackerr;
-	next += calc_packed_length_dataitem( ret->devBusAddr );
-
-	ret->recordType = unpack_dataitem( next );
-	if( !ret->recordType )
-		goto unpackerr;
-	next += calc_packed_length_dataitem( ret->recordType );
-
-	ret->scsiDetail = unpack_dataitem( next );
-	if( !ret->scsiDetail )
-		goto unpackerr;
-	next += calc_packed_length_dataitem( ret->scsiDetail );
-
-	ret->plantMfg = unpack_dataitem( next );
-	if( !ret->plantMfg )
-		goto unpackerr;
-	next += calc_packed_length_dataitem( ret->plantMfg );
-
-	ret->featureCode = unpack_dataitem( next );
-	if( !ret->featureCode )
-		goto unpackerr;
-	next += calc_packed_length_dataitem( ret->featureCode );
-
-	ret->keywordVersion = unpack_dataitem( next );
-	if( !ret->keywordVersion )
+	ret->loaded = fields & COMP_ALL_FIELDS;
+	if( size < sizeof( u32 ) )
 		goto unpackerr;
-	next += calc_packed_length_dataitem( ret->keywordVersion );
 
-	ret->microCodeImage = unpack_dataitem( next );
-	if( !ret->microCodeImage )
+	base = packed + sizeof( u32 );
+	tok = tokenize( base, size - sizeof( u32 ), stack, TOKENIZER_STACK_TOKENS,
+			&count );
+	if( !tok || count < COMP_FIELD_CHILDREN * 3 )
 		goto unpackerr;
-	next += calc_packed_length_dataitem( ret->microCodeImage );
 
-	ret->secondLocation = unpack_dataitem( next );
-	if( !ret->secondLocation )
-		goto unpackerr;
-	next += calc_packed_length_dataitem( ret->secondLocation );
-
-	ret->physicalLocation = unpack_dataitem( next );
-	if( !ret->physicalLocation )
-		goto unpackerr;
-	next += calc_packed_length_dataitem( ret->physicalLocation );
-
-	while( 0 == strncmp( next, CHILD_START, strlen( CHILD_START ) ) )
+	for( i = 0, t = 0; i < COMP_FIELD_CHILDREN; i++, t += 3 )
 	{
-		next++;
-		if( next > packed + size )
+		if( comp_fields[ i ].slot == COMP_NO_SLOT ||
+			!( fields & COMP_FIELD_BIT( i ) ) )
+			continue;
+
+		slot = (struct dataitem **)( (char*)ret + comp_fields[ i ].slot );
+		*slot = token_dataitem( base, &tok[ t ], arena );
+		if( !*slot )
 			goto unpackerr;
 	}
 
-	if( strncmp( next, CHILD_START, strlen( CHILD_START ) ) == 0 )
+	while( t < count && !token_equals( base, &tok[ t ], CHILD_START,
+			strlen( CHILD_START ) ) )
+		t++;
+
+	child = &ret->childrenIDs;
+	for( t++; t < count && !token_equals( base, &tok[ t ], CHILD_END,
+			strlen( CHILD_END ) ); t++ )
 	{
-		next += strlen( CHILD_START ) + 1;
-		if( next > packed + size )
-			goto unpackerr;
+		if( tok[ t ].length == 0 ||
+			!( fields & COMP_FIELD_BIT( COMP_FIELD_CHILDREN ) ) )
+			continue;
 
-		while( strncmp( next, CHILD_END, strlen( CHILD_END ) ) != 0 )
-		{
+		if( arena )
+			item = arena_alloc( arena, sizeof( struct list ) );
+		else
 			item = new_list( );
-			if( !item )
-				goto unpackerr;
-			item->data = strdup( next );
-			if (item->data == NULL)
-				goto unpackerr;
-			next += strlen( (char*)item->data ) + 1;
-			if( !ret->childrenIDs )
-				ret->childrenIDs = item;
-			else
-				concat_list( ret->childrenIDs, item );
-
-			if( next > packed + size )
-				goto unpackerr;
-		}
-
-		next += strlen( CHILD_END ) + 1;
-	}
-
-	if( strncmp( next, DEVICE_START, strlen( DEVICE_START ) ) == 0 )
-	{
-		next += strlen( DEVICE_START ) + 1;
-		if( next > packed + size )
+		if( !item )
 			goto unpackerr;
-
-		while( strncmp( next, DEVICE_END, strlen( DEVICE_END ) ) != 0 )
-		{
-			data = unpack_dataitem( next );
-			if( !data )
-				goto unpackerr;
-
-			next += calc_packed_length_dataitem( data );
-			if( !ret->deviceSpecific )
-				ret->deviceSpecific = data;
-			else
-				add_dataitem( ret->deviceSpecific, data );
-
-			if( next > packed + size )
-				goto unpackerr;
-		}
-
-		next += strlen( DEVICE_END ) + 1;
-	}
-
-	if( strncmp( next, USER_START, strlen( USER_START ) ) == 0 )
-	{
-		next += strlen( USER_START ) + 1;
-		if( next > packed + size )
+		*child = item;
+		child = &item->next;
+		item->data = token_strdup( base, &tok[ t ], arena );
+		if( item->data == NULL )
 			goto unpackerr;
-
-		while( strncmp( next, USER_END, strlen( USER_END ) ) != 0 )
-		{
-			data = unpack_dataitem( next );
-			if( !data )
-				goto unpackerr;
-
-			next += calc_packed_length_dataitem( data );
-			if( !ret->userData )
-				ret->userData = data;
-			else
-				add_dataitem( ret->userData, data );
-
-			if( next > packed + size )
-				goto unpackerr;
-		}
-
-		next += strlen( USER_END ) + 1;
 	}
+	if( t >= count )
+		goto unpackerr;
+	t++;
 
-	if( strncmp( next, AX_START, strlen( AX_START ) ) == 0 )
-	{
-		next += strlen( AX_START ) + 1;
-		if( next > packed + size )
-			goto unpackerr;
+	if( t < count && token_equals( base, &tok[ t ], DEVICE_START,
+			strlen( DEVICE_START ) ) &&
+		token_dataitem_list( base, tok, count, &t, DEVICE_END,
+			( fields & COMP_FIELD_BIT( COMP_FIELD_DEVICE_SPECIFIC ) ) ?
+			&ret->deviceSpecific : NULL, arena ) )
+		goto unpackerr;
 
-		while( strncmp( next, AX_END, strlen( AX_END ) ) != 0 )
-		{
-			data = unpack_dataitem( next );
-			if( !data )
-				goto unpackerr;
-
-			next += calc_packed_length_dataitem( data );
-			if( !ret->aixNames )
-				ret->aixNames = data;
-			else
-				add_dataitem( ret->aixNames, data );
-
-			if( next > packed + size )
-				goto unpackerr;
-		}
-	}
+	if( t < count && token_equals( base, &tok[ t ], USER_START,
+			strlen( USER_START ) ) &&
+		token_dataitem_list( base, tok, count, &t, USER_END,
+			( fields & COMP_FIELD_BIT( COMP_FIELD_USER_DATA ) ) ?
+			&ret->userData : NULL, arena ) )
+		goto unpackerr;
 
+	if( t < count && token_equals( base, &tok[ t ], AX_START,
+			strlen( AX_START ) ) &&
+		token_dataitem_list( base, tok, count, &t, AX_END,
+			( fields & COMP_FIELD_BIT( COMP_FIELD_AIX_NAMES ) ) ?
+			&ret->aixNames : NULL, arena ) )
+		goto unpackerr;
+
+	if( tok != stack )
+		free( tok );
 	return ret;
 
 unpackerr:
-	free_component( ret );
+	if( tok && tok != stack )
+		free( tok );
+	if( !arena )
+		free_component( ret );
 	return NULL;
 }
 
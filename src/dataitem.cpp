@@ -29,42 +29,107 @@
 #include <libvpd-2/dataitem.hpp>
 #include <libvpd-2/debug.hpp>
 
-#include <cstring> // for memcpy
-#include <ctype.h> // for isspace
+#include <cstring> // for memcpy and memchr
+#include <stdint.h>
+
+#if defined( __SSE2__ )
+#include <emmintrin.h>
+#endif
 
 using namespace std;
 
 namespace lsvpd
 {
+	const vector<Source*> DataItem::NO_SOURCES;
+
 	DataItem::DataItem( const DataItem& copyMe ) : humanName( copyMe.humanName ),
 		ac( copyMe.ac ), dataValue( copyMe.dataValue ),
-		packedLength( 0 ), prefLevelUsed(copyMe.prefLevelUsed)
-	{}
+		packedLength( 0 ), prefLevelUsed(copyMe.prefLevelUsed),
+		mpSources( NULL )
+	{
+		vector<Source*>::const_iterator i, end;
+		for( i = copyMe.getSources( ).begin( ),
+			end = copyMe.getSources( ).end( ); i != end; ++i )
+		{
+			addSource( new Source( **i ) );
+		}
+	}
 
-	DataItem::DataItem( ) : dataValue( "" ), packedLength( 0 )
+	DataItem::DataItem( DataItem&& moveMe ) noexcept :
+		humanName( std::move( moveMe.humanName ) ),
+		ac( std::move( moveMe.ac ) ),
+		dataValue( std::move( moveMe.dataValue ) ),
+		packedLength( moveMe.packedLength ),
+		prefLevelUsed( moveMe.prefLevelUsed ), mpSources( moveMe.mpSources )
+	{
+		moveMe.mpSources = NULL;
+		moveMe.packedLength = 0;
+		moveMe.prefLevelUsed = 0;
+	}
+
+	DataItem& DataItem::operator=( const DataItem& rhs )
+	{
+		if( this != &rhs )
+		{
+			DataItem copy( rhs );
+			*this = std::move( copy );
+		}
+		return *this;
+	}
+
+	DataItem& DataItem::operator=( DataItem&& rhs ) noexcept
+	{
+		if( this != &rhs )
+		{
+			deleteSources( );
+			humanName = std::move( rhs.humanName );
+			ac = std::move( rhs.ac );
+			dataValue = std::move( rhs.dataValue );
+			packedLength = rhs.packedLength;
+			prefLevelUsed = rhs.prefLevelUsed;
+			mpSources = rhs.mpSources;
+			rhs.mpSources = NULL;
+			rhs.packedLength = 0;
+			rhs.prefLevelUsed = 0;
+		}
+		return *this;
+	}
+
+	DataItem::DataItem( ) : dataValue( "" ), packedLength( 0 ),
+		mpSources( NULL )
 	{
 		prefLevelUsed = 0;
 	}
 
 	DataItem::~DataItem( )
 	{
+		deleteSources( );
+	}
+
+	void DataItem::deleteSources( )
+	{
+		if( mpSources == NULL )
+			return;
+
 		vector<Source*>::iterator i, end;
-		for( i = sources.begin( ), end = sources.end( ); i != end; ++i )
+		for( i = mpSources->begin( ), end = mpSources->end( ); i != end; ++i )
 		{
 			Source* s = *i;
 			delete s;
 		}
+		delete mpSources;
+		mpSources = NULL;
 	}
 
 	int DataItem::getNumSources() const
 	{
-		return sources.size();
+		return mpSources ? mpSources->size() : 0;
 	}
 
 	Source * DataItem::getSource(int i) const
 	{
-		if (i < getNumSources() || i == 0) {
-			return sources[i];
+		if (i < getNumSources()) {
+			return (*mpSources)[i];
 		}
 		else {
 			return NULL;
@@ -73,17 +138,20 @@ namespace lsvpd
 
 	void DataItem::addSource(Source *in)
 	{
+		if( mpSources == NULL )
+			mpSources = new vector<Source*>( );
+
 		vector<Source*>::iterator i, end;
-		for( i = sources.begin( ), end = sources.end( ); i != end; ++i )
+		for( i = mpSources->begin( ), end = mpSources->end( ); i != end; ++i )
 		{
 			if( (*i)->getPrefLvl( ) < in->getPrefLvl( ) )
 			{
-				sources.insert( i, in );
+				mpSources->insert( i, in );
 				return;
 			}
 		}
 
-		sources.push_back( in );
+		mpSources->push_back( in );
 	}
 
 	void DataItem::removeSource(int i)
@@ -91,12 +159,15 @@ namespace lsvpd
 		vector<Source*>::iterator cur, end;
 		int j = 0;
 
-		for( cur = sources.begin( ), end = sources.end( ); cur != end; ++cur, j++ )
+		if( mpSources == NULL )
+			return;
+
+		for( cur = mpSources->begin( ), end = mpSources->end( ); cur != end; ++cur, j++ )
 		{
 			if( j == i )
 			{
 				Source * s = *cur;
-				sources.erase( cur );
+				mpSources->erase( cur );
 				delete s;
 				return;
 			}
@@ -105,7 +176,7 @@ namespace lsvpd
 
 	const string& DataItem::getHumanName( ) const
 	{
-		return humanName;
+		return humanName.str( );
 	}
 
 	void DataItem::setHumanName( const string& in )
@@ -116,7 +187,7 @@ namespace lsvpd
 
 	const string& DataItem::getAC( ) const
 	{
-		return ac;
+		return ac.str( );
 	}
 
 	void DataItem::setAC( const string& in )
@@ -130,29 +201,169 @@ namespace lsvpd
 		return dataValue;
 	}
 
-	int DataItem::setValue( const string& in, int prefLevelUsed_t,
-									 const char *file, int lineNum)
+	/*
+	 * The bytes setValue drops wherever they are.
+	 */
+	static inline bool isDropped( unsigned char c )
 	{
-		int i;
+		return c == '\0' || c == '\n' || c == '\r';
+	}
 
-		if ((prefLevelUsed_t > prefLevelUsed) && (!in.empty()))
+	/*
+	 * The bytes setValue trims from either end: the dropped bytes and the
+	 * ASCII whitespace of the C locale.  Bytes above 0x7f are never
+	 * whitespace, whatever the locale, so UTF-8 and binary values keep
+	 * them untouched.
+	 */
+	static inline bool isTrimmed( unsigned char c )
+	{
+		return c == ' ' || ( c >= '\t' && c <= '\r' ) || c == '\0';
+	}
+
+	/*
+	 * Returns the offset of the first dropped byte in buf[ 0, len ), or len
+	 * if there is none.  With SSE2 the scan looks at 64 bytes per step and
+	 * narrows down to 16 once it sees a hit; elsewhere it checks 8 bytes at
+	 * a time in a 64 bit word.
+	 */
+	static size_t findDropped( const char* buf, size_t len )
+	{
+		size_t i = 0;
+
+#if defined( __SSE2__ )
+		const __m128i nul = _mm_setzero_si128( );
+		const __m128i lf = _mm_set1_epi8( '\n' );
+		const __m128i cr = _mm_set1_epi8( '\r' );
+
+		for( ; i + 64 <= len; i += 64 )
 		{
-			string val( in );
-			// Get rid of any NULL bytes, new lines or carriage returns
-			i = 0;
-			int pos;
-			while( ( pos = val.find( '\0' ) ) != (int)string::npos ||
-				( pos = val.find( '\n' ) ) != (int)string::npos ||
-				( pos = val.find( '\r' ) ) != (int)string::npos )
+			__m128i hit = _mm_setzero_si128( );
+			for( int k = 0; k < 64; k += 16 )
 			{
-				val.erase( pos, 1 );
+				__m128i v = _mm_loadu_si128( (const __m128i*)( buf + i + k ) );
+				hit = _mm_or_si128( hit, _mm_or_si128( _mm_cmpeq_epi8( v, nul ),
+					_mm_or_si128( _mm_cmpeq_epi8( v, lf ),
+						_mm_cmpeq_epi8( v, cr ) ) ) );
 			}
+			if( _mm_movemask_epi8( hit ) != 0 )
+				break;
+		}
 
-			// Get rid of leading and trailing whitespace
-			for (; val.length( ) > 0 && isspace( val.at( 0 ) ); val.erase( 0, 1 ));
+		for( ; i + 16 <= len; i += 16 )
+		{
+			__m128i v = _mm_loadu_si128( (const __m128i*)( buf + i ) );
+			__m128i hit = _mm_or_si128( _mm_cmpeq_epi8( v, nul ),
+				_mm_or_si128( _mm_cmpeq_epi8( v, lf ),
+					_mm_cmpeq_epi8( v, cr ) ) );
+			int mask = _mm_movemask_epi8( hit );
+			if( mask != 0 )
+				return i + __builtin_ctz( mask );
+		}
+#else
+		const uint64_t ones = 0x0101010101010101ULL;
+		const uint64_t highs = 0x8080808080808080ULL;
 
-			for( i = val.length( ) - 1; i >= 0 && isspace( val.at( i ) ); i-- )
-				val.erase( i, 1 );
+		for( ; i + 8 <= len; i += 8 )
+		{
+			uint64_t v, lf, cr;
+			memcpy( &v, buf + i, sizeof( v ) );
+			lf = v ^ ( ones * '\n' );
+			cr = v ^ ( ones * '\r' );
+			if( ( ( ( v - ones ) & ~v ) | ( ( lf - ones ) & ~lf ) |
+					( ( cr - ones ) & ~cr ) ) & highs )
+				break;
+		}
+#endif
+
+		for( ; i < len; i++ )
+		{
+			if( isDropped( buf[ i ] ) )
+				return i;
+		}
+		return len;
+	}
+
+	/*
+	 * Values at least this long are checked with memchr before the scan
+	 * above, see findFirstDropped.
+	 */
+	static const size_t MEMCHR_SCAN_MIN = 256;
+
+	/*
+	 * Like findDropped, for the first look at a whole value.  Most long
+	 * values have nothing to drop, and for those three passes of the C
+	 * library's memchr, which can use wider vectors than this file is
+	 * built for, beat one pass of findDropped.  Each pass only looks as far
+	 * as the earliest hit so far.
+	 */
+	static size_t findFirstDropped( const char* buf, size_t len )
+	{
+		const char drop[ ] = { '\n', '\r', '\0' };
+		size_t first = len;
+
+		if( len < MEMCHR_SCAN_MIN )
+			return findDropped( buf, len );
+
+		for( size_t k = 0; k < sizeof( drop ); k++ )
+		{
+			const char* hit = (const char*)memchr( buf, drop[ k ], first );
+			if( hit != NULL )
+				first = hit - buf;
+		}
+		return first;
+	}
+
+	/*
+	 * Sets out to in with every NUL, LF and CR removed and the whitespace
+	 * left at either end trimmed off.  A value with nothing to drop is
+	 * copied whole, otherwise the clean runs between the dropped bytes are
+	 * appended one by one.  out keeps its buffer when it is large enough.
+	 */
+	static void sanitize( const string& in, string& out )
+	{
+		if( &in == &out )
+		{
+			string copy( in );
+			sanitize( copy, out );
+			return;
+		}
+
+		const char* begin = in.data( );
+		const char* end = begin + in.length( );
+
+		while( begin < end && isTrimmed( *begin ) )
+			begin++;
+		while( end > begin && isTrimmed( end[ -1 ] ) )
+			end--;
+
+		size_t len = end - begin;
+		size_t next = findFirstDropped( begin, len );
+		if( next == len )
+		{
+			out.assign( begin, len );
+			return;
+		}
+
+		out.clear( );
+		out.reserve( len );
+		while( next < len )
+		{
+			out.append( begin, next );
+			begin += next + 1;
+			len -= next + 1;
+			next = findDropped( begin, len );
+		}
+		out.append( begin, len );
+	}
+
+	int DataItem::setValue( const string& in, int prefLevelUsed_t,
+									 const char *file, int lineNum)
+	{
+		if ((prefLevelUsed_t > prefLevelUsed) && (!in.empty()))
+		{
+			// Get rid of any NULL bytes, new lines or carriage returns
+			// and of leading and trailing whitespace
+			sanitize( in, dataValue );
 
 			/*
 			if (ac == "AX") {
@@ -178,7 +389,6 @@ namespace lsvpd
 				coutd << "DataVal Set!  New Val: '" << val << "'" << endl;
 			}
 			*/
-			dataValue = val;
 			packedLength = 0;
 			prefLevelUsed = prefLevelUsed_t;
 			return 0;
@@ -251,13 +461,39 @@ namespace lsvpd
 	void DataItem::unpack( const void * data )
 	{
 		char * buf = (char*) data;
-		ac = buf;
-		buf += ( ac.length( ) + 1 );
-		humanName = buf;
-		buf += ( humanName.length( ) + 1 );
+		size_t len;
+
+		packedLength = 0;
+		len = strlen( buf );
+		ac.assign( buf, len );
+		buf += len + 1;
+		len = strlen( buf );
+		humanName.assign( buf, len );
+		buf += len + 1;
 		dataValue = buf;
 	}
 
+	void DataItem::unpack( const char* acp, size_t acLen, const char* name,
+		size_t nameLen, const char* value, size_t valueLen )
+	{
+		packedLength = 0;
+		ac.assign( acp, acLen );
+		humanName.assign( name, nameLen );
+		dataValue.assign( value, valueLen );
+	}
+
+	/**
+	 * Empties the labels and value, used by Component::unpack for the fields
+	 * that were not asked for.
+	 */
+	void DataItem::clear( )
+	{
+		ac.clear( );
+		humanName.clear( );
+		dataValue.clear( );
+		packedLength = 0;
+	}
+
 	/*
 	 * Prints this DataItem to the ostream in a meaningful way.
 	 */
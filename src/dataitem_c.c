@@ -22,6 +22,8 @@
  ***************************************************************************/
 
 #include "libvpd-2/dataitem.h"
+#include "libvpd-2/common.h"
+#include "tokenizer.h"
 
 #include <string.h>
 #include <ctype.h>
@@ -108,3 +110,85 @@ void add_dataitem( struct dataitem *head, const struct dataitem *addme )
 		head = head->next;
 	head->next = (struct dataitem *) addme;
 }
+
+char * token_strdup( const char *buf, const struct vpdtoken *tok,
+		struct vpdarena *arena )
+{
+	char *ret;
+
+	if( arena )
+		ret = arena_alloc_text( arena, tok->length + 1 );
+	else
+		ret = malloc( tok->length + 1 );
+	if( !ret )
+		return NULL;
+
+	memcpy( ret, buf + tok->offset, tok->length );
+	ret[ tok->length ] = '\0';
+	return ret;
+}
+
+struct dataitem * token_dataitem( const char *buf, const struct vpdtoken *tok,
+		struct vpdarena *arena )
+{
+	struct dataitem *ret;
+
+	if( arena )
+		ret = arena_alloc( arena, sizeof( struct dataitem ) );
+	else
+		ret = new_dataitem( );
+	if( !ret )
+		return NULL;
+
+	ret->ac = token_strdup( buf, &tok[ 0 ], arena );
+	if( !ret->ac )
+		goto tokenerr;
+
+	ret->humanName = token_strdup( buf, &tok[ 1 ], arena );
+	if( !ret->humanName )
+		goto tokenerr;
+
+	ret->dataValue = token_strdup( buf, &tok[ 2 ], arena );
+	if( !ret->dataValue )
+		goto tokenerr;
+
+	return ret;
+
+tokenerr:
+	if( !arena )
+		free_dataitem( ret );
+	return NULL;
+}
+
+int token_dataitem_list( const char *buf, const struct vpdtoken *tok,
+		int count, int *t, const char *endMarker, struct dataitem **head,
+		struct vpdarena *arena )
+{
+	struct dataitem *data, **tail = head;
+	size_t markerLen = strlen( endMarker );
+	int i = *t + 1;
+
+	while( tail && *tail )
+		tail = &( *tail )->next;
+
+	while( i < count && !token_equals( buf, &tok[ i ], endMarker, markerLen ) )
+	{
+		if( i + 3 > count )
+			return 1;
+
+		if( tail )
+		{
+			data = token_dataitem( buf, &tok[ i ], arena );
+			if( !data )
+				return 1;
+			*tail = data;
+			tail = &data->next;
+		}
+		i += 3;
+	}
+
+	if( i >= count )
+		return 1;
+	*t = i + 1;
+	return 0;
+}
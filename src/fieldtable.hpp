@@ -0,0 +1,201 @@
+/***************************************************************************
+ *   Copyright (C) 2006, IBM                                               *
+ *                                                                         *
+ *   Maintained By:                                                        *
+ *   Eric Munson and Brad Peters                                           *
+ *   munsone@us.ibm.com, bpeters@us.ibm.com                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the Lesser GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of the  *
+ *   License, or at your option) any later version.                        *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Lesser General Public License for more details.                   *
+ *                                                                         *
+ *   You should have received a copy of the Lesser GNU General Public      *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef LSVPDFIELDTABLE_HPP
+#define LSVPDFIELDTABLE_HPP
+
+#include <libvpd-2/dataitem.hpp>
+#include <libvpd-2/lsvpd.hpp>
+#include "tokenizer.h"
+
+#include <cstddef>
+#include <utility>
+
+namespace lsvpd
+{
+	/**
+	 * FieldTable holds the loops over the single DataItems of a Component
+	 * or a System.  Each is driven by the class's FIELDS table (generated
+	 * from fields.h), so packing, unpacking, sizing, copying and comparing
+	 * always visit the same fields in the same order.  The tables are
+	 * constant and their length is part of their type, which leaves the
+	 * compiler free to unroll these loops.
+	 *
+	 * A table entry D has an id (the Field of the entry), ac and humanName
+	 * (the default labels) and member (the DataItem it describes).
+	 */
+	class FieldTable
+	{
+		public:
+			/**
+			 * Gives each DataItem of obj the default labels of its field.
+			 */
+			template<class T, class D, size_t N>
+			static inline void init( T& obj, const D (&fields)[ N ] )
+			{
+				for( size_t i = 0; i < N; i++ )
+				{
+					DataItem& d = obj.*fields[ i ].member;
+					if( *fields[ i ].ac )
+						d.ac = fields[ i ].ac;
+					if( *fields[ i ].humanName )
+						d.humanName = fields[ i ].humanName;
+				}
+			}
+
+			/**
+			 * The number of bytes pack needs for the DataItems of obj.
+			 */
+			template<class T, class D, size_t N>
+			static inline unsigned int packedSize( T& obj,
+				const D (&fields)[ N ] )
+			{
+				unsigned int ret = 0;
+				for( size_t i = 0; i < N; i++ )
+					ret += ( obj.*fields[ i ].member ).getPackedLength( );
+				return ret;
+			}
+
+			/**
+			 * Packs the DataItems of obj into buf, which must have room for
+			 * packedSize( obj, fields ) bytes.
+			 *
+			 * @return
+			 *   The end of what was written.
+			 */
+			template<class T, class D, size_t N>
+			static inline char* pack( T& obj, const D (&fields)[ N ],
+				char* buf )
+			{
+				for( size_t i = 0; i < N; i++ )
+					buf += ( obj.*fields[ i ].member ).pack( buf );
+				return buf;
+			}
+
+			/**
+			 * Fills the DataItems of obj from the first N * 3 tokens of a
+			 * packed buffer.  The DataItems whose field is not in mask are
+			 * cleared.
+			 */
+			template<class T, class D, size_t N>
+			static inline void unpack( T& obj, const D (&fields)[ N ],
+				const char* base, const struct vpdtoken* tok, u64 mask )
+			{
+				for( size_t i = 0; i < N; i++, tok += 3 )
+				{
+					DataItem& d = obj.*fields[ i ].member;
+					if( mask & ( (u64)1 << fields[ i ].id ) )
+						d.unpack( base + tok[ 0 ].offset, tok[ 0 ].length,
+							base + tok[ 1 ].offset, tok[ 1 ].length,
+							base + tok[ 2 ].offset, tok[ 2 ].length );
+					else
+						d.clear( );
+				}
+			}
+
+			/**
+			 * Copies the DataItems of from into to.
+			 */
+			template<class T, class D, size_t N>
+			static inline void copy( T& to, const T& from,
+				const D (&fields)[ N ] )
+			{
+				for( size_t i = 0; i < N; i++ )
+					to.*fields[ i ].member = from.*fields[ i ].member;
+			}
+
+			/**
+			 * Moves the DataItems of from into to.
+			 */
+			template<class T, class D, size_t N>
+			static inline void move( T& to, T& from, const D (&fields)[ N ] )
+			{
+				for( size_t i = 0; i < N; i++ )
+					to.*fields[ i ].member = std::move( from.*fields[ i ].member );
+			}
+
+			/**
+			 * Compares the DataItems of a and b the way pack would see them.
+			 *
+			 * @return
+			 *   A mask with the bit set for each field whose AC, human name or
+			 * value differs.
+			 */
+			template<class T, class D, size_t N>
+			static inline u64 diff( const T& a, const T& b,
+				const D (&fields)[ N ] )
+			{
+				u64 ret = 0;
+				for( size_t i = 0; i < N; i++ )
+				{
+					const DataItem& x = a.*fields[ i ].member;
+					const DataItem& y = b.*fields[ i ].member;
+					if( x.ac != y.ac || x.humanName != y.humanName ||
+						x.getValue( ) != y.getValue( ) )
+						ret |= (u64)1 << fields[ i ].id;
+				}
+				return ret;
+			}
+
+			/**
+			 * Folds len bytes of data into the FNV-1a hash h.
+			 */
+			static inline u64 hash( const char* data, size_t len, u64 h )
+			{
+				for( size_t i = 0; i < len; i++ )
+				{
+					h ^= (unsigned char)data[ i ];
+					h *= 0x100000001b3ULL;
+				}
+				// Stands in for the NUL that ends each string when packed.
+				h ^= 0xff;
+				return h * 0x100000001b3ULL;
+			}
+
+			static inline u64 hash( const string& s, u64 h )
+			{
+				return hash( s.data( ), s.length( ), h );
+			}
+
+			static inline u64 hash( const DataItem& d, u64 h )
+			{
+				h = hash( d.ac.str( ), h );
+				h = hash( d.humanName.str( ), h );
+				return hash( d.getValue( ), h );
+			}
+
+			/**
+			 * Folds the DataItems of obj into h.
+			 */
+			template<class T, class D, size_t N>
+			static inline u64 hash( const T& obj, const D (&fields)[ N ],
+				u64 h )
+			{
+				for( size_t i = 0; i < N; i++ )
+					h = hash( obj.*fields[ i ].member, h );
+				return h;
+			}
+	};
+}
+
+#endif /*LSVPDFIELDTABLE_HPP*/
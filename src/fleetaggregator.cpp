@@ -0,0 +1,700 @@
+/***************************************************************************
+ *   Copyright (C) 2006, IBM                                               *
+ *                                                                         *
+ *   Maintained By:                                                        *
+ *   Eric Munson and Brad Peters                                           *
+ *   munsone@us.ibm.com, bpeters@us.ibm.com                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the Lesser GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of the  *
+ *   License, or at your option) any later version.                        *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Lesser General Public License for more details.                   *
+ *                                                                         *
+ *   You should have received a copy of the Lesser GNU General Public      *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <libvpd-2/fleetaggregator.hpp>
+#include <libvpd-2/logger.hpp>
+#include <libvpd-2/system.hpp>
+#include <libvpd-2/vpddbenv.hpp>
+#include "fieldtable.hpp"
+
+#include <sstream>
+#include <fstream>
+#include <cstring>
+#include <ctime>
+#include <exception>
+#include <map>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+namespace lsvpd
+{
+	/*
+	 * One row read from a source, with the fields inventory keeps already
+	 * decoded.
+	 */
+	struct FleetRow
+	{
+		bool removed;
+		string id;
+		string data;
+		u64 hash;
+		string serial;
+		string partNumber;
+		string fru;
+		string location;
+		string firmware;
+	};
+
+	// Everything read from one source.
+	struct FleetHost
+	{
+		size_t source;
+		bool full;
+		bool ok;
+		string machineType;
+		string serial;
+		vector<FleetRow> rows;
+	};
+
+	static const Component::FieldMask INVENTORY_FIELDS =
+		Component::fieldMask( Component::FIELD_SERIAL_NUMBER ) |
+		Component::fieldMask( Component::FIELD_PART_NUMBER ) |
+		Component::fieldMask( Component::FIELD_FRU ) |
+		Component::fieldMask( Component::FIELD_PHYSICAL_LOCATION ) |
+		Component::fieldMask( Component::FIELD_FIRMWARE_LEVEL );
+
+	static const char SQLITE_MAGIC[ 16 ] = "SQLite format 3";
+
+	/*
+	 * Hands what the reading threads produce to the writer in source order.
+	 * A reader may only start on a source once the writer is less than
+	 * limit sources behind it, which bounds the memory held.
+	 */
+	class IngestWindow
+	{
+		private:
+			mutex mLock;
+			condition_variable mChanged;
+			map<size_t, FleetHost*> mReady;
+			size_t mTaken;
+			size_t mLimit;
+			bool mAborted;
+
+		public:
+			IngestWindow( size_t limit ) : mTaken( 0 ), mLimit( limit ),
+				mAborted( false ) { }
+
+			~IngestWindow( )
+			{
+				map<size_t, FleetHost*>::iterator i;
+				for( i = mReady.begin( ); i != mReady.end( ); ++i )
+					delete i->second;
+			}
+
+			bool reserve( size_t source )
+			{
+				unique_lock<mutex> guard( mLock );
+				while( !mAborted && source >= mTaken + mLimit )
+					mChanged.wait( guard );
+				return !mAborted;
+			}
+
+			void put( FleetHost* host )
+			{
+				lock_guard<mutex> guard( mLock );
+				mReady[ host->source ] = host;
+				mChanged.notify_all( );
+			}
+
+			FleetHost* take( size_t source )
+			{
+				unique_lock<mutex> guard( mLock );
+				map<size_t, FleetHost*>::iterator i;
+				while( ( i = mReady.find( source ) ) == mReady.end( ) )
+					mChanged.wait( guard );
+				FleetHost* ret = i->second;
+				mReady.erase( i );
+				mTaken = source + 1;
+				mChanged.notify_all( );
+				return ret;
+			}
+
+			void abort( )
+			{
+				lock_guard<mutex> guard( mLock );
+				mAborted = true;
+				mChanged.notify_all( );
+			}
+	};
+
+	/*
+	 * A prepared statement that is finalized when it goes out of scope.
+	 * step runs it once and resets it for the next set of bindings.
+	 */
+	class FleetStatement
+	{
+		private:
+			sqlite3_stmt* mpStmt;
+
+			FleetStatement( const FleetStatement& copyMe ) = delete;
+			FleetStatement& operator=( const FleetStatement& rhs ) = delete;
+
+		public:
+			FleetStatement( ) : mpStmt( NULL ) { }
+			~FleetStatement( ) { sqlite3_finalize( mpStmt ); }
+
+			int prepare( sqlite3* db, const string& sql )
+			{
+				const char *tail;
+				return SQLITE3_PREPARE( db, sql.c_str( ), sql.length( ) + 1,
+						&mpStmt, &tail );
+			}
+
+			// Empty strings are stored as NULL.
+			void bind( int col, const string& val )
+			{
+				if( val.empty( ) )
+					sqlite3_bind_null( mpStmt, col );
+				else
+					sqlite3_bind_text( mpStmt, col, val.c_str( ),
+							val.length( ), SQLITE_STATIC );
+			}
+
+			void bind( int col, sqlite3_int64 val )
+				{ sqlite3_bind_int64( mpStmt, col, val ); }
+
+			void bindBlob( int col, const string& val )
+			{
+				sqlite3_bind_blob( mpStmt, col, val.data( ), val.length( ),
+						SQLITE_STATIC );
+			}
+
+			int step( )
+			{
+				int rc = sqlite3_step( mpStmt );
+				sqlite3_reset( mpStmt );
+				sqlite3_clear_bindings( mpStmt );
+				return rc;
+			}
+
+			// Like step, but hands back the first column of the row found.
+			int stepInt( sqlite3_int64& out )
+			{
+				int rc = sqlite3_step( mpStmt );
+				if( rc == SQLITE_ROW )
+					out = sqlite3_column_int64( mpStmt, 0 );
+				sqlite3_reset( mpStmt );
+				sqlite3_clear_bindings( mpStmt );
+				return rc;
+			}
+	};
+
+	static void decodeRow( FleetRow& row, Component& scratch, FleetHost& host )
+	{
+		// The decoders trust the size the row starts with.
+		if( !packed_fits( row.data.data( ), row.data.length( ) ) )
+		{
+			VpdException ve( "Corrupt row " + row.id );
+			throw ve;
+		}
+		row.hash = FieldTable::hash( row.data.data( ), row.data.length( ),
+				0xcbf29ce484222325ULL );
+		if( row.id == System::ID )
+		{
+			System sys( row.data.data( ) );
+			host.machineType = sys.getMachineType( );
+			host.serial = sys.getSerial1( );
+			row.serial = host.serial;
+			row.location = sys.getLocation( );
+			return;
+		}
+		scratch.unpack( row.data.data( ), INVENTORY_FIELDS );
+		row.serial = scratch.getSerialNumber( );
+		row.partNumber = scratch.getPartNumber( );
+		row.fru = scratch.getFRU( );
+		row.location = scratch.getPhysicalLocation( );
+		row.firmware = scratch.getFirmwareLevel( );
+	}
+
+	static bool readDatabase( const string& path, FleetHost& host )
+	{
+		int rc;
+		const char *tail;
+		sqlite3 *db = NULL;
+		sqlite3_stmt *pstmt = NULL;
+		FleetRow row;
+
+		string sql = "SELECT " + VpdDbEnv::ID + ", " + VpdDbEnv::DATA +
+			" FROM " + VpdDbEnv::TABLE_NAME + ";";
+		rc = sqlite3_open_v2( path.c_str( ), &db, SQLITE_OPEN_READONLY, NULL );
+		if( rc == SQLITE_OK )
+			rc = SQLITE3_PREPARE( db, sql.c_str( ), sql.length( ) + 1,
+					&pstmt, &tail );
+		if( rc != SQLITE_OK )
+			goto READ_ERR;
+
+		row.removed = false;
+		while( ( rc = sqlite3_step( pstmt ) ) == SQLITE_ROW )
+		{
+			const char *id = (const char*)sqlite3_column_text( pstmt, 0 );
+			const char *data = (const char*)sqlite3_column_blob( pstmt, 1 );
+			if( id == NULL || data == NULL )
+				continue;
+			row.id.assign( id );
+			row.data.assign( data, sqlite3_column_bytes( pstmt, 1 ) );
+			host.rows.push_back( row );
+		}
+		if( rc != SQLITE_DONE )
+			goto READ_ERR;
+		sqlite3_finalize( pstmt );
+		sqlite3_close( db );
+		return true;
+
+READ_ERR:
+		{
+			ostringstream message;
+			message << path << ": SQLITE Error " << rc << ": " <<
+				( db ? sqlite3_errmsg( db ) : "out of memory" ) << endl;
+			Logger( ).log( message.str( ), LOG_ERR );
+		}
+		sqlite3_finalize( pstmt );
+		sqlite3_close( db );
+		return false;
+	}
+
+	/*
+	 * Reads and decodes one source.  A vpd.db is recognised by the header
+	 * every SQLite database starts with, anything else is taken to be a
+	 * delta.
+	 */
+	static bool readSource( const string& path, FleetHost& host )
+	{
+		char magic[ sizeof( SQLITE_MAGIC ) ] = { 0 };
+		Component scratch;
+		vector<FleetRow>::iterator i, end;
+
+		ifstream file( path.c_str( ), ios_base::in | ios_base::binary );
+		file.read( magic, sizeof( magic ) );
+		file.close( );
+
+		host.full = memcmp( magic, SQLITE_MAGIC, sizeof( magic ) ) == 0;
+		if( host.full )
+		{
+			if( !readDatabase( path, host ) )
+				return false;
+		}
+		else
+		{
+			vector<VpdDbEnv::DeltaRecord> records;
+			vector<VpdDbEnv::DeltaRecord>::iterator r;
+			FleetRow row;
+
+			if( !VpdDbEnv::readDelta( path, records ) )
+				return false;
+			host.rows.reserve( records.size( ) );
+			for( r = records.begin( ); r != records.end( ); ++r )
+			{
+				row.removed = r->op == VpdDbEnv::JOURNAL_REMOVE;
+				row.id.swap( r->id );
+				row.data.swap( r->data );
+				host.rows.push_back( row );
+			}
+		}
+
+		try {
+			for( i = host.rows.begin( ), end = host.rows.end( ); i != end; ++i )
+				if( !i->removed )
+					decodeRow( *i, scratch, host );
+		}
+		catch( VpdException& ve ) {
+			Logger( ).log( path + ": " + ve.what( ), LOG_ERR );
+			return false;
+		}
+		return true;
+	}
+
+	FleetAggregator::FleetAggregator( const string& envDir,
+						const string& dbFileName ) :
+		mDbPath( envDir + "/" + dbFileName ),
+		mpFleetDb( NULL ),
+		mBatchRows( DEFAULT_BATCH_ROWS )
+	{
+		int rc;
+		ostringstream message;
+
+		rc = sqlite3_open_v2( mDbPath.c_str( ), &mpFleetDb,
+				SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL );
+		if( rc != SQLITE_OK )
+		{
+			message << "SQLite Error " << rc << ": " <<
+				sqlite3_errmsg( mpFleetDb ) << endl;
+			goto OPEN_ERR;
+		}
+		sqlite3_busy_timeout( mpFleetDb, 60000 );
+
+		if( !execute( "CREATE TABLE IF NOT EXISTS hosts ( "
+				"host_id INTEGER PRIMARY KEY, name TEXT NOT NULL UNIQUE, "
+				"source TEXT, machine_type TEXT, serial TEXT, "
+				"ingested INTEGER );"
+				"CREATE TABLE IF NOT EXISTS blobs ( "
+				"blob_id INTEGER PRIMARY KEY, hash INTEGER NOT NULL, "
+				"data BLOB NOT NULL );"
+				"CREATE INDEX IF NOT EXISTS blobs_hash ON blobs ( hash );"
+				"CREATE TABLE IF NOT EXISTS inventory ( "
+				"host_id INTEGER NOT NULL, comp_id TEXT NOT NULL, "
+				"blob_id INTEGER NOT NULL, serial TEXT, part_number TEXT, "
+				"fru TEXT, location TEXT, firmware TEXT, "
+				"PRIMARY KEY ( host_id, comp_id ) );"
+				"CREATE INDEX IF NOT EXISTS inventory_serial ON "
+				"inventory ( serial );"
+				"PRAGMA synchronous = OFF;" ) )
+		{
+			message << "Could not create the fleet tables in " << mDbPath <<
+				endl;
+			goto OPEN_ERR;
+		}
+		return;
+
+OPEN_ERR:
+		Logger( ).log( message.str( ), LOG_ERR );
+		VpdException ve( message.str( ) );
+		if( mpFleetDb != NULL )
+			sqlite3_close( mpFleetDb );
+		throw ve;
+	}
+
+	FleetAggregator::~FleetAggregator( )
+	{
+		sqlite3_close( mpFleetDb );
+	}
+
+	bool FleetAggregator::execute( const string& sql )
+	{
+		char *err = NULL;
+		int rc = sqlite3_exec( mpFleetDb, sql.c_str( ), NULL, NULL, &err );
+
+		if( rc != SQLITE_OK )
+		{
+			ostringstream message;
+			message << "SQLITE Error " << rc << ": " <<
+				( err ? err : sqlite3_errmsg( mpFleetDb ) ) << endl;
+			Logger( ).log( message.str( ), LOG_ERR );
+			sqlite3_free( err );
+			return false;
+		}
+		return true;
+	}
+
+	bool FleetAggregator::ingest( const vector<Source>& sources,
+					unsigned int threads, Stats* stats )
+	{
+		FleetStatement addHost, findHost, updateHost, clearHost, removeRow,
+			findBlob, addBlob, addRow;
+		Stats done = { 0, 0, 0, 0, 0 }, committed = done;
+		chrono::steady_clock::time_point start = chrono::steady_clock::now( );
+		size_t count = sources.size( );
+		u64 inBatch = 0;
+		bool dropped = false, ok = false;
+		int rc;
+
+		if( threads == 0 )
+			threads = thread::hardware_concurrency( );
+		if( threads == 0 )
+			threads = 1;
+		if( threads > count )
+			threads = count;
+
+		rc = addHost.prepare( mpFleetDb,
+			"INSERT OR IGNORE INTO hosts ( name ) VALUES ( ? );" );
+		if( rc == SQLITE_OK )
+			rc = findHost.prepare( mpFleetDb,
+				"SELECT host_id FROM hosts WHERE name = ?;" );
+		if( rc == SQLITE_OK )
+			rc = updateHost.prepare( mpFleetDb,
+				"UPDATE hosts SET source = ?, machine_type = "
+				"COALESCE( ?, machine_type ), serial = COALESCE( ?, serial ), "
+				"ingested = ? WHERE host_id = ?;" );
+		if( rc == SQLITE_OK )
+			rc = clearHost.prepare( mpFleetDb,
+				"DELETE FROM inventory WHERE host_id = ?;" );
+		if( rc == SQLITE_OK )
+			rc = removeRow.prepare( mpFleetDb,
+				"DELETE FROM inventory WHERE host_id = ? AND comp_id = ?;" );
+		if( rc == SQLITE_OK )
+			rc = findBlob.prepare( mpFleetDb,
+				"SELECT blob_id FROM blobs WHERE hash = ? AND data = ?;" );
+		if( rc == SQLITE_OK )
+			rc = addBlob.prepare( mpFleetDb,
+				"INSERT INTO blobs ( hash, data ) VALUES ( ?, ? );" );
+		if( rc == SQLITE_OK )
+			rc = addRow.prepare( mpFleetDb,
+				"INSERT OR REPLACE INTO inventory ( host_id, comp_id, "
+				"blob_id, serial, part_number, fru, location, firmware ) "
+				"VALUES ( ?, ?, ?, ?, ?, ?, ?, ? );" );
+		if( rc != SQLITE_OK )
+		{
+			ostringstream message;
+			message << "SQLITE Error " << rc << ": " <<
+				sqlite3_errmsg( mpFleetDb ) << endl;
+			Logger( ).log( message.str( ), LOG_ERR );
+			return false;
+		}
+
+		IngestWindow window( threads * 2 );
+		atomic<size_t> next( 0 );
+		vector<thread> readers;
+
+		for( unsigned int t = 0; t < threads; t++ )
+			readers.push_back( thread( [ & ]( ) {
+				for( size_t i = next++; i < count; i = next++ )
+				{
+					if( !window.reserve( i ) )
+						return;
+					FleetHost* host = new FleetHost( );
+					host->source = i;
+					// Whatever goes wrong with one source only fails that
+					// host, it must not end the thread or the process.
+					try {
+						host->ok = readSource( sources[ i ].path, *host );
+					}
+					catch( exception& e ) {
+						Logger( ).log( sources[ i ].path + ": " + e.what( ),
+								LOG_ERR );
+						host->ok = false;
+					}
+					catch( ... ) {
+						Logger( ).log( sources[ i ].path +
+								": could not be read", LOG_ERR );
+						host->ok = false;
+					}
+					if( !host->ok )
+						vector<FleetRow>( ).swap( host->rows );
+					window.put( host );
+				}
+			} ) );
+
+		if( count > 0 && !execute( "BEGIN;" ) )
+			goto INGEST_DONE;
+
+		for( size_t i = 0; i < count; i++ )
+		{
+			FleetHost* host = window.take( i );
+			vector<FleetRow>::const_iterator row, end;
+			sqlite3_int64 hostID = 0;
+
+			if( !host->ok )
+			{
+				Logger( ).log( "Skipping " + sources[ i ].path + " for host " +
+						sources[ i ].host, LOG_ERR );
+				done.failed++;
+				delete host;
+				continue;
+			}
+
+			addHost.bind( 1, sources[ i ].host );
+			rc = addHost.step( );
+			if( rc == SQLITE_DONE )
+			{
+				findHost.bind( 1, sources[ i ].host );
+				rc = findHost.stepInt( hostID );
+			}
+			if( rc == SQLITE_ROW )
+			{
+				updateHost.bind( 1, sources[ i ].path );
+				updateHost.bind( 2, host->machineType );
+				updateHost.bind( 3, host->serial );
+				updateHost.bind( 4, (sqlite3_int64)time( NULL ) );
+				updateHost.bind( 5, hostID );
+				rc = updateHost.step( );
+			}
+			if( rc == SQLITE_DONE && host->full )
+			{
+				clearHost.bind( 1, hostID );
+				rc = clearHost.step( );
+				dropped = true;
+			}
+
+			end = host->rows.end( );
+			for( row = host->rows.begin( ); rc == SQLITE_DONE && row != end;
+				++row )
+			{
+				sqlite3_int64 blobID = 0;
+
+				if( row->removed )
+				{
+					removeRow.bind( 1, hostID );
+					removeRow.bind( 2, row->id );
+					rc = removeRow.step( );
+					dropped = true;
+					done.rows++;
+					continue;
+				}
+
+				findBlob.bind( 1, (sqlite3_int64)row->hash );
+				findBlob.bindBlob( 2, row->data );
+				rc = findBlob.stepInt( blobID );
+				if( rc == SQLITE_DONE )
+				{
+					addBlob.bind( 1, (sqlite3_int64)row->hash );
+					addBlob.bindBlob( 2, row->data );
+					rc = addBlob.step( );
+					blobID = sqlite3_last_insert_rowid( mpFleetDb );
+					done.newBlobs++;
+				}
+				else if( rc == SQLITE_ROW )
+					rc = SQLITE_DONE;
+				if( rc != SQLITE_DONE )
+					break;
+
+				addRow.bind( 1, hostID );
+				addRow.bind( 2, row->id );
+				addRow.bind( 3, blobID );
+				addRow.bind( 4, row->serial );
+				addRow.bind( 5, row->partNumber );
+				addRow.bind( 6, row->fru );
+				addRow.bind( 7, row->location );
+				addRow.bind( 8, row->firmware );
+				rc = addRow.step( );
+				done.rows++;
+			}
+			inBatch += host->rows.size( );
+			delete host;
+
+			if( rc != SQLITE_DONE )
+			{
+				ostringstream message;
+				message << "SQLITE Error " << rc << ": " <<
+					sqlite3_errmsg( mpFleetDb ) << endl;
+				Logger( ).log( message.str( ), LOG_ERR );
+				execute( "ROLLBACK;" );
+				goto INGEST_DONE;
+			}
+			done.hosts++;
+
+			/*
+			 * Hosts are never split across two transactions, but the
+			 * ingest as a whole is: what is committed here stays if a
+			 * later batch fails, and only the failed batch is undone.
+			 */
+			if( inBatch >= mBatchRows && i + 1 < count )
+			{
+				if( !execute( "COMMIT;" ) )
+				{
+					execute( "ROLLBACK;" );
+					goto INGEST_DONE;
+				}
+				committed = done;
+				if( !execute( "BEGIN;" ) )
+					goto INGEST_DONE;
+				inBatch = 0;
+			}
+		}
+
+		// Drop the rows no host refers to any more.
+		if( dropped && !execute( "DELETE FROM blobs WHERE blob_id NOT IN "
+				"( SELECT blob_id FROM inventory );" ) )
+		{
+			execute( "ROLLBACK;" );
+			goto INGEST_DONE;
+		}
+		ok = count == 0 || execute( "COMMIT;" );
+		if( !ok )
+			execute( "ROLLBACK;" );
+		else
+			committed = done;
+
+INGEST_DONE:
+		// Failures are counted whether or not their batch was kept.
+		committed.failed = done.failed;
+		window.abort( );
+		for( size_t t = 0; t < readers.size( ); t++ )
+			readers[ t ].join( );
+
+		committed.seconds = chrono::duration<double>(
+				chrono::steady_clock::now( ) - start ).count( );
+		if( stats != NULL )
+			*stats = committed;
+		return ok;
+	}
+
+	Component* FleetAggregator::fetch( const string& host, const string& id,
+						Component::FieldMask fields )
+	{
+		int rc;
+		const char *tail;
+		sqlite3_stmt *pstmt = NULL;
+		Component* ret = NULL;
+
+		string sql = "SELECT data FROM inventory JOIN hosts USING ( host_id ) "
+			"JOIN blobs USING ( blob_id ) WHERE hosts.name = ? AND "
+			"inventory.comp_id = ?;";
+		rc = SQLITE3_PREPARE( mpFleetDb, sql.c_str( ), sql.length( ) + 1,
+					&pstmt, &tail );
+		if( rc == SQLITE_OK )
+			rc = sqlite3_bind_text( pstmt, 1, host.c_str( ), host.length( ),
+						SQLITE_STATIC );
+		if( rc == SQLITE_OK )
+			rc = sqlite3_bind_text( pstmt, 2, id.c_str( ), id.length( ),
+						SQLITE_STATIC );
+		if( rc == SQLITE_OK )
+			rc = sqlite3_step( pstmt );
+
+		if( rc == SQLITE_ROW && !packed_fits( sqlite3_column_blob( pstmt, 0 ),
+				sqlite3_column_bytes( pstmt, 0 ) ) )
+			Logger( ).log( "Corrupt row " + id + " of " + host, LOG_ERR );
+		else if( rc == SQLITE_ROW )
+			ret = new Component( sqlite3_column_blob( pstmt, 0 ), fields );
+		else if( rc != SQLITE_DONE )
+		{
+			ostringstream message;
+			message << "SQLITE Error " << rc << ": " <<
+				sqlite3_errmsg( mpFleetDb ) << endl;
+			Logger( ).log( message.str( ), LOG_ERR );
+		}
+		sqlite3_finalize( pstmt );
+		return ret;
+	}
+
+	vector<string> FleetAggregator::getHosts( )
+	{
+		vector<string> ret;
+		int rc;
+		const char *tail;
+		sqlite3_stmt *pstmt = NULL;
+
+		string sql = "SELECT name FROM hosts ORDER BY name;";
+		rc = SQLITE3_PREPARE( mpFleetDb, sql.c_str( ), sql.length( ) + 1,
+					&pstmt, &tail );
+		if( rc == SQLITE_OK )
+		{
+			while( ( rc = sqlite3_step( pstmt ) ) == SQLITE_ROW )
+			{
+				const char *name = (const char*)sqlite3_column_text( pstmt, 0 );
+				if( name )
+					ret.push_back( name );
+			}
+		}
+		if( rc != SQLITE_DONE )
+		{
+			ostringstream message;
+			message << "SQLITE Error " << rc << ": " <<
+				sqlite3_errmsg( mpFleetDb ) << endl;
+			Logger( ).log( message.str( ), LOG_ERR );
+		}
+		sqlite3_finalize( pstmt );
+		return ret;
+	}
+}
@@ -36,6 +36,7 @@
 #include <sys/wait.h>
 #include <linux/limits.h>
 #include <libgen.h>
+#include <cctype>
 
 
 #define BUF_SIZE PATH_MAX
@@ -184,7 +185,7 @@ int spclose(FILE *stream, pid_t cpid)
 	 * @brief Finds AIX name which exists as a file or link in the dir
 	 *	'rootPath'
 	 */
-	string HelperFunctions::findAIXFSEntry(vector <DataItem*> aixNames,
+	string HelperFunctions::findAIXFSEntry(const vector<DataItem*>& aixNames,
 											const string& rootPath)
 	{
 		string fin;
@@ -194,7 +195,8 @@ int spclose(FILE *stream, pid_t cpid)
 		end = aixNames.end();
 
 		while (i != end) {
-			fin = rootPath + (*i)->getValue();
+			fin.assign( rootPath );
+			fin += (*i)->getValue();
 			fd = open( fin.c_str( ), O_RDONLY | O_NONBLOCK );
 			if( fd < 0 )
 				i++;
@@ -638,3 +640,74 @@ free_mem:
 
 		return rc;
 	}
+
+	/*
+	 * The byte in front of each part of a version key.  A level that ends
+	 * sorts after a pre-release tag and before anything that carries on.
+	 */
+	static const char VERSION_PRERELEASE = 'A';
+	static const char VERSION_END        = 'B';
+	static const char VERSION_WORD       = 'C';
+	static const char VERSION_NUMBER     = 'D';
+
+	// A number's digit count is one character, '0' + count, so it is capped.
+	static const size_t VERSION_MAX_DIGITS = 78;
+
+	string HelperFunctions::versionKey( const string& version )
+	{
+		static const char* const PRERELEASE[] = {
+			"alpha", "beta", "dev", "pre", "rc", NULL
+		};
+		string key, word;
+		size_t i = 0, n = version.length( ), start, digits;
+		int p;
+
+		if( n > 1 && ( version[ 0 ] == 'v' || version[ 0 ] == 'V' ) &&
+			isdigit( (unsigned char)version[ 1 ] ) )
+			i = 1;
+
+		while( i < n )
+		{
+			unsigned char c = version[ i ];
+
+			if( isdigit( c ) )
+			{
+				while( i < n && version[ i ] == '0' )
+					i++;
+				start = i;
+				while( i < n && isdigit( (unsigned char)version[ i ] ) )
+					i++;
+				digits = i - start;
+				if( digits > VERSION_MAX_DIGITS )
+					digits = VERSION_MAX_DIGITS;
+				key += VERSION_NUMBER;
+				key += (char)( '0' + digits );
+				key.append( version, start, digits );
+			}
+			else if( isalpha( c ) )
+			{
+				word.clear( );
+				for( ; i < n && isalpha( (unsigned char)version[ i ] ); i++ )
+					word += (char)tolower( (unsigned char)version[ i ] );
+				for( p = 0; PRERELEASE[ p ] != NULL; p++ )
+					if( word == PRERELEASE[ p ] )
+						break;
+				key += PRERELEASE[ p ] != NULL ? VERSION_PRERELEASE :
+					VERSION_WORD;
+				key += word;
+				// Ends the word below any letter, so "ab" < "abc".
+				key += ' ';
+			}
+			else
+				i++;
+		}
+
+		if( !key.empty( ) )
+			key += VERSION_END;
+		return key;
+	}
+
+	int HelperFunctions::compareVersions( const string& v1, const string& v2 )
+	{
+		return versionKey( v1 ).compare( versionKey( v2 ) );
+	}
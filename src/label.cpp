@@ -0,0 +1,200 @@
+/***************************************************************************
+ *   Copyright (C) 2006, IBM                                               *
+ *                                                                         *
+ *   Maintained By:                                                        *
+ *   Eric Munson and Brad Peters                                           *
+ *   munsone@us.ibm.com, bpeters@us.ibm.com                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the Lesser GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of the  *
+ *   License, or at your option) any later version.                        *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Lesser General Public License for more details.                   *
+ *                                                                         *
+ *   You should have received a copy of the Lesser GNU General Public      *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+
+#include <libvpd-2/label.hpp>
+#include <libvpd-2/fields.h>
+
+#include <functional>
+#include <vector>
+
+namespace lsvpd
+{
+#define LABEL_NAMES( NAME, member, slot, ac, humanName ) ac, humanName,
+
+	/*
+	 * Every name the pool holds: the default labels of the packed fields
+	 * of Component and System, and the labels of an AIX name entry.
+	 */
+	static const char* const POOLED_NAMES[] = {
+		VPD_COMPONENT_FIELDS( LABEL_NAMES )
+		VPD_SYSTEM_FIELDS( LABEL_NAMES )
+		"AX", "AIX Name"
+	};
+
+#undef LABEL_NAMES
+
+	/*
+	 * The pool is an open addressed hash table of pointers into names,
+	 * kept at most half full so probes stay short.  It is filled once,
+	 * on first use, and only read after that.
+	 */
+	struct LabelPool
+	{
+		vector<string> names;
+		vector<const string*> slots;
+
+		LabelPool( );
+	};
+
+	static size_t hashName( const char* str, size_t len )
+	{
+		size_t ret = 2166136261u;
+
+		for( size_t i = 0; i < len; i++ )
+		{
+			ret ^= (unsigned char)str[ i ];
+			ret *= 16777619u;
+		}
+		return ret;
+	}
+
+	static size_t findSlot( const vector<const string*>& slots,
+				const char* str, size_t len, size_t hash )
+	{
+		size_t mask = slots.size( ) - 1;
+		size_t i = hash & mask;
+
+		while( slots[ i ] != NULL && ( slots[ i ]->length( ) != len ||
+				memcmp( slots[ i ]->c_str( ), str, len ) != 0 ) )
+			i = ( i + 1 ) & mask;
+		return i;
+	}
+
+	LabelPool::LabelPool( )
+	{
+		size_t count = sizeof( POOLED_NAMES ) / sizeof( POOLED_NAMES[ 0 ] );
+		size_t size = 16, i, slot;
+
+		while( size < count * 2 )
+			size *= 2;
+		slots.assign( size, (const string*)NULL );
+
+		// names must not move once slots points into it.
+		names.reserve( count );
+		for( i = 0; i < count; i++ )
+		{
+			size_t len = strlen( POOLED_NAMES[ i ] );
+			slot = findSlot( slots, POOLED_NAMES[ i ], len,
+				hashName( POOLED_NAMES[ i ], len ) );
+			if( slots[ slot ] != NULL )
+				continue;
+			names.push_back( string( POOLED_NAMES[ i ], len ) );
+			slots[ slot ] = &names.back( );
+		}
+	}
+
+	/*
+	 * Built on first use so Labels in static objects are safe, and never
+	 * destroyed so they are still safe during exit.
+	 */
+	static const LabelPool& getPool( )
+	{
+		static const LabelPool* pool = new LabelPool( );
+		return *pool;
+	}
+
+	const string* Label::intern( const char* str, size_t len )
+	{
+		const LabelPool& pool = getPool( );
+		return pool.slots[ findSlot( pool.slots, str, len,
+			hashName( str, len ) ) ];
+	}
+
+	bool Label::isPooled( const string* str )
+	{
+		const vector<string>& names = getPool( ).names;
+		less<const string*> before;
+
+		return !before( str, names.data( ) ) &&
+			before( str, names.data( ) + names.size( ) );
+	}
+
+	const string* Label::getEmpty( )
+	{
+		static const string* empty = intern( "", 0 );
+		return empty;
+	}
+
+	Label::Label( ) : mpStr( getEmpty( ) )
+	{
+	}
+
+	Label::Label( const Label& copyMe ) : mpStr( copyMe.mpStr )
+	{
+		if( !isPooled( mpStr ) )
+			mpStr = new string( *copyMe.mpStr );
+	}
+
+	Label::Label( Label&& moveMe ) noexcept : mpStr( moveMe.mpStr )
+	{
+		moveMe.mpStr = getEmpty( );
+	}
+
+	Label::~Label( )
+	{
+		if( mpStr != NULL && !isPooled( mpStr ) )
+			delete mpStr;
+	}
+
+	Label& Label::operator=( const Label& rhs )
+	{
+		if( this != &rhs )
+			assign( rhs.mpStr->c_str( ), rhs.mpStr->length( ) );
+		return *this;
+	}
+
+	Label& Label::operator=( Label&& rhs ) noexcept
+	{
+		if( this != &rhs )
+		{
+			const string* old = mpStr;
+
+			mpStr = rhs.mpStr;
+			rhs.mpStr = old;
+		}
+		return *this;
+	}
+
+	void Label::assign( const char* str, size_t len )
+	{
+		const string* next;
+
+		if( mpStr != NULL && mpStr->length( ) == len &&
+				memcmp( mpStr->c_str( ), str, len ) == 0 )
+			return;
+
+		next = intern( str, len );
+		if( next == NULL )
+			next = new string( str, len );
+
+		if( mpStr != NULL && !isPooled( mpStr ) )
+			delete mpStr;
+		mpStr = next;
+	}
+
+	void Label::clear( )
+	{
+		assign( "", 0 );
+	}
+}
@@ -42,4 +42,34 @@ struct list* new_list( );
 void free_list( struct list *head );
 struct list* concat_list( struct list *head, const struct list *addme );
 
+/*
+ * A vpdarena hands out memory from a chain of large blocks that are all
+ * free'd together by free_arena.  Nothing allocated from an arena may be
+ * passed to free or to any of the free_* functions.
+ */
+#define ARENA_BLOCK_SIZE ( 64 * 1024 )
+
+struct arena_block
+{
+	struct arena_block *next;
+	size_t used;
+	size_t size;
+};
+
+struct vpdarena
+{
+	struct arena_block *head;
+};
+
+struct vpdarena * new_arena( void );
+void free_arena( struct vpdarena *freeme );
+/* Returns size bytes of zeroed memory, or NULL if it could not be had. */
+void * arena_alloc( struct vpdarena *arena, size_t size );
+/*
+ * Returns size bytes for the characters of a string, neither zeroed nor
+ * aligned: the caller writes every one of them.
+ */
+char * arena_alloc_text( struct vpdarena *arena, size_t size );
+char * arena_strdup( struct vpdarena *arena, const char *str );
+
 #endif /*COMMON_H_*/
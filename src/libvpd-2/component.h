@@ -26,6 +26,7 @@
 
 #include <libvpd-2/common.h>
 #include <libvpd-2/dataitem.h>
+#include <libvpd-2/fields.h>
 
 #define CHILD_START  "::childrenStart::"
 #define CHILD_END    "::childrenEnd::"
@@ -37,6 +38,28 @@
 #define AX_END       "::axEnd::"
 #define COMP_INIT_BUF_SIZE 129
 
+/*
+ * Field numbers in the order the fields are packed (see fields.h), these
+ * match lsvpd::Component::Field.  unpack_component_fields takes a mask of
+ * COMP_FIELD_BIT( field ) values to choose which fields are decoded.  The
+ * n5 and n6 fields are packed by the C++ library but have no member here.
+ */
+#define COMP_FIELD_ENUM( name, member, slot, ac, humanName ) \
+	COMP_FIELD_##name,
+enum comp_field
+{
+	VPD_COMPONENT_FIELDS( COMP_FIELD_ENUM )
+	COMP_FIELD_CHILDREN,
+	COMP_FIELD_DEVICE_SPECIFIC,
+	COMP_FIELD_USER_DATA,
+	COMP_FIELD_AIX_NAMES,
+	COMP_FIELD_COUNT
+};
+#undef COMP_FIELD_ENUM
+
+#define COMP_FIELD_BIT( f )  ( (u64)1 << (f) )
+#define COMP_ALL_FIELDS      ( COMP_FIELD_BIT( COMP_FIELD_COUNT ) - 1 )
+
 /* All lists should be NULL terminated */
 struct component
 {
@@ -88,11 +111,25 @@ struct component
 	struct list *childrenIDs;
 	struct component *children;
 	struct component *next;
+
+	/*
+	 * COMP_FIELD_BIT's of the fields that were decoded, a field that was
+	 * not asked for is left NULL and its bit is clear.
+	 */
+	u64 loaded;
 };
 
 struct component* new_component( int init );
 void free_component( struct component *freeme );
 struct component * unpack_component( void *buffer );
+struct component * unpack_component_fields( void *buffer, u64 fields );
+/*
+ * Like unpack_component_fields, but the component and everything it holds
+ * is allocated from arena.  It must not be free'd with free_component, it
+ * goes away with the arena.
+ */
+struct component * unpack_component_arena( void *buffer, u64 fields,
+		struct vpdarena *arena );
 void add_component( struct component *head, const struct component *addme );
 
 #endif /*COMPONENT_H_*/
@@ -28,6 +28,8 @@
 #include <iostream>
 
 #include <libvpd-2/dataitem.hpp>
+#include <libvpd-2/fields.h>
+#include <libvpd-2/lsvpd.hpp>
 
 /**
  * @defgroup lsvpd lsvpd
@@ -40,6 +42,10 @@ namespace lsvpd
 {
 	static const int COMPONENT_STATE_LIVE = 0x00000001;
 	static const int COMPONENT_STATE_DEAD = 0x00000002;
+
+	class KeyIndex;
+	struct ListIndex;
+
 	/**
 	 * This class provides a single storage point for all the VPD connected
 	 * to a single entity on a system.  An entity may be a physical piece of
@@ -67,6 +73,34 @@ namespace lsvpd
 		friend class SysFSTreeCollector;
 		friend class ICollector;
 		friend class Gatherer;
+		friend class SnapshotEditor;
+		friend class TreeIndex;
+
+		public:
+			/**
+			 * Identifies each field of a packed Component, in the order the
+			 * fields are stored (see fields.h).  A FieldMask with the bit
+			 * for a field set asks for that field to be decoded.
+			 */
+#define LSVPD_FIELD_ENUM( name, member, slot, ac, humanName ) \
+				FIELD_##name,
+			enum Field {
+				VPD_COMPONENT_FIELDS( LSVPD_FIELD_ENUM )
+				FIELD_CHILDREN,
+				FIELD_DEVICE_SPECIFIC,
+				FIELD_USER_DATA,
+				FIELD_AIX_NAMES,
+				FIELD_COUNT
+			};
+#undef LSVPD_FIELD_ENUM
+
+			typedef u64 FieldMask;
+
+			static const FieldMask ALL_FIELDS =
+				( (FieldMask)1 << FIELD_COUNT ) - 1;
+
+			static inline FieldMask fieldMask( Field f )
+			{ return (FieldMask)1 << f; }
 
 		private:
 			/**
@@ -265,7 +299,13 @@ namespace lsvpd
 			vector<DataItem*> mAIXNames;
 
 			// These are not stored in the DB, they are computed.
+			FieldMask mLoaded;
 			vector<Component*> mLeaves;
+			// List entries left over from an earlier unpack, for reuse.
+			vector<DataItem*> mSpareItems;
+			vector<string> mSpareChildren;
+			// Lookup indexes over the lists, built on demand for long lists.
+			ListIndex* mpIndex;
 			Component* mpParent;
 			int devMajor;  ///< Major:minor codes for device lookup
 			int devMinor;
@@ -359,6 +399,10 @@ namespace lsvpd
 			int numChildren();
 
 			/**
+			 * Replaces everything in *this with a deep copy of copyMe.
+			 * The list DataItems and the leaves are copied, never shared,
+			 * and the copied leaves have *this as their parent.
+			 *
 			 * @brief
 			 *   Copies data from arg to this.
 			 * @param copyMe
@@ -366,6 +410,18 @@ namespace lsvpd
 			 */
 			void copyToMe( const Component& copyMe );
 
+			/**
+			 * Takes the contents of moveMe, which is left empty.  The
+			 * lists and leaves change owner without being copied.
+			 */
+			void moveToMe( Component& moveMe ) noexcept;
+
+			/**
+			 * Releases the leaves and list DataItems owned by *this and
+			 * empties the vectors that held them.
+			 */
+			void freeLists( );
+
 			/**
 			 * Starts with the base size of a Component (INIT_BUF_SIZE), and
 			 * sums the size of each Data Item and returns the number of
@@ -376,6 +432,35 @@ namespace lsvpd
 			 */
 			unsigned int getPackedSize( );
 
+			/**
+			 * Describes one of the single DataItems of a Component, see
+			 * FieldTable.
+			 */
+			struct FieldDesc
+			{
+				Field id;
+				const char* ac;
+				const char* humanName;
+				DataItem Component::* member;
+			};
+
+			/**
+			 * The single DataItems of a Component in packed order, indexed
+			 * by Field.  The lists follow them in the packed buffer.
+			 */
+			static const int NUM_PACKED_ITEMS = FIELD_CHILDREN;
+			static const FieldDesc FIELDS[ NUM_PACKED_ITEMS ];
+
+			/**
+			 * Position lookups in the lists, through mpIndex once a list
+			 * is long enough to be worth indexing.  They return -1 if
+			 * there is no such entry.
+			 */
+			int findItem( KeyIndex ListIndex::* which,
+				const vector<DataItem*>& list, const string& key,
+				bool byValue );
+			int findChild( const string& id );
+
 		public:
 			/**
 			 * This is the number of bytes required to store an empty
@@ -407,10 +492,16 @@ namespace lsvpd
 
 			/**
 			 * @brief
-			 *   Copies provided Component
+			 *   Copies provided Component, including its leaves.
 			 */
 			Component( const Component& copyMe );
 
+			/**
+			 * @brief
+			 *   Takes the contents of moveMe without copying them.
+			 */
+			Component( Component&& moveMe ) noexcept;
+
 			/**
 			 * Uses the unpack method to populate a new Component with the
 			 * "serialized" data in the provided buffer.
@@ -422,9 +513,30 @@ namespace lsvpd
 			 */
 			Component( const void* packedData );
 
+			/**
+			 * Like Component( const void* ), but only the fields selected by
+			 * fields are decoded, see unpack( const void*, FieldMask ).
+			 *
+			 * @param packedData
+			 *   Buffer that contains Component information
+			 * @param fields
+			 *   The fields to decode
+			 */
+			Component( const void* packedData, FieldMask fields );
+
 			~Component( );
 
 			Component& operator=( const Component& rhs );
+			Component& operator=( Component&& rhs ) noexcept;
+
+			/**
+			 * NOTE: The pointer returned is "newed" by this method but the
+			 * caller will be responsible for deleting it.
+			 *
+			 * @brief
+			 *   Returns a deep copy of *this on the heap.
+			 */
+			inline Component* clone( ) const { return new Component( *this ); }
 
 
 
@@ -494,6 +606,58 @@ namespace lsvpd
 			 */
 			void unpack( const void* packed );
 
+			/**
+			 * Unpacks only the fields selected by fields; the others are
+			 * stepped over without being copied, left empty and reported
+			 * as not loaded by isLoaded.  A Component that is not fully
+			 * loaded cannot be packed.
+			 *
+			 * @brief
+			 *   Unpacks part of the provided buffer into *this
+			 * @param packed
+			 *   The buffer holding a packed Component
+			 * @param fields
+			 *   The fields to decode
+			 */
+			void unpack( const void* packed, FieldMask fields );
+
+			/**
+			 * @brief
+			 *   Reports if a field was decoded when *this was unpacked.
+			 */
+			inline bool isLoaded( Field f ) const
+			{ return ( mLoaded & fieldMask( f ) ) != 0; }
+
+			inline FieldMask getLoadedFields( ) const
+			{ return mLoaded; }
+
+			/**
+			 * @brief
+			 *   Gives access to a single field by its Field number.
+			 *
+			 * @return
+			 *   The DataItem for f, or NULL if f is one of the list fields.
+			 */
+			const DataItem* getField( Field f ) const;
+
+			/**
+			 * @brief
+			 *   Compares the single fields of *this and other.
+			 *
+			 * @return
+			 *   A FieldMask with the bit set for each field whose AC,
+			 * human name or value differs between the two.  The list
+			 * fields are not compared.
+			 */
+			FieldMask diffFields( const Component& other ) const;
+
+			/**
+			 * @return
+			 *   A 64 bit hash of everything pack would store, so two
+			 * Components that pack the same hash the same.
+			 */
+			u64 contentHash( ) const;
+
 			/**
 			 * This method takes a char ** and creates a buffer sized
 			 * appropriately to hold the information stored in *this.
@@ -701,7 +865,18 @@ namespace lsvpd
 			{ return plantMfg.getHumanName(); }
 
 			inline const vector<Component*>& getLeaves( ) const { return mLeaves; }
-			inline void addLeaf( Component* in ) { mLeaves.push_back( in ); }
+			inline void addLeaf( Component* in )
+			{
+				in->mpParent = this;
+				mLeaves.push_back( in );
+			}
+
+			/**
+			 * @return
+			 *   The Component whose leaves hold *this, NULL at the top of
+			 * the tree (below the System) or outside of a tree.
+			 */
+			inline Component* getParentComponent( ) const { return mpParent; }
 	};
 
 }
@@ -0,0 +1,122 @@
+/***************************************************************************
+ *   Copyright (C) 2006, IBM                                               *
+ *                                                                         *
+ *   Maintained By:                                                        *
+ *   Eric Munson and Brad Peters                                           *
+ *   munsone@us.ibm.com, bpeters@us.ibm.com                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the Lesser GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of the  *
+ *   License, or at your option) any later version.                        *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Lesser General Public License for more details.                   *
+ *                                                                         *
+ *   You should have received a copy of the Lesser GNU General Public      *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef LSVPDCOMPONENTFILTER_HPP
+#define LSVPDCOMPONENTFILTER_HPP
+
+#include <string>
+
+#include <libvpd-2/component.hpp>
+
+using namespace std;
+
+namespace lsvpd
+{
+
+	/**
+	 * A ComponentFilter decides which Components are kept while
+	 * VpdRetriever::getComponentTree is loading the tree, instead of
+	 * loading everything and filtering afterwards.  A Component is kept if
+	 * it matches or if any of its descendants is kept, so every match
+	 * comes with its ancestors.  Components that are not kept are deleted
+	 * as soon as their subtree has been visited.
+	 *
+	 * @class ComponentFilter
+	 *
+	 * @ingroup lsvpd
+	 *
+	 * @brief
+	 *   Load time predicate for the VPD tree
+	 */
+	class ComponentFilter
+	{
+		public:
+			virtual ~ComponentFilter( ) { }
+
+			/**
+			 * @return
+			 *   The fields that matches and mayContainMatch need decoded,
+			 * the children are always decoded by the loader.
+			 */
+			virtual Component::FieldMask getFields( ) const
+			{ return Component::ALL_FIELDS; }
+
+			/**
+			 * @return
+			 *   true if c should be part of the loaded tree.
+			 */
+			virtual bool matches( const Component& c ) const = 0;
+
+			/**
+			 * Called before the children of c are fetched.  Returning
+			 * false prunes the whole subtree below c without reading it
+			 * from the database.  The default never prunes, only a
+			 * filter that knows how its matches are laid out in the tree
+			 * can (e.g. one that matches a single device class which is
+			 * only ever found below one kind of parent).
+			 *
+			 * @return
+			 *   false if no descendant of c can match.
+			 */
+			virtual bool mayContainMatch( const Component& /*c*/ ) const
+			{ return true; }
+	};
+
+	/**
+	 * Matches the Components where one field has a given value, or where
+	 * it is not empty (e.g. devBus == "scsi", or any Component with a FRU
+	 * number).
+	 *
+	 * Most fields of a Component say nothing about the fields of its
+	 * descendants, so for them every Component is still read once, only
+	 * the ones that are not kept are dropped while loading.  The subtree
+	 * below a match is pruned when the match is on a value of
+	 * Component::FIELD_ID, which is unique, or of Component::FIELD_PARENT,
+	 * which no descendant of a child of that parent can share.  Derive
+	 * from it and override mayContainMatch to prune in other cases.
+	 */
+	class FieldFilter : public ComponentFilter
+	{
+		private:
+			Component::Field mField;
+			string mValue;
+			bool mAnyValue;
+
+		public:
+			/**
+			 * Matches Components where f is not empty.
+			 */
+			FieldFilter( Component::Field f );
+
+			/**
+			 * Matches Components where f equals value.
+			 */
+			FieldFilter( Component::Field f, const string& value );
+
+			virtual Component::FieldMask getFields( ) const;
+			virtual bool matches( const Component& c ) const;
+			virtual bool mayContainMatch( const Component& c ) const;
+	};
+}
+
+#endif
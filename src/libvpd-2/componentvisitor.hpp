@@ -0,0 +1,80 @@
+/***************************************************************************
+ *   Copyright (C) 2006, IBM                                               *
+ *                                                                         *
+ *   Maintained By:                                                        *
+ *   Eric Munson and Brad Peters                                           *
+ *   munsone@us.ibm.com, bpeters@us.ibm.com                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the Lesser GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of the  *
+ *   License, or at your option) any later version.                        *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Lesser General Public License for more details.                   *
+ *                                                                         *
+ *   You should have received a copy of the Lesser GNU General Public      *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef LSVPDCOMPONENTVISITOR_HPP
+#define LSVPDCOMPONENTVISITOR_HPP
+
+#include <string>
+
+#include <libvpd-2/component.hpp>
+
+using namespace std;
+
+namespace lsvpd
+{
+
+	/**
+	 * A ComponentVisitor is handed each Component of the database in turn
+	 * by VpdRetriever::traverse, which streams the tree instead of loading
+	 * it: the Component passed to visit is only valid for the duration of
+	 * the call and has no leaves.  Copy what is needed out of it.
+	 *
+	 * @class ComponentVisitor
+	 *
+	 * @ingroup lsvpd
+	 *
+	 * @brief
+	 *   Callback for streaming traversals of the VPD tree
+	 */
+	class ComponentVisitor
+	{
+		public:
+			enum Action {
+				CONTINUE,       ///< Go on, including the children of c
+				SKIP_CHILDREN,  ///< Go on, but leave out the subtree below c
+				STOP            ///< End the traversal
+			};
+
+			enum Order {
+				DEPTH_FIRST,    ///< Each Component before its subtree
+				BREADTH_FIRST   ///< One level of the tree after the other
+			};
+
+			virtual ~ComponentVisitor( ) { }
+
+			/**
+			 * @param c
+			 *   The Component being visited
+			 * @param parentID
+			 *   The ID of its parent, System::ID at the top of the tree
+			 * @param depth
+			 *   1 for the Components directly below the System
+			 * @return
+			 *   How the traversal should go on.
+			 */
+			virtual Action visit( const Component& c, const string& parentID,
+				unsigned int depth ) = 0;
+	};
+}
+
+#endif
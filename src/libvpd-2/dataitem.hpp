@@ -28,6 +28,7 @@
 #include <iostream>
 
 #include <libvpd-2/Source.hpp>
+#include <libvpd-2/label.hpp>
 
 using namespace std;
 
@@ -36,7 +37,11 @@ namespace lsvpd
 	/**
 	 * Holds a single item of data inside a Component as well as some
 	 * meta-data about this information.  It contains labels for this data
-	 * and a vector of sources for this data.
+	 * and a vector of sources for this data.  The labels are interned and
+	 * the sources, which only the collectors use and which are never
+	 * stored, are only allocated once the first one is added, so a
+	 * DataItem that was read back from the database is little more than
+	 * its value.
 	 *
 	 * @class DataItem
 	 *
@@ -64,30 +69,35 @@ namespace lsvpd
 		friend class Gatherer;
 		friend class Component;
 		friend class System;
+		friend class FieldTable;
 
 		private:
-			string humanName; ///< Human readable name for field
-			string ac; ///< Acronym for field - refer to lsvpd-acronyms
+			Label humanName; ///< Human readable name for field
+			Label ac; ///< Acronym for field - refer to lsvpd-acronyms
 			string dataValue;  /**< Actual value of this data item,
 								as obtained from one of the sub-systems*/
 			int packedLength;
-			vector<Source*> sources;	/**< A collection of all the
-										alternative sources to fill this data
-										 item */
 			int prefLevelUsed;	/**< PreferenceLevel of source used to fill
 									this dataitem.  Zero if not filled*/
+			vector<Source*>* mpSources;	/**< A collection of all the
+										alternative sources to fill this data
+										 item, NULL until one is added */
+
+			static const vector<Source*> NO_SOURCES;
 
 			int setValue( const string& in, int prefLevelUsed_t,
 								const char *file, int lineNum);
 			void setHumanName( const string& in );
 			void setAC(const string& in);
 			int getPrefLevel();
+			void clear( );
+			void deleteSources( );
 
 		public:
 
 			DataItem( );
 			DataItem(string& in) : dataValue(in), packedLength( 0 ),
-				 prefLevelUsed(0)
+				 prefLevelUsed(0), mpSources( NULL )
 				 {};
 
 			/**
@@ -99,12 +109,26 @@ namespace lsvpd
 			 * @param data
 			 *   The buffer holding the DataItem
 			 */
-			DataItem( const void * data ) : packedLength( 0 ), prefLevelUsed(0)
+			DataItem( const void * data ) : packedLength( 0 ), prefLevelUsed(0),
+				mpSources( NULL )
 			{ unpack( data ); }
+			/**
+			 * Copies the labels, value and sources of copyMe, the
+			 * sources are copied rather than shared.
+			 */
 			DataItem( const DataItem& copyMe );
 
+			/**
+			 * Takes the value and sources of moveMe without copying
+			 * them, moveMe is left empty.
+			 */
+			DataItem( DataItem&& moveMe ) noexcept;
+
 			~DataItem( );
 
+			DataItem& operator=( const DataItem& rhs );
+			DataItem& operator=( DataItem&& rhs ) noexcept;
+
 			const string& getHumanName( ) const;
 			const string& getAC( ) const;
 			const string& getValue() const;
@@ -150,6 +174,14 @@ namespace lsvpd
 			 */
 			void unpack( const void * data );
 
+			/**
+			 * Fills *this from the three strings of a packed DataItem
+			 * that the caller has already found, none of which needs to
+			 * be '\0' terminated.
+			 */
+			void unpack( const char* acp, size_t acLen, const char* name,
+				size_t nameLen, const char* value, size_t valueLen );
+
 			int getNumSources() const;
 			Source * getSource(int i) const;
 			void addSource(Source *in);
@@ -160,12 +192,12 @@ namespace lsvpd
 			{ return prefLevelUsed; }
 
 			inline const vector<Source*>& getSources( ) const
-			{ return sources; }
+			{ return mpSources ? *mpSources : NO_SOURCES; }
 
 			inline const Source* getFirstSource( ) const
 			{
-				if( !sources.empty( ) )
-					return sources.at( 0 );
+				if( mpSources && !mpSources->empty( ) )
+					return mpSources->at( 0 );
 				else
 					return NULL;
 			}
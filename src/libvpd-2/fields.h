@@ -0,0 +1,138 @@
+/***************************************************************************
+ *   Copyright (C) 2007, IBM                                               *
+ *                                                                         *
+ *   Maintained By:                                                        *
+ *   Eric Munson and Brad Peters                                           *
+ *   ebmunson@us.ibm.com, bpeters@us.ibm.com                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the Lesser GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of the  *
+ *   License, or at your option) any later version.                        *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Lesser General Public License for more details.                   *
+ *                                                                         *
+ *   You should have received a copy of the Lesser GNU General Public      *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef FIELDS_H_
+#define FIELDS_H_
+
+/*
+ * The single dataitems of a packed component and of a packed system, in the
+ * order they are stored.  This is the one place that order is written down:
+ * the field enums of both libraries, the C struct slots, the default labels
+ * and every pack, unpack, size and compare loop are generated from these
+ * lists.  Adding a field means adding one line here and the members it
+ * names.
+ *
+ * Each entry is X( NAME, member, slot, ac, humanName ) where
+ *   NAME      is the suffix of the field's enum constant,
+ *   member    is the lsvpd::Component (or lsvpd::System) DataItem,
+ *   slot      is CSLOT( member ) of struct component (or struct system),
+ *             or CNONE when the C struct has no member for the field,
+ *   ac        and humanName are the labels a new object starts with.
+ *
+ * The user of a list defines X, and CSLOT and CNONE if it looks at slot.
+ *
+ * For RL (FIRMWARE_LEVEL) a special rule applies: if devBus is "disk" it
+ * must be stored as Hex, see device_scsi_append_field() in lsvpd-0.16.
+ */
+#define VPD_COMPONENT_FIELDS( X ) \
+	X( ID, idNode, CSLOT( id ), "None", \
+		"Main Device Node, equals sysFsNode or deviceTreeNode" ) \
+	X( DEVICE_TREE_NODE, deviceTreeNode, CSLOT( deviceTreeNode ), "None", \
+		"/proc/device-tree Device Node" ) \
+	X( SYSFS_NODE, sysFsNode, CSLOT( sysFsNode ), "None", \
+		"/sys Device Node" ) \
+	X( SYSFS_LINK_TARGET, sysFsLinkTarget, CSLOT( sysFsLinkTarget ), "None", \
+		"/sys/bus Device Node" ) \
+	X( HAL_UDI, halUDI, CSLOT( halUDI ), "", "" ) \
+	X( NET_ADDR, mNetAddr, CSLOT( netAddr ), "NA", "Network Address" ) \
+	X( DEV_CLASS, mDevClass, CSLOT( devClass ), "None", \
+		"/sys/class - Device Node" ) \
+	X( DESCRIPTION, mDescription, CSLOT( description ), "DS", \
+		"Displayable Message" ) \
+	X( CD, mCDField, CSLOT( cdField ), "CD", "Card ID" ) \
+	X( SERIAL_NUMBER, mSerialNumber, CSLOT( serialNumber ), "SN", \
+		"Serial Number" ) \
+	X( PART_NUMBER, mPartNumber, CSLOT( partNumber ), "PN", \
+		"Part Number of assembly" ) \
+	X( FIRMWARE_LEVEL, mFirmwareLevel, CSLOT( firmwareLevel ), "RL", \
+		"Non-alterable ROM level" ) \
+	X( FIRMWARE_VERSION, mFirmwareVersion, CSLOT( firmwareVersion ), "RM", \
+		"Alterable ROM Level" ) \
+	X( FRU, mFRU, CSLOT( fru ), "FN", "Field Replaceable Unit Number" ) \
+	X( MANUFACTURER, mManufacturer, CSLOT( manufacturer ), "MF", \
+		"Manufacturer Name" ) \
+	X( MODEL, mModel, CSLOT( model ), "TM", "Machine Type-Model" ) \
+	X( MANUFACTURER_ID, mManufacturerID, CSLOT( manufacturerID ), "MN", \
+		"Manufacturer ID" ) \
+	X( ENG_CHANGE, mEngChangeLevel, CSLOT( engChangeLevel ), "EC", \
+		"Engineering Change Level" ) \
+	X( PARENT, mParent, CSLOT( parent ), "Parent Node", "Parent Node" ) \
+	X( DEV_SUBSYSTEM, devSubsystem, CSLOT( devSubSystem ), "", "" ) \
+	X( DEV_DRIVER, devDriver, CSLOT( devDriver ), "DD", \
+		"Device Driver Level" ) \
+	X( DEV_KERNEL, devKernel, CSLOT( devKernel ), "", "" ) \
+	X( DEV_KERNEL_NUMBER, devKernelNumber, CSLOT( devKernelNumber ), "", "" ) \
+	X( DEV_SYS_NAME, devSysName, CSLOT( devSysName ), "", \
+		"Device name from sysFS" ) \
+	X( DEV_TREE_NAME, devDevTreeName, CSLOT( devDevTreeName ), "", \
+		"Device name from /proc/device-tree" ) \
+	X( DEV_BUS, devBus, CSLOT( devBus ), "", "Device Bus" ) \
+	X( DEV_BUS_ADDR, devBusAddr, CSLOT( devBusAddr ), "", "" ) \
+	X( RECORD_TYPE, mRecordType, CSLOT( recordType ), "RT", "Record Type" ) \
+	X( SCSI_DETAIL, scsiDetail, CSLOT( scsiDetail ), "ZZ", "Device Details" ) \
+	X( N5, n5, CNONE, "N5", "Processor CoD Capacity Card Info" ) \
+	X( N6, n6, CNONE, "N6", "Memory CoD Capacity Card Info" ) \
+	X( PLANT_MFG, plantMfg, CSLOT( plantMfg ), "SE", "Plant of manufacture" ) \
+	X( FEATURE_CODE, mFeatureCode, CSLOT( featureCode ), "FC", \
+		"Feature Code or Request for Price Quotation (RPQ) number" ) \
+	X( KEYWORD_VERSION, mKeywordVersion, CSLOT( keywordVersion ), "VK", \
+		"Keyword Version" ) \
+	X( MICRO_CODE_IMAGE, mMicroCodeImage, CSLOT( microCodeImage ), "MI", \
+		"Micro Code Image" ) \
+	X( SECOND_LOCATION, mSecondLocation, CSLOT( secondLocation ), "YL", \
+		"Location Code" ) \
+	X( PHYSICAL_LOCATION, mPhysicalLocation, CSLOT( physicalLocation ), "YL", \
+		"Location Code" )
+
+/*
+ * The system's cpu count is packed ahead of these as a bare u32.
+ */
+#define VPD_SYSTEM_FIELDS( X ) \
+	X( ID, mIdNode, CSLOT( id ), "", "" ) \
+	X( ARCH, mArch, CSLOT( arch ), "", "" ) \
+	X( DEVICE_TREE_NODE, deviceTreeNode, CSLOT( deviceTreeNode ), "", "" ) \
+	X( DESCRIPTION, mDescription, CSLOT( description ), "DS", "Description" ) \
+	X( BRAND, mBrand, CSLOT( brand ), "BR", "Brand Keyword" ) \
+	X( NODE_NAME, mNodeName, CSLOT( nodeName ), "", "" ) \
+	X( OS, mOS, CSLOT( os ), "OS", "Operating System" ) \
+	X( PROCESSOR_ID, mProcessorID, CSLOT( processorID ), "PI", \
+		"Processor ID or unique ID" ) \
+	X( MACHINE_TYPE, mMachineType, CSLOT( machineType ), "TM", \
+		"Machine Type" ) \
+	X( MACHINE_MODEL, mMachineModel, CSLOT( machineModel ), "TM", \
+		"Machine Model" ) \
+	X( FEATURE_CODE, mFeatureCode, CSLOT( featureCode ), "FC", \
+		"Feature Code" ) \
+	X( FLAG_FIELD, mFlagField, CSLOT( flagField ), "FG", "Flag Field" ) \
+	X( RECORD_TYPE, mRecordType, CSLOT( recordType ), "RT", "Record Type" ) \
+	X( SERIAL_NUM1, mSerialNum1, CSLOT( serialNum1 ), "SE", \
+		"Machine or Cabinet Serial Number" ) \
+	X( SERIAL_NUM2, mSerialNum2, CSLOT( serialNum2 ), "SE", \
+		"Machine or Cabinet Serial Number" ) \
+	X( SUID, mSUID, CSLOT( suid ), "SU", "System Unique ID" ) \
+	X( KEYWORD_VERSION, mKeywordVersion, CSLOT( keywordVersion ), "VK", \
+		"Version of Keywords" ) \
+	X( LOCATION_CODE, mLocationCode, CSLOT( locationCode ), "YL", \
+		"Location Code" )
+
+#endif /*FIELDS_H_*/
@@ -0,0 +1,169 @@
+/***************************************************************************
+ *   Copyright (C) 2006, IBM                                               *
+ *                                                                         *
+ *   Maintained By:                                                        *
+ *   Eric Munson and Brad Peters                                           *
+ *   munsone@us.ibm.com, bpeters@us.ibm.com                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the Lesser GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of the  *
+ *   License, or at your option) any later version.                        *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Lesser General Public License for more details.                   *
+ *                                                                         *
+ *   You should have received a copy of the Lesser GNU General Public      *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef LSVPDFLEETAGGREGATOR_HPP
+#define LSVPDFLEETAGGREGATOR_HPP
+
+#include <string>
+#include <vector>
+#include <sqlite3.h>
+
+#include <libvpd-2/component.hpp>
+#include <libvpd-2/lsvpd.hpp>
+
+using namespace std;
+
+namespace lsvpd
+{
+
+	/**
+	 * A FleetAggregator gathers the VPD databases of many hosts into one
+	 * fleet database that can be queried with plain SQL:
+	 *
+	 *   hosts ( host_id, name, source, machine_type, serial, ingested )
+	 *   inventory ( host_id, comp_id, blob_id, serial, part_number, fru,
+	 *               location, firmware )
+	 *   blobs ( blob_id, hash, data )
+	 *
+	 * inventory has a row for every Component (and the System) of every
+	 * host, with the fields most often searched on copied out of it.  The
+	 * packed row itself is in blobs, which holds each distinct one once
+	 * however many hosts share it.
+	 *
+	 * Sources are read and decoded by a pool of threads while the calling
+	 * thread writes what they produce, committing once every
+	 * getBatchRows( ) rows rather than once per row.
+	 *
+	 * @class FleetAggregator
+	 *
+	 * @ingroup lsvpd
+	 *
+	 * @brief
+	 *   Bulk loader for the VPD of many hosts
+	 */
+	class FleetAggregator
+	{
+		public:
+			/**
+			 * Where the VPD of one host comes from: a vpd.db file, which
+			 * replaces everything held for the host, or a file written by
+			 * VpdDbEnv::exportDelta, which is applied on top of it.
+			 */
+			struct Source
+			{
+				string host;
+				string path;
+			};
+
+			/**
+			 * What an ingest did.
+			 */
+			struct Stats
+			{
+				unsigned int hosts;       ///< Sources ingested
+				unsigned int failed;      ///< Sources that could not be read
+				u64 rows;                 ///< Rows written or removed
+				u64 newBlobs;             ///< Distinct rows not seen before
+				double seconds;
+
+				inline double rowsPerSecond( ) const
+					{ return seconds > 0 ? rows / seconds : 0; }
+			};
+
+			// Rows written between two commits by default
+			static const unsigned int DEFAULT_BATCH_ROWS = 50000;
+
+		private:
+			string mDbPath;
+			sqlite3* mpFleetDb;
+			unsigned int mBatchRows;
+
+			FleetAggregator( const FleetAggregator& copyMe ) = delete;
+			FleetAggregator& operator=( const FleetAggregator& rhs ) = delete;
+
+			bool execute( const string& sql );
+
+		public:
+			/**
+			 * Opens the fleet database, creating it if needed.
+			 *
+			 * @throws VpdException
+			 *   If the database cannot be opened or created.
+			 */
+			FleetAggregator( const string& envDir, const string& dbFileName );
+			~FleetAggregator( );
+
+			/**
+			 * Reads every source and writes it to the fleet database.  A
+			 * source that cannot be read, for whatever reason, is logged,
+			 * counted in Stats::failed and skipped, the others are still
+			 * ingested.
+			 *
+			 * An ingest is not atomic: the sources are committed in
+			 * batches of about getBatchRows( ) rows, each host whole in
+			 * one of them.  If writing fails, the batch being written is
+			 * rolled back but the ones committed before it stay, and
+			 * Stats only counts those.  Rows no host refers to any more
+			 * are dropped from blobs at the end, so a failed ingest may
+			 * leave some there until the next one; they are never seen
+			 * through inventory.
+			 *
+			 * @param sources
+			 *   The files to read, several may name the same host and
+			 * are applied in order
+			 * @param threads
+			 *   The number of threads reading sources, 0 for one per
+			 * processor
+			 * @param stats
+			 *   If not NULL, filled in with what was done
+			 * @returns
+			 *   false if the fleet database could not be written.
+			 */
+			bool ingest( const vector<Source>& sources,
+					unsigned int threads = 0, Stats* stats = NULL );
+
+			/**
+			 * Loads one Component of a host from the fleet database.
+			 *
+			 * NOTE: The pointer returned is "newed" by this method but the
+			 * caller will be responsible for deleting it.
+			 *
+			 * @returns
+			 *   The Component, NULL if the host has no such row.
+			 */
+			Component* fetch( const string& host, const string& id,
+					Component::FieldMask fields = Component::ALL_FIELDS );
+
+			/**
+			 * @returns
+			 *   The name of every host ingested so far.
+			 */
+			vector<string> getHosts( );
+
+			inline void setBatchRows( unsigned int rows )
+				{ mBatchRows = rows > 0 ? rows : 1; }
+			inline unsigned int getBatchRows( ) const { return mBatchRows; }
+	};
+}
+
+#endif /*LSVPDFLEETAGGREGATOR_HPP*/
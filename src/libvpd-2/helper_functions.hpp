@@ -41,7 +41,7 @@ namespace lsvpd {
 		public:
 			static string readMatchFromFile(const string&, const string&);
 			static string parseString(const string& line, int str_pos, string& out);
-			static string findAIXFSEntry(vector <DataItem*>, const string&);
+			static string findAIXFSEntry(const vector<DataItem*>&, const string&);
 			static string parsePathr(const string& path, int count);
 			static string parsePath(const string& path, int count);
 			static string getSymLinkTarget(const string&);
@@ -63,6 +63,34 @@ namespace lsvpd {
 			static bool contains( const vector<DataItem*>& vec,
 				const string& val );
 			static int execCmd( const char *cmd, string& output );
+
+			/**
+			 * Derives a key from a firmware or microcode level such that
+			 * comparing two keys byte by byte orders the levels the way
+			 * their vendors mean them: "3.5.1" < "3.10.0",
+			 * "2.0-rc1" < "2.0" < "2.0a" < "2.0.1" and
+			 * "FW860.10 (61)" < "FW950.50 (105)".  The level is read as
+			 * runs of digits, compared as numbers with leading zeros
+			 * dropped, and runs of letters, compared without case, with
+			 * everything else separating them.  A "v" right before the
+			 * first digit is ignored, and alpha, beta, dev, pre and rc
+			 * sort before the end of a level.  Levels of different
+			 * schemes still compare, one that starts with letters before
+			 * one that starts with digits, but the order means little.
+			 *
+			 * @returns
+			 *   The key, empty if version has no letters or digits.
+			 */
+			static string versionKey( const string& version );
+
+			/**
+			 * Compares two levels by their versionKey.
+			 *
+			 * @returns
+			 *   Less than, equal to or greater than 0 when v1 is older
+			 * than, the same as or newer than v2.
+			 */
+			static int compareVersions( const string& v1, const string& v2 );
 	};
 }
 
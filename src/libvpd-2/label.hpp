@@ -0,0 +1,105 @@
+/***************************************************************************
+ *   Copyright (C) 2006, IBM                                               *
+ *                                                                         *
+ *   Maintained By:                                                        *
+ *   Eric Munson and Brad Peters                                           *
+ *   munsone@us.ibm.com, bpeters@us.ibm.com                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the Lesser GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of the  *
+ *   License, or at your option) any later version.                        *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Lesser General Public License for more details.                   *
+ *                                                                         *
+ *   You should have received a copy of the Lesser GNU General Public      *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#ifndef LSVPDLABEL_HPP
+#define LSVPDLABEL_HPP
+
+#include <cstring>
+#include <string>
+#include <iostream>
+
+using namespace std;
+
+namespace lsvpd
+{
+
+	/**
+	 * A Label holds one of the names of a DataItem, its acronym or its
+	 * human readable name.  Nearly every DataItem carries one of the
+	 * fixed names of the packed fields (fields.h), so those are stored
+	 * once in a read only pool and a Label is then only a pointer to the
+	 * pooled copy.  Any other name, such as the keyword of a
+	 * device-specific entry, is copied into a string owned by the Label.
+	 * The pool never grows and needs no locking once it is built.
+	 *
+	 * @class Label
+	 *
+	 * @ingroup lsvpd
+	 *
+	 * @brief
+	 *   Interned name of a DataItem
+	 */
+	class Label
+	{
+		private:
+			const string* mpStr;
+
+			static const string* intern( const char* str, size_t len );
+			static bool isPooled( const string* str );
+			static const string* getEmpty( );
+
+		public:
+			Label( );
+			Label( const string& in ) : mpStr( NULL )
+			{ assign( in.c_str( ), in.length( ) ); }
+			Label( const Label& copyMe );
+			Label( Label&& moveMe ) noexcept;
+			~Label( );
+
+			/**
+			 * Points *this at the pooled copy of str, or at a copy of
+			 * its own when str is not one of the pooled names.  Nothing
+			 * is looked up when str equals the current name.
+			 */
+			void assign( const char* str, size_t len );
+			void clear( );
+
+			Label& operator=( const Label& rhs );
+			Label& operator=( Label&& rhs ) noexcept;
+			inline Label& operator=( const string& in )
+			{ assign( in.c_str( ), in.length( ) ); return *this; }
+			inline Label& operator=( const char* in )
+			{ assign( in, strlen( in ) ); return *this; }
+
+			inline const string& str( ) const { return *mpStr; }
+			inline operator const string&( ) const { return *mpStr; }
+			inline const char* c_str( ) const { return mpStr->c_str( ); }
+			inline size_t length( ) const { return mpStr->length( ); }
+			inline bool empty( ) const { return mpStr->empty( ); }
+
+			inline bool operator==( const Label& rhs ) const
+			{ return mpStr == rhs.mpStr || *mpStr == *rhs.mpStr; }
+			inline bool operator==( const string& rhs ) const
+			{ return *mpStr == rhs; }
+			inline bool operator==( const char* rhs ) const
+			{ return *mpStr == rhs; }
+			inline bool operator!=( const string& rhs ) const
+			{ return *mpStr != rhs; }
+			inline bool operator!=( const char* rhs ) const
+			{ return *mpStr != rhs; }
+	};
+
+	inline ostream& operator<<( ostream& os, const Label& in )
+	{ return os << in.str( ); }
+}
+
+#endif
@@ -0,0 +1,144 @@
+/***************************************************************************
+ *   Copyright (C) 2006, IBM                                               *
+ *                                                                         *
+ *   Maintained By:                                                        *
+ *   Eric Munson and Brad Peters                                           *
+ *   munsone@us.ibm.com, bpeters@us.ibm.com                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the Lesser GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of the  *
+ *   License, or at your option) any later version.                        *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Lesser General Public License for more details.                   *
+ *                                                                         *
+ *   You should have received a copy of the Lesser GNU General Public      *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef LSVPDLOCATIONTRIE_HPP
+#define LSVPDLOCATIONTRIE_HPP
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <libvpd-2/component.hpp>
+#include <libvpd-2/componentfilter.hpp>
+#include <libvpd-2/system.hpp>
+
+using namespace std;
+
+namespace lsvpd
+{
+
+	/**
+	 * A LocationTrie files the Components of a loaded tree under their
+	 * physical location codes, split into the segments between the
+	 * dashes (U78D2.001.WZS0ABC-P1-C3-T1 is U78D2.001.WZS0ABC, P1, C3,
+	 * T1).  A Component is filed under both its physical and its second
+	 * location.  Queries walk one trie node per segment, so they cost the
+	 * length of the code (plus the size of the answer) rather than the
+	 * number of Components.
+	 *
+	 * Like a TreeIndex, the trie holds pointers into the tree and must
+	 * not outlive it or be used after the tree is changed.
+	 *
+	 * @class LocationTrie
+	 *
+	 * @ingroup lsvpd
+	 *
+	 * @brief
+	 *   Hierarchical lookup by physical location code
+	 */
+	class LocationTrie
+	{
+		public:
+			typedef vector<Component*> Matches;
+
+			static const char SEPARATOR = '-';
+
+		private:
+			struct Node
+			{
+				map<string, Node*> mChildren;
+				Matches mComponents;
+
+				~Node( );
+			};
+
+			Node mRoot;
+			size_t mSize;
+
+			static const Matches NONE;
+
+			void add( Component* comp );
+			void add( const string& loc, Component* comp );
+			const Node* find( const string& loc ) const;
+			static void collect( const Node* node, Matches& out );
+
+			LocationTrie( const LocationTrie& copyMe ) = delete;
+			LocationTrie& operator=( const LocationTrie& rhs ) = delete;
+
+		public:
+			/**
+			 * Files every Component below root that has a location
+			 * code.
+			 */
+			LocationTrie( System* root );
+
+			/**
+			 * @return
+			 *   The number of location codes filed.
+			 */
+			inline size_t size( ) const { return mSize; }
+
+			/**
+			 * @return
+			 *   The Components located at exactly loc.
+			 */
+			const Matches& findExact( const string& loc ) const;
+
+			/**
+			 * Finds everything in the enclosure, slot or port loc, e.g.
+			 * U78D2.001.WZS0ABC-P1-C3 finds the card in C3 and every
+			 * port and device on it.
+			 *
+			 * @return
+			 *   The Components at loc or at any location below it, each
+			 * once, in location code order.
+			 */
+			Matches findWithin( const string& loc ) const;
+
+			/**
+			 * Like findWithin, but the last segment of prefix may be
+			 * partial: U78D2.001.WZS0ABC-P1-C1 also finds C10 to C19.
+			 *
+			 * @return
+			 *   The Components whose location code starts with prefix,
+			 * each once, in location code order.
+			 */
+			Matches findByPrefix( const string& prefix ) const;
+
+			/**
+			 * Finds the closest Component above loc, walking up one
+			 * segment at a time, e.g. the FRU holding a port when filter
+			 * is a FieldFilter on Component::FIELD_FRU.  loc itself need
+			 * not be filed.
+			 *
+			 * @param filter
+			 *   If not NULL only a Component it matches is returned
+			 * @return
+			 *   The Component, NULL if there is none.
+			 */
+			Component* findNearest( const string& loc,
+				const ComponentFilter* filter = NULL ) const;
+	};
+}
+
+#endif /*LSVPDLOCATIONTRIE_HPP*/
@@ -0,0 +1,312 @@
+/***************************************************************************
+ *   Copyright (C) 2006, IBM                                               *
+ *                                                                         *
+ *   Maintained By:                                                        *
+ *   Eric Munson and Brad Peters                                           *
+ *   munsone@us.ibm.com, bpeters@us.ibm.com                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the Lesser GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of the  *
+ *   License, or at your option) any later version.                        *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Lesser General Public License for more details.                   *
+ *                                                                         *
+ *   You should have received a copy of the Lesser GNU General Public      *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#ifndef LSVPDSNAPSHOT_HPP
+#define LSVPDSNAPSHOT_HPP
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <libvpd-2/component.hpp>
+#include <libvpd-2/lsvpd.hpp>
+#include <libvpd-2/system.hpp>
+
+using namespace std;
+
+namespace lsvpd
+{
+	class Snapshot;
+	class SnapshotNode;
+
+	/**
+	 * The handle readers hold on a Snapshot.  Copies of it may be made and
+	 * dropped from any thread, the Snapshot is deleted along with the last
+	 * one.
+	 */
+	typedef shared_ptr<const Snapshot> SnapshotPtr;
+	typedef shared_ptr<const SnapshotNode> SnapshotNodePtr;
+
+	/**
+	 * One Component of a Snapshot along with the nodes below it.  A node
+	 * is never changed once it is part of a Snapshot, so the Snapshots
+	 * made from one another by a SnapshotEditor share every node that the
+	 * edit did not touch.  The Component itself has no leaves, they are
+	 * held by the node.
+	 *
+	 * @class SnapshotNode
+	 *
+	 * @ingroup lsvpd
+	 */
+	class SnapshotNode
+	{
+		private:
+			friend class VpdRetriever;
+			friend class SnapshotEditor;
+
+			shared_ptr<const Component> mpComponent;
+			vector<SnapshotNodePtr> mLeaves;
+			u64 mComponentHash;
+			u64 mHash;
+
+			void rehash( );
+
+		public:
+			SnapshotNode( const shared_ptr<const Component>& comp ) :
+				mpComponent( comp ), mComponentHash( comp->contentHash( ) ),
+				mHash( mComponentHash ) { }
+
+			inline const Component& getComponent( ) const
+				{ return *mpComponent; }
+
+			inline const vector<SnapshotNodePtr>& getLeaves( ) const
+				{ return mLeaves; }
+
+			/**
+			 * @return
+			 *   A hash of the Component (see Component::contentHash).
+			 */
+			inline u64 getComponentHash( ) const { return mComponentHash; }
+
+			/**
+			 * @return
+			 *   A hash of the Component and of everything below it, in
+			 * order.  Equal subtrees hash the same whichever Snapshot
+			 * they come from.
+			 */
+			inline u64 getHash( ) const { return mHash; }
+	};
+
+	/**
+	 * A Snapshot is a tree of VPD, loaded once by
+	 * VpdRetriever::getSnapshot or made from an older one by a
+	 * SnapshotEditor, and never changed afterwards.  It is only ever
+	 * handed out as a SnapshotPtr to const, so any number of threads can
+	 * walk the same Snapshot at once without locking or copying it.
+	 * The tree is reached through getLeaves and SnapshotNode::getLeaves,
+	 * the System and Components themselves hold no leaves.
+	 *
+	 * @class Snapshot
+	 *
+	 * @ingroup lsvpd
+	 *
+	 * @brief
+	 *   Immutable, shareable tree of VPD
+	 */
+	class Snapshot
+	{
+		private:
+			friend class VpdRetriever;
+			friend class SnapshotEditor;
+
+			typedef unordered_map<string, string> ParentMap;
+
+			shared_ptr<const System> mpSystem;
+			vector<SnapshotNodePtr> mLeaves;
+
+			// The ID of the parent of every node, System::ID for the top
+			// level ones.  mpParentChanges holds what was edited since
+			// mpParents was built, an empty parent marks a removed ID.
+			shared_ptr<const ParentMap> mpParents;
+			shared_ptr<const ParentMap> mpParentChanges;
+			u64 mGeneration;
+
+			Snapshot( );
+			Snapshot( const Snapshot& copyMe ) = delete;
+			Snapshot& operator=( const Snapshot& rhs ) = delete;
+
+			static const string* parentOf( const ParentMap& base,
+				const ParentMap* changes, const string& id );
+			static bool locate( const vector<SnapshotNodePtr>& top,
+				const ParentMap& base, const ParentMap* changes,
+				const string& id, vector<size_t>& path );
+
+		public:
+			/**
+			 * @return
+			 *   The root of the tree.
+			 */
+			inline const System& getSystem( ) const { return *mpSystem; }
+
+			/**
+			 * @return
+			 *   The nodes directly below the System.
+			 */
+			inline const vector<SnapshotNodePtr>& getLeaves( ) const
+				{ return mLeaves; }
+
+			/**
+			 * Finds the node of a Component by walking up its parent
+			 * ID's and back down from the top, so it costs the depth of
+			 * the node times the number of its siblings on each level.
+			 *
+			 * @return
+			 *   The node, empty if id is not in this Snapshot.
+			 */
+			SnapshotNodePtr find( const string& id ) const;
+
+			/**
+			 * @return
+			 *   A number that is larger for every Snapshot loaded or
+			 * committed after this one in this process.
+			 */
+			inline u64 getGeneration( ) const { return mGeneration; }
+	};
+
+	/**
+	 * A SnapshotEditor builds the next generation of a Snapshot.  Only the
+	 * nodes on the path from a changed Component up to the top are copied,
+	 * the rest of the tree is shared with the base Snapshot, so an edit
+	 * costs the depth of the Component rather than the size of the tree.
+	 * Nodes the editor created itself are changed in place until they are
+	 * committed.  An editor must only be used from one thread at a time,
+	 * the Snapshots it commits may be shared like any other.
+	 *
+	 * @class SnapshotEditor
+	 *
+	 * @ingroup lsvpd
+	 *
+	 * @brief
+	 *   Copy-on-write editing of a Snapshot
+	 */
+	class SnapshotEditor
+	{
+		private:
+			typedef Snapshot::ParentMap ParentMap;
+
+			shared_ptr<const System> mpSystem;
+			vector<SnapshotNodePtr> mLeaves;
+			shared_ptr<const ParentMap> mpParents;
+			shared_ptr<const ParentMap> mpParentChanges;
+
+			// What this editor created since the last commit, safe to
+			// change in place.
+			shared_ptr<ParentMap> mpOwnChanges;
+			unordered_set<const SnapshotNode*> mOwnNodes;
+			unordered_set<const Component*> mOwnComponents;
+			bool mOwnSystem;
+
+			SnapshotEditor( const SnapshotEditor& copyMe ) = delete;
+			SnapshotEditor& operator=( const SnapshotEditor& rhs ) = delete;
+
+			SnapshotNode* own( SnapshotNodePtr& node );
+			Component* ownComponent( SnapshotNode* node );
+			System* ownSystem( );
+			ParentMap& changes( );
+			SnapshotNode* ownPath( const vector<size_t>& path,
+				size_t length );
+			bool locate( const string& id, vector<size_t>& path ) const;
+			SnapshotNodePtr detach( const vector<size_t>& path );
+			bool attach( const SnapshotNodePtr& node, const string& parentID );
+			void rehash( SnapshotNode* node );
+
+		public:
+			/**
+			 * Starts editing from base, which is left as it is.
+			 */
+			SnapshotEditor( const SnapshotPtr& base );
+
+			/**
+			 * Puts comp into the tree.  A Component with the same ID is
+			 * replaced and keeps the nodes below it; if parentID differs
+			 * from its current parent it is moved there.  A new
+			 * Component is added below parentID (System::ID for the
+			 * top level) and its ID is added to the parent's children.
+			 * The children list of comp is kept as it is, but only the
+			 * nodes already in the tree are placed below it (none for a
+			 * new Component); upsert the children afterwards.
+			 *
+			 * NOTE: comp must be "newed", the editor takes it over and
+			 * deletes it when it is no longer used, even on failure.
+			 *
+			 * @return
+			 *   false if parentID is not in the tree.
+			 */
+			bool upsert( Component* comp, const string& parentID );
+
+			/**
+			 * Removes the Component with ID id and everything below
+			 * it, and drops id from the children of its parent.
+			 *
+			 * @return
+			 *   false if id is not in the tree.
+			 */
+			bool remove( const string& id );
+
+			/**
+			 * Makes a new Snapshot of the tree as edited so far, with a
+			 * new generation.  The editor can keep going from there.
+			 *
+			 * @return
+			 *   The only handle on the new Snapshot.
+			 */
+			SnapshotPtr commit( );
+	};
+
+	/**
+	 * A SnapshotPublisher holds the current Snapshot of a process.  A
+	 * writer publishes each newly loaded Snapshot, readers take a
+	 * SnapshotPtr to the current one and keep using it for as long as
+	 * they need to.  A Snapshot that is replaced stays alive until the
+	 * last reader still holding it lets go.  All of the methods may be
+	 * called from any thread.
+	 *
+	 * @class SnapshotPublisher
+	 *
+	 * @ingroup lsvpd
+	 *
+	 * @brief
+	 *   Atomically replaceable current Snapshot
+	 */
+	class SnapshotPublisher
+	{
+		private:
+			SnapshotPtr mCurrent;
+
+			SnapshotPublisher( const SnapshotPublisher& copyMe ) = delete;
+			SnapshotPublisher& operator=( const SnapshotPublisher& rhs )
+				= delete;
+
+		public:
+			SnapshotPublisher( ) { }
+
+			/**
+			 * @return
+			 *   The Snapshot most recently published, empty if there
+			 * has not been one.
+			 */
+			SnapshotPtr current( ) const;
+
+			/**
+			 * Makes snap the current Snapshot.  A Snapshot older than
+			 * the current one (by generation) is not published.
+			 *
+			 * @return
+			 *   true if snap is now the current Snapshot.
+			 */
+			bool publish( const SnapshotPtr& snap );
+	};
+}
+
+#endif /*LSVPDSNAPSHOT_HPP*/
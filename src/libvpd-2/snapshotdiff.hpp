@@ -0,0 +1,198 @@
+/***************************************************************************
+ *   Copyright (C) 2006, IBM                                               *
+ *                                                                         *
+ *   Maintained By:                                                        *
+ *   Eric Munson and Brad Peters                                           *
+ *   munsone@us.ibm.com, bpeters@us.ibm.com                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the Lesser GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of the  *
+ *   License, or at your option) any later version.                        *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Lesser General Public License for more details.                   *
+ *                                                                         *
+ *   You should have received a copy of the Lesser GNU General Public      *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef LSVPDSNAPSHOTDIFF_HPP
+#define LSVPDSNAPSHOTDIFF_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <libvpd-2/component.hpp>
+#include <libvpd-2/snapshot.hpp>
+
+using namespace std;
+
+namespace lsvpd
+{
+
+	/**
+	 * One value that differs between two versions of a Component or of
+	 * the System.
+	 */
+	struct FieldChange
+	{
+		int field;      ///< A Component::Field, a System::Field for the System
+		string ac;      ///< The AC of the field or list entry, or a child ID
+		string before;  ///< Empty if there was no such entry before
+		string after;   ///< Empty if there is no such entry after
+	};
+
+	/**
+	 * One Component that differs between two Snapshots.
+	 */
+	struct ComponentChange
+	{
+		enum Kind {
+			ADDED,    ///< Only in the newer Snapshot
+			REMOVED,  ///< Only in the older Snapshot
+			MOVED,    ///< Below another parent, and maybe changed as well
+			CHANGED   ///< Same place, different content
+		};
+
+		Kind kind;
+		string id;
+		string parentBefore;  ///< Empty when ADDED
+		string parentAfter;   ///< Empty when REMOVED
+
+		shared_ptr<const Component> before;  ///< Empty when ADDED
+		shared_ptr<const Component> after;   ///< Empty when REMOVED
+
+		/**
+		 * The fields that differ, every field when ADDED or REMOVED.
+		 * FIELD_PARENT is always set when MOVED.
+		 */
+		Component::FieldMask fields;
+
+		/**
+		 * The values that differ, one per entry for the list fields.
+		 * Only filled in for MOVED and CHANGED.
+		 */
+		vector<FieldChange> fieldChanges;
+	};
+
+	/**
+	 * A SnapshotDiff lists what changed from one Snapshot to another, for
+	 * example from before to after a maintenance window (load each
+	 * database with VpdRetriever::getSnapshot) or between two generations
+	 * made by a SnapshotEditor.
+	 *
+	 * The trees are walked together, matching children by ID, and a
+	 * subtree is skipped as soon as its nodes are shared or their hashes
+	 * (see SnapshotNode::getHash) are equal.  The work is therefore
+	 * proportional to the number of changes times their depth and
+	 * fan-out, not to the size of the trees.  A subtree that is only in
+	 * one of the Snapshots is looked at node by node, so that the
+	 * Components that moved out of it are told apart from those that
+	 * are gone.
+	 *
+	 * @class SnapshotDiff
+	 *
+	 * @ingroup lsvpd
+	 *
+	 * @brief
+	 *   Differences between two Snapshots
+	 */
+	class SnapshotDiff
+	{
+		private:
+			vector<ComponentChange> mChanges;
+			vector<FieldChange> mSystemChanges;
+			size_t mVisited;
+
+		public:
+			SnapshotDiff( const SnapshotPtr& before, const SnapshotPtr& after );
+
+			/**
+			 * @return
+			 *   The changed Components, in ID order.
+			 */
+			inline const vector<ComponentChange>& getChanges( ) const
+				{ return mChanges; }
+
+			/**
+			 * @return
+			 *   The single fields of the System that differ.
+			 */
+			inline const vector<FieldChange>& getSystemChanges( ) const
+				{ return mSystemChanges; }
+
+			inline bool empty( ) const
+				{ return mChanges.empty( ) && mSystemChanges.empty( ); }
+
+			/**
+			 * @return
+			 *   The number of nodes that were compared, a measure of
+			 * the work the diff took.
+			 */
+			inline size_t getVisited( ) const { return mVisited; }
+	};
+
+	/**
+	 * Receives the changes a ChangeNotifier was subscribed to.
+	 */
+	class ChangeListener
+	{
+		public:
+			virtual ~ChangeListener( ) { }
+
+			virtual void changed( const ComponentChange& change ) = 0;
+	};
+
+	/**
+	 * A ChangeNotifier passes on the changes of a SnapshotDiff to the
+	 * listeners subscribed to the fields they touch, e.g. to be told of
+	 * every firmware level that moved when a new Snapshot is published.
+	 * Added and removed Components touch every field.  A ChangeNotifier
+	 * does no locking of its own.
+	 *
+	 * @class ChangeNotifier
+	 *
+	 * @ingroup lsvpd
+	 *
+	 * @brief
+	 *   Field level change subscriptions
+	 */
+	class ChangeNotifier
+	{
+		private:
+			struct Subscription
+			{
+				ChangeListener* listener;
+				Component::FieldMask fields;
+			};
+
+			vector<Subscription> mSubscriptions;
+
+		public:
+			/**
+			 * Has listener called for each change to any of fields.
+			 * The listener is not owned and must be unsubscribed before
+			 * it is deleted.
+			 */
+			void subscribe( ChangeListener* listener,
+				Component::FieldMask fields );
+
+			void unsubscribe( ChangeListener* listener );
+
+			/**
+			 * Calls the listeners for the changes in diff, in ID order.
+			 *
+			 * @return
+			 *   The number of calls made.
+			 */
+			size_t notify( const SnapshotDiff& diff ) const;
+	};
+}
+
+#endif /*LSVPDSNAPSHOTDIFF_HPP*/
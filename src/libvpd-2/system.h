@@ -27,10 +27,24 @@
 #include <libvpd-2/common.h>
 #include <libvpd-2/dataitem.h>
 #include <libvpd-2/component.h>
+#include <libvpd-2/fields.h>
 
 #define SYS_INIT_BUF_SIZE 107
 #define SYS_ID "/sys/bus"
 
+/*
+ * Field numbers of the dataitems of a packed system, in packed order (see
+ * fields.h).
+ */
+#define SYS_FIELD_ENUM( name, member, slot, ac, humanName ) \
+	SYS_FIELD_##name,
+enum sys_field
+{
+	VPD_SYSTEM_FIELDS( SYS_FIELD_ENUM )
+	SYS_FIELD_COUNT
+};
+#undef SYS_FIELD_ENUM
+
 struct system
 {
 	struct dataitem *id;
@@ -29,6 +29,7 @@
 
 #include <libvpd-2/dataitem.hpp>
 #include <libvpd-2/component.hpp>
+#include <libvpd-2/fields.h>
 #include <libvpd-2/lsvpd.hpp>
 
 #include <sys/types.h>
@@ -43,8 +44,40 @@ namespace lsvpd
 		friend class SysFSTreeCollector;
 		friend class ICollector;
 		friend class Gatherer;
+		friend class SnapshotEditor;
+
+		public:
+			/**
+			 * Identifies each single field of a packed System, in the
+			 * order the fields are stored (see fields.h).
+			 */
+#define LSVPD_FIELD_ENUM( name, member, slot, ac, humanName ) \
+				FIELD_##name,
+			enum Field {
+				VPD_SYSTEM_FIELDS( LSVPD_FIELD_ENUM )
+				FIELD_COUNT
+			};
+#undef LSVPD_FIELD_ENUM
 
 		private:
+			/**
+			 * Describes one of the single DataItems of a System, see
+			 * FieldTable.
+			 */
+			struct FieldDesc
+			{
+				Field id;
+				const char* ac;
+				const char* humanName;
+				DataItem System::* member;
+			};
+
+			/**
+			 * The single DataItems of a System in packed order, indexed
+			 * by Field.
+			 */
+			static const FieldDesc FIELDS[ FIELD_COUNT ];
+
 			DataItem mIdNode;
 			DataItem mArch;
 			DataItem deviceTreeNode;
@@ -71,6 +104,8 @@ namespace lsvpd
 			vector<Component*> mLeaves;
 
 			unsigned int getPackedSize( );
+			void copyToMe( const System& copyMe );
+			void freeLists( );
 
 			// All of the mutator methods for this are private to prevent anyone outside
 			// of our friend list from modifying a System Object.
@@ -104,8 +139,16 @@ namespace lsvpd
 
 			System();
 			System( const void* packedData );
+
+			/**
+			 * Makes a deep copy of copyMe, including a copy of every
+			 * Component in its leaves.
+			 */
+			System( const System& copyMe );
 			~System( );
 
+			System& operator=( const System& rhs );
+
 			// These methods contain the logic to pack and unpack this object
 			// for use with the db.  pack will new the apporiate buffer and
 			// store it in *buffer and it will expect the consumer to call an
@@ -116,6 +159,22 @@ namespace lsvpd
 
 			unsigned int pack( void** buffer );
 
+			/**
+			 * @brief
+			 *   Compares the single fields of *this and other.
+			 *
+			 * @return
+			 *   A mask with the bit ( 1 << Field ) set for each field whose
+			 * AC, human name or value differs between the two.
+			 */
+			u64 diffFields( const System& other ) const;
+
+			/**
+			 * @return
+			 *   The DataItem for f, or NULL if f is not a Field.
+			 */
+			const DataItem* getField( Field f ) const;
+
 			inline const vector<string>& getChildren( ) const
 			{
 				return mChildren;
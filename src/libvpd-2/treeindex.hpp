@@ -0,0 +1,146 @@
+/***************************************************************************
+ *   Copyright (C) 2006, IBM                                               *
+ *                                                                         *
+ *   Maintained By:                                                        *
+ *   Eric Munson and Brad Peters                                           *
+ *   munsone@us.ibm.com, bpeters@us.ibm.com                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the Lesser GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of the  *
+ *   License, or at your option) any later version.                        *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Lesser General Public License for more details.                   *
+ *                                                                         *
+ *   You should have received a copy of the Lesser GNU General Public      *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef LSVPDTREEINDEX_HPP
+#define LSVPDTREEINDEX_HPP
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <libvpd-2/component.hpp>
+#include <libvpd-2/lsvpd.hpp>
+#include <libvpd-2/system.hpp>
+
+using namespace std;
+
+namespace lsvpd
+{
+
+	/**
+	 * A TreeIndex finds the Components of a loaded tree by the keys agents
+	 * look them up with, in constant time instead of a walk over the
+	 * leaves.  It is built in one pass over the tree, which also sets the
+	 * parent of every Component (see Component::getParentComponent).
+	 *
+	 * The index holds pointers into the tree: it must not be used once the
+	 * tree is deleted, and a Component that is changed, added or removed
+	 * afterwards is not reflected until the index is rebuilt.  Empty keys
+	 * are not indexed, nor is the major:minor of a Component with 0:0.
+	 *
+	 * @class TreeIndex
+	 *
+	 * @ingroup lsvpd
+	 *
+	 * @brief
+	 *   Multi-key lookup over a tree of VPD
+	 */
+	class TreeIndex
+	{
+		public:
+			typedef vector<Component*> Matches;
+
+		private:
+			typedef unordered_map<string, Component*> UniqueMap;
+			typedef unordered_map<string, Matches> MultiMap;
+
+			UniqueMap mByID;
+			UniqueMap mBySysFsNode;
+			MultiMap mByDevBusAddr;
+			MultiMap mBySerialNumber;
+			MultiMap mByLocation;
+			unordered_map<u64, Matches> mByDevice;
+
+			static const Matches NONE;
+
+			void add( Component* comp, Component* parent );
+
+			static Component* lookup( const UniqueMap& map, const string& key );
+			static const Matches& lookup( const MultiMap& map,
+				const string& key );
+
+			TreeIndex( const TreeIndex& copyMe ) = delete;
+			TreeIndex& operator=( const TreeIndex& rhs ) = delete;
+
+		public:
+			/**
+			 * Indexes every Component below root.
+			 */
+			TreeIndex( System* root );
+
+			/**
+			 * @return
+			 *   The number of Components indexed.
+			 */
+			inline size_t size( ) const { return mByID.size( ); }
+
+			/**
+			 * @return
+			 *   The Component with the given ID, NULL if there is none.
+			 */
+			inline Component* findByID( const string& id ) const
+				{ return lookup( mByID, id ); }
+
+			/**
+			 * @return
+			 *   The Component for the given sysfs node, NULL if there is
+			 * none.
+			 */
+			inline Component* findBySysFsNode( const string& node ) const
+				{ return lookup( mBySysFsNode, node ); }
+
+			/**
+			 * @return
+			 *   Every Component with the given address on its bus, in
+			 * tree order.
+			 */
+			inline const Matches& findByDevBusAddr( const string& addr ) const
+				{ return lookup( mByDevBusAddr, addr ); }
+
+			/**
+			 * @return
+			 *   Every Component with the given serial number, in tree
+			 * order.
+			 */
+			inline const Matches& findBySerialNumber( const string& sn ) const
+				{ return lookup( mBySerialNumber, sn ); }
+
+			/**
+			 * @return
+			 *   Every Component with the given physical location code,
+			 * in tree order.
+			 */
+			inline const Matches& findByLocation( const string& loc ) const
+				{ return lookup( mByLocation, loc ); }
+
+			/**
+			 * @return
+			 *   Every Component with the given device numbers (see
+			 * Component::getMajor and Component::getMinor), in tree
+			 * order.
+			 */
+			const Matches& findByDevice( int major, int minor ) const;
+	};
+}
+
+#endif /*LSVPDTREEINDEX_HPP*/
@@ -36,7 +36,9 @@
 #define TABLE_NAME       "components"
 #define ID               "comp_id"
 #define DATA             "comp_data"
+#define KEYWORD_TABLE    "keywords"
 #define MAX_NAME_LENGTH  256
+#define FETCH_BATCH_SIZE 500
 
 #if HAVE_SQLITE3_PREPARE_V2
 #define SQLITE3_PREPARE sqlite3_prepare_v2
@@ -52,9 +54,52 @@ struct vpddbenv
 	sqlite3 *db;
 };
 
+/*
+ * A vpdcursor streams the rows of a scan one at a time in comp_id order.  id
+ * points at the current row's ID and is only valid until the next call to
+ * cursor_next, which returns 1 for a row, 0 at the end of the scan and -1 if
+ * reading the next row failed.
+ */
+struct vpdcursor
+{
+	struct vpddbenv *dbenv;
+	sqlite3_stmt *stmt;
+	const char *id;
+};
+
 struct vpddbenv * new_vpddbenv( const char *dir, const char *file );
 void free_vpddbenv( struct vpddbenv *freeme );
 struct component* fetch_component( struct vpddbenv *db, const char *deviceID );
+struct component* fetch_component_fields( struct vpddbenv *db,
+		const char *deviceID, u64 fields );
+struct component* fetch_component_arena( struct vpddbenv *db,
+		const char *deviceID, u64 fields, struct vpdarena *arena );
+int fetch_components( struct vpddbenv *db, const char **deviceIDs, int count,
+		struct component **out );
 struct system* fetch_system( struct vpddbenv *db );
+struct vpdcursor * scan_prefix( struct vpddbenv *db, const char *prefix );
+struct vpdcursor * scan_range( struct vpddbenv *db, const char *first,
+		const char *last );
+int cursor_next( struct vpdcursor *cursor );
+struct component * cursor_component( struct vpdcursor *cursor );
+void free_cursor( struct vpdcursor *freeme );
+int find_by_keyword( struct vpddbenv *db, const char *ac, const char *value,
+		struct list **out );
+
+/*
+ * Registers the VPD SQL functions and virtual table on db, which new_vpddbenv
+ * does for its own connection; call this to use them from a connection opened
+ * some other way.  They read the packed components without unpacking them:
+ *   vpd_field( comp_data, key ) returns the value of the field named key
+ *     (e.g. 'SERIAL_NUMBER'), or else of keyword key (e.g. 'SN') from the
+ *     fixed fields or the device specific, user data and AIX name lists,
+ *     preferring a match that has a value.
+ *   vpd_children( comp_data ) returns the child ID's as a JSON array.
+ *   vpd_components is a table with one row per component, the columns are
+ *     comp_id, one per field named as in fields.h and children as JSON.
+ * Both functions return NULL for anything that is not a packed component,
+ * the system row among them.  Returns an SQLite result code.
+ */
+int register_vpd_sql( sqlite3 *db );
 
 #endif /*VPDDBENV_H_*/
@@ -73,6 +73,116 @@ namespace lsvpd
 						bool readOnly );
 					~UpdateLock();
 			};
+
+			/**
+			 * A Cursor walks the rows of a scan one at a time, in comp_id
+			 * order, holding only the current row in memory.  The
+			 * Component for a row is only unpacked when asked for.  A
+			 * Cursor must be deleted before the VpdDbEnv that created it.
+			 */
+			class Cursor {
+				private:
+					friend VpdDbEnv;
+					sqlite3* mpVpdDb;
+					sqlite3_stmt* mpStmt;
+					string mID;
+					bool mFailed;
+
+					Cursor( sqlite3* db, sqlite3_stmt* stmt );
+					Cursor( const Cursor& copyMe ) = delete;
+					Cursor& operator=( const Cursor& rhs ) = delete;
+				public:
+					~Cursor();
+
+					/**
+					 * Advances to the next row of the scan.
+					 *
+					 * @returns
+					 *   true if there is a current row, false once the scan
+					 * is exhausted or an error was logged, see failed( ).
+					 */
+					bool next( );
+
+					/**
+					 * Tells a scan that ended early from one that reached
+					 * the end: once next( ) has returned false, the rows
+					 * it visited are all there are only if this is false.
+					 *
+					 * @returns
+					 *   true if next( ) stopped because reading the next
+					 * row failed.
+					 */
+					inline bool failed( ) const { return mFailed; }
+
+					/**
+					 * @returns
+					 *   The ID of the current row.
+					 */
+					inline const string& getID( ) const { return mID; }
+
+					/**
+					 * Unpacks the current row.  The pointer returned is
+					 * "newed" and the caller is responsible for deleting it.
+					 *
+					 * @param fields
+					 *   The fields to decode, the rest are not loaded
+					 * @returns
+					 *   The Component stored in the current row.
+					 * @throws VpdException
+					 *   If the row is corrupt.
+					 */
+					Component* getComponent( Component::FieldMask fields =
+								Component::ALL_FIELDS );
+			};
+
+			/**
+			 * What a journal entry records being done to a row.
+			 */
+			enum JournalOp {
+				JOURNAL_STORE = 1,  ///< Stored or replaced
+				JOURNAL_REMOVE = 2  ///< Removed
+			};
+
+			/**
+			 * One entry of the change journal.
+			 */
+			struct JournalEntry {
+				u64 generation;
+				string id;
+				JournalOp op;
+				u64 hash;  ///< Of the data stored, 0 for a removal
+			};
+
+			/**
+			 * The lists of a Component whose items are kept in the
+			 * keyword table, as bits so that queries can ask for several.
+			 */
+			enum KeywordList {
+				KEYWORD_DEVICE_SPECIFIC = 1,
+				KEYWORD_USER_DATA = 2,
+				KEYWORD_AIX_NAME = 4,
+				ALL_KEYWORD_LISTS = 7
+			};
+
+			/**
+			 * The levels of a Component that are kept in the version
+			 * table, as bits so that queries can ask for several.
+			 */
+			enum VersionField {
+				VERSION_FIRMWARE_LEVEL = 1,    ///< getFirmwareLevel( )
+				VERSION_FIRMWARE_VERSION = 2,  ///< getFirmwareVersion( )
+				VERSION_MICROCODE_LEVEL = 4,   ///< getMicroCodeLevel( )
+				ALL_VERSION_FIELDS = 7
+			};
+
+			/**
+			 * One row of a delta file, see exportDelta.
+			 */
+			struct DeltaRecord {
+				JournalOp op;
+				string id;
+				string data;  ///< The packed row, empty for a removal
+			};
 		private:
 			VpdDbEnv& operator=( const VpdDbEnv& rhs ) = delete;
 			VpdDbEnv( const VpdDbEnv& copyMe ) = delete;
@@ -83,6 +193,28 @@ namespace lsvpd
 			string mEnvDir;
 			string mDbPath;
 			sqlite3* mpVpdDb;
+			sqlite3_stmt* mpFetchStmt;
+			u64 mJournalRetention;
+			bool mHasSearch;
+
+			const void* fetchBlob( const string& deviceID );
+			bool storePacked( const string& id, const void* data,
+					unsigned int dataSize, bool replace );
+			bool journal( const string& id, JournalOp op, u64 hash );
+			bool execute( const string& sql );
+			bool hasTable( const string& name );
+			bool indexKeywords( const string& id, const void* data );
+			bool unindexKeywords( const string& id );
+			vector<string> findKeyword( const string& ac, const string* value,
+					int lists );
+			bool indexVersions( const string& id, const void* data );
+			bool unindexVersions( const string& id );
+			sqlite3_int64 searchRowid( const string& id );
+			bool indexSearch( const string& id, const void* data,
+					unsigned int dataSize );
+			bool unindexSearch( const string& id );
+			vector<string> searchScan( const vector<string>& terms,
+					unsigned int limit );
 
 		public:
 			// Table name for the components
@@ -90,6 +222,27 @@ namespace lsvpd
 			static const string ID;
 			static const string DATA;
 
+			// Table name for the change journal
+			static const string JOURNAL_TABLE;
+
+			// Table name for the epoch of the change journal
+			static const string EPOCH_TABLE;
+
+			// Table name for the keyword index
+			static const string KEYWORD_TABLE;
+
+			// Table name for the full text search index
+			static const string SEARCH_TABLE;
+
+			// Table name for the version index
+			static const string VERSION_TABLE;
+
+			// Journal entries kept by default, see setJournalRetention
+			static const u64 DEFAULT_JOURNAL_RETENTION = 100000;
+
+			// Number of ID's bound into a single multi-get statement
+			static const unsigned int BATCH_SIZE = 500;
+
 			VpdDbEnv( const string& envDir, const string& dbFileName,
 						bool readOnly );
 			VpdDbEnv( const VpdDbEnv::UpdateLock&);
@@ -102,15 +255,75 @@ namespace lsvpd
 			 * thrown if there is an unrecoverable problem communicating with
 			 * the database.
 			 *
+			 * Only the fields selected in fields are decoded, the others
+			 * are skipped without being copied and are reported as not
+			 * loaded by Component::isLoaded.
+			 *
 			 * @param deviceID
 			 *   The ID for the device information to retrieve from the db
+			 * @param fields
+			 *   The fields to decode, all of them by default
 			 * @returns
 			 *   The collection of device information
 			 * @throws VpdException
 			 *   In the event of an unrecoverable error (e.g. new returns NULL,
 			 * database is corrupt, etc.) a VpdException will be thrown.
 			 */
-			Component* fetch( const string& deviceID );
+			Component* fetch( const string& deviceID,
+					Component::FieldMask fields = Component::ALL_FIELDS );
+
+			/**
+			 * fetchInto loads the specified Component into out instead
+			 * of a newly allocated object.  The strings and vectors
+			 * already in out are reused, so fetching many Components
+			 * into the same object does not allocate once it has grown
+			 * to fit them.  The lookup statement is prepared once and
+			 * kept for the life of this VpdDbEnv.
+			 *
+			 * @param deviceID
+			 *   The ID for the device information to retrieve from the db
+			 * @param out
+			 *   The Component to overwrite
+			 * @param fields
+			 *   The fields to decode, all of them by default
+			 * @returns
+			 *   true if the Component was found, false if it was not or
+			 * an error was logged, in which case out is unchanged.
+			 * @throws VpdException
+			 *   If the stored Component is corrupt.
+			 */
+			bool fetchInto( const string& deviceID, Component& out,
+					Component::FieldMask fields = Component::ALL_FIELDS );
+
+			/**
+			 * Fetch attempts to load every one of the specified Components
+			 * from the VPD database, issuing a single query for each batch
+			 * of BATCH_SIZE ID's rather than one query per ID.  The
+			 * returned vector is in the same order as deviceIDs; the entry
+			 * for an ID that is not in the database is NULL and that ID is
+			 * appended to missing (if it is not NULL).  The result is all
+			 * or nothing: when a query fails or a stored Component is
+			 * corrupt, the Components already loaded are freed and a
+			 * VpdException is thrown instead of returning a partial vector.
+			 *
+			 * NOTE: Every non-NULL pointer returned is "newed" by this
+			 * method and the caller is responsible for deleting it.
+			 *
+			 * @param deviceIDs
+			 *   The ID's for the device information to retrieve from the db
+			 * @param missing
+			 *   Optional, filled with the ID's that were not found
+			 * @param fields
+			 *   The fields to decode, all of them by default
+			 * @returns
+			 *   The collection of device information, one per requested ID
+			 * @throws VpdException
+			 *   If a query fails, new fails or a stored Component is
+			 * corrupt.  Nothing is returned or added to missing then.
+			 */
+			vector<Component*> fetch( const vector<string>& deviceIDs,
+						vector<string>* missing = NULL,
+						Component::FieldMask fields = Component::ALL_FIELDS );
 
 			/**
 			 * Fetch attempts to load the root System from the VPD database.
@@ -127,6 +340,20 @@ namespace lsvpd
 			 */
 			System* fetch( );
 
+			/**
+			 * fetchPacked copies the stored form of a row, Component or
+			 * System, into out without unpacking it.
+			 *
+			 * @param id
+			 *   The ID of the row
+			 * @param out
+			 *   Overwritten with the packed data
+			 * @returns
+			 *   true if the row was found, false if it was not or an
+			 * error was logged.
+			 */
+			bool fetchPacked( const string& id, string& out );
+
 			/**
 			 * Store attempts to save the specified Component to the VPD
 			 * database.  If the save is not successfull, store will return
@@ -159,6 +386,30 @@ namespace lsvpd
 			 */
 			bool store( System *storeMe );
 
+			/**
+			 * Upsert saves the specified Component like store, but
+			 * replaces the row of a Component with the same ID if there
+			 * is one, so a single changed device can be written back
+			 * without removing it first.
+			 *
+			 * @param storeMe
+			 *   The device information to store into the db
+			 * @returns
+			 *  true is everything succeeded, fales otherwise
+			 */
+			bool upsert( Component *storeMe );
+
+			/**
+			 * Upsert saves the specified System like store, replacing
+			 * the one already in the database.
+			 *
+			 * @param storeMe
+			 *   The system information to store into the db
+			 * @returns
+			 *  true is everything succeeded, fales otherwise
+			 */
+			bool upsert( System *storeMe );
+
 			/**
 			 * Remove deletes the specified Component from the VPD database, if
 			 * the delete is unsuccessfull remove will return false.  A
@@ -187,6 +438,337 @@ namespace lsvpd
 			 * database is corrupt, etc.) a VpdException will be thrown.
 			 */
 			vector<string> getKeys( );
+
+			/**
+			 * getKeys returns one page of the keys in the VPD database, in
+			 * comp_id order.  Pass an empty resumeToken for the first page
+			 * and the nextToken of each page to get the page after it.
+			 * nextToken is set to an empty string once there are no more
+			 * pages.
+			 *
+			 * @param resumeToken
+			 *   Where to continue from, empty for the first page
+			 * @param pageSize
+			 *   The maximum number of keys to return
+			 * @param nextToken
+			 *   Filled with the resume token for the following page
+			 * @returns
+			 *   Up to pageSize device ID's
+			 */
+			vector<string> getKeys( const string& resumeToken,
+						unsigned int pageSize, string& nextToken );
+
+			/**
+			 * scanPrefix opens a Cursor over every Component whose ID
+			 * starts with prefix (e.g. all the devices below a sysfs
+			 * directory).  The scan is a range seek on the comp_id index.
+			 * The pointer returned is "newed" and the caller is
+			 * responsible for deleting it.
+			 *
+			 * @param prefix
+			 *   The leading part of the ID's to visit
+			 * @returns
+			 *   A Cursor positioned before the first match, NULL on error
+			 */
+			Cursor* scanPrefix( const string& prefix );
+
+			/**
+			 * scanRange opens a Cursor over every Component whose ID is in
+			 * [first, last).  An empty last means there is no upper bound.
+			 * The pointer returned is "newed" and the caller is
+			 * responsible for deleting it.
+			 *
+			 * @param first
+			 *   The lowest ID to visit
+			 * @param last
+			 *   The ID to stop before, or empty to scan to the end
+			 * @returns
+			 *   A Cursor positioned before the first match, NULL on error
+			 */
+			Cursor* scanRange( const string& first, const string& last );
+
+			/**
+			 * Every store, upsert and remove made through a writable
+			 * VpdDbEnv appends an entry to a journal table in the same
+			 * database, inside the same transaction as the change itself,
+			 * and each entry gets the next generation number.
+			 *
+			 * Generations only mean something within one journal: a
+			 * database that is deleted and built again starts over at 1.
+			 * So the journal also has an epoch, a random number picked
+			 * when it is created, and a generation is only valid together
+			 * with the epoch it was read with.
+			 *
+			 * @param epoch
+			 *   If not NULL, set to the epoch of the journal, see
+			 * getEpoch
+			 * @returns
+			 *   The generation of the newest change, 0 if there is none
+			 * or the database has no journal.
+			 */
+			u64 getGeneration( u64* epoch = NULL );
+
+			/**
+			 * @returns
+			 *   The epoch of the change journal, never 0 for a database
+			 * that has a journal, 0 for one that has none.
+			 */
+			u64 getEpoch( );
+
+			/**
+			 * changesSince lists the journal entries made after
+			 * generation, oldest first.  A collector keeps a copy of the
+			 * database and the epoch and generation it had, and then only
+			 * asks for what changed since.
+			 *
+			 * @param epoch
+			 *   The epoch generation was read with
+			 * @param generation
+			 *   The newest generation the caller already has
+			 * @param out
+			 *   Filled with the entries after generation
+			 * @returns
+			 *   false if epoch is not the epoch of this journal (the
+			 * database was built anew since) or the journal no longer
+			 * reaches back to generation (it was compacted), in which
+			 * case a full copy is needed.
+			 */
+			bool changesSince( u64 epoch, u64 generation,
+					vector<JournalEntry>& out );
+
+			/**
+			 * exportDelta writes the rows changed after generation to
+			 * fileName, each ID once with its current data (or as
+			 * removed), so that another copy of the database can be
+			 * brought up to date with applyDelta.  The file records
+			 * epoch, so the copy can ask for the next delta.
+			 *
+			 * @param epoch
+			 *   The epoch generation was read with
+			 * @param upTo
+			 *   If not NULL, set to the generation the delta reaches
+			 * @returns
+			 *   false if epoch is not the epoch of this journal, the
+			 * journal no longer reaches back to generation or the file
+			 * could not be written.
+			 */
+			bool exportDelta( u64 epoch, u64 generation,
+					const string& fileName, u64* upTo = NULL );
+
+			/**
+			 * applyDelta makes the changes in a file written by
+			 * exportDelta to this database, all of them or none.
+			 *
+			 * @param upTo
+			 *   If not NULL, set to the generation of the source database
+			 * that the delta reaches
+			 * @param epoch
+			 *   If not NULL, set to the epoch of the source database
+			 * @returns
+			 *   false if the file is corrupt or a change failed.
+			 */
+			bool applyDelta( const string& fileName, u64* upTo = NULL,
+					u64* epoch = NULL );
+
+			/**
+			 * readDelta loads the rows of a file written by exportDelta
+			 * without applying them anywhere.
+			 *
+			 * @param from
+			 *   If not NULL, set to the generation the delta starts
+			 * after
+			 * @param upTo
+			 *   If not NULL, set to the generation the delta reaches
+			 * @param epoch
+			 *   If not NULL, set to the epoch of the source database
+			 * @returns
+			 *   false if the file could not be read or is corrupt.
+			 */
+			static bool readDelta( const string& fileName,
+					vector<DeltaRecord>& records, u64* from = NULL,
+					u64* upTo = NULL, u64* epoch = NULL );
+
+			/**
+			 * Sets how many of the newest journal entries are kept, older
+			 * ones are dropped from time to time as new ones are added.  A
+			 * collector that falls further behind than this needs a full
+			 * copy.
+			 */
+			inline void setJournalRetention( u64 entries )
+				{ mJournalRetention = entries > 0 ? entries : 1; }
+
+			/**
+			 * Besides the packed rows, a writable VpdDbEnv keeps a
+			 * keyword table with one (comp_id, list, ac, value) row for
+			 * each device specific item, user data item and AIX name of
+			 * every Component, and for the device specific items of the
+			 * System.  It is updated along with the row on every store
+			 * and remove, and is indexed on (ac, value), so finding the
+			 * Components with a given keyword does not unpack anything.
+			 *
+			 * @param ac
+			 *   The keyword, e.g. "Z3", or "AX" for the AIX names
+			 * @param value
+			 *   The value it must have
+			 * @param lists
+			 *   The KeywordList bits of the lists to look in
+			 * @returns
+			 *   The ID's of the matching Components, sorted.
+			 */
+			inline vector<string> findByKeyword( const string& ac,
+					const string& value, int lists = ALL_KEYWORD_LISTS )
+				{ return findKeyword( ac, &value, lists ); }
+
+			/**
+			 * Like findByKeyword, but matches any value of ac.
+			 */
+			inline vector<string> findWithKeyword( const string& ac,
+					int lists = ALL_KEYWORD_LISTS )
+				{ return findKeyword( ac, NULL, lists ); }
+
+			/**
+			 * Rebuilds the keyword table from the packed rows.  This is
+			 * done when a database written before the table existed is
+			 * first opened for writing.
+			 *
+			 * @returns
+			 *   false if an error was logged, the table is unchanged then.
+			 */
+			bool rebuildKeywords( );
+
+			/**
+			 * Besides the packed rows, a writable VpdDbEnv keeps a version
+			 * table with one (comp_id, field, value, vkey) row for each
+			 * firmware level, firmware version and microcode level (the
+			 * "ML" device specific item) of every Component, where vkey is
+			 * HelperFunctions::versionKey( value ).  It is indexed on
+			 * (field, vkey), so finding the Components at a range of
+			 * levels is one index range scan per field and unpacks
+			 * nothing.  The levels are compared as versionKey describes,
+			 * a level with no letters or digits is not kept.
+			 *
+			 * @param from
+			 *   The oldest level to match, empty for no lower bound
+			 * @param to
+			 *   The first level that is too new to match, empty for no
+			 * upper bound
+			 * @param fields
+			 *   The VersionField bits of the levels to look at
+			 * @returns
+			 *   The ID's of the Components that have a level in
+			 * [from, to), sorted.
+			 */
+			vector<string> findVersionRange( const string& from,
+					const string& to, int fields = ALL_VERSION_FIELDS );
+
+			/**
+			 * Finds the Components with a level older than version, e.g.
+			 * findOlderThan( "FW950.50", VERSION_FIRMWARE_LEVEL ).
+			 */
+			inline vector<string> findOlderThan( const string& version,
+					int fields = ALL_VERSION_FIELDS )
+				{ return findVersionRange( "", version, fields ); }
+
+			/**
+			 * Finds the Components with a level at least as new as
+			 * version.
+			 */
+			inline vector<string> findAtLeast( const string& version,
+					int fields = ALL_VERSION_FIELDS )
+				{ return findVersionRange( version, "", fields ); }
+
+			/**
+			 * Rebuilds the version table from the packed rows.  This is
+			 * done when a database written before the table existed is
+			 * first opened for writing.
+			 *
+			 * @returns
+			 *   false if an error was logged, the table is unchanged then.
+			 */
+			bool rebuildVersions( );
+
+			/**
+			 * Finds the Components with values that contain every word of
+			 * text, ignoring case.  A word matches anywhere in a single
+			 * value, so a fragment of a serial number, a part number
+			 * prefix or a word of a description all work.  Every field
+			 * and every device specific, user data and AIX name value is
+			 * searched.
+			 *
+			 * The full text index (see setSearchIndex) answers queries
+			 * whose words are all at least three characters long.
+			 * Anything else, or any query on a database without the
+			 * index, is answered by scanning the packed rows without
+			 * unpacking them.
+			 *
+			 * @param text
+			 *   The words to look for, separated by white space
+			 * @param limit
+			 *   The most ID's to return, 0 for all of them
+			 * @returns
+			 *   The ID's of the matching Components, best matches first.
+			 */
+			vector<string> search( const string& text, unsigned int limit = 0 );
+
+			/**
+			 * @returns
+			 *   true if search can use the full text index.
+			 */
+			inline bool hasSearchIndex( ) const { return mHasSearch; }
+
+			/**
+			 * Creates or drops the full text index in SEARCH_TABLE.  It is
+			 * off by default because it makes a store two to three times
+			 * slower and the database about twice as large.
+			 * Once created it is kept up to date by every writable
+			 * VpdDbEnv along with the packed rows.  It needs FTS5 with its
+			 * trigram tokenizer (SQLite 3.34).
+			 *
+			 * @param enabled
+			 *   true to create the index from the rows already stored,
+			 * false to drop it
+			 * @returns
+			 *   false if an error was logged, e.g. the database is read
+			 * only or SQLite has no FTS5.
+			 */
+			bool setSearchIndex( bool enabled );
+
+			/**
+			 * Rebuilds the search index from the packed rows.
+			 *
+			 * @returns
+			 *   false if there is no index or an error was logged, the
+			 * index is unchanged then.
+			 */
+			bool rebuildSearch( );
+
+			/**
+			 * Registers the VPD SQL functions and the vpd_components
+			 * virtual table on db, every VpdDbEnv does this for its own
+			 * connection.  They work on the packed rows directly, so
+			 * filters, GROUP BYs and joins over VPD fields run inside
+			 * SQLite, e.g.
+			 *
+			 *   SELECT model, firmware_level, count( * )
+			 *     FROM vpd_components GROUP BY 1, 2;
+			 *   SELECT comp_id FROM components
+			 *     WHERE vpd_field( comp_data, 'SN' ) = 'YL1234';
+			 *
+			 * vpd_field( comp_data, key ) returns the field named key as
+			 * in Component::Field without the FIELD_ prefix, or else the
+			 * first item with keyword key that has a value, looking in the
+			 * fixed fields and then the device specific, user data and AIX
+			 * name lists.  vpd_children( comp_data ) returns the child
+			 * ID's as a JSON array.  vpd_components has the columns
+			 * comp_id, one per field named the same way and children.
+			 * The System row is not a Component and is left out.
+			 *
+			 * @param db
+			 *   A connection to a VPD database
+			 * @returns
+			 *   false if an error was logged.
+			 */
+			static bool registerSqlFunctions( sqlite3* db );
 	};
 }
 #endif
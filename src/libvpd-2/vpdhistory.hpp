@@ -0,0 +1,173 @@
+/***************************************************************************
+ *   Copyright (C) 2006, IBM                                               *
+ *                                                                         *
+ *   Maintained By:                                                        *
+ *   Eric Munson and Brad Peters                                           *
+ *   munsone@us.ibm.com, bpeters@us.ibm.com                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the Lesser GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of the  *
+ *   License, or at your option) any later version.                        *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Lesser General Public License for more details.                   *
+ *                                                                         *
+ *   You should have received a copy of the Lesser GNU General Public      *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef LSVPDVPDHISTORY_HPP
+#define LSVPDVPDHISTORY_HPP
+
+#include <string>
+#include <vector>
+#include <ctime>
+#include <sqlite3.h>
+
+#include <libvpd-2/component.hpp>
+#include <libvpd-2/lsvpd.hpp>
+#include <libvpd-2/system.hpp>
+#include <libvpd-2/vpddbenv.hpp>
+
+using namespace std;
+
+namespace lsvpd
+{
+
+	/**
+	 * A VpdHistory keeps every version of every row a VPD database has
+	 * held, in a database of its own, so that the tree can be rebuilt as
+	 * it was at some earlier time.  Nothing is kept unless capture is
+	 * called, typically after each run of vpdupdate.
+	 *
+	 * A version is stored as a delta against the one before it: the
+	 * stretches of the packed data that did not change are copied and
+	 * only the rest is stored.  Every KEYFRAME_INTERVAL versions of a row
+	 * (and whenever the delta would not be smaller) the whole row is
+	 * stored instead, so no version takes more than that many deltas to
+	 * rebuild.
+	 *
+	 * @class VpdHistory
+	 *
+	 * @ingroup lsvpd
+	 *
+	 * @brief
+	 *   Past versions of the VPD database
+	 */
+	class VpdHistory
+	{
+		public:
+			/**
+			 * A version of a row.
+			 */
+			struct Version
+			{
+				time_t when;
+				bool removed;
+			};
+
+		private:
+			// The newest version of a row at some time.
+			struct Latest
+			{
+				u64 seq;
+				bool removed;
+				u64 hash;
+			};
+
+			string mDbPath;
+			sqlite3* mpHistDb;
+			sqlite3_stmt* mpLatestStmt;
+			sqlite3_stmt* mpRebuildStmt;
+
+			VpdHistory( const VpdHistory& copyMe ) = delete;
+			VpdHistory& operator=( const VpdHistory& rhs ) = delete;
+
+			bool execute( const string& sql );
+			void logError( int rc );
+			int prepare( sqlite3_stmt*& stmt, const string& sql );
+			bool latest( const string& id, time_t when, Latest& out );
+			bool rebuild( const string& id, u64 seq, string& out );
+			bool addVersion( const string& id, time_t when, u64 seq,
+				const string* prev, const string* data );
+			bool record( const string& id, time_t when, const string* data,
+				unsigned int& changed );
+			void buildSubTree( Component* root, time_t when,
+				Component::FieldMask fields );
+
+		public:
+			// Number of versions of a row between two full copies
+			static const u64 KEYFRAME_INTERVAL = 16;
+
+			/**
+			 * Opens the history database, creating it if needed.
+			 *
+			 * @throws VpdException
+			 *   If the database cannot be opened or created.
+			 */
+			VpdHistory( const string& envDir, const string& dbFileName );
+			~VpdHistory( );
+
+			/**
+			 * Records the rows of db that changed since the last
+			 * capture, as of when.  Only the rows named by the journal
+			 * of db are looked at (see VpdDbEnv::changesSince), unless
+			 * the journal does not reach back to the last capture or
+			 * has another epoch than the one it was taken from (db is
+			 * another database, or was built anew), in which case every
+			 * row is compared.
+			 *
+			 * @param db
+			 *   The database to record
+			 * @param when
+			 *   The time to record the changes at, no earlier than that
+			 * of the last capture
+			 * @param changed
+			 *   If not NULL, set to the number of versions recorded
+			 * @returns
+			 *   false if an error was logged, nothing is recorded then.
+			 */
+			bool capture( VpdDbEnv& db, time_t when = time( NULL ),
+					unsigned int* changed = NULL );
+
+			/**
+			 * Rebuilds the tree as it was at when.
+			 *
+			 * NOTE: The pointer returned is "newed" by this method but the
+			 * caller will be responsible for deleting it.
+			 *
+			 * @param fields
+			 *   The fields to decode, all of them by default
+			 * @returns
+			 *   The root of the tree, NULL if nothing was captured by
+			 * then.
+			 */
+			System* asOf( time_t when, Component::FieldMask fields =
+						Component::ALL_FIELDS );
+
+			/**
+			 * Rebuilds one Component as it was at when.
+			 *
+			 * NOTE: The pointer returned is "newed" by this method but the
+			 * caller will be responsible for deleting it.
+			 *
+			 * @returns
+			 *   The Component, NULL if it was not in the database then.
+			 */
+			Component* componentAsOf( const string& id, time_t when,
+					Component::FieldMask fields = Component::ALL_FIELDS );
+
+			/**
+			 * @returns
+			 *   Every version recorded for id, oldest first.
+			 */
+			vector<Version> getVersions( const string& id );
+	};
+}
+
+#endif /*LSVPDVPDHISTORY_HPP*/
@@ -39,6 +39,33 @@ struct vpdretriever
 	struct vpddbenv *dbenv;
 };
 
+/*
+ * A load time filter for get_component_tree_filtered.  matches is called on
+ * each component once the fields it asks for have been decoded, a non-zero
+ * return keeps the component.  may_contain is optional, it is called before
+ * the children of a component are fetched and returning 0 skips the whole
+ * subtree.  arg is handed to both.
+ */
+struct component_filter
+{
+	u64 fields;
+	int (*matches)( const struct component *comp, void *arg );
+	int (*may_contain)( const struct component *comp, void *arg );
+	void *arg;
+};
+
+/*
+ * A component tree whose components are all allocated from one arena, so it
+ * is torn down by releasing a handful of blocks instead of free'ing every
+ * component, dataitem and string on its own.  root itself is malloc'd as
+ * usual, everything below it belongs to arena.
+ */
+struct component_tree
+{
+	struct vpdarena *arena;
+	struct system *root;
+};
+
 /*
  * Creates a new vpdretiever, takes a directory where the VPD db lives, a
  * filename for the db to query, and an unsigned 32 bit integer that holds the
@@ -63,6 +90,35 @@ void free_vpdretriever( struct vpdretriever *freeme );
  */
 struct system * get_component_tree( struct vpdretriever *dbenv );
 
+/*
+ * Like get_component_tree, but each component only has the fields selected
+ * by fields (a mask of COMP_FIELD_BIT values from component.h) decoded, the
+ * rest are left NULL and their bits are clear in component->loaded.  The
+ * children are always decoded so the tree can be built.
+ */
+struct system * get_component_tree_fields( struct vpdretriever *dbenv,
+		u64 fields );
+
+/*
+ * Like get_component_tree_fields, but the components are placed in an arena.
+ * The pointer returned is malloc'd and must be free'd using
+ * free_component_tree, never by calling free_system on its root.  On error
+ * NULL is returned.
+ */
+struct component_tree * load_component_tree( struct vpdretriever *dbenv,
+		u64 fields );
+void free_component_tree( struct component_tree *freeme );
+
+/*
+ * Retrieves only the components that match filter, along with their
+ * ancestors.  A component that neither matches nor has a kept descendant is
+ * free'd as soon as its subtree has been visited.  childrenIDs still names
+ * every child, children only holds the kept ones.  The pointer returned
+ * should be free'd using free_system.  On error NULL is returned.
+ */
+struct system * get_component_tree_filtered( struct vpdretriever *dbenv,
+		const struct component_filter *filter );
+
 /*
  * Retrieves the specified component.  The pointer returned is malloc'd and
  * should be free'd using free_component function from component.h.  On error
@@ -70,6 +126,47 @@ struct system * get_component_tree( struct vpdretriever *dbenv );
  */
 struct component * get_component( struct vpdretriever *dbenv, const char *id );
 
+/*
+ * Like get_component, but only the fields selected by fields are decoded.
+ */
+struct component * get_component_fields( struct vpdretriever *dbenv,
+		const char *id, u64 fields );
+
+/*
+ * Retrieves count components in one query per batch of ids rather than one
+ * query per id.  out must have room for count pointers; out[i] is set to the
+ * component for ids[i] or to NULL if that id is not in the db.  Each non-NULL
+ * pointer is malloc'd and should be free'd using free_component.  Returns the
+ * number of components found, or -1 on error.  On error the components
+ * already fetched are free'd and every entry of out is NULL.
+ */
+int get_components( struct vpdretriever *dbenv, const char **ids, int count,
+		struct component **out );
+
+/*
+ * Opens a streaming scan over the components whose id starts with prefix, or
+ * whose id is in [first, last) (a NULL last scans to the end).  Step through
+ * the rows with cursor_next, which returns 1 while there is a current row, 0
+ * at the end of the scan and -1 on error, and unpack the current row with
+ * cursor_component.  The cursor is malloc'd and must be free'd using
+ * free_cursor before the vpdretriever is free'd.  On error NULL is returned.
+ */
+struct vpdcursor * get_components_by_prefix( struct vpdretriever *dbenv,
+		const char *prefix );
+struct vpdcursor * get_components_in_range( struct vpdretriever *dbenv,
+		const char *first, const char *last );
+
+/*
+ * Finds the components that have device specific keyword, user data keyword
+ * or AIX name ("AX") ac with the given value, or with any value if value is
+ * NULL, without unpacking any of them.  *out is set to a list of their ids
+ * in id order, which should be free'd using free_list from common.h.
+ * Returns the number of matches, or -1 on error (e.g. a db that was never
+ * opened for writing by a libvpd that keeps the keyword index).
+ */
+int get_components_by_keyword( struct vpdretriever *dbenv, const char *ac,
+		const char *value, struct list **out );
+
 /*
  * Retrieves the system level VPD.  The pointer returned is malloc'd and
  * should be free'd using free_system function from system.h.  On error
@@ -25,7 +25,12 @@
 #define LSVPDVPDRETRIEVER_HPP
 
 #include <libvpd-2/component.hpp>
+#include <libvpd-2/componentfilter.hpp>
+#include <libvpd-2/componentvisitor.hpp>
+#include <libvpd-2/locationtrie.hpp>
+#include <libvpd-2/snapshot.hpp>
 #include <libvpd-2/system.hpp>
+#include <libvpd-2/treeindex.hpp>
 #include <libvpd-2/vpddbenv.hpp>
 #include <libvpd-2/vpdexception.hpp>
 
@@ -36,8 +41,15 @@ namespace lsvpd
 	{
 		private:
 			VpdDbEnv* db;
-			void buildSubTree( System* root );
-			void buildSubTree( Component* root );
+			void buildSubTree( System* root, Component::FieldMask fields );
+			void buildSubTree( Component* root, Component::FieldMask fields );
+			Component* buildFiltered( const string& id,
+				const ComponentFilter& filter, Component::FieldMask probe,
+				Component::FieldMask fields, Component& scratch );
+			void buildSnapshot( const vector<string>& children,
+				const string& parentID, vector<SnapshotNodePtr>& leaves,
+				unordered_map<string, string>& parents,
+				Component::FieldMask fields );
 
 		public:
 			static const string DEFAULT_DIR;
@@ -79,10 +91,75 @@ namespace lsvpd
 			 * of the VPD for that device will be contained in the
 			 * corresponding entry only.
 			 *
+			 * Only the fields selected in fields are decoded for each
+			 * Component, the children are always loaded so that the tree
+			 * can be built.  The System itself is always fully loaded.
+			 *
+			 * @param fields
+			 *   The fields to decode, all of them by default
 			 * @return
 			 *   The root of the tree of device VPD.
 			 */
-			System* getComponentTree( );
+			System* getComponentTree( Component::FieldMask fields =
+						Component::ALL_FIELDS );
+
+			/**
+			 * Loads the tree like getComponentTree( ) and wraps it in a
+			 * Snapshot that can be shared between threads, see
+			 * SnapshotPublisher for handing newer ones out.
+			 *
+			 * @param fields
+			 *   The fields to decode, all of them by default
+			 * @return
+			 *   The only handle on the new Snapshot.
+			 */
+			SnapshotPtr getSnapshot( Component::FieldMask fields =
+						Component::ALL_FIELDS );
+
+			/**
+			 * Like getComponentTree( ), but only the Components that
+			 * match filter and their ancestors are kept.  The filter is
+			 * checked as each Component is loaded, decoded with just
+			 * filter.getFields( ) and the children: a subtree that
+			 * filter.mayContainMatch rules out is never read, and only
+			 * the Components that are kept are decoded again with
+			 * fields.  The children lists of the kept Components still
+			 * name every child, the leaves only hold the ones that were
+			 * kept.
+			 *
+			 * @param filter
+			 *   Chooses the Components to keep
+			 * @param fields
+			 *   The fields to decode in addition to filter.getFields( )
+			 * @return
+			 *   The root of the pruned tree of device VPD.
+			 */
+			System* getComponentTree( const ComponentFilter& filter,
+						Component::FieldMask fields = 0 );
+
+			/**
+			 * Streams the tree through visitor without building it.  The
+			 * traversal keeps a list of the ID's it has yet to visit and
+			 * one Component, which is reused for every row, so depth
+			 * first it holds at most depth times fan-out ID's and breadth
+			 * first at most two levels of them, whatever the size of the
+			 * tree.  Nothing is recursive.
+			 *
+			 * @param visitor
+			 *   Called once for each Component
+			 * @param order
+			 *   Depth first visits the Components in the same order
+			 * as a walk over getComponentTree( ) would
+			 * @param fields
+			 *   The fields to decode, the ID and children are always
+			 * decoded
+			 * @return
+			 *   false if visitor stopped the traversal.
+			 */
+			bool traverse( ComponentVisitor& visitor,
+					ComponentVisitor::Order order =
+						ComponentVisitor::DEPTH_FIRST,
+					Component::FieldMask fields = Component::ALL_FIELDS );
 
 			/**
 			 * Gets a specified Component from the database.  A Component is
@@ -94,11 +171,147 @@ namespace lsvpd
 			 *
 			 * @param id
 			 *   The string ID for the requested component.
+			 * @param fields
+			 *   The fields to decode, all of them by default.
 			 * @return
 			 *   A pointer to the requested information or NULL on failure.
 			 */
-			inline Component* getComponent( const string& id )
-				{ return db->fetch( id ); }
+			inline Component* getComponent( const string& id,
+					Component::FieldMask fields = Component::ALL_FIELDS )
+				{ return db->fetch( id, fields ); }
+
+			/**
+			 * Loads a specified Component into out, reusing the memory
+			 * it already holds.  Meant for loops that look at many
+			 * Components one at a time.
+			 *
+			 * @param id
+			 *   The string ID for the requested component.
+			 * @param out
+			 *   The Component to overwrite.
+			 * @param fields
+			 *   The fields to decode, all of them by default.
+			 * @return
+			 *   true if the Component was found.
+			 */
+			inline bool getComponentInto( const string& id, Component& out,
+					Component::FieldMask fields = Component::ALL_FIELDS )
+				{ return db->fetchInto( id, out, fields ); }
+
+			/**
+			 * Gets every one of the specified Components from the database
+			 * using one query per batch of ID's instead of one per ID.  The
+			 * results are in the same order as ids, an ID that is not in the
+			 * database yields a NULL entry and is reported in missing rather
+			 * than causing an exception.
+			 *
+			 * NOTE: The pointers returned are "newed" by this method but the
+			 * caller will be responsible for deleting them.
+			 *
+			 * @param ids
+			 *   The string ID's for the requested components.
+			 * @param missing
+			 *   Optional, filled with the ID's that could not be found.
+			 * @param fields
+			 *   The fields to decode, all of them by default.
+			 * @return
+			 *   One pointer (or NULL) per requested ID.
+			 * @throws VpdException
+			 *   If the database fails or a stored Component is corrupt, in
+			 * which case no Components are returned.
+			 */
+			inline vector<Component*> getComponents( const vector<string>& ids,
+							vector<string>* missing = NULL,
+							Component::FieldMask fields = Component::ALL_FIELDS )
+				{ return db->fetch( ids, missing, fields ); }
+
+			/**
+			 * Opens a streaming scan over every Component whose ID starts
+			 * with prefix, in ID order.  Only the current row is held in
+			 * memory, so this is the way to visit a sysfs subtree without
+			 * loading every key first.
+			 *
+			 * NOTE: The pointer returned is "newed" by this method but the
+			 * caller will be responsible for deleting it, before this
+			 * VpdRetriever is destroyed.
+			 *
+			 * @param prefix
+			 *   The leading part of the ID's to visit.
+			 * @return
+			 *   A Cursor over the matching Components or NULL on failure.
+			 */
+			inline VpdDbEnv::Cursor* scanPrefix( const string& prefix )
+				{ return db->scanPrefix( prefix ); }
+
+			/**
+			 * Opens a streaming scan over every Component whose ID is in
+			 * [first, last), in ID order.  An empty last scans to the end.
+			 *
+			 * NOTE: The pointer returned is "newed" by this method but the
+			 * caller will be responsible for deleting it, before this
+			 * VpdRetriever is destroyed.
+			 *
+			 * @return
+			 *   A Cursor over the matching Components or NULL on failure.
+			 */
+			inline VpdDbEnv::Cursor* scanRange( const string& first,
+							const string& last )
+				{ return db->scanRange( first, last ); }
+
+			/**
+			 * Lists the ID's in the database one page at a time.  Pass an
+			 * empty resumeToken for the first page, and the nextToken
+			 * returned with a page to get the one after it.  nextToken is
+			 * empty after the last page.
+			 *
+			 * @return
+			 *   Up to pageSize ID's.
+			 */
+			inline vector<string> getKeys( const string& resumeToken,
+						unsigned int pageSize, string& nextToken )
+				{ return db->getKeys( resumeToken, pageSize, nextToken ); }
+
+			/**
+			 * Finds the Components that have keyword ac with the given
+			 * value, see VpdDbEnv::findByKeyword.
+			 *
+			 * @return
+			 *   The ID's of the matching Components, sorted.
+			 */
+			inline vector<string> findByKeyword( const string& ac,
+					const string& value,
+					int lists = VpdDbEnv::ALL_KEYWORD_LISTS )
+				{ return db->findByKeyword( ac, value, lists ); }
+
+			/**
+			 * Finds the Components with a firmware or microcode level in
+			 * [from, to), see VpdDbEnv::findVersionRange.
+			 *
+			 * @return
+			 *   The ID's of the matching Components, sorted.
+			 */
+			inline vector<string> findVersionRange( const string& from,
+					const string& to,
+					int fields = VpdDbEnv::ALL_VERSION_FIELDS )
+				{ return db->findVersionRange( from, to, fields ); }
+
+			/**
+			 * Finds the Components with a level older than version.
+			 */
+			inline vector<string> findOlderThan( const string& version,
+					int fields = VpdDbEnv::ALL_VERSION_FIELDS )
+				{ return db->findOlderThan( version, fields ); }
+
+			/**
+			 * Finds the Components with values that contain every word of
+			 * text, see VpdDbEnv::search.
+			 *
+			 * @return
+			 *   Up to limit ID's (all of them for 0), best matches first.
+			 */
+			inline vector<string> search( const string& text,
+					unsigned int limit = 0 )
+				{ return db->search( text, limit ); }
 
 			/**
 			 * Gets the root or System Component from the database.  A
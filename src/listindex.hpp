@@ -0,0 +1,224 @@
+/***************************************************************************
+ *   Copyright (C) 2006, IBM                                               *
+ *                                                                         *
+ *   Maintained By:                                                        *
+ *   Eric Munson and Brad Peters                                           *
+ *   munsone@us.ibm.com, bpeters@us.ibm.com                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the Lesser GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of the  *
+ *   License, or at your option) any later version.                        *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Lesser General Public License for more details.                   *
+ *                                                                         *
+ *   You should have received a copy of the Lesser GNU General Public      *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef LSVPDLISTINDEX_HPP
+#define LSVPDLISTINDEX_HPP
+
+#include <libvpd-2/lsvpd.hpp>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace lsvpd
+{
+	/**
+	 * KeyIndex finds entries of a list by key (the AC of a DataItem, a
+	 * child ID, ...) without scanning the list.  The list itself is not
+	 * changed and keeps its order, the index is an open addressed hash
+	 * table of positions in it.
+	 *
+	 * The index is built lazily and only for lists of at least
+	 * MIN_INDEXED entries, a scan is faster than hashing for shorter
+	 * ones.  Entries appended since the last lookup are indexed by the
+	 * next one and a list that shrank is indexed again from scratch, so
+	 * appending needs no bookkeeping.  An entry erased from the middle of
+	 * the list must be reported with erase( ), and any other change (an
+	 * entry's key changed in place, say) must be followed by clear( ).  A
+	 * position found is always checked against the list, so a stale index
+	 * can miss an entry but never return the wrong one.
+	 *
+	 * When a key appears more than once, the first entry is found, like
+	 * the scan it replaces.
+	 */
+	class KeyIndex
+	{
+		public:
+			static const size_t MIN_INDEXED = 16;
+
+			KeyIndex( ) : mIndexed( 0 ) { }
+
+			/**
+			 * Scans the list for key without using an index.
+			 *
+			 * @param keyOf
+			 *   Returns the key of the entry at a position, as a const
+			 * string&
+			 * @return
+			 *   The position of the first entry with key, or -1.
+			 */
+			template<class KeyOf>
+			static int scan( const string& key, size_t size, KeyOf keyOf )
+			{
+				for( size_t i = 0; i < size; i++ )
+				{
+					if( keyOf( i ) == key )
+						return (int)i;
+				}
+				return -1;
+			}
+
+			/**
+			 * Looks up key in a list of size entries, indexing any
+			 * entries that were appended since the last lookup first.
+			 *
+			 * @return
+			 *   The position of the first entry with key, or -1.
+			 */
+			template<class KeyOf>
+			int find( const string& key, size_t size, KeyOf keyOf )
+			{
+				// A list that shrank while it was too short to be
+				// looked up here may have grown back past mIndexed.
+				if( size < mIndexed )
+					clear( );
+				if( size < MIN_INDEXED )
+					return scan( key, size, keyOf );
+
+				if( mSlots.size( ) < size * 2 )
+				{
+					size_t cap = 64;
+					while( cap < size * 2 )
+						cap <<= 1;
+					mSlots.assign( cap, Slot( ) );
+					mIndexed = 0;
+				}
+
+				size_t mask = mSlots.size( ) - 1;
+				for( ; mIndexed < size; mIndexed++ )
+				{
+					u32 h = hashOf( keyOf( mIndexed ) );
+					size_t i = h & mask;
+					while( mSlots[ i ].pos != 0 )
+						i = ( i + 1 ) & mask;
+					mSlots[ i ].pos = (u32)mIndexed + 1;
+					mSlots[ i ].hash = h;
+				}
+
+				// Every entry with key is in the chain, keep the first.
+				u32 h = hashOf( key ), found = 0;
+				for( size_t i = h & mask; mSlots[ i ].pos != 0; i = ( i + 1 ) & mask )
+				{
+					u32 pos = mSlots[ i ].pos;
+					if( mSlots[ i ].hash == h && ( found == 0 || pos < found ) &&
+						keyOf( pos - 1 ) == key )
+						found = pos;
+				}
+				return (int)found - 1;
+			}
+
+			/**
+			 * Drops the entry at pos, which has key and is about to be
+			 * erased from the list, and moves the positions after it
+			 * down by one.  This is linear in the size of the index, but
+			 * so is the erase.
+			 */
+			void erase( size_t pos, const string& key )
+			{
+				if( pos >= mIndexed )
+					return;
+
+				size_t mask = mSlots.size( ) - 1, i, j;
+				u32 h = hashOf( key );
+				for( i = h & mask; mSlots[ i ].pos != 0 &&
+					mSlots[ i ].pos != pos + 1; i = ( i + 1 ) & mask )
+					;
+				if( mSlots[ i ].pos == 0 )
+				{
+					clear( );
+					return;
+				}
+
+				// Close the gap so that no probe chain is cut short.
+				for( j = ( i + 1 ) & mask; mSlots[ j ].pos != 0;
+					j = ( j + 1 ) & mask )
+				{
+					size_t home = mSlots[ j ].hash & mask;
+					if( ( j > i && ( home <= i || home > j ) ) ||
+						( j < i && home <= i && home > j ) )
+					{
+						mSlots[ i ] = mSlots[ j ];
+						i = j;
+					}
+				}
+				mSlots[ i ] = Slot( );
+
+				for( i = 0; i <= mask; i++ )
+				{
+					if( mSlots[ i ].pos > pos + 1 )
+						mSlots[ i ].pos--;
+				}
+				mIndexed--;
+			}
+
+			/**
+			 * Forgets everything indexed, the next lookup indexes the
+			 * list again.
+			 */
+			inline void clear( )
+			{
+				mSlots.clear( );
+				mIndexed = 0;
+			}
+
+		private:
+			struct Slot
+			{
+				u32 pos;     ///< Position + 1 of an entry, 0 if empty
+				u32 hash;    ///< hashOf the entry's key
+				Slot( ) : pos( 0 ), hash( 0 ) { }
+			};
+
+			vector<Slot> mSlots;
+			// The number of entries, from the front, in mSlots.
+			size_t mIndexed;
+
+			static inline u32 hashOf( const string& key )
+			{
+				return (u32)hash<string>( )( key );
+			}
+	};
+
+	/**
+	 * The indexes over the lists of one Component, see Component::mpIndex.
+	 */
+	struct ListIndex
+	{
+		KeyIndex deviceSpecific;   ///< by AC
+		KeyIndex userData;         ///< by AC
+		KeyIndex aixNames;         ///< by value
+		KeyIndex children;         ///< by ID
+
+		inline void clear( )
+		{
+			deviceSpecific.clear( );
+			userData.clear( );
+			aixNames.clear( );
+			children.clear( );
+		}
+	};
+}
+
+#endif /*LSVPDLISTINDEX_HPP*/
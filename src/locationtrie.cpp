@@ -0,0 +1,205 @@
+/***************************************************************************
+ *   Copyright (C) 2006, IBM                                               *
+ *                                                                         *
+ *   Maintained By:                                                        *
+ *   Eric Munson and Brad Peters                                           *
+ *   munsone@us.ibm.com, bpeters@us.ibm.com                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the Lesser GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of the  *
+ *   License, or at your option) any later version.                        *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Lesser General Public License for more details.                   *
+ *                                                                         *
+ *   You should have received a copy of the Lesser GNU General Public      *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <libvpd-2/locationtrie.hpp>
+
+#include <unordered_set>
+
+namespace lsvpd
+{
+	const LocationTrie::Matches LocationTrie::NONE;
+
+	LocationTrie::Node::~Node( )
+	{
+		map<string, Node*>::iterator i, end = mChildren.end( );
+		for( i = mChildren.begin( ); i != end; ++i )
+			delete i->second;
+	}
+
+	LocationTrie::LocationTrie( System* root ) : mSize( 0 )
+	{
+		const vector<Component*>& leaves = root->getLeaves( );
+		vector<Component*>::const_iterator i, end = leaves.end( );
+
+		for( i = leaves.begin( ); i != end; ++i )
+			add( *i );
+	}
+
+	void LocationTrie::add( Component* comp )
+	{
+		const string& loc = comp->getPhysicalLocation( );
+		const string& second = comp->getSecondLocation( );
+
+		if( !loc.empty( ) )
+			add( loc, comp );
+		if( !second.empty( ) && second != loc )
+			add( second, comp );
+
+		const vector<Component*>& leaves = comp->getLeaves( );
+		vector<Component*>::const_iterator i, end = leaves.end( );
+		for( i = leaves.begin( ); i != end; ++i )
+			add( *i );
+	}
+
+	void LocationTrie::add( const string& loc, Component* comp )
+	{
+		Node* node = &mRoot;
+		size_t start = 0, pos;
+
+		do
+		{
+			pos = loc.find( SEPARATOR, start );
+			Node*& next = node->mChildren[ loc.substr( start, pos - start ) ];
+			if( next == NULL )
+				next = new Node( );
+			node = next;
+			start = pos + 1;
+		} while( pos != string::npos );
+
+		node->mComponents.push_back( comp );
+		mSize++;
+	}
+
+	const LocationTrie::Node* LocationTrie::find( const string& loc ) const
+	{
+		const Node* node = &mRoot;
+		size_t start = 0, pos;
+
+		do
+		{
+			pos = loc.find( SEPARATOR, start );
+			map<string, Node*>::const_iterator i =
+				node->mChildren.find( loc.substr( start, pos - start ) );
+			if( i == node->mChildren.end( ) )
+				return NULL;
+			node = i->second;
+			start = pos + 1;
+		} while( pos != string::npos );
+
+		return node;
+	}
+
+	void LocationTrie::collect( const Node* node, Matches& out )
+	{
+		out.insert( out.end( ), node->mComponents.begin( ),
+			node->mComponents.end( ) );
+
+		map<string, Node*>::const_iterator i, end = node->mChildren.end( );
+		for( i = node->mChildren.begin( ); i != end; ++i )
+			collect( i->second, out );
+	}
+
+	/**
+	 * A Component filed under both of its locations is only reported the
+	 * first time it is found.
+	 */
+	static void dropRepeats( LocationTrie::Matches& matches )
+	{
+		unordered_set<Component*> seen;
+		LocationTrie::Matches::iterator i, out = matches.begin( );
+
+		for( i = matches.begin( ); i != matches.end( ); ++i )
+		{
+			if( seen.insert( *i ).second )
+				*out++ = *i;
+		}
+		matches.erase( out, matches.end( ) );
+	}
+
+	const LocationTrie::Matches& LocationTrie::findExact(
+		const string& loc ) const
+	{
+		const Node* node = find( loc );
+		return node == NULL ? NONE : node->mComponents;
+	}
+
+	LocationTrie::Matches LocationTrie::findWithin( const string& loc ) const
+	{
+		Matches ret;
+		const Node* node = find( loc );
+
+		if( node != NULL )
+		{
+			collect( node, ret );
+			dropRepeats( ret );
+		}
+		return ret;
+	}
+
+	LocationTrie::Matches LocationTrie::findByPrefix(
+		const string& prefix ) const
+	{
+		Matches ret;
+		size_t last = prefix.rfind( SEPARATOR );
+		const Node* node = &mRoot;
+		string partial = prefix;
+
+		if( last != string::npos )
+		{
+			node = find( prefix.substr( 0, last ) );
+			if( node == NULL )
+				return ret;
+			partial = prefix.substr( last + 1 );
+		}
+
+		map<string, Node*>::const_iterator i, end = node->mChildren.end( );
+		for( i = node->mChildren.lower_bound( partial ); i != end &&
+			i->first.compare( 0, partial.length( ), partial ) == 0; ++i )
+		{
+			collect( i->second, ret );
+		}
+		dropRepeats( ret );
+		return ret;
+	}
+
+	Component* LocationTrie::findNearest( const string& loc,
+		const ComponentFilter* filter ) const
+	{
+		const Node* node = &mRoot;
+		Component* ret = NULL;
+		size_t start = 0, pos;
+
+		for( ;; )
+		{
+			pos = loc.find( SEPARATOR, start );
+			map<string, Node*>::const_iterator i =
+				node->mChildren.find( loc.substr( start, pos - start ) );
+			// Stop at loc itself, only what is above it counts.
+			if( i == node->mChildren.end( ) || pos == string::npos )
+				break;
+			node = i->second;
+			start = pos + 1;
+
+			Matches::const_iterator c, end = node->mComponents.end( );
+			for( c = node->mComponents.begin( ); c != end; ++c )
+			{
+				if( filter == NULL || filter->matches( **c ) )
+				{
+					ret = *c;
+					break;
+				}
+			}
+		}
+		return ret;
+	}
+}
@@ -0,0 +1,387 @@
+/***************************************************************************
+ *   Copyright (C) 2006, IBM                                               *
+ *                                                                         *
+ *   Maintained By:                                                        *
+ *   Eric Munson and Brad Peters                                           *
+ *   munsone@us.ibm.com, bpeters@us.ibm.com                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the Lesser GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of the  *
+ *   License, or at your option) any later version.                        *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Lesser General Public License for more details.                   *
+ *                                                                         *
+ *   You should have received a copy of the Lesser GNU General Public      *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <libvpd-2/snapshot.hpp>
+
+#include <algorithm>
+#include <atomic>
+
+namespace lsvpd
+{
+	static atomic<u64> sGenerations( 0 );
+
+	// Past this many edited parents a commit folds them into a new base
+	// map, so that every commit copies at most this many entries.
+	static const size_t MAX_PARENT_CHANGES = 256;
+
+	Snapshot::Snapshot( ) : mGeneration( ++sGenerations )
+	{
+	}
+
+	void SnapshotNode::rehash( )
+	{
+		u64 h = mComponentHash;
+		vector<SnapshotNodePtr>::const_iterator i, end = mLeaves.end( );
+
+		for( i = mLeaves.begin( ); i != end; ++i )
+		{
+			h = ( h << 7 | h >> 57 ) ^ (*i)->mHash;
+			h *= 0x9e3779b97f4a7c15ULL;
+		}
+		mHash = h;
+	}
+
+	const string* Snapshot::parentOf( const ParentMap& base,
+		const ParentMap* changes, const string& id )
+	{
+		ParentMap::const_iterator i;
+
+		if( changes != NULL )
+		{
+			i = changes->find( id );
+			if( i != changes->end( ) )
+				return i->second.empty( ) ? NULL : &i->second;
+		}
+
+		i = base.find( id );
+		if( i == base.end( ) )
+			return NULL;
+		return &i->second;
+	}
+
+	/**
+	 * Fills path with the position of each node on the way down from top
+	 * to the node of id.  The parent ID's give the way, a node that is
+	 * not found among the leaves of the one above it is not in the tree.
+	 */
+	bool Snapshot::locate( const vector<SnapshotNodePtr>& top,
+		const ParentMap& base, const ParentMap* changes, const string& id,
+		vector<size_t>& path )
+	{
+		vector<const string*> chain;
+		const string* cur = &id;
+		size_t limit = base.size( ) + ( changes ? changes->size( ) : 0 );
+
+		while( *cur != System::ID )
+		{
+			if( chain.size( ) > limit )
+				return false;
+			chain.push_back( cur );
+			cur = parentOf( base, changes, *cur );
+			if( cur == NULL )
+				return false;
+		}
+
+		path.clear( );
+		const vector<SnapshotNodePtr>* leaves = &top;
+		vector<const string*>::reverse_iterator i, end = chain.rend( );
+		for( i = chain.rbegin( ); i != end; ++i )
+		{
+			size_t j, count = leaves->size( );
+			for( j = 0; j < count; j++ )
+			{
+				if( (*leaves)[ j ]->getComponent( ).getID( ) == **i )
+					break;
+			}
+			if( j == count )
+				return false;
+			path.push_back( j );
+			leaves = &(*leaves)[ j ]->getLeaves( );
+		}
+		return true;
+	}
+
+	SnapshotNodePtr Snapshot::find( const string& id ) const
+	{
+		vector<size_t> path;
+
+		if( !locate( mLeaves, *mpParents, mpParentChanges.get( ), id, path ) ||
+			path.empty( ) )
+			return SnapshotNodePtr( );
+
+		const vector<SnapshotNodePtr>* leaves = &mLeaves;
+		vector<size_t>::const_iterator i, end = path.end( ) - 1;
+		for( i = path.begin( ); i != end; ++i )
+			leaves = &(*leaves)[ *i ]->getLeaves( );
+		return (*leaves)[ path.back( ) ];
+	}
+
+	SnapshotEditor::SnapshotEditor( const SnapshotPtr& base ) :
+		mpSystem( base->mpSystem ), mLeaves( base->mLeaves ),
+		mpParents( base->mpParents ), mpParentChanges( base->mpParentChanges ),
+		mOwnSystem( false )
+	{
+	}
+
+	SnapshotNode* SnapshotEditor::own( SnapshotNodePtr& node )
+	{
+		if( mOwnNodes.count( node.get( ) ) )
+			return const_cast<SnapshotNode*>( node.get( ) );
+
+		shared_ptr<SnapshotNode> copy = make_shared<SnapshotNode>( *node );
+		mOwnNodes.insert( copy.get( ) );
+		node = copy;
+		return copy.get( );
+	}
+
+	Component* SnapshotEditor::ownComponent( SnapshotNode* node )
+	{
+		if( mOwnComponents.count( node->mpComponent.get( ) ) )
+			return const_cast<Component*>( node->mpComponent.get( ) );
+
+		shared_ptr<Component> copy =
+			make_shared<Component>( *node->mpComponent );
+		mOwnComponents.insert( copy.get( ) );
+		node->mpComponent = copy;
+		return copy.get( );
+	}
+
+	System* SnapshotEditor::ownSystem( )
+	{
+		if( !mOwnSystem )
+		{
+			mpSystem = make_shared<System>( *mpSystem );
+			mOwnSystem = true;
+		}
+		return const_cast<System*>( mpSystem.get( ) );
+	}
+
+	Snapshot::ParentMap& SnapshotEditor::changes( )
+	{
+		if( !mpOwnChanges )
+		{
+			if( mpParentChanges )
+				mpOwnChanges = make_shared<ParentMap>( *mpParentChanges );
+			else
+				mpOwnChanges = make_shared<ParentMap>( );
+			mpParentChanges = mpOwnChanges;
+		}
+		return *mpOwnChanges;
+	}
+
+	/**
+	 * Copies the first length nodes of path, unless they are our own
+	 * already, and returns the last of them (NULL for a length of 0, which
+	 * stands for the top level).
+	 */
+	SnapshotNode* SnapshotEditor::ownPath( const vector<size_t>& path,
+		size_t length )
+	{
+		vector<SnapshotNodePtr>* leaves = &mLeaves;
+		SnapshotNode* node = NULL;
+
+		for( size_t i = 0; i < length; i++ )
+		{
+			node = own( (*leaves)[ path[ i ] ] );
+			leaves = &node->mLeaves;
+		}
+		return node;
+	}
+
+	bool SnapshotEditor::locate( const string& id, vector<size_t>& path ) const
+	{
+		return Snapshot::locate( mLeaves, *mpParents, mpParentChanges.get( ),
+			id, path );
+	}
+
+	SnapshotNodePtr SnapshotEditor::detach( const vector<size_t>& path )
+	{
+		SnapshotNode* parent = ownPath( path, path.size( ) - 1 );
+		vector<SnapshotNodePtr>& leaves = parent ? parent->mLeaves : mLeaves;
+		SnapshotNodePtr node = leaves[ path.back( ) ];
+		const string& id = node->getComponent( ).getID( );
+
+		leaves.erase( leaves.begin( ) + path.back( ) );
+		if( parent != NULL )
+			ownComponent( parent )->removeChild( id );
+		else
+			ownSystem( )->removeChild( id );
+		return node;
+	}
+
+	bool SnapshotEditor::attach( const SnapshotNodePtr& node,
+		const string& parentID )
+	{
+		const string& id = node->getComponent( ).getID( );
+
+		if( parentID == System::ID )
+		{
+			mLeaves.push_back( node );
+			const vector<string>& children = mpSystem->mChildren;
+			if( std::find( children.begin( ), children.end( ), id ) ==
+				children.end( ) )
+				ownSystem( )->addChild( id );
+		}
+		else
+		{
+			vector<size_t> path;
+			if( !locate( parentID, path ) )
+				return false;
+
+			SnapshotNode* parent = ownPath( path, path.size( ) );
+			parent->mLeaves.push_back( node );
+			const vector<string>& children =
+				parent->mpComponent->getChildren( );
+			if( std::find( children.begin( ), children.end( ), id ) ==
+				children.end( ) )
+				ownComponent( parent )->addChild( id );
+		}
+
+		const string* old = Snapshot::parentOf( *mpParents,
+			mpParentChanges.get( ), id );
+		if( old == NULL || *old != parentID )
+			changes( )[ id ] = parentID;
+		return true;
+	}
+
+	bool SnapshotEditor::upsert( Component* comp, const string& parentID )
+	{
+		// From here on comp is deleted along with its last node.
+		shared_ptr<const Component> mine( comp );
+		const string& id = mine->getID( );
+		vector<size_t> path, to;
+
+		if( id == System::ID )
+			return false;
+
+		if( parentID != System::ID && !locate( parentID, to ) )
+			return false;
+
+		if( !locate( id, path ) )
+		{
+			shared_ptr<SnapshotNode> node = make_shared<SnapshotNode>( mine );
+			mOwnNodes.insert( node.get( ) );
+			mOwnComponents.insert( mine.get( ) );
+			return attach( node, parentID );
+		}
+
+		if( *Snapshot::parentOf( *mpParents, mpParentChanges.get( ), id ) ==
+			parentID )
+		{
+			SnapshotNode* node = ownPath( path, path.size( ) );
+			node->mpComponent = mine;
+			mOwnComponents.insert( mine.get( ) );
+			return true;
+		}
+
+		// A Component can not be moved below itself.
+		if( to.size( ) >= path.size( ) &&
+			std::equal( path.begin( ), path.end( ), to.begin( ) ) )
+			return false;
+
+		SnapshotNodePtr node = detach( path );
+		own( node )->mpComponent = mine;
+		mOwnComponents.insert( mine.get( ) );
+		return attach( node, parentID );
+	}
+
+	bool SnapshotEditor::remove( const string& id )
+	{
+		vector<size_t> path;
+
+		if( !locate( id, path ) || path.empty( ) )
+			return false;
+
+		detach( path );
+		// The ID's below id are left in the map, with id gone they
+		// no longer lead anywhere.
+		changes( )[ id ] = string( );
+		return true;
+	}
+
+	/**
+	 * Brings the hashes of node and of the nodes of our own below it up to
+	 * date, the others have not changed.
+	 */
+	void SnapshotEditor::rehash( SnapshotNode* node )
+	{
+		vector<SnapshotNodePtr>::const_iterator i, end = node->mLeaves.end( );
+
+		for( i = node->mLeaves.begin( ); i != end; ++i )
+		{
+			if( mOwnNodes.count( i->get( ) ) )
+				rehash( const_cast<SnapshotNode*>( i->get( ) ) );
+		}
+		if( mOwnComponents.count( node->mpComponent.get( ) ) )
+			node->mComponentHash = node->mpComponent->contentHash( );
+		node->rehash( );
+	}
+
+	SnapshotPtr SnapshotEditor::commit( )
+	{
+		Snapshot* snap = new Snapshot( );
+		SnapshotPtr ret( snap );
+		vector<SnapshotNodePtr>::const_iterator i, end = mLeaves.end( );
+
+		for( i = mLeaves.begin( ); i != end; ++i )
+		{
+			if( mOwnNodes.count( i->get( ) ) )
+				rehash( const_cast<SnapshotNode*>( i->get( ) ) );
+		}
+
+		if( mpParentChanges && mpParentChanges->size( ) > MAX_PARENT_CHANGES )
+		{
+			shared_ptr<ParentMap> merged = make_shared<ParentMap>( *mpParents );
+			ParentMap::const_iterator j, jEnd = mpParentChanges->end( );
+			for( j = mpParentChanges->begin( ); j != jEnd; ++j )
+			{
+				if( j->second.empty( ) )
+					merged->erase( j->first );
+				else
+					(*merged)[ j->first ] = j->second;
+			}
+			mpParents = merged;
+			mpParentChanges.reset( );
+		}
+
+		snap->mpSystem = mpSystem;
+		snap->mLeaves = mLeaves;
+		snap->mpParents = mpParents;
+		snap->mpParentChanges = mpParentChanges;
+
+		// Everything is shared with snap now.
+		mpOwnChanges.reset( );
+		mOwnNodes.clear( );
+		mOwnComponents.clear( );
+		mOwnSystem = false;
+		return ret;
+	}
+
+	SnapshotPtr SnapshotPublisher::current( ) const
+	{
+		return atomic_load( &mCurrent );
+	}
+
+	bool SnapshotPublisher::publish( const SnapshotPtr& snap )
+	{
+		SnapshotPtr cur = atomic_load( &mCurrent );
+
+		do
+		{
+			if( cur && snap && cur->getGeneration( ) > snap->getGeneration( ) )
+				return false;
+		} while( !atomic_compare_exchange_weak( &mCurrent, &cur, snap ) );
+
+		return true;
+	}
+}
@@ -0,0 +1,418 @@
+/***************************************************************************
+ *   Copyright (C) 2006, IBM                                               *
+ *                                                                         *
+ *   Maintained By:                                                        *
+ *   Eric Munson and Brad Peters                                           *
+ *   munsone@us.ibm.com, bpeters@us.ibm.com                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the Lesser GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of the  *
+ *   License, or at your option) any later version.                        *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Lesser General Public License for more details.                   *
+ *                                                                         *
+ *   You should have received a copy of the Lesser GNU General Public      *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <libvpd-2/snapshotdiff.hpp>
+
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace lsvpd
+{
+	/**
+	 * Adds a FieldChange to out for each entry of a list that differs,
+	 * matching the entries by AC.
+	 */
+	static void diffByAC( int field, const vector<DataItem*>& a,
+		const vector<DataItem*>& b, vector<FieldChange>& out )
+	{
+		unordered_map<string, const string*> before, after;
+		vector<DataItem*>::const_iterator i, end;
+
+		for( i = a.begin( ), end = a.end( ); i != end; ++i )
+			before.insert( make_pair( (*i)->getAC( ), &(*i)->getValue( ) ) );
+		for( i = b.begin( ), end = b.end( ); i != end; ++i )
+			after.insert( make_pair( (*i)->getAC( ), &(*i)->getValue( ) ) );
+
+		for( i = a.begin( ), end = a.end( ); i != end; ++i )
+		{
+			const string& ac = (*i)->getAC( );
+			unordered_map<string, const string*>::iterator j = after.find( ac );
+			if( j == after.end( ) )
+			{
+				if( before[ ac ] == &(*i)->getValue( ) )
+					out.push_back( FieldChange{ field, ac, (*i)->getValue( ),
+						string( ) } );
+			}
+			else if( *j->second != (*i)->getValue( ) &&
+				before[ ac ] == &(*i)->getValue( ) )
+			{
+				out.push_back( FieldChange{ field, ac, (*i)->getValue( ),
+					*j->second } );
+			}
+		}
+		for( i = b.begin( ), end = b.end( ); i != end; ++i )
+		{
+			const string& ac = (*i)->getAC( );
+			if( before.find( ac ) == before.end( ) &&
+				after[ ac ] == &(*i)->getValue( ) )
+				out.push_back( FieldChange{ field, ac, string( ),
+					(*i)->getValue( ) } );
+		}
+	}
+
+	/**
+	 * Adds a FieldChange to out for each value that is only in one of the
+	 * lists.
+	 */
+	static void diffValues( int field, const vector<string>& a,
+		const vector<string>& b, vector<FieldChange>& out )
+	{
+		unordered_set<string> before( a.begin( ), a.end( ) );
+		unordered_set<string> after( b.begin( ), b.end( ) );
+		vector<string>::const_iterator i, end;
+
+		for( i = a.begin( ), end = a.end( ); i != end; ++i )
+		{
+			if( !after.count( *i ) )
+				out.push_back( FieldChange{ field, *i, *i, string( ) } );
+		}
+		for( i = b.begin( ), end = b.end( ); i != end; ++i )
+		{
+			if( !before.count( *i ) )
+				out.push_back( FieldChange{ field, *i, string( ), *i } );
+		}
+	}
+
+	static vector<string> values( const vector<DataItem*>& list )
+	{
+		vector<string> ret;
+		vector<DataItem*>::const_iterator i, end = list.end( );
+
+		ret.reserve( list.size( ) );
+		for( i = list.begin( ); i != end; ++i )
+			ret.push_back( (*i)->getValue( ) );
+		return ret;
+	}
+
+	/**
+	 * Fills in the fields and fieldChanges of change.
+	 */
+	static void describe( const Component& a, const Component& b,
+		ComponentChange& change )
+	{
+		vector<FieldChange>& out = change.fieldChanges;
+		Component::FieldMask mask = a.diffFields( b );
+
+		for( int f = 0; f < Component::FIELD_CHILDREN; f++ )
+		{
+			if( !( mask & Component::fieldMask( (Component::Field)f ) ) )
+				continue;
+			const DataItem* x = a.getField( (Component::Field)f );
+			const DataItem* y = b.getField( (Component::Field)f );
+			out.push_back( FieldChange{ f,
+				y->getAC( ).empty( ) ? x->getAC( ) : y->getAC( ),
+				x->getValue( ), y->getValue( ) } );
+		}
+
+		size_t count = out.size( );
+		diffValues( Component::FIELD_CHILDREN, a.getChildren( ),
+			b.getChildren( ), out );
+		if( out.size( ) != count )
+			mask |= Component::fieldMask( Component::FIELD_CHILDREN );
+
+		count = out.size( );
+		diffByAC( Component::FIELD_DEVICE_SPECIFIC, a.getDeviceSpecific( ),
+			b.getDeviceSpecific( ), out );
+		if( out.size( ) != count )
+			mask |= Component::fieldMask( Component::FIELD_DEVICE_SPECIFIC );
+
+		count = out.size( );
+		diffByAC( Component::FIELD_USER_DATA, a.getUserData( ),
+			b.getUserData( ), out );
+		if( out.size( ) != count )
+			mask |= Component::fieldMask( Component::FIELD_USER_DATA );
+
+		count = out.size( );
+		diffValues( Component::FIELD_AIX_NAMES, values( a.getAIXNames( ) ),
+			values( b.getAIXNames( ) ), out );
+		if( out.size( ) != count )
+			mask |= Component::fieldMask( Component::FIELD_AIX_NAMES );
+
+		change.fields = mask;
+	}
+
+	/**
+	 * Holds a node of a subtree that is only in one of the Snapshots.
+	 */
+	struct LooseNode
+	{
+		SnapshotNodePtr node;
+		string parentID;
+	};
+
+	typedef unordered_map<string, LooseNode> LooseMap;
+
+	/**
+	 * The state of one SnapshotDiff while the trees are walked.
+	 */
+	class DiffWalk
+	{
+		private:
+			vector<ComponentChange>& mChanges;
+			LooseMap mGone;
+			LooseMap mArrived;
+
+		public:
+			size_t mVisited;
+
+			DiffWalk( vector<ComponentChange>& changes ) : mChanges( changes ),
+				mVisited( 0 ) { }
+
+			void leaves( const vector<SnapshotNodePtr>& a,
+				const vector<SnapshotNodePtr>& b, const string& parentID );
+			void node( const SnapshotNodePtr& a, const SnapshotNodePtr& b,
+				const string& parentID );
+			void compare( const SnapshotNodePtr& a, const SnapshotNodePtr& b,
+				const string& parentBefore, const string& parentAfter );
+			void loose( const SnapshotNodePtr& top, const string& parentID,
+				LooseMap& into );
+			void finish( );
+	};
+
+	void DiffWalk::leaves( const vector<SnapshotNodePtr>& a,
+		const vector<SnapshotNodePtr>& b, const string& parentID )
+	{
+		size_t i, count = a.size( );
+		bool aligned = count == b.size( );
+
+		for( i = 0; aligned && i < count; i++ )
+			aligned = a[ i ]->getComponent( ).getID( ) ==
+				b[ i ]->getComponent( ).getID( );
+
+		if( aligned )
+		{
+			for( i = 0; i < count; i++ )
+				node( a[ i ], b[ i ], parentID );
+			return;
+		}
+
+		unordered_map<string, size_t> before;
+		for( i = 0; i < count; i++ )
+			before.insert( make_pair( a[ i ]->getComponent( ).getID( ), i ) );
+
+		for( i = 0; i < b.size( ); i++ )
+		{
+			unordered_map<string, size_t>::iterator j =
+				before.find( b[ i ]->getComponent( ).getID( ) );
+			if( j == before.end( ) )
+				loose( b[ i ], parentID, mArrived );
+			else
+			{
+				node( a[ j->second ], b[ i ], parentID );
+				before.erase( j );
+			}
+		}
+
+		for( i = 0; i < count && !before.empty( ); i++ )
+		{
+			if( before.erase( a[ i ]->getComponent( ).getID( ) ) )
+				loose( a[ i ], parentID, mGone );
+		}
+	}
+
+	void DiffWalk::node( const SnapshotNodePtr& a, const SnapshotNodePtr& b,
+		const string& parentID )
+	{
+		mVisited++;
+		if( a == b || a->getHash( ) == b->getHash( ) )
+			return;
+
+		compare( a, b, parentID, parentID );
+		leaves( a->getLeaves( ), b->getLeaves( ),
+			a->getComponent( ).getID( ) );
+	}
+
+	void DiffWalk::compare( const SnapshotNodePtr& a, const SnapshotNodePtr& b,
+		const string& parentBefore, const string& parentAfter )
+	{
+		bool moved = parentBefore != parentAfter;
+
+		if( !moved && ( &a->getComponent( ) == &b->getComponent( ) ||
+			a->getComponentHash( ) == b->getComponentHash( ) ) )
+			return;
+
+		ComponentChange change;
+		change.kind = moved ? ComponentChange::MOVED : ComponentChange::CHANGED;
+		change.id = a->getComponent( ).getID( );
+		change.parentBefore = parentBefore;
+		change.parentAfter = parentAfter;
+		// The nodes own their Components, share them with the change.
+		change.before = shared_ptr<const Component>( a, &a->getComponent( ) );
+		change.after = shared_ptr<const Component>( b, &b->getComponent( ) );
+		describe( a->getComponent( ), b->getComponent( ), change );
+		if( moved )
+			change.fields |= Component::fieldMask( Component::FIELD_PARENT );
+
+		if( moved || !change.fieldChanges.empty( ) )
+			mChanges.push_back( std::move( change ) );
+	}
+
+	/**
+	 * Files top and every node below it in into, without recursing.
+	 */
+	void DiffWalk::loose( const SnapshotNodePtr& top, const string& parentID,
+		LooseMap& into )
+	{
+		vector<LooseNode> stack;
+
+		stack.push_back( LooseNode{ top, parentID } );
+		while( !stack.empty( ) )
+		{
+			LooseNode next = std::move( stack.back( ) );
+			stack.pop_back();
+			mVisited++;
+
+			const string& id = next.node->getComponent( ).getID( );
+			vector<SnapshotNodePtr>::const_iterator i, end;
+			for( i = next.node->getLeaves( ).begin( ),
+				end = next.node->getLeaves( ).end( ); i != end; ++i )
+			{
+				stack.push_back( LooseNode{ *i, id } );
+			}
+			into.insert( make_pair( id, std::move( next ) ) );
+		}
+	}
+
+	static ComponentChange oneSided( ComponentChange::Kind kind,
+		const LooseNode& n )
+	{
+		ComponentChange change;
+
+		change.kind = kind;
+		change.id = n.node->getComponent( ).getID( );
+		shared_ptr<const Component> comp( n.node, &n.node->getComponent( ) );
+		if( kind == ComponentChange::ADDED )
+		{
+			change.parentAfter = n.parentID;
+			change.after = comp;
+		}
+		else
+		{
+			change.parentBefore = n.parentID;
+			change.before = comp;
+		}
+		change.fields = Component::ALL_FIELDS;
+		return change;
+	}
+
+	/**
+	 * Pairs up the nodes that left one place with those that turned up in
+	 * another, what is left over was removed or added.
+	 */
+	void DiffWalk::finish( )
+	{
+		LooseMap::iterator i, end = mGone.end( );
+
+		for( i = mGone.begin( ); i != end; ++i )
+		{
+			LooseMap::iterator j = mArrived.find( i->first );
+			if( j == mArrived.end( ) )
+				mChanges.push_back( oneSided( ComponentChange::REMOVED,
+					i->second ) );
+			else
+			{
+				compare( i->second.node, j->second.node, i->second.parentID,
+					j->second.parentID );
+				mArrived.erase( j );
+			}
+		}
+
+		for( i = mArrived.begin( ), end = mArrived.end( ); i != end; ++i )
+			mChanges.push_back( oneSided( ComponentChange::ADDED, i->second ) );
+	}
+
+	static bool byID( const ComponentChange& a, const ComponentChange& b )
+	{
+		return a.id < b.id;
+	}
+
+	SnapshotDiff::SnapshotDiff( const SnapshotPtr& before,
+		const SnapshotPtr& after )
+	{
+		const System& a = before->getSystem( );
+		const System& b = after->getSystem( );
+
+		if( &a != &b )
+		{
+			u64 mask = a.diffFields( b );
+			for( int f = 0; f < System::FIELD_COUNT; f++ )
+			{
+				if( !( mask & ( (u64)1 << f ) ) )
+					continue;
+				const DataItem* x = a.getField( (System::Field)f );
+				const DataItem* y = b.getField( (System::Field)f );
+				mSystemChanges.push_back( FieldChange{ f,
+					y->getAC( ).empty( ) ? x->getAC( ) : y->getAC( ),
+					x->getValue( ), y->getValue( ) } );
+			}
+		}
+
+		DiffWalk walk( mChanges );
+		walk.leaves( before->getLeaves( ), after->getLeaves( ), System::ID );
+		walk.finish( );
+		mVisited = walk.mVisited;
+
+		sort( mChanges.begin( ), mChanges.end( ), byID );
+	}
+
+	void ChangeNotifier::subscribe( ChangeListener* listener,
+		Component::FieldMask fields )
+	{
+		mSubscriptions.push_back( Subscription{ listener, fields } );
+	}
+
+	void ChangeNotifier::unsubscribe( ChangeListener* listener )
+	{
+		vector<Subscription>::iterator i = mSubscriptions.begin( );
+
+		while( i != mSubscriptions.end( ) )
+		{
+			if( i->listener == listener )
+				i = mSubscriptions.erase( i );
+			else
+				++i;
+		}
+	}
+
+	size_t ChangeNotifier::notify( const SnapshotDiff& diff ) const
+	{
+		size_t calls = 0;
+		const vector<ComponentChange>& changes = diff.getChanges( );
+		vector<ComponentChange>::const_iterator i, end = changes.end( );
+		vector<Subscription>::const_iterator s, sEnd = mSubscriptions.end( );
+
+		for( i = changes.begin( ); i != end; ++i )
+		{
+			for( s = mSubscriptions.begin( ); s != sEnd; ++s )
+			{
+				if( i->fields & s->fields )
+				{
+					s->listener->changed( *i );
+					calls++;
+				}
+			}
+		}
+		return calls;
+	}
+}
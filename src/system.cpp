@@ -31,6 +31,8 @@
 #include <libvpd-2/vpdexception.hpp>
 #include <libvpd-2/debug.hpp>
 #include <libvpd-2/logger.hpp>
+#include "fieldtable.hpp"
+#include "tokenizer.h"
 
 #include <cstring>
 
@@ -45,39 +47,22 @@ namespace lsvpd
 
 	string const System::ID ( "/sys/bus" );
 
+	/**
+	 * The single DataItems in the order that pack writes them, generated
+	 * from fields.h.
+	 */
+#define LSVPD_FIELD_DESC( name, member, slot, ac, humanName ) \
+		{ FIELD_##name, ac, humanName, &System::member },
+	constexpr System::FieldDesc System::FIELDS[ FIELD_COUNT ] = {
+		VPD_SYSTEM_FIELDS( LSVPD_FIELD_DESC )
+	};
+#undef LSVPD_FIELD_DESC
+
 	System::System()
 	{
 		mIdNode.setValue( ID, 100, __FILE__, __LINE__ );
 
-		mDescription.ac = "DS";
-		mDescription.humanName = "Description";
-		mBrand.ac = "BR";
-		mBrand.humanName = "Brand Keyword";
-		mOS.ac = "OS";
-		mOS.humanName = "Operating System";
-		mProcessorID.ac = "PI";
-		mProcessorID.humanName = "Processor ID or unique ID";
-		mMachineType.ac = "TM";
-		mMachineType.humanName = "Machine Type";
-		mMachineModel.ac = "TM";
-		mMachineModel.humanName = "Machine Model";
-		mFeatureCode.ac = "FC";
-		mFeatureCode.humanName = "Feature Code";
-		mFlagField.ac = "FG";
-		mFlagField.humanName = "Flag Field";
-		mRecordType.ac = "RT";
-		mRecordType.humanName = "Record Type";
-		mSerialNum1.ac = "SE";
-		mSerialNum1.humanName = "Machine or Cabinet Serial Number";
-		mSerialNum2.ac = "SE";
-		mSerialNum2.humanName = "Machine or Cabinet Serial Number";
-		mSUID.ac = "SU";
-		mSUID.humanName = "System Unique ID";
-		mKeywordVersion.ac = "VK";
-		mKeywordVersion.humanName = "Version of Keywords";
-		mLocationCode.ac = "YL";
-		mLocationCode.humanName = "Location Code";
-		mArch = "";
+		FieldTable::init( *this, FIELDS );
 		mCPUCount = 1;
 
 		mDeviceSpecific = vector<DataItem*>( );
@@ -88,12 +73,80 @@ namespace lsvpd
 
 	System::System( const void* packedData )
 	{
-		unpack( packedData );
+		try
+		{
+			unpack( packedData );
+		}
+		catch( ... )
+		{
+			// The destructor will not run, drop what was unpacked.
+			vector<DataItem*>::iterator j, dEnd;
+			for( j = mDeviceSpecific.begin( ), dEnd = mDeviceSpecific.end( );
+				j != dEnd; ++j )
+			{
+				delete (*j);
+			}
+			for( j = mUserData.begin( ), dEnd = mUserData.end( ); j != dEnd; ++j )
+			{
+				delete (*j);
+			}
+			throw;
+		}
 		mIdNode.setValue( ID, 100, __FILE__, __LINE__ );
 		mLeaves = vector<Component*>( );
 	}
 
+	System::System( const System& copyMe )
+	{
+		copyToMe( copyMe );
+	}
+
 	System::~System( )
+	{
+		freeLists( );
+	}
+
+	System& System::operator=( const System& rhs )
+	{
+		if( this != &rhs )
+		{
+			freeLists( );
+			copyToMe( rhs );
+		}
+		return (*this);
+	}
+
+	void System::copyToMe( const System& copyMe )
+	{
+		FieldTable::copy( *this, copyMe, FIELDS );
+		mCPUCount = copyMe.mCPUCount;
+		mChildren = copyMe.mChildren;
+
+		vector<DataItem*>::const_iterator j, dEnd;
+		mDeviceSpecific.reserve( copyMe.mDeviceSpecific.size( ) );
+		for( j = copyMe.mDeviceSpecific.begin( ),
+			dEnd = copyMe.mDeviceSpecific.end( ); j != dEnd; ++j )
+		{
+			mDeviceSpecific.push_back( new DataItem( **j ) );
+		}
+
+		mUserData.reserve( copyMe.mUserData.size( ) );
+		for( j = copyMe.mUserData.begin( ), dEnd = copyMe.mUserData.end( );
+			j != dEnd; ++j )
+		{
+			mUserData.push_back( new DataItem( **j ) );
+		}
+
+		vector<Component*>::const_iterator k, cEnd;
+		mLeaves.reserve( copyMe.mLeaves.size( ) );
+		for( k = copyMe.mLeaves.begin( ), cEnd = copyMe.mLeaves.end( );
+			k != cEnd; ++k )
+		{
+			mLeaves.push_back( new Component( **k ) );
+		}
+	}
+
+	void System::freeLists( )
 	{
 		vector<Component*>::iterator i, end = mLeaves.end( );
 		for( i = mLeaves.begin( ); i != end; ++i )
@@ -106,6 +159,28 @@ namespace lsvpd
 		{
 			delete (*j);
 		}
+
+		for( j = mUserData.begin( ), dEnd = mUserData.end( ); j != dEnd; ++j )
+		{
+			delete (*j);
+		}
+
+		mLeaves.clear( );
+		mDeviceSpecific.clear( );
+		mUserData.clear( );
+		mChildren.clear( );
+	}
+
+	u64 System::diffFields( const System& other ) const
+	{
+		return FieldTable::diff( *this, other, FIELDS );
+	}
+
+	const DataItem* System::getField( Field f ) const
+	{
+		if( f < 0 || f >= FIELD_COUNT )
+			return NULL;
+		return &( this->*FIELDS[ f ].member );
 	}
 
 	unsigned int System::getPackedSize( )
@@ -113,24 +188,7 @@ namespace lsvpd
 		unsigned int ret = INIT_BUF_SIZE;
 
 		ret += ( sizeof( u32 ) * 2 );
-		ret += mIdNode.getPackedLength( );
-		ret += mArch.getPackedLength( );
-		ret += deviceTreeNode.getPackedLength( );
-		ret += mDescription.getPackedLength( );
-		ret += mBrand.getPackedLength( );
-		ret += mNodeName.getPackedLength( );
-		ret += mOS.getPackedLength( );
-		ret += mProcessorID.getPackedLength( );
-		ret += mMachineType.getPackedLength( );
-		ret += mMachineModel.getPackedLength( );
-		ret += mFeatureCode.getPackedLength( );
-		ret += mFlagField.getPackedLength( );
-		ret += mRecordType.getPackedLength( );
-		ret += mSerialNum1.getPackedLength( );
-		ret += mSerialNum2.getPackedLength( );
-		ret += mSUID.getPackedLength( );
-		ret += mKeywordVersion.getPackedLength( );
-		ret += mLocationCode.getPackedLength( );
+		ret += FieldTable::packedSize( *this, FIELDS );
 
 		ret += mDeviceSpecific.size( );
 		ret += mUserData.size( );
@@ -199,42 +257,7 @@ namespace lsvpd
 		memcpy( buf, &netOrder, sizeof( u32 ) );
 		buf += sizeof( u32 );
 		// Pack the individual data items.
-		length = mIdNode.pack( buf );
-		buf += length;
-		length = mArch.pack( buf );
-		buf += length;
-		length = deviceTreeNode.pack( buf );
-		buf += length;
-		length = mDescription.pack( buf );
-		buf += length;
-		length = mBrand.pack( buf );
-		buf += length;
-		length = mNodeName.pack( buf );
-		buf += length;
-		length = mOS.pack( buf );
-		buf += length;
-		length = mProcessorID.pack( buf );
-		buf += length;
-		length = mMachineType.pack( buf );
-		buf += length;
-		length = mMachineModel.pack( buf );
-		buf += length;
-		length = mFeatureCode.pack( buf );
-		buf += length;
-		length = mFlagField.pack( buf );
-		buf += length;
-		length = mRecordType.pack( buf );
-		buf += length;
-		length = mSerialNum1.pack( buf );
-		buf += length;
-		length = mSerialNum2.pack( buf );
-		buf += length;
-		length = mSUID.pack( buf );
-		buf += length;
-		length = mKeywordVersion.pack( buf );
-		buf += length;
-		length = mLocationCode.pack( buf );
-		buf += length;
+		buf = FieldTable::pack( *this, FIELDS, buf );
 
 		// Pack the child vector.
 		memcpy( buf, CHILD_START.c_str( ), CHILD_START.length( ) );
@@ -299,12 +322,40 @@ namespace lsvpd
 	 * size claims that we have, then we have a corrupt buffer and we will
 	 * throw an exception.
 	 */
+	/**
+	 * Builds one list section of a packed System from its tokens, t must
+	 * index the start marker and is left after the end marker.  Returns
+	 * false if the tokens are corrupt.
+	 */
+	static bool unpackList( const char* base, const struct vpdtoken* tok,
+		int count, int& t, const string& endMarker, vector<DataItem*>& out )
+	{
+		for( t++; t < count && !token_equals( base, &tok[ t ],
+			endMarker.c_str( ), endMarker.length( ) ); t += 3 )
+		{
+			if( t + 3 > count )
+				return false;
+
+			DataItem* d = new DataItem( );
+			d->unpack( base + tok[ t ].offset, tok[ t ].length,
+				base + tok[ t + 1 ].offset, tok[ t + 1 ].length,
+				base + tok[ t + 2 ].offset, tok[ t + 2 ].length );
+			out.push_back( d );
+		}
+		if( t >= count )
+			return false;
+		t++;
+		return true;
+	}
+
 	void System::unpack( const void* payload )
 	{
 		u32 size = 0, netOrder;
-		char* packed = (char*) payload;
-		char* next = packed;;
-		string item;
+		const char* packed = (const char*) payload;
+		const char* base;
+		struct vpdtoken stack[ TOKENIZER_STACK_TOKENS ];
+		struct vpdtoken* tok = NULL;
+		int t, count;
 
 		if( payload == NULL )
 		{
@@ -315,206 +366,73 @@ namespace lsvpd
 		}
 
 		// Load the size of the payload. (It is packed in network order)
-		memcpy( &netOrder, next, sizeof( u32 ) );
+		memcpy( &netOrder, packed, sizeof( u32 ) );
 		size = ntohl( netOrder );
-		next += sizeof( u32 );
+		if( size < sizeof( u32 ) * 2 )
+		{
+			goto lderror;
+		}
 
-		memcpy( &netOrder, next, sizeof( u32 ) );
+		memcpy( &netOrder, packed + sizeof( u32 ), sizeof( u32 ) );
 		mCPUCount = ntohl( netOrder );
-		next += sizeof( u32 );
 
 		mChildren = vector<string>( );
 		mDeviceSpecific = vector<DataItem*>( );
+		mUserData = vector<DataItem*>( );
 
-		mIdNode = DataItem( next );
-		next += mIdNode.getPackedLength( );
-		if( next > packed + size )
-		{
-			goto lderror;
-		}
-		mArch = DataItem( next );
-		next += mArch.getPackedLength( );
-		if( next > packed + size )
-		{
-			goto lderror;
-		}
-		deviceTreeNode = DataItem( next );
-		next += deviceTreeNode.getPackedLength( );
-		if( next > packed + size )
-		{
-			goto lderror;
-		}
-		mDescription = DataItem( next );
-		next += mDescription.getPackedLength( );
-		if( next > packed + size )
-		{
-			goto lderror;
-		}
-		mBrand = DataItem( next );
-		next += mBrand.getPackedLength( );
-		if( next > packed + size )
-		{
-			goto lderror;
-		}
-		mNodeName = DataItem( next );
-		next += mNodeName.getPackedLength( );
-		if( next > packed + size )
-		{
-			goto lderror;
-		}
-		mOS = DataItem( next );
-		next += mOS.getPackedLength( );
-		if( next > packed + size )
-		{
-			goto lderror;
-		}
-		mProcessorID = DataItem( next );
-		next += mProcessorID.getPackedLength( );
-		if( next > packed + size )
-		{
-			goto lderror;
-		}
-		mMachineType = DataItem( next );
-		next += mMachineType.getPackedLength( );
-		if( next > packed + size )
-		{
-			goto lderror;
-		}
-		mMachineModel = DataItem( next );
-		next += mMachineModel.getPackedLength( );
-		if( next > packed + size )
-		{
-			goto lderror;
-		}
-		mFeatureCode = DataItem( next );
-		next += mFeatureCode.getPackedLength( );
-		if( next > packed + size )
-		{
-			goto lderror;
-		}
-		mFlagField = DataItem( next );
-		next += mFlagField.getPackedLength( );
-		if( next > packed + size )
-		{
-			goto lderror;
-		}
-		mRecordType = DataItem( next );
-		next += mRecordType.getPackedLength( );
-		if( next > packed + size )
-		{
-			goto lderror;
-		}
-		mSerialNum1 = DataItem( next );
-		next += mSerialNum1.getPackedLength( );
-		if( next > packed + size )
-		{
-			goto lderror;
-		}
-		mSerialNum2 = DataItem( next );
-		next += mSerialNum2.getPackedLength( );
-		if( next > packed + size )
-		{
-			goto lderror;
-		}
-		mSUID = DataItem( next );
-		next += mSUID.getPackedLength( );
-		if( next > packed + size )
-		{
-			goto lderror;
-		}
-		mKeywordVersion = DataItem( next );
-		next += mKeywordVersion.getPackedLength( );
-		if( next > packed + size )
-		{
-			goto lderror;
-		}
-		mLocationCode = DataItem( next );
-		next += mLocationCode.getPackedLength( );
-		if( next > packed + size )
+		base = packed + sizeof( u32 ) * 2;
+		tok = tokenize( base, size - sizeof( u32 ) * 2, stack,
+			TOKENIZER_STACK_TOKENS, &count );
+		if( tok == NULL || count < FIELD_COUNT * 3 )
 		{
 			goto lderror;
 		}
 
+		FieldTable::unpack( *this, FIELDS, base, tok, ~(u64)0 );
+		t = FIELD_COUNT * 3;
+
 		// Now onto the vectors, these should go much the same way that the packing
 		// did.
-		if( next == CHILD_START )
+		if( t < count && token_equals( base, &tok[ t ], CHILD_START.c_str( ),
+			CHILD_START.length( ) ) )
 		{
-			next += CHILD_START.length( ) + 1;
-			if( next > packed + size )
-			{
-				goto lderror;
-			}
-			item = string( (char*)next );
-			while( CHILD_END != item )
+			for( t++; t < count && !token_equals( base, &tok[ t ],
+				CHILD_END.c_str( ), CHILD_END.length( ) ); t++ )
 			{
-				if( item != string( "" ) )
+				if( tok[ t ].length != 0 )
 				{
-					string child = string( (char*)next );
-					mChildren.push_back( child );
-					next += item.length( );
+					mChildren.push_back( string( base + tok[ t ].offset,
+						tok[ t ].length ) );
 				}
-				next++;
-				item = string( (char*)next );
 			}
-			next += CHILD_END.length( ) + 1;
-		}
-
-		if( DEVICE_START == next )
-		{
-			next += DEVICE_START.length( ) + 1;
-			if( next > packed + size )
+			if( t >= count )
 			{
 				goto lderror;
 			}
-			item = string( (char*) next );
-			while( DEVICE_END != item )
-			{
-				DataItem* d = new DataItem( next );
-				if ( d == NULL ) {
-					VpdException ve( "Out of memory." );
-					throw ve;
-                                }
-				next += d->getPackedLength( );
-				if( next > packed + size )
-				{
-					delete ( d );
-					goto lderror;
-				}
-				mDeviceSpecific.push_back( d );
-				item = string( (char*)next );
-			}
-			next += DEVICE_END.length( ) + 1;
+			t++;
 		}
 
-		if( USER_START == next )
+		if( t < count && token_equals( base, &tok[ t ], DEVICE_START.c_str( ),
+			DEVICE_START.length( ) ) &&
+			!unpackList( base, tok, count, t, DEVICE_END, mDeviceSpecific ) )
 		{
-			next += USER_START.length( ) + 1;
-			if( next > packed + size )
-			{
-				goto lderror;
-			}
-			item = string( (char*) next );
-			while( USER_END != item )
-			{
-				DataItem* d = new DataItem( next );
-				if ( d == NULL ) {
-					VpdException ve( "Out of memory." );
-					throw ve;
-                                }
-				next += d->getPackedLength( );
-				if( next > packed + size )
-				{
-					delete ( d );
-					goto lderror;
-				}
-				mDeviceSpecific.push_back( d );
-				item = string( (char*)next );
+			goto lderror;
+		}
 
-			}
+		if( t < count && token_equals( base, &tok[ t ], USER_START.c_str( ),
+			USER_START.length( ) ) &&
+			!unpackList( base, tok, count, t, USER_END, mUserData ) )
+		{
+			goto lderror;
 		}
+
+		if( tok != stack )
+			free( tok );
 		return;
 
 lderror:
+		if( tok != NULL && tok != stack )
+			free( tok );
 		string message( "Component.unpack( ): Attempting to unpack corrupt buffer." );
 		Logger l;
 		l.log( message, LOG_ERR );
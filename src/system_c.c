@@ -22,13 +22,38 @@
  ***************************************************************************/
 
 #include <libvpd-2/system.h>
+#include "tokenizer.h"
+
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 #include <netinet/in.h>
 
+/*
+ * Where each packed dataitem is kept in struct system and the labels a new
+ * one starts with, in packed order.
+ */
+struct sys_field_desc
+{
+	size_t slot;
+	const char *ac;
+	const char *humanName;
+};
+
+#define CSLOT( member ) offsetof( struct system, member )
+#define SYS_FIELD_DESC( name, member, slot, ac, humanName ) \
+	{ slot, ac, humanName },
+static const struct sys_field_desc sys_fields[ SYS_FIELD_COUNT ] = {
+	VPD_SYSTEM_FIELDS( SYS_FIELD_DESC )
+};
+#undef SYS_FIELD_DESC
+#undef CSLOT
+
 struct system * new_system( int init )
 {
 	struct system *ret;
+	struct dataitem **slot;
+	int i;
 
 	ret = calloc( 1, sizeof( struct system ) );
 	if( !ret )
@@ -36,94 +61,33 @@ struct system * new_system( int init )
 
 	if( init )
 	{
-		ret->id = new_dataitem( );
-		if( !ret->id )
-			goto newsyserr;
-		ret->id->dataValue = strdup( SYS_ID );
-
-		ret->description = new_dataitem( );
-		if( !ret->description )
-			goto newsyserr;
-		ret->description->ac = strdup( "DS" );
-		ret->description->humanName = strdup( "Description" );
-
-		ret->description = new_dataitem( );
-		if( !ret->description )
-			goto newsyserr;
-		ret->description->ac = strdup( "BR" );
-		ret->description->humanName = strdup( "Brand Keyword" );
-		
-		ret->description = new_dataitem( );
-		if( !ret->description )
-			goto newsyserr;
-		ret->description->ac = strdup( "OS" );
-		ret->description->humanName = strdup( "Operation System" );
-
-		ret->description = new_dataitem( );
-		if( !ret->description )
-			goto newsyserr;
-		ret->description->ac = strdup( "PI" );
-		ret->description->humanName = strdup( "Processor ID or Unique ID" );
-
-		ret->description = new_dataitem( );
-		if( !ret->description )
-			goto newsyserr;
-		ret->description->ac = strdup( "TM" );
-		ret->description->humanName = strdup( "Machine Type" );
-
-		ret->description = new_dataitem( );
-		if( !ret->description )
-			goto newsyserr;
-		ret->description->ac = strdup( "TM" );
-		ret->description->humanName = strdup( "Machine Model" );
-
-		ret->description = new_dataitem( );
-		if( !ret->description )
-			goto newsyserr;
-		ret->description->ac = strdup( "FC" );
-		ret->description->humanName = strdup( "Feature Code" );
-
-		ret->description = new_dataitem( );
-		if( !ret->description )
-			goto newsyserr;
-		ret->description->ac = strdup( "FG" );
-		ret->description->humanName = strdup( "Flag Field" );
-
-		ret->description = new_dataitem( );
-		if( !ret->description )
-			goto newsyserr;
-		ret->description->ac = strdup( "RT" );
-		ret->description->humanName = strdup( "Record Type" );
-
-		ret->description = new_dataitem( );
-		if( !ret->description )
-			goto newsyserr;
-		ret->description->ac = strdup( "SE" );
-		ret->description->humanName = strdup( "Machine or Cabinet Serial Number" );
-
-		ret->description = new_dataitem( );
-		if( !ret->description )
-			goto newsyserr;
-		ret->description->ac = strdup( "SE" );
-		ret->description->humanName = strdup( "Machine or Cabinet Serial Number" );
-
-		ret->description = new_dataitem( );
-		if( !ret->description )
-			goto newsyserr;
-		ret->description->ac = strdup( "SU" );
-		ret->description->humanName = strdup( "System Unique ID" );
-
-		ret->description = new_dataitem( );
-		if( !ret->description )
-			goto newsyserr;
-		ret->description->ac = strdup( "VK" );
-		ret->description->humanName = strdup( "Version of Keywords" );
+		for( i = 0; i < SYS_FIELD_COUNT; i++ )
+		{
+			if( i != SYS_FIELD_ID && !*sys_fields[ i ].ac &&
+				!*sys_fields[ i ].humanName )
+				continue;
+
+			slot = (struct dataitem **)( (char*)ret + sys_fields[ i ].slot );
+			*slot = new_dataitem( );
+			if( !*slot )
+				goto newsyserr;
+			if( *sys_fields[ i ].ac )
+			{
+				(*slot)->ac = strdup( sys_fields[ i ].ac );
+				if( !(*slot)->ac )
+					goto newsyserr;
+			}
+			if( *sys_fields[ i ].humanName )
+			{
+				(*slot)->humanName = strdup( sys_fields[ i ].humanName );
+				if( !(*slot)->humanName )
+					goto newsyserr;
+			}
+		}
 
-		ret->description = new_dataitem( );
-		if( !ret->description )
+		ret->id->dataValue = strdup( SYS_ID );
+		if( !ret->id->dataValue )
 			goto newsyserr;
-		ret->description->ac = strdup( "YL" );
-		ret->description->humanName = strdup( "Physical Location" );
 
 		ret->cpuCount = 1;
 	}
@@ -140,9 +104,11 @@ struct system * unpack_system( void * buffer )
 	struct system *ret = NULL;
 	u32 size = 0, netOrder;
 	char *packed = (char*)buffer;
-	char * next;
-	struct list *item;
-	struct dataitem *data;
+	const char *base;
+	struct vpdtoken stack[ TOKENIZER_STACK_TOKENS ], *tok = NULL;
+	struct list *item, **child;
+	struct dataitem **slot;
+	int i, t, count;
 
 	if( !buffer )
 		return ret;
@@ -153,193 +119,74 @@ struct system * unpack_system( void * buffer )
 
 	memcpy( &netOrder, packed, sizeof( u32 ) );
 	size = ntohl( netOrder );
-	next = packed + sizeof( u32 );
-
-	memcpy( &netOrder, next, sizeof( u32 ) );
-	ret->cpuCount = ntohl( netOrder );
-	next = next + sizeof( u32 );
-
-	ret->id = unpack_dataitem( next );
-	if( !ret->id )
-		goto unpackerr;
-	next = next + calc_packed_length_dataitem( ret->id );
-
-	ret->arch = unpack_dataitem( next );
-	if( !ret->arch )
-		goto unpackerr;
-	next = next + calc_packed_length_dataitem( ret->arch );
-
-	ret->deviceTreeNode = unpack_dataitem( next );
-	if( !ret->deviceTreeNode )
-		goto unpackerr;
-	next = next + calc_packed_length_dataitem( ret->deviceTreeNode );
-
-	ret->description = unpack_dataitem( next );
-	if( !ret->description )
-		goto unpackerr;
-	next = next + calc_packed_length_dataitem( ret->description );
-
-	ret->brand = unpack_dataitem( next );
-	if( !ret->brand )
-		goto unpackerr;
-	next = next + calc_packed_length_dataitem( ret->brand );
-
-	ret->nodeName = unpack_dataitem( next );
-	if( !ret->nodeName )
-		goto unpackerr;
-	next = next + calc_packed_length_dataitem( ret->nodeName );
-
-	ret->os = unpack_dataitem( next );
-	if( !ret->os )
+	if( size < 2 * sizeof( u32 ) )
 		goto unpackerr;
-	next = next + calc_packed_length_dataitem( ret->os );
 
-	ret->processorID = unpack_dataitem( next );
-	if( !ret->processorID )
-		goto unpackerr;
-	next = next + calc_packed_length_dataitem( ret->processorID );
-
-	ret->machineType = unpack_dataitem( next );
-	if( !ret->machineType )
-		goto unpackerr;
-	next = next + calc_packed_length_dataitem( ret->machineType );
-
-	ret->machineModel = unpack_dataitem( next );
-	if( !ret->machineModel )
-		goto unpackerr;
-	next = next + calc_packed_length_dataitem( ret->machineModel );
-
-	ret->featureCode = unpack_dataitem( next );
-	if( !ret->featureCode )
-		goto unpackerr;
-	next = next + calc_packed_length_dataitem( ret->featureCode );
-
-	ret->flagField = unpack_dataitem( next );
-	if( !ret->flagField )
-		goto unpackerr;
-	next = next + calc_packed_length_dataitem( ret->flagField );
-
-	ret->recordType = unpack_dataitem( next );
-	if( !ret->recordType )
-		goto unpackerr;
-	next = next + calc_packed_length_dataitem( ret->recordType );
-
-	ret->serialNum1 = unpack_dataitem( next );
-	if( !ret->serialNum1 )
-		goto unpackerr;
-	next = next + calc_packed_length_dataitem( ret->serialNum1 );
-
-	ret->serialNum2 = unpack_dataitem( next );
-	if( !ret->serialNum2 )
-		goto unpackerr;
-	next = next + calc_packed_length_dataitem( ret->serialNum2 );
-
-	ret->suid = unpack_dataitem( next );
-	if( !ret->suid )
-		goto unpackerr;
-	next = next + calc_packed_length_dataitem( ret->suid );
-
-	ret->keywordVersion = unpack_dataitem( next );
-	if( !ret->keywordVersion )
-		goto unpackerr;
-	next = next + calc_packed_length_dataitem( ret->keywordVersion );
+	memcpy( &netOrder, packed + sizeof( u32 ), sizeof( u32 ) );
+	ret->cpuCount = ntohl( netOrder );
 
-	ret->locationCode = unpack_dataitem( next );
-	if( !ret->locationCode )
+	base = packed + 2 * sizeof( u32 );
+	tok = tokenize( base, size - 2 * sizeof( u32 ), stack,
+			TOKENIZER_STACK_TOKENS, &count );
+	if( !tok || count < SYS_FIELD_COUNT * 3 )
 		goto unpackerr;
-	next = next + calc_packed_length_dataitem( ret->locationCode );
 
-	while( 0 != strncmp( next, CHILD_START, strlen( CHILD_START ) ) )
+	for( i = 0, t = 0; i < SYS_FIELD_COUNT; i++, t += 3 )
 	{
-		next++;
-		if( next > packed + size )
+		slot = (struct dataitem **)( (char*)ret + sys_fields[ i ].slot );
+		*slot = token_dataitem( base, &tok[ t ], NULL );
+		if( !*slot )
 			goto unpackerr;
 	}
 
-	if( strncmp( next, CHILD_START, strlen( CHILD_START ) ) == 0 )
-	{
-		next = next + strlen( CHILD_START ) + 1;
-		if( next > packed + size )
-			goto unpackerr;
-
-		while( strncmp( next, CHILD_END, strlen( CHILD_END ) ) != 0 )
-		{
-			item = new_list( );
-			if( !item )
-				goto unpackerr;
-			item->data = strdup( next );
-			if (item->data == NULL) {
-				free(item);
-				goto unpackerr;
-			}
-			next = next + strlen( (char*)item->data ) + 1;
-			if( !ret->childrenIDs )
-				ret->childrenIDs = item;
-			else
-				concat_list( ret->childrenIDs, item );
+	while( t < count && !token_equals( base, &tok[ t ], CHILD_START,
+			strlen( CHILD_START ) ) )
+		t++;
 
-			if( next > packed + size )
-				goto unpackerr;
-		}
-		next = next + strlen( CHILD_END ) + 1;
-	}
-
-	if( strncmp( next, DEVICE_START, strlen( DEVICE_START ) ) == 0 )
+	child = &ret->childrenIDs;
+	for( t++; t < count && !token_equals( base, &tok[ t ], CHILD_END,
+			strlen( CHILD_END ) ); t++ )
 	{
-		next = next + strlen( DEVICE_START ) + 1;
-		if( next > packed + size )
+		item = new_list( );
+		if( !item )
 			goto unpackerr;
-
-		while( strncmp( next, DEVICE_END, strlen( DEVICE_END ) ) != 0 )
-		{
-			data = unpack_dataitem( next );
-			if( !data )
-				goto unpackerr;
-
-			next = next + calc_packed_length_dataitem( data );
-			if( !ret->deviceSpecific )
-				ret->deviceSpecific = data;
-			else
-				add_dataitem( ret->deviceSpecific, data );
-
-			if( next > packed + size )
-				goto unpackerr;
-		}
-		next = next + strlen( DEVICE_END ) + 1;
-	}
-
-	if( strncmp( next, USER_START, strlen( USER_START ) ) == 0 )
-	{
-		next = next + strlen( USER_START ) + 1;
-		if( next > packed + size )
+		*child = item;
+		child = &item->next;
+		item->data = token_strdup( base, &tok[ t ], NULL );
+		if( item->data == NULL )
 			goto unpackerr;
+	}
+	if( t >= count )
+		goto unpackerr;
+	t++;
 
-		while( strncmp( next, USER_END, strlen( USER_END ) ) != 0 )
-		{
-			data = unpack_dataitem( next );
-			if( !data )
-				goto unpackerr;
-
-			next = next + calc_packed_length_dataitem( data );
-			if( !ret->userData )
-				ret->userData = data;
-			else
-				add_dataitem( ret->userData, data );
+	if( t < count && token_equals( base, &tok[ t ], DEVICE_START,
+			strlen( DEVICE_START ) ) &&
+		token_dataitem_list( base, tok, count, &t, DEVICE_END,
+			&ret->deviceSpecific, NULL ) )
+		goto unpackerr;
 
-			if( next > packed + size )
-				goto unpackerr;
-		}
-	}
+	if( t < count && token_equals( base, &tok[ t ], USER_START,
+			strlen( USER_START ) ) &&
+		token_dataitem_list( base, tok, count, &t, USER_END,
+			&ret->userData, NULL ) )
+		goto unpackerr;
 
+	if( tok != stack )
+		free( tok );
 	return ret;
 
 unpackerr:
+	if( tok && tok != stack )
+		free( tok );
 	free_system( ret );
 	return NULL;
 }
 
 void free_system( struct system *freeme )
 {
+	struct component *this, *next;
+
 	if( !freeme )
 		return;
 
@@ -364,6 +211,16 @@ void free_system( struct system *freeme )
 
 	free_dataitem( freeme->deviceSpecific );
 	free_dataitem( freeme->userData );
+
+	/* Free Children */
+	this = freeme->children;
+	while( this )
+	{
+		next = this->next;
+		free_component( this );
+		this = next;
+	}
+
 	free_list( freeme->childrenIDs );
 	free( freeme );
 }
@@ -0,0 +1,110 @@
+/***************************************************************************
+ *   Copyright (C) 2007, IBM                                               *
+ *                                                                         *
+ *   Maintained By:                                                        *
+ *   Eric Munson and Brad Peters                                           *
+ *   ebmunson@us.ibm.com, bpeters@us.ibm.com                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the Lesser GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of the  *
+ *   License, or at your option) any later version.                        *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Lesser General Public License for more details.                   *
+ *                                                                         *
+ *   You should have received a copy of the Lesser GNU General Public      *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "tokenizer.h"
+
+#include <limits.h>
+#include <stdlib.h>
+
+#if defined( __SSE2__ )
+#include <emmintrin.h>
+#endif
+
+int tokenize_fields( const char *buf, size_t len, struct vpdtoken *out,
+		int max )
+{
+	size_t i = 0, start = 0;
+	const char *nul;
+	int count = 0;
+
+	if( len > UINT_MAX )
+		return -1;
+
+#if defined( __SSE2__ )
+	/*
+	 * Fields are short, so rather than calling memchr once per field the
+	 * '\0' bytes of 16 bytes at a time are turned into a bit mask and
+	 * every bit is a token.
+	 */
+	{
+		const __m128i zero = _mm_setzero_si128( );
+
+		for( ; i + 16 <= len; i += 16 )
+		{
+			__m128i v = _mm_loadu_si128( (const __m128i*)( buf + i ) );
+			unsigned int mask = _mm_movemask_epi8(
+				_mm_cmpeq_epi8( v, zero ) );
+
+			while( mask )
+			{
+				size_t end = i + __builtin_ctz( mask );
+
+				if( count < max )
+				{
+					out[ count ].offset = start;
+					out[ count ].length = end - start;
+				}
+				count++;
+				start = end + 1;
+				mask &= mask - 1;
+			}
+		}
+	}
+#endif
+
+	while( i < len && ( nul = memchr( buf + i, '\0', len - i ) ) != NULL )
+	{
+		i = nul - buf;
+		if( count < max )
+		{
+			out[ count ].offset = start;
+			out[ count ].length = i - start;
+		}
+		count++;
+		start = ++i;
+	}
+
+	return count;
+}
+
+struct vpdtoken * tokenize( const char *buf, size_t len,
+		struct vpdtoken *stack, int stackSize, int *count )
+{
+	struct vpdtoken *ret = stack;
+	int n;
+
+	n = tokenize_fields( buf, len, stack, stackSize );
+	if( n < 0 )
+		return NULL;
+
+	if( n > stackSize )
+	{
+		ret = malloc( n * sizeof( struct vpdtoken ) );
+		if( !ret )
+			return NULL;
+		tokenize_fields( buf, len, ret, n );
+	}
+
+	*count = n;
+	return ret;
+}
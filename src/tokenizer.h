@@ -0,0 +1,130 @@
+/***************************************************************************
+ *   Copyright (C) 2007, IBM                                               *
+ *                                                                         *
+ *   Maintained By:                                                        *
+ *   Eric Munson and Brad Peters                                           *
+ *   ebmunson@us.ibm.com, bpeters@us.ibm.com                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the Lesser GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of the  *
+ *   License, or at your option) any later version.                        *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Lesser General Public License for more details.                   *
+ *                                                                         *
+ *   You should have received a copy of the Lesser GNU General Public      *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef VPDTOKENIZER_H_
+#define VPDTOKENIZER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <arpa/inet.h>
+
+/*
+ * The packed form of components and systems is a run of '\0' terminated
+ * strings.  The decoders in both libraries split the whole buffer with
+ * tokenize first and then build their objects from the tokens, so no
+ * decoder walks raw memory looking for the end of a string.  Every token
+ * lies inside the buffer it came from and is followed there by its '\0'.
+ *
+ * This header is private to the libraries and is not installed, and both
+ * build tokenizer.c in, so its functions are kept out of their exports.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct vpdarena;
+struct dataitem;
+
+#ifdef __GNUC__
+#pragma GCC visibility push(hidden)
+#endif
+
+struct vpdtoken
+{
+	unsigned int offset;
+	unsigned int length;
+};
+
+/*
+ * Enough tokens for a typical component, decoders keep this many on the
+ * stack and only allocate for larger buffers.
+ */
+#define TOKENIZER_STACK_TOKENS 256
+
+/*
+ * Records the offset and length of each '\0' terminated string in
+ * buf[ 0, len ) in out, up to max of them.  Trailing bytes with no '\0'
+ * after them are not a token.  Returns the total number of tokens, which
+ * may be more than max, or -1 if len is too large to describe.
+ */
+int tokenize_fields( const char *buf, size_t len, struct vpdtoken *out,
+		int max );
+
+/*
+ * Tokenizes buf into stack when there is room and into a malloc'd array
+ * otherwise.  *count is set to the number of tokens.  Returns the array
+ * used, which must be free'd if it is not stack, or NULL on error.
+ */
+struct vpdtoken * tokenize( const char *buf, size_t len,
+		struct vpdtoken *stack, int stackSize, int *count );
+
+static inline int token_equals( const char *buf, const struct vpdtoken *tok,
+		const char *str, size_t len )
+{
+	return tok->length == len && memcmp( buf + tok->offset, str, len ) == 0;
+}
+
+/*
+ * The decoders take the size of a packed buffer from the network order u32
+ * it starts with.  Returns non-zero if the len bytes at buf hold all of
+ * that, callers with a stored row check it before decoding the row.
+ */
+static inline int packed_fits( const void *buf, size_t len )
+{
+	uint32_t netOrder;
+
+	if( !buf || len < sizeof( netOrder ) )
+		return 0;
+	memcpy( &netOrder, buf, sizeof( netOrder ) );
+	return ntohl( netOrder ) <= len;
+}
+
+/*
+ * Builders for the C library, implemented in dataitem_c.c.  Memory comes
+ * from arena when it is not NULL and from malloc otherwise.
+ *
+ * token_strdup copies one token.  token_dataitem builds a dataitem from
+ * the three tokens at tok.  token_dataitem_list builds a list section,
+ * *t must index its start marker and is left after its end marker; the
+ * entries are appended to *head, or stepped over when head is NULL.  It
+ * returns non-zero if the tokens are corrupt or memory runs out.
+ */
+char * token_strdup( const char *buf, const struct vpdtoken *tok,
+		struct vpdarena *arena );
+struct dataitem * token_dataitem( const char *buf, const struct vpdtoken *tok,
+		struct vpdarena *arena );
+int token_dataitem_list( const char *buf, const struct vpdtoken *tok,
+		int count, int *t, const char *endMarker, struct dataitem **head,
+		struct vpdarena *arena );
+
+#ifdef __GNUC__
+#pragma GCC visibility pop
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*VPDTOKENIZER_H_*/
@@ -0,0 +1,88 @@
+/***************************************************************************
+ *   Copyright (C) 2006, IBM                                               *
+ *                                                                         *
+ *   Maintained By:                                                        *
+ *   Eric Munson and Brad Peters                                           *
+ *   munsone@us.ibm.com, bpeters@us.ibm.com                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the Lesser GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of the  *
+ *   License, or at your option) any later version.                        *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Lesser General Public License for more details.                   *
+ *                                                                         *
+ *   You should have received a copy of the Lesser GNU General Public      *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <libvpd-2/treeindex.hpp>
+
+namespace lsvpd
+{
+	const TreeIndex::Matches TreeIndex::NONE;
+
+	static inline u64 deviceKey( int major, int minor )
+	{
+		return ( (u64)(u32)major << 32 ) | (u32)minor;
+	}
+
+	TreeIndex::TreeIndex( System* root )
+	{
+		const vector<Component*>& leaves = root->getLeaves( );
+		vector<Component*>::const_iterator i, end = leaves.end( );
+
+		for( i = leaves.begin( ); i != end; ++i )
+			add( *i, NULL );
+	}
+
+	void TreeIndex::add( Component* comp, Component* parent )
+	{
+		comp->mpParent = parent;
+
+		if( !comp->getID( ).empty( ) )
+			mByID.insert( make_pair( comp->getID( ), comp ) );
+		if( !comp->getSysFsNode( ).empty( ) )
+			mBySysFsNode.insert( make_pair( comp->getSysFsNode( ), comp ) );
+		if( !comp->getDevBusAddr( ).empty( ) )
+			mByDevBusAddr[ comp->getDevBusAddr( ) ].push_back( comp );
+		if( !comp->getSerialNumber( ).empty( ) )
+			mBySerialNumber[ comp->getSerialNumber( ) ].push_back( comp );
+		if( !comp->getPhysicalLocation( ).empty( ) )
+			mByLocation[ comp->getPhysicalLocation( ) ].push_back( comp );
+		if( comp->getMajor( ) != 0 || comp->getMinor( ) != 0 )
+			mByDevice[ deviceKey( comp->getMajor( ), comp->getMinor( ) ) ]
+				.push_back( comp );
+
+		const vector<Component*>& leaves = comp->getLeaves( );
+		vector<Component*>::const_iterator i, end = leaves.end( );
+		for( i = leaves.begin( ); i != end; ++i )
+			add( *i, comp );
+	}
+
+	Component* TreeIndex::lookup( const UniqueMap& map, const string& key )
+	{
+		UniqueMap::const_iterator i = map.find( key );
+		return i == map.end( ) ? NULL : i->second;
+	}
+
+	const TreeIndex::Matches& TreeIndex::lookup( const MultiMap& map,
+		const string& key )
+	{
+		MultiMap::const_iterator i = map.find( key );
+		return i == map.end( ) ? NONE : i->second;
+	}
+
+	const TreeIndex::Matches& TreeIndex::findByDevice( int major,
+		int minor ) const
+	{
+		unordered_map<u64, Matches>::const_iterator i =
+			mByDevice.find( deviceKey( major, minor ) );
+		return i == mByDevice.end( ) ? NONE : i->second;
+	}
+}
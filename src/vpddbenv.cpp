@@ -24,9 +24,16 @@
 #include <libvpd-2/vpddbenv.hpp>
 #include <libvpd-2/logger.hpp>
 #include <libvpd-2/debug.hpp>
+#include <libvpd-2/helper_functions.hpp>
+#include "fieldtable.hpp"
+#include "vpdsql.h"
 
 #include <sstream>
+#include <fstream>
+#include <algorithm>
 #include <cstring>
+#include <unordered_map>
+#include <arpa/inet.h>
 #include <fcntl.h>
 #include <errno.h>
 #include <sys/types.h>
@@ -41,6 +48,23 @@ namespace lsvpd
 	const string VpdDbEnv::TABLE_NAME ( "components" );
 	const string VpdDbEnv::ID         ( "comp_id" );
 	const string VpdDbEnv::DATA       ( "comp_data" );
+	const string VpdDbEnv::JOURNAL_TABLE( "journal" );
+	const string VpdDbEnv::EPOCH_TABLE( "journal_epoch" );
+	const string VpdDbEnv::KEYWORD_TABLE( "keywords" );
+	const string VpdDbEnv::SEARCH_TABLE( "search" );
+	const string VpdDbEnv::VERSION_TABLE( "version_keys" );
+
+	/*
+	 * A delta file is the magic, a version, the epoch of the source database,
+	 * the generations it goes from and to and a record count, then for each
+	 * record an op byte and the ID and data each preceded by their length.
+	 * Numbers are in network order.  Version 1 had no epoch.
+	 */
+	static const char DELTA_MAGIC[ 8 ] = { 'V', 'P', 'D', 'D', 'E', 'L', 'T', 'A' };
+	static const u32 DELTA_VERSION = 2;
+
+	// The journal is compacted once every this many generations.
+	static const u64 JOURNAL_COMPACT_INTERVAL = 256;
 
 	pid_t VpdDbEnv::UpdateLock::lockFileUpdate( bool blocking )
 	{
@@ -150,7 +174,10 @@ CON_ERR:
 		mUpdateLock( *new UpdateLock(envDir, dbFileName, readOnly )),
 		mDbFileName( dbFileName ),
 		mEnvDir( envDir ),
-		mpVpdDb( NULL )
+		mpVpdDb( NULL ),
+		mpFetchStmt( NULL ),
+		mJournalRetention( DEFAULT_JOURNAL_RETENTION ),
+		mHasSearch( false )
 	{
 		initFromLock();
 	}
@@ -159,7 +186,10 @@ CON_ERR:
 		mUpdateLock( lock ),
 		mDbFileName( mUpdateLock.mDbFileName ),
 		mEnvDir( mUpdateLock.mEnvDir ),
-		mpVpdDb( NULL )
+		mpVpdDb( NULL ),
+		mpFetchStmt( NULL ),
+		mJournalRetention( DEFAULT_JOURNAL_RETENTION ),
+		mHasSearch( false )
 	{
 		initFromLock();
 	}
@@ -207,6 +237,11 @@ CON_ERR:
 				sqlite3_errmsg( mpVpdDb ) << endl;
 			goto CON_ERR;
 		}
+		if( !registerSqlFunctions( mpVpdDb ) )
+		{
+			message << "Could not register the VPD SQL functions" << endl;
+			goto CON_ERR;
+		}
 
 		if( !dbExists )
 		{
@@ -233,6 +268,97 @@ CON_ERR:
 			sqlite3_finalize( pstmt );
 		}
 
+		if( !readOnly )
+		{
+			ostringstream sql;
+			char *err = NULL;
+			sql << "CREATE TABLE IF NOT EXISTS " << JOURNAL_TABLE <<
+				" ( gen INTEGER PRIMARY KEY AUTOINCREMENT, " << ID <<
+				" TEXT NOT NULL, op INTEGER NOT NULL, " <<
+				"hash INTEGER NOT NULL ); " <<
+				// One random, non zero row that tells this journal apart
+				// from the one of a database built anew.
+				"CREATE TABLE IF NOT EXISTS " << EPOCH_TABLE <<
+				" ( epoch INTEGER NOT NULL ); INSERT INTO " << EPOCH_TABLE <<
+				" ( epoch ) SELECT ( random( ) & 9223372036854775807 ) | 1 " <<
+				"WHERE NOT EXISTS ( SELECT 1 FROM " << EPOCH_TABLE << " );";
+			rc = sqlite3_exec( mpVpdDb, sql.str( ).c_str( ), NULL, NULL,
+						&err );
+			if( rc != SQLITE_OK )
+			{
+				message << "SQLITE Error " << rc << ": " <<
+					( err ? err : sqlite3_errmsg( mpVpdDb ) ) << endl;
+				sqlite3_free( err );
+				goto CON_ERR;
+			}
+
+			bool backfillKeywords = false, backfillVersions = false;
+
+			if( !hasTable( KEYWORD_TABLE ) )
+			{
+				sql.str( "" );
+				sql << "CREATE TABLE " << KEYWORD_TABLE << " ( " << ID <<
+					" TEXT NOT NULL, list INTEGER NOT NULL, ac TEXT NOT NULL, " <<
+					"value TEXT NOT NULL ); CREATE INDEX " << KEYWORD_TABLE <<
+					"_ac_value ON " << KEYWORD_TABLE << " ( ac, value ); " <<
+					"CREATE INDEX " << KEYWORD_TABLE << "_id ON " <<
+					KEYWORD_TABLE << " ( " << ID << " );";
+				rc = sqlite3_exec( mpVpdDb, sql.str( ).c_str( ), NULL, NULL,
+							&err );
+				if( rc != SQLITE_OK )
+				{
+					message << "SQLITE Error " << rc << ": " <<
+						( err ? err : sqlite3_errmsg( mpVpdDb ) ) << endl;
+					sqlite3_free( err );
+					goto CON_ERR;
+				}
+
+				backfillKeywords = dbExists;
+			}
+
+			if( !hasTable( VERSION_TABLE ) )
+			{
+				sql.str( "" );
+				sql << "CREATE TABLE " << VERSION_TABLE << " ( " << ID <<
+					" TEXT NOT NULL, field INTEGER NOT NULL, " <<
+					"value TEXT NOT NULL, vkey TEXT NOT NULL ); " <<
+					"CREATE INDEX " << VERSION_TABLE << "_field_vkey ON " <<
+					VERSION_TABLE << " ( field, vkey ); CREATE INDEX " <<
+					VERSION_TABLE << "_id ON " << VERSION_TABLE << " ( " << ID <<
+					" );";
+				rc = sqlite3_exec( mpVpdDb, sql.str( ).c_str( ), NULL, NULL,
+							&err );
+				if( rc != SQLITE_OK )
+				{
+					message << "SQLITE Error " << rc << ": " <<
+						( err ? err : sqlite3_errmsg( mpVpdDb ) ) << endl;
+					sqlite3_free( err );
+					goto CON_ERR;
+				}
+				backfillVersions = dbExists;
+			}
+
+			/*
+			 * A database written before the tables existed is indexed now,
+			 * once the schema is final: a statement from sqlite3_prepare
+			 * does not survive a schema change.
+			 */
+			if( backfillKeywords && !rebuildKeywords( ) )
+			{
+				message << "Could not index the keywords in " << mDbPath <<
+					endl;
+				goto CON_ERR;
+			}
+			if( backfillVersions && !rebuildVersions( ) )
+			{
+				message << "Could not index the versions in " << mDbPath <<
+					endl;
+				goto CON_ERR;
+			}
+		}
+
+		mHasSearch = hasTable( SEARCH_TABLE );
+
 		SQLITE3_PREPARE( mpVpdDb, async.c_str( ), async.length( ) + 1,
 				&pstmt, &out );
 		sqlite3_step( pstmt );
@@ -250,6 +376,8 @@ CON_ERR:
 	VpdDbEnv::~VpdDbEnv()
 	{
 		int rc;
+		if( mpFetchStmt != NULL )
+			sqlite3_finalize( mpFetchStmt );
 		rc = sqlite3_close( mpVpdDb );
 		if( rc != SQLITE_OK )
 		{
@@ -262,51 +390,244 @@ CON_ERR:
 		delete &mUpdateLock;
 	}
 
-	Component* VpdDbEnv::fetch( const string& deviceID )
+	/*
+	 * The decoders trust the size a packed row starts with, so a row that
+	 * is shorter than that is reported as corrupt before it is decoded
+	 * rather than read past its end.
+	 */
+	static void checkPacked( sqlite3_stmt* stmt, int column )
+	{
+		const void* data = sqlite3_column_blob( stmt, column );
+
+		if( !packed_fits( data, sqlite3_column_bytes( stmt, column ) ) )
+		{
+			string message( "Corrupt row: shorter than its packed size" );
+			Logger( ).log( message, LOG_ERR );
+			VpdException ve( message );
+			throw ve;
+		}
+	}
+
+	/*
+	 * Runs the cached single row lookup for deviceID.  The blob returned
+	 * stays valid until mpFetchStmt is reset, NULL means the row was not
+	 * found or an error was logged.
+	 *
+	 * A statement from the legacy sqlite3_prepare fails for good once
+	 * another connection changes the schema, so a failed step drops the
+	 * statement and the lookup is prepared again and retried once.
+	 */
+	const void* VpdDbEnv::fetchBlob( const string& deviceID )
+	{
+		int rc = SQLITE_OK, attempt;
+		const char *out;
+		string sql;
+
+		for( attempt = 0; attempt < 2; attempt++ )
+		{
+			if( mpFetchStmt == NULL )
+			{
+				sql = "SELECT " + DATA + " FROM " + TABLE_NAME +
+					" WHERE " + ID + "=?";
+				rc = SQLITE3_PREPARE( mpVpdDb, sql.c_str( ),
+					sql.length( ) + 1, &mpFetchStmt, &out );
+				if( rc != SQLITE_OK )
+					break;
+			}
+			else
+				sqlite3_reset( mpFetchStmt );
+
+			rc = sqlite3_bind_text( mpFetchStmt, 1, deviceID.c_str(),
+					       deviceID.length(), SQLITE_STATIC );
+			if( rc != SQLITE_OK )
+				break;
+
+			rc = sqlite3_step( mpFetchStmt );
+			if( rc == SQLITE_ROW )
+				return sqlite3_column_blob( mpFetchStmt, 0 );
+			if( rc == SQLITE_DONE )
+			{
+				sqlite3_reset( mpFetchStmt );
+				return NULL;
+			}
+
+			// The legacy interface only reports the real error code
+			// from sqlite3_reset.
+			rc = sqlite3_reset( mpFetchStmt );
+			if( rc != SQLITE_SCHEMA && rc != SQLITE_ERROR )
+				break;
+			sqlite3_finalize( mpFetchStmt );
+			mpFetchStmt = NULL;
+		}
+
+		{
+			ostringstream message;
+			message << "SQLITE Error " << rc << ": " <<
+				sqlite3_errmsg( mpVpdDb ) << endl;
+			Logger().log( message.str( ), LOG_ERR );
+		}
+		if( mpFetchStmt )
+		{
+			sqlite3_finalize( mpFetchStmt );
+			mpFetchStmt = NULL;
+		}
+		return NULL;
+	}
+
+	Component* VpdDbEnv::fetch( const string& deviceID,
+					Component::FieldMask fields )
 	{
 		Component* ret = NULL;
+		const void* blob = fetchBlob( deviceID );
+
+		if( blob == NULL )
+			return NULL;
+
+		try {
+			checkPacked( mpFetchStmt, 0 );
+			ret = new Component( blob, fields );
+		}
+		catch (std::bad_alloc& ba) {
+			Logger().log( "SQLITE Error: call to new() failed ", LOG_ERR );
+		}
+		catch (...) {
+			sqlite3_reset( mpFetchStmt );
+			throw;
+		}
+
+		sqlite3_reset( mpFetchStmt );
+		return ret;
+	}
+
+	bool VpdDbEnv::fetchInto( const string& deviceID, Component& out,
+					Component::FieldMask fields )
+	{
+		const void* blob = fetchBlob( deviceID );
+
+		if( blob == NULL )
+			return false;
+
+		try {
+			checkPacked( mpFetchStmt, 0 );
+			out.unpack( blob, fields );
+		}
+		catch (...) {
+			sqlite3_reset( mpFetchStmt );
+			throw;
+		}
+
+		sqlite3_reset( mpFetchStmt );
+		return true;
+	}
+
+	/*
+	 * Deletes the Components a failed multi-get has loaded so far.
+	 */
+	static void freeComponents( vector<Component*>& comps )
+	{
+		for( size_t i = 0; i < comps.size( ); i++ )
+		{
+			delete comps[ i ];
+			comps[ i ] = NULL;
+		}
+	}
+
+	/*
+	 * Multi-get: the ID's are bound BATCH_SIZE at a time into a single
+	 * "WHERE comp_id IN (?,?,...)" statement and each returned row is
+	 * routed back to every position it was requested at.
+	 */
+	vector<Component*> VpdDbEnv::fetch( const vector<string>& deviceIDs,
+					vector<string>* missing, Component::FieldMask fields )
+	{
+		vector<Component*> ret( deviceIDs.size( ), (Component*)NULL );
+		unordered_map<string, vector<size_t> > wanted;
 		sqlite3_stmt *pstmt = NULL;
-		int rc;
+		int rc = SQLITE_OK;
 		const char *out;
 		ostringstream message;
-		string sql = "SELECT " + DATA + " FROM " + TABLE_NAME + " WHERE " +
-				ID + "=?";
+		size_t start, end, i;
 
-		rc = SQLITE3_PREPARE( mpVpdDb, sql.c_str( ), sql.length( ) + 1,
-					&pstmt, &out );
-		if( rc != SQLITE_OK )
-			goto FETCH_COMP_ERR;
-
-		rc = sqlite3_bind_text(pstmt, 1, deviceID.c_str(),
-				       deviceID.length(), SQLITE_STATIC);
-		if (rc != SQLITE_OK)
-			goto FETCH_COMP_ERR;
-
-		rc = sqlite3_step( pstmt );
-		if( rc != SQLITE_ROW && rc != SQLITE_DONE )
-			goto FETCH_COMP_ERR;
+		for( start = 0; start < deviceIDs.size( ); start = end )
+		{
+			end = start + BATCH_SIZE;
+			if( end > deviceIDs.size( ) )
+				end = deviceIDs.size( );
+
+			string sql = "SELECT " + ID + ", " + DATA + " FROM " +
+				TABLE_NAME + " WHERE " + ID + " IN (?";
+			for( i = start + 1; i < end; i++ )
+				sql += ",?";
+			sql += ")";
+
+			rc = SQLITE3_PREPARE( mpVpdDb, sql.c_str( ), sql.length( ) + 1,
+						&pstmt, &out );
+			if( rc != SQLITE_OK )
+				goto FETCH_MULTI_ERR;
 
-		if( rc == SQLITE_ROW ) {
-			try {
-				ret = new Component( sqlite3_column_blob( pstmt, 0 ) );
+			wanted.clear( );
+			for( i = start; i < end; i++ )
+			{
+				rc = sqlite3_bind_text( pstmt, i - start + 1,
+						deviceIDs[ i ].c_str( ), deviceIDs[ i ].length( ),
+						SQLITE_STATIC );
+				if( rc != SQLITE_OK )
+					goto FETCH_MULTI_ERR;
+				wanted[ deviceIDs[ i ] ].push_back( i );
 			}
-			catch (std::bad_alloc& ba) {
-				message << "SQLITE Error: call to new() failed " << endl;
-				goto FETCH_NEW_FAILED;
+
+			while( ( rc = sqlite3_step( pstmt ) ) == SQLITE_ROW )
+			{
+				const char *id = (const char*)sqlite3_column_text( pstmt, 0 );
+				unordered_map<string, vector<size_t> >::iterator hit;
+
+				if( id == NULL ||
+					( hit = wanted.find( string( id ) ) ) == wanted.end( ) )
+					continue;
+
+				const vector<size_t>& slots = hit->second;
+				try {
+					checkPacked( pstmt, 1 );
+					for( i = 0; i < slots.size( ); i++ )
+						ret[ slots[ i ] ] =
+							new Component( sqlite3_column_blob( pstmt, 1 ),
+								fields );
+				}
+				catch (std::bad_alloc& ba) {
+					message << "SQLITE Error: call to new() failed " << endl;
+					goto FETCH_NEW_FAILED;
+				}
+				catch (...) {
+					sqlite3_finalize( pstmt );
+					freeComponents( ret );
+					throw;
+				}
 			}
+			if( rc != SQLITE_DONE )
+				goto FETCH_MULTI_ERR;
+
+			sqlite3_finalize( pstmt );
+			pstmt = NULL;
 		}
 
-		sqlite3_finalize( pstmt );
+		if( missing != NULL )
+		{
+			for( i = 0; i < ret.size( ); i++ )
+				if( ret[ i ] == NULL )
+					missing->push_back( deviceIDs[ i ] );
+		}
 		return ret;
 
-FETCH_COMP_ERR:
+FETCH_MULTI_ERR:
 		message << "SQLITE Error " << rc << ": " <<
 			sqlite3_errmsg( mpVpdDb ) << endl;
 FETCH_NEW_FAILED:
 		Logger().log( message.str( ), LOG_ERR );
 		if( pstmt )
 			sqlite3_finalize( pstmt );
-		return ret;
+		freeComponents( ret );
+		VpdException ve( message.str( ) );
+		throw ve;
 	}
 
 	/*
@@ -334,12 +655,17 @@ FETCH_NEW_FAILED:
 
 		if( rc == SQLITE_ROW ) {
 			try {
+				checkPacked( pstmt, 0 );
 				ret = new System( sqlite3_column_blob( pstmt, 0 ) );
 			}
 			catch (std::bad_alloc& ba) {
 				message << "SQLITE Error: call to new() failed " << endl;
 				goto FETCH_NEW_FAILED;
 			}
+			catch (...) {
+				sqlite3_finalize( pstmt );
+				throw;
+			}
 		}
 
 		sqlite3_finalize( pstmt );
@@ -355,145 +681,1178 @@ FETCH_NEW_FAILED:
 		return ret;
 	}
 
-	bool VpdDbEnv::store( Component *storeMe )
+	bool VpdDbEnv::fetchPacked( const string& id, string& out )
+	{
+		const void *data = fetchBlob( id );
+
+		if( data == NULL )
+			return false;
+		out.assign( (const char*)data, sqlite3_column_bytes( mpFetchStmt, 0 ) );
+		sqlite3_reset( mpFetchStmt );
+		return true;
+	}
+
+	bool VpdDbEnv::execute( const string& sql )
+	{
+		char *err = NULL;
+		int rc = sqlite3_exec( mpVpdDb, sql.c_str( ), NULL, NULL, &err );
+
+		if( rc != SQLITE_OK )
+		{
+			Logger l;
+			ostringstream message;
+			message << "SQLITE Error " << rc << ": " <<
+				( err ? err : sqlite3_errmsg( mpVpdDb ) ) << endl;
+			l.log( message.str( ), LOG_ERR );
+			sqlite3_free( err );
+			return false;
+		}
+		return true;
+	}
+
+	/*
+	 * Appends an entry for a change that has just been made, in the caller's
+	 * savepoint, and drops the entries that fell out of the retention once
+	 * every JOURNAL_COMPACT_INTERVAL generations.
+	 */
+	bool VpdDbEnv::journal( const string& id, JournalOp op, u64 hash )
 	{
-		void * buffer = NULL;
-		unsigned int dataSize;
 		int rc;
 		const char *out;
 		sqlite3_stmt *pstmt = NULL;
+		u64 gen;
 
-		string sql = "INSERT INTO " + TABLE_NAME + " (" + ID + ", " + DATA +
-				") VALUES ('" + storeMe->getID( ) + "', ?);";
+		string sql = "INSERT INTO " + JOURNAL_TABLE + " (" + ID +
+				", op, hash) VALUES (?, ?, ?);";
 		rc = SQLITE3_PREPARE( mpVpdDb, sql.c_str( ), sql.length( ) + 1,
 					&pstmt, &out );
 		if( rc != SQLITE_OK )
-			goto STORE_COMP_ERR;
+			goto JOURNAL_ERR;
 
-		dataSize = storeMe->pack( &buffer );
-		rc = sqlite3_bind_blob( pstmt, 1, buffer, dataSize, SQLITE_TRANSIENT );
+		rc = sqlite3_bind_text( pstmt, 1, id.c_str( ), id.length( ),
+					SQLITE_STATIC );
 		if( rc != SQLITE_OK )
-			goto STORE_COMP_ERR;
+			goto JOURNAL_ERR;
+
+		rc = sqlite3_bind_int( pstmt, 2, op );
+		if( rc != SQLITE_OK )
+			goto JOURNAL_ERR;
+
+		rc = sqlite3_bind_int64( pstmt, 3, (sqlite3_int64)hash );
+		if( rc != SQLITE_OK )
+			goto JOURNAL_ERR;
 
 		rc = sqlite3_step( pstmt );
 		if( rc != SQLITE_DONE )
-			goto STORE_COMP_ERR;
-
-		if( buffer != NULL )
-			delete [] (char*)buffer;
+			goto JOURNAL_ERR;
 		sqlite3_finalize( pstmt );
+
+		gen = (u64)sqlite3_last_insert_rowid( mpVpdDb );
+		if( gen % JOURNAL_COMPACT_INTERVAL == 0 && gen > mJournalRetention )
+		{
+			ostringstream del;
+			del << "DELETE FROM " << JOURNAL_TABLE << " WHERE gen <= " <<
+				gen - mJournalRetention << ";";
+			return execute( del.str( ) );
+		}
 		return true;
 
-STORE_COMP_ERR:
-		if( buffer != NULL )
-			delete [] (char*)buffer;
+JOURNAL_ERR:
 		Logger l;
 		ostringstream message;
 		message << "SQLITE Error " << rc << ": " <<
 			sqlite3_errmsg( mpVpdDb ) << endl;
 		l.log( message.str( ), LOG_ERR );
+		sqlite3_finalize( pstmt );
+		return false;
+	}
 
-		if ( rc == SQLITE_BUSY )
-			l.log( "Another instance of vpdupdate running." );
+	bool VpdDbEnv::hasTable( const string& name )
+	{
+		int rc;
+		const char *out;
+		sqlite3_stmt *pstmt = NULL;
+		bool ret = false;
 
+		string sql = "SELECT 1 FROM sqlite_master WHERE type = 'table' AND "
+			"name = ?;";
+		rc = SQLITE3_PREPARE( mpVpdDb, sql.c_str( ), sql.length( ) + 1,
+					&pstmt, &out );
+		if( rc == SQLITE_OK )
+			rc = sqlite3_bind_text( pstmt, 1, name.c_str( ), name.length( ),
+						SQLITE_STATIC );
+		if( rc == SQLITE_OK )
+			ret = sqlite3_step( pstmt ) == SQLITE_ROW;
 		sqlite3_finalize( pstmt );
-		return false;
+		return ret;
 	}
 
-	bool VpdDbEnv::store( System *storeMe )
+	bool VpdDbEnv::unindexKeywords( const string& id )
 	{
-		void * buffer = NULL;
-		unsigned int dataSize;
 		int rc;
 		const char *out;
 		sqlite3_stmt *pstmt = NULL;
 
-		string sql = "INSERT INTO " + TABLE_NAME + " (" + ID + ", " + DATA +
-				") VALUES ('" + storeMe->getID( ) + "', ?);";
+		string sql = "DELETE FROM " + KEYWORD_TABLE + " WHERE " + ID + " = ?;";
 		rc = SQLITE3_PREPARE( mpVpdDb, sql.c_str( ), sql.length( ) + 1,
 					&pstmt, &out );
-		if( rc != SQLITE_OK )
-			goto STORE_SYS_ERR;
+		if( rc == SQLITE_OK )
+			rc = sqlite3_bind_text( pstmt, 1, id.c_str( ), id.length( ),
+						SQLITE_STATIC );
+		if( rc == SQLITE_OK )
+			rc = sqlite3_step( pstmt );
+		sqlite3_finalize( pstmt );
+
+		if( rc != SQLITE_DONE )
+		{
+			Logger l;
+			ostringstream message;
+			message << "SQLITE Error " << rc << ": " <<
+				sqlite3_errmsg( mpVpdDb ) << endl;
+			l.log( message.str( ), LOG_ERR );
+			return false;
+		}
+		return true;
+	}
+
+	/*
+	 * Adds a row to the keyword table for each item of items, using the
+	 * insert statement prepared by indexKeywords.
+	 */
+	static int addKeywords( sqlite3_stmt* pstmt, const string& id,
+				VpdDbEnv::KeywordList list, const vector<DataItem*>& items )
+	{
+		vector<DataItem*>::const_iterator i, end = items.end( );
+		int rc = SQLITE_DONE;
+
+		for( i = items.begin( ); rc == SQLITE_DONE && i != end; ++i )
+		{
+			const string& ac = (*i)->getAC( );
+			const string& value = (*i)->getValue( );
+
+			sqlite3_reset( pstmt );
+			rc = sqlite3_bind_text( pstmt, 1, id.c_str( ), id.length( ),
+						SQLITE_STATIC );
+			if( rc == SQLITE_OK )
+				rc = sqlite3_bind_int( pstmt, 2, list );
+			if( rc == SQLITE_OK )
+				rc = sqlite3_bind_text( pstmt, 3, ac.c_str( ), ac.length( ),
+							SQLITE_STATIC );
+			if( rc == SQLITE_OK )
+				rc = sqlite3_bind_text( pstmt, 4, value.c_str( ),
+							value.length( ), SQLITE_STATIC );
+			if( rc == SQLITE_OK )
+				rc = sqlite3_step( pstmt );
+		}
+		return rc;
+	}
+
+	/*
+	 * Replaces the keyword rows of id with those found in its packed data.
+	 * The packed row stays the only record of the keywords, these rows can
+	 * always be rebuilt from it (see rebuildKeywords).
+	 */
+	bool VpdDbEnv::indexKeywords( const string& id, const void* data )
+	{
+		static const Component::FieldMask KEYWORD_FIELDS =
+			Component::fieldMask( Component::FIELD_DEVICE_SPECIFIC ) |
+			Component::fieldMask( Component::FIELD_USER_DATA ) |
+			Component::fieldMask( Component::FIELD_AIX_NAMES );
+		int rc;
+		const char *out;
+		sqlite3_stmt *pstmt = NULL;
+
+		if( !unindexKeywords( id ) )
+			return false;
 
-		dataSize = storeMe->pack( &buffer );
-		rc = sqlite3_bind_blob( pstmt, 1, buffer, dataSize, SQLITE_TRANSIENT );
+		string sql = "INSERT INTO " + KEYWORD_TABLE + " (" + ID +
+			", list, ac, value) VALUES (?, ?, ?, ?);";
+		rc = SQLITE3_PREPARE( mpVpdDb, sql.c_str( ), sql.length( ) + 1,
+					&pstmt, &out );
 		if( rc != SQLITE_OK )
-			goto STORE_SYS_ERR;
+			goto INDEX_ERR;
 
-		rc = sqlite3_step( pstmt );
+		try {
+			if( id == System::ID )
+			{
+				System sys( data );
+				rc = addKeywords( pstmt, id, KEYWORD_DEVICE_SPECIFIC,
+						sys.getDeviceSpecific( ) );
+			}
+			else
+			{
+				Component comp( data, KEYWORD_FIELDS );
+				rc = addKeywords( pstmt, id, KEYWORD_DEVICE_SPECIFIC,
+						comp.getDeviceSpecific( ) );
+				if( rc == SQLITE_DONE )
+					rc = addKeywords( pstmt, id, KEYWORD_USER_DATA,
+							comp.getUserData( ) );
+				if( rc == SQLITE_DONE )
+					rc = addKeywords( pstmt, id, KEYWORD_AIX_NAME,
+							comp.getAIXNames( ) );
+			}
+		}
+		catch( VpdException& ve ) {
+			Logger( ).log( "Could not index the keywords of " + id + ": " +
+					ve.what( ), LOG_ERR );
+			sqlite3_finalize( pstmt );
+			return false;
+		}
 		if( rc != SQLITE_DONE )
-			goto STORE_SYS_ERR;
-
-		if( buffer != NULL )
-			delete [] (char*)buffer;
+			goto INDEX_ERR;
 		sqlite3_finalize( pstmt );
 		return true;
 
-STORE_SYS_ERR:
-		if( buffer != NULL )
-			delete [] (char*)buffer;
+INDEX_ERR:
 		Logger l;
 		ostringstream message;
 		message << "SQLITE Error " << rc << ": " <<
 			sqlite3_errmsg( mpVpdDb ) << endl;
 		l.log( message.str( ), LOG_ERR );
+		sqlite3_finalize( pstmt );
+		return false;
+	}
 
-		if ( rc == SQLITE_BUSY )
-			l.log( "Another instance of vpdupdate running." );
+	bool VpdDbEnv::rebuildKeywords( )
+	{
+		vector<string> ids = getKeys( );
+		vector<string>::const_iterator i, end = ids.end( );
+		string data;
 
-		sqlite3_finalize( pstmt );
+		if( !execute( "SAVEPOINT vpd_keywords;" ) )
+			return false;
+		if( !execute( "DELETE FROM " + KEYWORD_TABLE + ";" ) )
+			goto REBUILD_UNDO;
+
+		for( i = ids.begin( ); i != end; ++i )
+		{
+			if( !fetchPacked( *i, data ) )
+				continue;
+			if( !indexKeywords( *i, data.data( ) ) )
+				goto REBUILD_UNDO;
+		}
+		return execute( "RELEASE vpd_keywords;" );
+
+REBUILD_UNDO:
+		execute( "ROLLBACK TO vpd_keywords; RELEASE vpd_keywords;" );
 		return false;
 	}
 
-	bool VpdDbEnv::remove( const string& deviceID )
+	bool VpdDbEnv::registerSqlFunctions( sqlite3* db )
+	{
+		int rc = register_vpd_sql( db );
+
+		if( rc != SQLITE_OK )
+		{
+			Logger l;
+			ostringstream message;
+
+			message << "SQLITE Error " << rc << ": " << sqlite3_errmsg( db ) <<
+				endl;
+			l.log( message.str( ), LOG_ERR );
+			return false;
+		}
+		return true;
+	}
+
+	vector<string> VpdDbEnv::findKeyword( const string& ac,
+					const string* value, int lists )
 	{
+		vector<string> ret;
 		int rc;
 		const char *out;
 		sqlite3_stmt *pstmt = NULL;
 
-		string sql = "DELETE FROM " + TABLE_NAME + " WHERE " + ID + "='" +
-			deviceID + "';";
+		string sql = "SELECT DISTINCT " + ID + " FROM " + KEYWORD_TABLE +
+			" WHERE ac = ?1" + ( value ? " AND value = ?2" : "" ) +
+			" AND ( list & ?3 ) != 0 ORDER BY " + ID + ";";
 		rc = SQLITE3_PREPARE( mpVpdDb, sql.c_str( ), sql.length( ) + 1,
 					&pstmt, &out );
+		if( rc == SQLITE_OK )
+			rc = sqlite3_bind_text( pstmt, 1, ac.c_str( ), ac.length( ),
+						SQLITE_STATIC );
+		if( rc == SQLITE_OK && value )
+			rc = sqlite3_bind_text( pstmt, 2, value->c_str( ),
+						value->length( ), SQLITE_STATIC );
+		if( rc == SQLITE_OK )
+			rc = sqlite3_bind_int( pstmt, 3, lists );
 		if( rc != SQLITE_OK )
-			goto REMOVE_ERR;
+			goto FIND_ERR;
 
-		rc = sqlite3_step( pstmt );
+		while( ( rc = sqlite3_step( pstmt ) ) == SQLITE_ROW )
+		{
+			const char *id = (const char*)sqlite3_column_text( pstmt, 0 );
+			if( id )
+				ret.push_back( id );
+		}
 		if( rc != SQLITE_DONE )
-			goto REMOVE_ERR;
+			goto FIND_ERR;
 		sqlite3_finalize( pstmt );
-		return true;
+		return ret;
 
-REMOVE_ERR:
+FIND_ERR:
 		Logger l;
 		ostringstream message;
 		message << "SQLITE Error " << rc << ": " <<
 			sqlite3_errmsg( mpVpdDb ) << endl;
 		l.log( message.str( ), LOG_ERR );
 		sqlite3_finalize( pstmt );
-		return false;
+		ret.clear( );
+		return ret;
 	}
 
-	vector<string> VpdDbEnv::getKeys( )
+	bool VpdDbEnv::unindexVersions( const string& id )
 	{
-		vector<string> ret;
-		sqlite3_stmt *pstmt = NULL;
 		int rc;
 		const char *out;
+		sqlite3_stmt *pstmt = NULL;
 
-		string sql = "SELECT " + ID + " FROM " + TABLE_NAME + ";";
+		string sql = "DELETE FROM " + VERSION_TABLE + " WHERE " + ID + " = ?;";
 		rc = SQLITE3_PREPARE( mpVpdDb, sql.c_str( ), sql.length( ) + 1,
 					&pstmt, &out );
-		if( rc != SQLITE_OK )
+		if( rc == SQLITE_OK )
+			rc = sqlite3_bind_text( pstmt, 1, id.c_str( ), id.length( ),
+						SQLITE_STATIC );
+		if( rc == SQLITE_OK )
+			rc = sqlite3_step( pstmt );
+		sqlite3_finalize( pstmt );
+
+		if( rc != SQLITE_DONE )
 		{
 			Logger l;
 			ostringstream message;
 			message << "SQLITE Error " << rc << ": " <<
 				sqlite3_errmsg( mpVpdDb ) << endl;
 			l.log( message.str( ), LOG_ERR );
-			return ret;
+			return false;
 		}
-
+		return true;
+	}
+
+	/*
+	 * Replaces the version rows of id with the levels found in its packed
+	 * data.  The System has none.
+	 */
+	bool VpdDbEnv::indexVersions( const string& id, const void* data )
+	{
+		static const Component::FieldMask VERSION_FIELDS =
+			Component::fieldMask( Component::FIELD_FIRMWARE_LEVEL ) |
+			Component::fieldMask( Component::FIELD_FIRMWARE_VERSION ) |
+			Component::fieldMask( Component::FIELD_DEVICE_SPECIFIC );
+		int rc = SQLITE_DONE;
+		const char *out;
+		sqlite3_stmt *pstmt = NULL;
+
+		if( !unindexVersions( id ) )
+			return false;
+		if( id == System::ID )
+			return true;
+
+		string sql = "INSERT INTO " + VERSION_TABLE + " (" + ID +
+			", field, value, vkey) VALUES (?, ?, ?, ?);";
+		try {
+			Component comp( data, VERSION_FIELDS );
+			const string* microCode = comp.getMicroCodeLevel( );
+			const string* levels[] = { &comp.getFirmwareLevel( ),
+				&comp.getFirmwareVersion( ), microCode };
+			const VersionField fields[] = { VERSION_FIRMWARE_LEVEL,
+				VERSION_FIRMWARE_VERSION, VERSION_MICROCODE_LEVEL };
+
+			for( int i = 0; rc == SQLITE_DONE && i < 3; i++ )
+			{
+				if( levels[ i ] == NULL )
+					continue;
+				string key = HelperFunctions::versionKey( *levels[ i ] );
+				if( key.empty( ) )
+					continue;
+
+				if( pstmt == NULL )
+				{
+					rc = SQLITE3_PREPARE( mpVpdDb, sql.c_str( ),
+								sql.length( ) + 1, &pstmt, &out );
+					if( rc != SQLITE_OK )
+						break;
+				}
+				else
+					sqlite3_reset( pstmt );
+
+				rc = sqlite3_bind_text( pstmt, 1, id.c_str( ), id.length( ),
+							SQLITE_STATIC );
+				if( rc == SQLITE_OK )
+					rc = sqlite3_bind_int( pstmt, 2, fields[ i ] );
+				if( rc == SQLITE_OK )
+					rc = sqlite3_bind_text( pstmt, 3, levels[ i ]->c_str( ),
+								levels[ i ]->length( ), SQLITE_STATIC );
+				if( rc == SQLITE_OK )
+					rc = sqlite3_bind_text( pstmt, 4, key.c_str( ),
+								key.length( ), SQLITE_TRANSIENT );
+				if( rc == SQLITE_OK )
+					rc = sqlite3_step( pstmt );
+			}
+		}
+		catch( VpdException& ve ) {
+			Logger( ).log( "Could not index the versions of " + id + ": " +
+					ve.what( ), LOG_ERR );
+			sqlite3_finalize( pstmt );
+			return false;
+		}
+		if( rc != SQLITE_DONE )
+		{
+			Logger l;
+			ostringstream message;
+			message << "SQLITE Error " << rc << ": " <<
+				sqlite3_errmsg( mpVpdDb ) << endl;
+			l.log( message.str( ), LOG_ERR );
+			sqlite3_finalize( pstmt );
+			return false;
+		}
+		sqlite3_finalize( pstmt );
+		return true;
+	}
+
+	bool VpdDbEnv::rebuildVersions( )
+	{
+		vector<string> ids = getKeys( );
+		vector<string>::const_iterator i, end = ids.end( );
+		string data;
+
+		if( !execute( "SAVEPOINT vpd_versions;" ) )
+			return false;
+		if( !execute( "DELETE FROM " + VERSION_TABLE + ";" ) )
+			goto REBUILD_UNDO;
+
+		for( i = ids.begin( ); i != end; ++i )
+		{
+			if( !fetchPacked( *i, data ) )
+				continue;
+			if( !indexVersions( *i, data.data( ) ) )
+				goto REBUILD_UNDO;
+		}
+		return execute( "RELEASE vpd_versions;" );
+
+REBUILD_UNDO:
+		execute( "ROLLBACK TO vpd_versions; RELEASE vpd_versions;" );
+		return false;
+	}
+
+	vector<string> VpdDbEnv::findVersionRange( const string& from,
+					const string& to, int fields )
+	{
+		vector<string> ret;
+		int rc;
+		const char *out;
+		sqlite3_stmt *pstmt = NULL;
+		string fromKey = HelperFunctions::versionKey( from );
+		string toKey = HelperFunctions::versionKey( to );
+		ostringstream sql;
+
+		// One range of the ( field, vkey ) index is scanned per field.
+		sql << "SELECT DISTINCT " << ID << " FROM " << VERSION_TABLE <<
+			" WHERE field IN ( " << ( fields & VERSION_FIRMWARE_LEVEL ) <<
+			", " << ( fields & VERSION_FIRMWARE_VERSION ) << ", " <<
+			( fields & VERSION_MICROCODE_LEVEL ) << " )";
+		if( !fromKey.empty( ) )
+			sql << " AND vkey >= ?1";
+		if( !toKey.empty( ) )
+			sql << " AND vkey < ?2";
+		sql << " ORDER BY " << ID << ";";
+
+		string stmt = sql.str( );
+		rc = SQLITE3_PREPARE( mpVpdDb, stmt.c_str( ), stmt.length( ) + 1,
+					&pstmt, &out );
+		if( rc == SQLITE_OK && !fromKey.empty( ) )
+			rc = sqlite3_bind_text( pstmt, 1, fromKey.c_str( ),
+						fromKey.length( ), SQLITE_STATIC );
+		if( rc == SQLITE_OK && !toKey.empty( ) )
+			rc = sqlite3_bind_text( pstmt, 2, toKey.c_str( ),
+						toKey.length( ), SQLITE_STATIC );
+		if( rc != SQLITE_OK )
+			goto FIND_ERR;
+
+		while( ( rc = sqlite3_step( pstmt ) ) == SQLITE_ROW )
+		{
+			const char *id = (const char*)sqlite3_column_text( pstmt, 0 );
+			if( id )
+				ret.push_back( id );
+		}
+		if( rc != SQLITE_DONE )
+			goto FIND_ERR;
+		sqlite3_finalize( pstmt );
+		return ret;
+
+FIND_ERR:
+		Logger l;
+		ostringstream message;
+		message << "SQLITE Error " << rc << ": " <<
+			sqlite3_errmsg( mpVpdDb ) << endl;
+		l.log( message.str( ), LOG_ERR );
+		sqlite3_finalize( pstmt );
+		ret.clear( );
+		return ret;
+	}
+
+	/*
+	 * Appends the values of a packed Component or System to fields (the
+	 * single DataItems) and keywords (the device specific, user data and
+	 * AIX name items), each followed by a '\n'.  Empty values are left out.
+	 * The tokens are read directly, nothing is unpacked.  Returns false if
+	 * data is not a packed row.
+	 */
+	static bool searchValues( const string& id, const char* data, size_t size,
+				string& fields, string& keywords )
+	{
+		bool isSystem = id == System::ID;
+		size_t header = isSystem ? sizeof( u32 ) * 2 : sizeof( u32 );
+		int fixed = isSystem ? (int)System::FIELD_COUNT :
+			(int)Component::FIELD_CHILDREN;
+		struct vpdtoken stack[ TOKENIZER_STACK_TOKENS ];
+		struct vpdtoken* tok;
+		const string* end;
+		const char* base;
+		u32 packedSize, netOrder;
+		int t, count;
+
+		if( data == NULL || size < header )
+			return false;
+		memcpy( &netOrder, data, sizeof( u32 ) );
+		packedSize = ntohl( netOrder );
+		if( packedSize < header || packedSize > size )
+			return false;
+
+		base = data + header;
+		tok = tokenize( base, packedSize - header, stack,
+				TOKENIZER_STACK_TOKENS, &count );
+		if( tok == NULL )
+			return false;
+		if( count < fixed * 3 )
+		{
+			if( tok != stack )
+				free( tok );
+			return false;
+		}
+
+		for( t = 2; t < fixed * 3; t += 3 )
+		{
+			if( tok[ t ].length > 0 )
+			{
+				fields.append( base + tok[ t ].offset, tok[ t ].length );
+				fields += '\n';
+			}
+		}
+
+		for( t = fixed * 3; t < count; t++ )
+		{
+			if( token_equals( base, &tok[ t ], Component::CHILD_START.c_str( ),
+				Component::CHILD_START.length( ) ) )
+			{
+				while( t < count && !token_equals( base, &tok[ t ],
+					Component::CHILD_END.c_str( ),
+					Component::CHILD_END.length( ) ) )
+					t++;
+				continue;
+			}
+
+			if( token_equals( base, &tok[ t ], Component::DEVICE_START.c_str( ),
+				Component::DEVICE_START.length( ) ) )
+				end = &Component::DEVICE_END;
+			else if( token_equals( base, &tok[ t ],
+				Component::USER_START.c_str( ),
+				Component::USER_START.length( ) ) )
+				end = &Component::USER_END;
+			else if( token_equals( base, &tok[ t ], Component::AX_START.c_str( ),
+				Component::AX_START.length( ) ) )
+				end = &Component::AX_END;
+			else
+				continue;
+
+			for( t++; t + 3 <= count && !token_equals( base, &tok[ t ],
+				end->c_str( ), end->length( ) ); t += 3 )
+			{
+				if( tok[ t + 2 ].length > 0 )
+				{
+					keywords.append( base + tok[ t + 2 ].offset,
+							tok[ t + 2 ].length );
+					keywords += '\n';
+				}
+			}
+		}
+
+		if( tok != stack )
+			free( tok );
+		return true;
+	}
+
+	/*
+	 * Returns the rowid id has in the search table, or 0 if it has none.
+	 */
+	sqlite3_int64 VpdDbEnv::searchRowid( const string& id )
+	{
+		int rc;
+		const char *out;
+		sqlite3_stmt *pstmt = NULL;
+		sqlite3_int64 ret = 0;
+
+		string sql = "SELECT rowid FROM " + SEARCH_TABLE + "_ids WHERE " + ID +
+			" = ?;";
+		rc = SQLITE3_PREPARE( mpVpdDb, sql.c_str( ), sql.length( ) + 1,
+					&pstmt, &out );
+		if( rc == SQLITE_OK )
+			rc = sqlite3_bind_text( pstmt, 1, id.c_str( ), id.length( ),
+						SQLITE_STATIC );
+		if( rc == SQLITE_OK && sqlite3_step( pstmt ) == SQLITE_ROW )
+			ret = sqlite3_column_int64( pstmt, 0 );
+		sqlite3_finalize( pstmt );
+		return ret;
+	}
+
+	bool VpdDbEnv::unindexSearch( const string& id )
+	{
+		ostringstream sql;
+		sqlite3_int64 rowid = searchRowid( id );
+
+		if( rowid == 0 )
+			return true;
+		sql << "DELETE FROM " << SEARCH_TABLE << " WHERE rowid = " << rowid <<
+			"; DELETE FROM " << SEARCH_TABLE << "_ids WHERE rowid = " <<
+			rowid << ";";
+		return execute( sql.str( ) );
+	}
+
+	/*
+	 * Replaces the search row of id with the values found in its packed
+	 * data.  The full text table keys its rows by the rowid of SEARCH_TABLE
+	 * _ids, which maps them to ID's and, unlike the rowid of TABLE_NAME,
+	 * never changes behind our back.
+	 */
+	bool VpdDbEnv::indexSearch( const string& id, const void* data,
+				unsigned int dataSize )
+	{
+		int rc;
+		const char *out;
+		sqlite3_stmt *pstmt = NULL;
+		sqlite3_int64 rowid = searchRowid( id );
+		string fields, keywords;
+
+		if( !searchValues( id, (const char*)data, dataSize, fields,
+			keywords ) )
+		{
+			Logger( ).log( "Could not index the values of " + id, LOG_ERR );
+			return false;
+		}
+
+		string sql;
+		if( rowid == 0 )
+		{
+			sql = "INSERT INTO " + SEARCH_TABLE + "_ids (" + ID +
+				") VALUES (?);";
+			rc = SQLITE3_PREPARE( mpVpdDb, sql.c_str( ), sql.length( ) + 1,
+						&pstmt, &out );
+			if( rc == SQLITE_OK )
+				rc = sqlite3_bind_text( pstmt, 1, id.c_str( ), id.length( ),
+							SQLITE_STATIC );
+			if( rc == SQLITE_OK )
+				rc = sqlite3_step( pstmt );
+			if( rc != SQLITE_DONE )
+				goto SEARCH_ERR;
+			sqlite3_finalize( pstmt );
+			pstmt = NULL;
+			rowid = sqlite3_last_insert_rowid( mpVpdDb );
+		}
+		else
+		{
+			ostringstream del;
+			del << "DELETE FROM " << SEARCH_TABLE << " WHERE rowid = " <<
+				rowid << ";";
+			if( !execute( del.str( ) ) )
+				return false;
+		}
+
+		sql = "INSERT INTO " + SEARCH_TABLE +
+			" (rowid, fields, keywords) VALUES (?, ?, ?);";
+		rc = SQLITE3_PREPARE( mpVpdDb, sql.c_str( ), sql.length( ) + 1,
+					&pstmt, &out );
+		if( rc == SQLITE_OK )
+			rc = sqlite3_bind_int64( pstmt, 1, rowid );
+		if( rc == SQLITE_OK )
+			rc = sqlite3_bind_text( pstmt, 2, fields.c_str( ),
+						fields.length( ), SQLITE_STATIC );
+		if( rc == SQLITE_OK )
+			rc = sqlite3_bind_text( pstmt, 3, keywords.c_str( ),
+						keywords.length( ), SQLITE_STATIC );
+		if( rc == SQLITE_OK )
+			rc = sqlite3_step( pstmt );
+		if( rc != SQLITE_DONE )
+			goto SEARCH_ERR;
+		sqlite3_finalize( pstmt );
+		return true;
+
+SEARCH_ERR:
+		Logger l;
+		ostringstream message;
+		message << "SQLITE Error " << rc << ": " <<
+			sqlite3_errmsg( mpVpdDb ) << endl;
+		l.log( message.str( ), LOG_ERR );
+		sqlite3_finalize( pstmt );
+		return false;
+	}
+
+	bool VpdDbEnv::rebuildSearch( )
+	{
+		sqlite3_stmt *pstmt = NULL;
+		const char *out;
+		int rc;
+
+		if( !mHasSearch )
+			return false;
+		if( !execute( "SAVEPOINT vpd_search;" ) )
+			return false;
+		if( !execute( "DELETE FROM " + SEARCH_TABLE + "; DELETE FROM " +
+			SEARCH_TABLE + "_ids;" ) )
+			goto REBUILD_UNDO;
+
+		{
+			string sql = "SELECT " + ID + ", " + DATA + " FROM " + TABLE_NAME +
+				";";
+			rc = SQLITE3_PREPARE( mpVpdDb, sql.c_str( ), sql.length( ) + 1,
+						&pstmt, &out );
+			if( rc != SQLITE_OK )
+				goto REBUILD_UNDO;
+
+			while( ( rc = sqlite3_step( pstmt ) ) == SQLITE_ROW )
+			{
+				string id( (const char*)sqlite3_column_text( pstmt, 0 ),
+						sqlite3_column_bytes( pstmt, 0 ) );
+				const void* data = sqlite3_column_blob( pstmt, 1 );
+
+				if( !indexSearch( id, data, sqlite3_column_bytes( pstmt, 1 ) ) )
+					goto REBUILD_UNDO;
+			}
+			if( rc != SQLITE_DONE )
+				goto REBUILD_UNDO;
+			sqlite3_finalize( pstmt );
+		}
+		return execute( "RELEASE vpd_search;" );
+
+REBUILD_UNDO:
+		sqlite3_finalize( pstmt );
+		execute( "ROLLBACK TO vpd_search; RELEASE vpd_search;" );
+		return false;
+	}
+
+	bool VpdDbEnv::setSearchIndex( bool enabled )
+	{
+		ostringstream sql;
+		char *err = NULL;
+		int rc;
+
+		if( enabled == mHasSearch )
+			return true;
+		if( mUpdateLock.mReadOnly )
+		{
+			Logger( ).log( "The search index of a read only database cannot "
+					"be changed", LOG_ERR );
+			return false;
+		}
+
+		if( enabled )
+			sql << "SAVEPOINT vpd_search_create; CREATE VIRTUAL TABLE " <<
+				SEARCH_TABLE << " USING fts5( fields, keywords, " <<
+				"tokenize = 'trigram' ); CREATE TABLE " << SEARCH_TABLE <<
+				"_ids ( " << ID << " TEXT NOT NULL UNIQUE );";
+		else
+			sql << "DROP TABLE " << SEARCH_TABLE << "; DROP TABLE " <<
+				SEARCH_TABLE << "_ids;";
+		rc = sqlite3_exec( mpVpdDb, sql.str( ).c_str( ), NULL, NULL, &err );
+
+		// sqlite3_prepare statements do not survive a schema change.
+		if( mpFetchStmt != NULL )
+		{
+			sqlite3_finalize( mpFetchStmt );
+			mpFetchStmt = NULL;
+		}
+
+		if( rc != SQLITE_OK )
+		{
+			Logger l;
+			ostringstream message;
+			message << "SQLITE Error " << rc << ": " <<
+				( err ? err : sqlite3_errmsg( mpVpdDb ) ) << endl;
+			l.log( message.str( ), enabled ? LOG_WARNING : LOG_ERR );
+			sqlite3_free( err );
+			if( enabled )
+				execute( "ROLLBACK TO vpd_search_create; "
+						"RELEASE vpd_search_create;" );
+			return false;
+		}
+
+		mHasSearch = enabled;
+		if( !enabled )
+			return true;
+
+		if( !rebuildSearch( ) )
+		{
+			mHasSearch = false;
+			execute( "ROLLBACK TO vpd_search_create; "
+					"RELEASE vpd_search_create;" );
+			return false;
+		}
+		return execute( "RELEASE vpd_search_create;" );
+	}
+
+	/*
+	 * Lower cases the ASCII letters of str in place, the same folding the
+	 * scan uses on the values.
+	 */
+	static void foldCase( string& str )
+	{
+		string::iterator i, end = str.end( );
+		for( i = str.begin( ); i != end; ++i )
+			if( *i >= 'A' && *i <= 'Z' )
+				*i += 'a' - 'A';
+	}
+
+	/*
+	 * The scan behind search when the index cannot answer.  Every term must
+	 * be in one value, rows are ranked by how often the terms occur and then
+	 * by how short their values are, much like the index ranks them.
+	 */
+	vector<string> VpdDbEnv::searchScan( const vector<string>& terms,
+				unsigned int limit )
+	{
+		struct Match {
+			u64 hits;
+			size_t length;
+			string id;
+			bool operator<( const Match& rhs ) const
+			{
+				if( hits != rhs.hits )
+					return hits > rhs.hits;
+				if( length != rhs.length )
+					return length < rhs.length;
+				return id < rhs.id;
+			}
+		};
+		vector<Match> matches;
+		vector<string> ret;
+		vector<string>::const_iterator term, tEnd = terms.end( );
+		sqlite3_stmt *pstmt = NULL;
+		const char *out;
+		string text, keywords;
+		int rc;
+
+		string sql = "SELECT " + ID + ", " + DATA + " FROM " + TABLE_NAME + ";";
+		rc = SQLITE3_PREPARE( mpVpdDb, sql.c_str( ), sql.length( ) + 1,
+					&pstmt, &out );
+		if( rc != SQLITE_OK )
+			goto SCAN_ERR;
+
+		while( ( rc = sqlite3_step( pstmt ) ) == SQLITE_ROW )
+		{
+			string id( (const char*)sqlite3_column_text( pstmt, 0 ),
+					sqlite3_column_bytes( pstmt, 0 ) );
+			const char* data = (const char*)sqlite3_column_blob( pstmt, 1 );
+			Match m;
+
+			text.clear( );
+			keywords.clear( );
+			if( !searchValues( id, data, sqlite3_column_bytes( pstmt, 1 ),
+				text, keywords ) )
+				continue;
+			text += keywords;
+			foldCase( text );
+
+			m.hits = 0;
+			for( term = terms.begin( ); term != tEnd; ++term )
+			{
+				size_t pos = text.find( *term );
+				if( pos == string::npos )
+					break;
+				for( ; pos != string::npos; pos = text.find( *term, pos + 1 ) )
+					m.hits++;
+			}
+			if( term != tEnd )
+				continue;
+
+			m.length = text.length( );
+			m.id = id;
+			matches.push_back( m );
+		}
+		if( rc != SQLITE_DONE )
+			goto SCAN_ERR;
+		sqlite3_finalize( pstmt );
+
+		if( limit > 0 && limit < matches.size( ) )
+		{
+			partial_sort( matches.begin( ), matches.begin( ) + limit,
+					matches.end( ) );
+			matches.resize( limit );
+		}
+		else
+			sort( matches.begin( ), matches.end( ) );
+
+		ret.reserve( matches.size( ) );
+		for( vector<Match>::iterator i = matches.begin( );
+			i != matches.end( ); ++i )
+			ret.push_back( i->id );
+		return ret;
+
+SCAN_ERR:
+		Logger l;
+		ostringstream message;
+		message << "SQLITE Error " << rc << ": " <<
+			sqlite3_errmsg( mpVpdDb ) << endl;
+		l.log( message.str( ), LOG_ERR );
+		sqlite3_finalize( pstmt );
+		return ret;
+	}
+
+	vector<string> VpdDbEnv::search( const string& text, unsigned int limit )
+	{
+		vector<string> terms, ret;
+		vector<string>::const_iterator term, tEnd;
+		istringstream words( text );
+		string word, query;
+		bool useIndex = mHasSearch;
+		sqlite3_stmt *pstmt = NULL;
+		const char *out;
+		int rc;
+
+		while( words >> word )
+		{
+			foldCase( word );
+			terms.push_back( word );
+		}
+		if( terms.empty( ) )
+			return ret;
+
+		/*
+		 * The trigram index cannot look up less than three characters, a
+		 * query with a shorter term is left to the scan.  Each term is
+		 * quoted so that nothing in it is taken as query syntax.
+		 */
+		for( term = terms.begin( ), tEnd = terms.end( ); term != tEnd; ++term )
+		{
+			size_t chars = 0;
+			for( string::const_iterator c = term->begin( );
+				c != term->end( ); ++c )
+				if( ( *c & 0xc0 ) != 0x80 )
+					chars++;
+			if( chars < 3 )
+				useIndex = false;
+
+			query += query.empty( ) ? "\"" : " \"";
+			for( string::const_iterator c = term->begin( );
+				c != term->end( ); ++c )
+				query += *c == '"' ? string( "\"\"" ) : string( 1, *c );
+			query += '"';
+		}
+		if( !useIndex )
+			return searchScan( terms, limit );
+
+		string sql = "SELECT i." + ID + " FROM " + SEARCH_TABLE + " s JOIN " +
+			SEARCH_TABLE + "_ids i ON i.rowid = s.rowid WHERE " +
+			SEARCH_TABLE + " MATCH ? ORDER BY s.rank LIMIT ?;";
+		rc = SQLITE3_PREPARE( mpVpdDb, sql.c_str( ), sql.length( ) + 1,
+					&pstmt, &out );
+		// A reader whose SQLite lacks FTS5 can still scan.
+		if( rc != SQLITE_OK )
+		{
+			sqlite3_finalize( pstmt );
+			return searchScan( terms, limit );
+		}
+
+		rc = sqlite3_bind_text( pstmt, 1, query.c_str( ), query.length( ),
+					SQLITE_STATIC );
+		if( rc == SQLITE_OK )
+			rc = sqlite3_bind_int64( pstmt, 2,
+						limit > 0 ? (sqlite3_int64)limit : -1 );
+		if( rc != SQLITE_OK )
+			goto SEARCH_ERR;
+
+		while( ( rc = sqlite3_step( pstmt ) ) == SQLITE_ROW )
+			ret.push_back( string(
+				(const char*)sqlite3_column_text( pstmt, 0 ),
+				sqlite3_column_bytes( pstmt, 0 ) ) );
+		if( rc != SQLITE_DONE )
+			goto SEARCH_ERR;
+		sqlite3_finalize( pstmt );
+		return ret;
+
+SEARCH_ERR:
+		Logger l;
+		ostringstream message;
+		message << "SQLITE Error " << rc << ": " <<
+			sqlite3_errmsg( mpVpdDb ) << endl;
+		l.log( message.str( ), LOG_ERR );
+		sqlite3_finalize( pstmt );
+		ret.clear( );
+		return ret;
+	}
+
+	/*
+	 * Writes one packed row and its journal entry, both or neither.  data
+	 * still belongs to the caller.
+	 */
+	bool VpdDbEnv::storePacked( const string& id, const void* data,
+				unsigned int dataSize, bool replace )
+	{
+		int rc;
+		const char *out;
+		sqlite3_stmt *pstmt = NULL;
+
+		if( !execute( "SAVEPOINT vpd_store;" ) )
+			return false;
+
+		string sql = string( replace ? "INSERT OR REPLACE" : "INSERT" ) +
+				" INTO " + TABLE_NAME + " (" + ID + ", " + DATA +
+				") VALUES (?, ?);";
+		rc = SQLITE3_PREPARE( mpVpdDb, sql.c_str( ), sql.length( ) + 1,
+					&pstmt, &out );
+		if( rc != SQLITE_OK )
+			goto STORE_ERR;
+
+		rc = sqlite3_bind_text( pstmt, 1, id.c_str( ), id.length( ),
+					SQLITE_STATIC );
+		if( rc != SQLITE_OK )
+			goto STORE_ERR;
+
+		rc = sqlite3_bind_blob( pstmt, 2, data, dataSize, SQLITE_STATIC );
+		if( rc != SQLITE_OK )
+			goto STORE_ERR;
+
+		rc = sqlite3_step( pstmt );
+		if( rc != SQLITE_DONE )
+			goto STORE_ERR;
+		sqlite3_finalize( pstmt );
+
+		if( !indexKeywords( id, data ) || !indexVersions( id, data ) ||
+			( mHasSearch && !indexSearch( id, data, dataSize ) ) ||
+			!journal( id, JOURNAL_STORE, FieldTable::hash(
+				(const char*)data, dataSize, 0xcbf29ce484222325ULL ) ) )
+		{
+			execute( "ROLLBACK TO vpd_store; RELEASE vpd_store;" );
+			return false;
+		}
+		return execute( "RELEASE vpd_store;" );
+
+STORE_ERR:
+		Logger l;
+		ostringstream message;
+		message << "SQLITE Error " << rc << ": " <<
+			sqlite3_errmsg( mpVpdDb ) << endl;
+		l.log( message.str( ), LOG_ERR );
+
+		if ( rc == SQLITE_BUSY )
+			l.log( "Another instance of vpdupdate running." );
+
+		sqlite3_finalize( pstmt );
+		execute( "ROLLBACK TO vpd_store; RELEASE vpd_store;" );
+		return false;
+	}
+
+	bool VpdDbEnv::store( Component *storeMe )
+	{
+		void * buffer = NULL;
+		unsigned int dataSize = storeMe->pack( &buffer );
+		bool ret = storePacked( storeMe->getID( ), buffer, dataSize, false );
+		delete [] (char*)buffer;
+		return ret;
+	}
+
+	bool VpdDbEnv::store( System *storeMe )
+	{
+		void * buffer = NULL;
+		unsigned int dataSize = storeMe->pack( &buffer );
+		bool ret = storePacked( storeMe->getID( ), buffer, dataSize, false );
+		delete [] (char*)buffer;
+		return ret;
+	}
+
+	bool VpdDbEnv::upsert( Component *storeMe )
+	{
+		void * buffer = NULL;
+		unsigned int dataSize = storeMe->pack( &buffer );
+		bool ret = storePacked( storeMe->getID( ), buffer, dataSize, true );
+		delete [] (char*)buffer;
+		return ret;
+	}
+
+	bool VpdDbEnv::upsert( System *storeMe )
+	{
+		void * buffer = NULL;
+		unsigned int dataSize = storeMe->pack( &buffer );
+		bool ret = storePacked( storeMe->getID( ), buffer, dataSize, true );
+		delete [] (char*)buffer;
+		return ret;
+	}
+
+	bool VpdDbEnv::remove( const string& deviceID )
+	{
+		int rc;
+		const char *out;
+		sqlite3_stmt *pstmt = NULL;
+
+		if( !execute( "SAVEPOINT vpd_remove;" ) )
+			return false;
+
+		string sql = "DELETE FROM " + TABLE_NAME + " WHERE " + ID + " = ?;";
+		rc = SQLITE3_PREPARE( mpVpdDb, sql.c_str( ), sql.length( ) + 1,
+					&pstmt, &out );
+		if( rc != SQLITE_OK )
+			goto REMOVE_ERR;
+
+		rc = sqlite3_bind_text( pstmt, 1, deviceID.c_str( ),
+					deviceID.length( ), SQLITE_STATIC );
+		if( rc != SQLITE_OK )
+			goto REMOVE_ERR;
+
+		rc = sqlite3_step( pstmt );
+		if( rc != SQLITE_DONE )
+			goto REMOVE_ERR;
+		sqlite3_finalize( pstmt );
+
+		// Removing a row that is not there is not a change.
+		if( sqlite3_changes( mpVpdDb ) > 0 &&
+			( !unindexKeywords( deviceID ) || !unindexVersions( deviceID ) ||
+			( mHasSearch && !unindexSearch( deviceID ) ) ||
+			!journal( deviceID, JOURNAL_REMOVE, 0 ) ) )
+		{
+			execute( "ROLLBACK TO vpd_remove; RELEASE vpd_remove;" );
+			return false;
+		}
+		return execute( "RELEASE vpd_remove;" );
+
+REMOVE_ERR:
+		Logger l;
+		ostringstream message;
+		message << "SQLITE Error " << rc << ": " <<
+			sqlite3_errmsg( mpVpdDb ) << endl;
+		l.log( message.str( ), LOG_ERR );
+		sqlite3_finalize( pstmt );
+		execute( "ROLLBACK TO vpd_remove; RELEASE vpd_remove;" );
+		return false;
+	}
+
+	vector<string> VpdDbEnv::getKeys( )
+	{
+		vector<string> ret;
+		sqlite3_stmt *pstmt = NULL;
+		int rc;
+		const char *out;
+
+		string sql = "SELECT " + ID + " FROM " + TABLE_NAME + ";";
+		rc = SQLITE3_PREPARE( mpVpdDb, sql.c_str( ), sql.length( ) + 1,
+					&pstmt, &out );
+		if( rc != SQLITE_OK )
+		{
+			Logger l;
+			ostringstream message;
+			message << "SQLITE Error " << rc << ": " <<
+				sqlite3_errmsg( mpVpdDb ) << endl;
+			l.log( message.str( ), LOG_ERR );
+			return ret;
+		}
+
 		rc = sqlite3_step( pstmt );
 		while( rc == SQLITE_ROW )
 		{
@@ -505,4 +1864,521 @@ REMOVE_ERR:
 		sqlite3_finalize( pstmt );
 		return ret;
 	}
+
+	vector<string> VpdDbEnv::getKeys( const string& resumeToken,
+					unsigned int pageSize, string& nextToken )
+	{
+		vector<string> ret;
+		sqlite3_stmt *pstmt = NULL;
+		int rc;
+		const char *out;
+
+		nextToken.clear( );
+		if( pageSize == 0 )
+			return ret;
+
+		string sql = "SELECT " + ID + " FROM " + TABLE_NAME + " WHERE " +
+			ID + " > ? ORDER BY " + ID + " LIMIT ?;";
+		rc = SQLITE3_PREPARE( mpVpdDb, sql.c_str( ), sql.length( ) + 1,
+					&pstmt, &out );
+		if( rc != SQLITE_OK )
+			goto KEYS_PAGE_ERR;
+
+		rc = sqlite3_bind_text( pstmt, 1, resumeToken.c_str( ),
+				resumeToken.length( ), SQLITE_STATIC );
+		if( rc != SQLITE_OK )
+			goto KEYS_PAGE_ERR;
+
+		// Ask for one extra row to find out if there is another page.
+		rc = sqlite3_bind_int64( pstmt, 2, (sqlite3_int64)pageSize + 1 );
+		if( rc != SQLITE_OK )
+			goto KEYS_PAGE_ERR;
+
+		while( ( rc = sqlite3_step( pstmt ) ) == SQLITE_ROW )
+		{
+			const char *row = (const char*)sqlite3_column_text( pstmt, 0 );
+			if( ret.size( ) == pageSize )
+			{
+				nextToken = ret.back( );
+				break;
+			}
+			if( row )
+				ret.push_back( string( row ) );
+		}
+		if( rc != SQLITE_ROW && rc != SQLITE_DONE )
+			goto KEYS_PAGE_ERR;
+
+		sqlite3_finalize( pstmt );
+		return ret;
+
+KEYS_PAGE_ERR:
+		Logger l;
+		ostringstream message;
+		message << "SQLITE Error " << rc << ": " <<
+			sqlite3_errmsg( mpVpdDb ) << endl;
+		l.log( message.str( ), LOG_ERR );
+		if( pstmt )
+			sqlite3_finalize( pstmt );
+		nextToken.clear( );
+		return ret;
+	}
+
+	/*
+	 * Returns the smallest string that is greater than every string
+	 * starting with prefix, or an empty string if there is no such bound
+	 * (empty prefix or a prefix made only of 0xff bytes).
+	 */
+	static string prefixUpperBound( const string& prefix )
+	{
+		string ret( prefix );
+
+		while( !ret.empty( ) )
+		{
+			unsigned char last = ret[ ret.length( ) - 1 ];
+			if( last != 0xff )
+			{
+				ret[ ret.length( ) - 1 ] = last + 1;
+				break;
+			}
+			ret.erase( ret.length( ) - 1 );
+		}
+		return ret;
+	}
+
+	VpdDbEnv::Cursor* VpdDbEnv::scanPrefix( const string& prefix )
+	{
+		return scanRange( prefix, prefixUpperBound( prefix ) );
+	}
+
+	/*
+	 * Both scans are plain comparisons on comp_id so that SQLite can seek
+	 * the UNIQUE index on it rather than visiting every row.  The System
+	 * row is skipped because it does not hold a Component.
+	 */
+	VpdDbEnv::Cursor* VpdDbEnv::scanRange( const string& first,
+					const string& last )
+	{
+		Cursor *ret = NULL;
+		sqlite3_stmt *pstmt = NULL;
+		int rc;
+		const char *out;
+		ostringstream message;
+
+		string sql = "SELECT " + ID + ", " + DATA + " FROM " + TABLE_NAME +
+			" WHERE " + ID + " >= ?1 AND " + ID + " != ?3";
+		if( !last.empty( ) )
+			sql += " AND " + ID + " < ?2";
+		sql += " ORDER BY " + ID + ";";
+
+		rc = SQLITE3_PREPARE( mpVpdDb, sql.c_str( ), sql.length( ) + 1,
+					&pstmt, &out );
+		if( rc != SQLITE_OK )
+			goto SCAN_ERR;
+
+		rc = sqlite3_bind_text( pstmt, 1, first.c_str( ), first.length( ),
+				SQLITE_TRANSIENT );
+		if( rc != SQLITE_OK )
+			goto SCAN_ERR;
+
+		if( !last.empty( ) )
+		{
+			rc = sqlite3_bind_text( pstmt, 2, last.c_str( ), last.length( ),
+					SQLITE_TRANSIENT );
+			if( rc != SQLITE_OK )
+				goto SCAN_ERR;
+		}
+
+		rc = sqlite3_bind_text( pstmt, 3, System::ID.c_str( ),
+				System::ID.length( ), SQLITE_STATIC );
+		if( rc != SQLITE_OK )
+			goto SCAN_ERR;
+
+		try {
+			ret = new Cursor( mpVpdDb, pstmt );
+		}
+		catch (std::bad_alloc& ba) {
+			message << "SQLITE Error: call to new() failed " << endl;
+			goto SCAN_NEW_FAILED;
+		}
+		return ret;
+
+SCAN_ERR:
+		message << "SQLITE Error " << rc << ": " <<
+			sqlite3_errmsg( mpVpdDb ) << endl;
+SCAN_NEW_FAILED:
+		Logger().log( message.str( ), LOG_ERR );
+		if( pstmt )
+			sqlite3_finalize( pstmt );
+		return NULL;
+	}
+
+	VpdDbEnv::Cursor::Cursor( sqlite3* db, sqlite3_stmt* stmt ) :
+		mpVpdDb( db ),
+		mpStmt( stmt ),
+		mFailed( false )
+	{
+	}
+
+	VpdDbEnv::Cursor::~Cursor( )
+	{
+		if( mpStmt )
+			sqlite3_finalize( mpStmt );
+	}
+
+	bool VpdDbEnv::Cursor::next( )
+	{
+		int rc;
+
+		if( mpStmt == NULL )
+			return false;
+
+		rc = sqlite3_step( mpStmt );
+		if( rc == SQLITE_ROW )
+		{
+			const char *id = (const char*)sqlite3_column_text( mpStmt, 0 );
+			mID.assign( id ? id : "" );
+			return true;
+		}
+
+		if( rc != SQLITE_DONE )
+		{
+			Logger l;
+			ostringstream message;
+			message << "SQLITE Error " << rc << ": " <<
+				sqlite3_errmsg( mpVpdDb ) << endl;
+			l.log( message.str( ), LOG_ERR );
+			mFailed = true;
+		}
+
+		// Release the statement (and its read lock) as soon as we are done.
+		sqlite3_finalize( mpStmt );
+		mpStmt = NULL;
+		mID.clear( );
+		return false;
+	}
+
+	Component* VpdDbEnv::Cursor::getComponent( Component::FieldMask fields )
+	{
+		if( mpStmt == NULL )
+			return NULL;
+
+		checkPacked( mpStmt, 1 );
+		try {
+			return new Component( sqlite3_column_blob( mpStmt, 1 ), fields );
+		}
+		catch (std::bad_alloc& ba) {
+			Logger().log( "SQLITE Error: call to new() failed ", LOG_ERR );
+		}
+		return NULL;
+	}
+
+	u64 VpdDbEnv::getEpoch( )
+	{
+		int rc;
+		const char *out;
+		sqlite3_stmt *pstmt = NULL;
+		u64 ret = 0;
+
+		string sql = "SELECT epoch FROM " + EPOCH_TABLE + " LIMIT 1;";
+		rc = SQLITE3_PREPARE( mpVpdDb, sql.c_str( ), sql.length( ) + 1,
+					&pstmt, &out );
+		if( rc != SQLITE_OK )
+		{
+			// A database written before the journal existed has none.
+			sqlite3_finalize( pstmt );
+			return 0;
+		}
+
+		if( sqlite3_step( pstmt ) == SQLITE_ROW )
+			ret = (u64)sqlite3_column_int64( pstmt, 0 );
+		sqlite3_finalize( pstmt );
+		return ret;
+	}
+
+	u64 VpdDbEnv::getGeneration( u64* epoch )
+	{
+		int rc;
+		const char *out;
+		sqlite3_stmt *pstmt = NULL;
+		u64 ret = 0;
+
+		if( epoch != NULL )
+			*epoch = getEpoch( );
+
+		string sql = "SELECT MAX(gen) FROM " + JOURNAL_TABLE + ";";
+		rc = SQLITE3_PREPARE( mpVpdDb, sql.c_str( ), sql.length( ) + 1,
+					&pstmt, &out );
+		if( rc != SQLITE_OK )
+		{
+			// A database written before the journal existed has none.
+			sqlite3_finalize( pstmt );
+			return 0;
+		}
+
+		if( sqlite3_step( pstmt ) == SQLITE_ROW )
+			ret = (u64)sqlite3_column_int64( pstmt, 0 );
+		sqlite3_finalize( pstmt );
+		return ret;
+	}
+
+	bool VpdDbEnv::changesSince( u64 epoch, u64 generation,
+					vector<JournalEntry>& out )
+	{
+		int rc;
+		const char *tail;
+		sqlite3_stmt *pstmt = NULL;
+		JournalEntry entry;
+		u64 current;
+
+		out.clear( );
+		// Generations of another journal say nothing about this one.
+		if( generation > getGeneration( &current ) || epoch != current ||
+			current == 0 )
+			return false;
+
+		string sql = "SELECT gen, " + ID + ", op, hash FROM " + JOURNAL_TABLE +
+			" WHERE gen > ? ORDER BY gen;";
+		rc = SQLITE3_PREPARE( mpVpdDb, sql.c_str( ), sql.length( ) + 1,
+					&pstmt, &tail );
+		if( rc != SQLITE_OK )
+			goto CHANGES_ERR;
+
+		rc = sqlite3_bind_int64( pstmt, 1, (sqlite3_int64)generation );
+		if( rc != SQLITE_OK )
+			goto CHANGES_ERR;
+
+		while( ( rc = sqlite3_step( pstmt ) ) == SQLITE_ROW )
+		{
+			const char *id = (const char*)sqlite3_column_text( pstmt, 1 );
+			entry.generation = (u64)sqlite3_column_int64( pstmt, 0 );
+			entry.id.assign( id ? id : "" );
+			entry.op = (JournalOp)sqlite3_column_int( pstmt, 2 );
+			entry.hash = (u64)sqlite3_column_int64( pstmt, 3 );
+
+			/*
+			 * Generations are handed out without gaps, so if the first one
+			 * is not the next the ones in between were compacted away.
+			 */
+			if( out.empty( ) && entry.generation != generation + 1 )
+			{
+				sqlite3_finalize( pstmt );
+				return false;
+			}
+			out.push_back( entry );
+		}
+		if( rc != SQLITE_DONE )
+			goto CHANGES_ERR;
+		sqlite3_finalize( pstmt );
+		return true;
+
+CHANGES_ERR:
+		Logger l;
+		ostringstream message;
+		message << "SQLITE Error " << rc << ": " <<
+			sqlite3_errmsg( mpVpdDb ) << endl;
+		l.log( message.str( ), LOG_ERR );
+		sqlite3_finalize( pstmt );
+		out.clear( );
+		return false;
+	}
+
+	static void putU32( ostream& os, u32 val )
+	{
+		u32 netOrder = htonl( val );
+		os.write( (const char*)&netOrder, sizeof( netOrder ) );
+	}
+
+	static void putU64( ostream& os, u64 val )
+	{
+		putU32( os, (u32)( val >> 32 ) );
+		putU32( os, (u32)val );
+	}
+
+	/*
+	 * Reads a number from the delta in buf, advancing pos, false if it would
+	 * run past len.
+	 */
+	static bool getU32( const string& buf, size_t& pos, u32& val )
+	{
+		u32 netOrder;
+		if( buf.length( ) - pos < sizeof( netOrder ) )
+			return false;
+		memcpy( &netOrder, buf.data( ) + pos, sizeof( netOrder ) );
+		val = ntohl( netOrder );
+		pos += sizeof( netOrder );
+		return true;
+	}
+
+	static bool getU64( const string& buf, size_t& pos, u64& val )
+	{
+		u32 high, low;
+		if( !getU32( buf, pos, high ) || !getU32( buf, pos, low ) )
+			return false;
+		val = ( (u64)high << 32 ) | low;
+		return true;
+	}
+
+	bool VpdDbEnv::exportDelta( u64 epoch, u64 generation,
+					const string& fileName, u64* upTo )
+	{
+		vector<JournalEntry> changes;
+		vector<JournalEntry>::reverse_iterator i, end;
+		unordered_map<string, bool> seen;
+		vector<string> ids;
+		ostringstream body;
+		u32 count = 0;
+		u64 last;
+		bool ret = false;
+
+		// Reads the journal and the rows at one point in time.
+		if( !execute( "SAVEPOINT vpd_export;" ) )
+			return false;
+
+		if( !changesSince( epoch, generation, changes ) )
+			goto EXPORT_DONE;
+		last = changes.empty( ) ? generation : changes.back( ).generation;
+
+		// Only the newest state of each row matters, oldest change first.
+		for( i = changes.rbegin( ), end = changes.rend( ); i != end; ++i )
+			if( seen.insert( make_pair( i->id, true ) ).second )
+				ids.push_back( i->id );
+
+		for( vector<string>::reverse_iterator id = ids.rbegin( );
+			id != ids.rend( ); ++id )
+		{
+			const void *data = fetchBlob( *id );
+
+			body.put( (char)( data ? JOURNAL_STORE : JOURNAL_REMOVE ) );
+			putU32( body, id->length( ) );
+			body.write( id->data( ), id->length( ) );
+			if( data )
+			{
+				u32 size = sqlite3_column_bytes( mpFetchStmt, 0 );
+				putU32( body, size );
+				body.write( (const char*)data, size );
+				sqlite3_reset( mpFetchStmt );
+			}
+			else
+				putU32( body, 0 );
+			count++;
+		}
+
+		{
+			ofstream file( fileName.c_str( ), ios_base::out |
+					ios_base::trunc | ios_base::binary );
+			file.write( DELTA_MAGIC, sizeof( DELTA_MAGIC ) );
+			putU32( file, DELTA_VERSION );
+			putU64( file, epoch );
+			putU64( file, generation );
+			putU64( file, last );
+			putU32( file, count );
+			file << body.str( );
+			file.close( );
+			if( !file )
+			{
+				Logger( ).log( "Could not write delta to " + fileName,
+						LOG_ERR );
+				goto EXPORT_DONE;
+			}
+		}
+
+		if( upTo != NULL )
+			*upTo = last;
+		ret = true;
+
+EXPORT_DONE:
+		execute( "RELEASE vpd_export;" );
+		return ret;
+	}
+
+	bool VpdDbEnv::readDelta( const string& fileName,
+				vector<DeltaRecord>& records, u64* from, u64* upTo,
+				u64* epoch )
+	{
+		ifstream file( fileName.c_str( ), ios_base::in | ios_base::binary );
+		ostringstream contents;
+		string buf;
+		size_t pos = sizeof( DELTA_MAGIC );
+		u32 version, count, len;
+		u64 source, first, last;
+		DeltaRecord rec;
+
+		records.clear( );
+		contents << file.rdbuf( );
+		buf = contents.str( );
+		if( !file || buf.length( ) < pos ||
+			memcmp( buf.data( ), DELTA_MAGIC, pos ) != 0 ||
+			!getU32( buf, pos, version ) || version != DELTA_VERSION ||
+			!getU64( buf, pos, source ) ||
+			!getU64( buf, pos, first ) || !getU64( buf, pos, last ) ||
+			!getU32( buf, pos, count ) )
+			goto READ_CORRUPT;
+
+		for( u32 n = 0; n < count; n++ )
+		{
+			if( pos >= buf.length( ) )
+				goto READ_CORRUPT;
+			rec.op = (JournalOp)buf[ pos++ ];
+			if( rec.op != JOURNAL_STORE && rec.op != JOURNAL_REMOVE )
+				goto READ_CORRUPT;
+			if( !getU32( buf, pos, len ) || buf.length( ) - pos < len )
+				goto READ_CORRUPT;
+			rec.id.assign( buf, pos, len );
+			pos += len;
+			if( !getU32( buf, pos, len ) || buf.length( ) - pos < len )
+				goto READ_CORRUPT;
+			rec.data.assign( buf, pos, len );
+			pos += len;
+			records.push_back( rec );
+		}
+
+		if( from != NULL )
+			*from = first;
+		if( upTo != NULL )
+			*upTo = last;
+		if( epoch != NULL )
+			*epoch = source;
+		return true;
+
+READ_CORRUPT:
+		Logger( ).log( "Delta " + fileName + " is corrupt", LOG_ERR );
+		records.clear( );
+		return false;
+	}
+
+	bool VpdDbEnv::applyDelta( const string& fileName, u64* upTo,
+					u64* epoch )
+	{
+		vector<DeltaRecord> records;
+		vector<DeltaRecord>::const_iterator i, end;
+		u64 to, source;
+
+		if( !readDelta( fileName, records, NULL, &to, &source ) )
+			return false;
+
+		if( !execute( "SAVEPOINT vpd_apply;" ) )
+			return false;
+
+		for( i = records.begin( ), end = records.end( ); i != end; ++i )
+		{
+			bool ok = i->op == JOURNAL_STORE ?
+				storePacked( i->id, i->data.data( ), i->data.length( ), true ) :
+				remove( i->id );
+			if( !ok )
+			{
+				execute( "ROLLBACK TO vpd_apply; RELEASE vpd_apply;" );
+				Logger( ).log( "Delta " + fileName + " could not be applied",
+						LOG_ERR );
+				return false;
+			}
+		}
+
+		if( !execute( "RELEASE vpd_apply;" ) )
+			return false;
+		if( upTo != NULL )
+			*upTo = to;
+		if( epoch != NULL )
+			*epoch = source;
+		return true;
+	}
 }
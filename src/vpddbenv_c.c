@@ -22,6 +22,7 @@
  ***************************************************************************/
 
 #include <libvpd-2/vpddbenv.h>
+#include "tokenizer.h"
 #include <stdio.h>
 #include <unistd.h>
 
@@ -84,6 +85,10 @@ struct vpddbenv * new_vpddbenv( const char *dir, const char *file )
 	if( rc != SQLITE_OK )
 		goto newerr;
 
+	rc = register_vpd_sql( ret->db );
+	if( rc != SQLITE_OK )
+		goto newerr;
+
 	return ret;
 
 newerr:
@@ -104,6 +109,18 @@ void free_vpddbenv( struct vpddbenv *freeme )
 }
 
 struct component* fetch_component( struct vpddbenv *db, const char *deviceID )
+{
+	return fetch_component_fields( db, deviceID, COMP_ALL_FIELDS );
+}
+
+struct component* fetch_component_fields( struct vpddbenv *db,
+		const char *deviceID, u64 fields )
+{
+	return fetch_component_arena( db, deviceID, fields, NULL );
+}
+
+struct component* fetch_component_arena( struct vpddbenv *db,
+		const char *deviceID, u64 fields, struct vpdarena *arena )
 {
 	struct component* ret = NULL;
 	sqlite3_stmt *pstmt = NULL;
@@ -125,7 +142,13 @@ struct component* fetch_component( struct vpddbenv *db, const char *deviceID )
 		goto FETCH_COMP_ERR;
 	if( rc == SQLITE_ROW )
 	{
-		ret = unpack_component( (void *) sqlite3_column_blob( pstmt, 0 ) );
+		void *blob = (void *) sqlite3_column_blob( pstmt, 0 );
+
+		if( packed_fits( blob, sqlite3_column_bytes( pstmt, 0 ) ) )
+			ret = unpack_component_arena( blob, fields, arena );
+		else
+			fprintf( stderr, "Error fetching '%s': corrupt component\n",
+					deviceID );
 	}
 	
 	sqlite3_finalize( pstmt );
@@ -139,6 +162,152 @@ FETCH_COMP_ERR:
 	return ret;
 }
 
+struct fetch_slot
+{
+	const char *id;
+	int pos;
+};
+
+static int fetch_slot_cmp( const void *a, const void *b )
+{
+	return strcmp( ((const struct fetch_slot*)a)->id,
+			((const struct fetch_slot*)b)->id );
+}
+
+/*
+ * Binds up to FETCH_BATCH_SIZE ids into one "IN (?,?,...)" statement per
+ * batch.  The batch is sorted so each returned row can be matched back to
+ * every slot it was requested for with a binary search.
+ */
+int fetch_components( struct vpddbenv *db, const char **deviceIDs, int count,
+		struct component **out )
+{
+	sqlite3_stmt *pstmt = NULL;
+	struct fetch_slot *slots = NULL;
+	char *sql = NULL;
+	const char *tail;
+	const char *id;
+	void *blob;
+	const char *err = NULL;
+	int rc = SQLITE_OK, found = 0;
+	int start, n, i, lo, hi, mid;
+	size_t len;
+	static const char head[] = "SELECT " ID ", " DATA " FROM " TABLE_NAME
+		" WHERE " ID " IN (";
+
+	if( !out || count < 0 )
+		return -1;
+
+	for( i = 0; i < count; i++ )
+		out[ i ] = NULL;
+
+	if( !db || !deviceIDs )
+		return -1;
+
+	slots = malloc( sizeof( struct fetch_slot ) * FETCH_BATCH_SIZE );
+	sql = malloc( sizeof( head ) + FETCH_BATCH_SIZE * 2 + 1 );
+	if( !slots || !sql )
+	{
+		err = "out of memory";
+		goto FETCH_MULTI_ERR;
+	}
+
+	for( start = 0; start < count; start += n )
+	{
+		n = count - start;
+		if( n > FETCH_BATCH_SIZE )
+			n = FETCH_BATCH_SIZE;
+
+		len = sizeof( head ) - 1;
+		memcpy( sql, head, len );
+		for( i = 0; i < n; i++ )
+		{
+			if( i )
+				sql[ len++ ] = ',';
+			sql[ len++ ] = '?';
+		}
+		sql[ len++ ] = ')';
+		sql[ len ] = '\0';
+
+		rc = SQLITE3_PREPARE( db->db, sql, len + 1, &pstmt, &tail );
+		if( rc != SQLITE_OK )
+			goto FETCH_MULTI_ERR;
+
+		for( i = 0; i < n; i++ )
+		{
+			slots[ i ].id = deviceIDs[ start + i ] ?
+				deviceIDs[ start + i ] : "";
+			slots[ i ].pos = start + i;
+			rc = sqlite3_bind_text( pstmt, i + 1, slots[ i ].id,
+					strlen( slots[ i ].id ), SQLITE_STATIC );
+			if( rc != SQLITE_OK )
+				goto FETCH_MULTI_ERR;
+		}
+		qsort( slots, n, sizeof( struct fetch_slot ), fetch_slot_cmp );
+
+		while( ( rc = sqlite3_step( pstmt ) ) == SQLITE_ROW )
+		{
+			id = (const char *) sqlite3_column_text( pstmt, 0 );
+			blob = (void *) sqlite3_column_blob( pstmt, 1 );
+			if( !id )
+				continue;
+			/* A row cut short is as corrupt as one unpack rejects */
+			if( !packed_fits( blob, sqlite3_column_bytes( pstmt, 1 ) ) )
+				blob = NULL;
+
+			/* Find the first slot holding this id */
+			lo = 0;
+			hi = n;
+			while( lo < hi )
+			{
+				mid = ( lo + hi ) / 2;
+				if( strcmp( slots[ mid ].id, id ) < 0 )
+					lo = mid + 1;
+				else
+					hi = mid;
+			}
+
+			for( ; lo < n && strcmp( slots[ lo ].id, id ) == 0; lo++ )
+			{
+				out[ slots[ lo ].pos ] = unpack_component( blob );
+				if( !out[ slots[ lo ].pos ] )
+				{
+					err = "corrupt or unreadable component";
+					goto FETCH_MULTI_ERR;
+				}
+				found++;
+			}
+		}
+		if( rc != SQLITE_DONE )
+			goto FETCH_MULTI_ERR;
+
+		sqlite3_finalize( pstmt );
+		pstmt = NULL;
+	}
+
+	free( sql );
+	free( slots );
+	return found;
+
+FETCH_MULTI_ERR:
+	if( err )
+		fprintf( stderr, "Error fetching components: %s\n", err );
+	else
+		fprintf( stderr, "Error fetching components: %s\n",
+				sqlite3_errmsg( db->db ) );
+	if( pstmt )
+		sqlite3_finalize( pstmt );
+	free( sql );
+	free( slots );
+	for( i = 0; i < count; i++ )
+	{
+		if( out[ i ] )
+			free_component( out[ i ] );
+		out[ i ] = NULL;
+	}
+	return -1;
+}
+
 struct system* fetch_system( struct vpddbenv *db )
 {
 	struct system* ret = NULL;
@@ -157,7 +326,13 @@ struct system* fetch_system( struct vpddbenv *db )
 	
 	if( rc == SQLITE_ROW )
 	{
-		ret = unpack_system( (void *) sqlite3_column_blob( pstmt, 0 ) );
+		void *blob = (void *) sqlite3_column_blob( pstmt, 0 );
+
+		if( packed_fits( blob, sqlite3_column_bytes( pstmt, 0 ) ) )
+			ret = unpack_system( blob );
+		else
+			fprintf( stderr, "Error fetching '%s': corrupt system\n",
+					SYS_ID );
 	}
 	
 	sqlite3_finalize( pstmt );
@@ -170,3 +345,203 @@ FETCH_SYS_ERR:
 		sqlite3_finalize( pstmt );
 	return ret;
 }
+
+/*
+ * Like the C++ scans, both of these are range comparisons on comp_id so the
+ * UNIQUE index is used, and the system row is skipped.
+ */
+struct vpdcursor * scan_range( struct vpddbenv *db, const char *first,
+		const char *last )
+{
+	struct vpdcursor *ret = NULL;
+	sqlite3_stmt *pstmt = NULL;
+	int rc;
+	const char *out;
+	char sql_all[] = "SELECT " ID ", " DATA " FROM " TABLE_NAME " WHERE "
+		ID " >= ?1 AND " ID " != '" SYS_ID "' ORDER BY " ID ";";
+	char sql_range[] = "SELECT " ID ", " DATA " FROM " TABLE_NAME " WHERE "
+		ID " >= ?1 AND " ID " < ?2 AND " ID " != '" SYS_ID "' ORDER BY "
+		ID ";";
+
+	if( !db )
+		return NULL;
+	if( !first )
+		first = "";
+
+	if( last && *last )
+		rc = SQLITE3_PREPARE( db->db, sql_range, sizeof( sql_range ),
+				&pstmt, &out );
+	else
+		rc = SQLITE3_PREPARE( db->db, sql_all, sizeof( sql_all ),
+				&pstmt, &out );
+	if( rc != SQLITE_OK )
+		goto SCAN_ERR;
+
+	rc = sqlite3_bind_text( pstmt, 1, first, strlen( first ),
+			SQLITE_TRANSIENT );
+	if( rc != SQLITE_OK )
+		goto SCAN_ERR;
+
+	if( last && *last )
+	{
+		rc = sqlite3_bind_text( pstmt, 2, last, strlen( last ),
+				SQLITE_TRANSIENT );
+		if( rc != SQLITE_OK )
+			goto SCAN_ERR;
+	}
+
+	ret = calloc( 1, sizeof( struct vpdcursor ) );
+	if( !ret )
+		goto SCAN_ERR;
+	ret->dbenv = db;
+	ret->stmt = pstmt;
+	return ret;
+
+SCAN_ERR:
+	fprintf( stderr, "Error scanning '%s': %s\n", first ? first : "",
+			sqlite3_errmsg( db->db ) );
+	if( pstmt )
+		sqlite3_finalize( pstmt );
+	return NULL;
+}
+
+struct vpdcursor * scan_prefix( struct vpddbenv *db, const char *prefix )
+{
+	struct vpdcursor *ret;
+	char *last;
+	size_t len;
+
+	if( !prefix )
+		prefix = "";
+
+	/*
+	 * The upper bound is the prefix with its last byte incremented,
+	 * dropping any trailing 0xff bytes first.
+	 */
+	len = strlen( prefix );
+	last = strdup( prefix );
+	if( !last )
+		return NULL;
+	while( len > 0 && (unsigned char)last[ len - 1 ] == 0xff )
+		last[ --len ] = '\0';
+	if( len > 0 )
+		last[ len - 1 ] = (char)( (unsigned char)last[ len - 1 ] + 1 );
+
+	ret = scan_range( db, prefix, last );
+	free( last );
+	return ret;
+}
+
+int cursor_next( struct vpdcursor *cursor )
+{
+	int rc;
+
+	if( !cursor || !cursor->stmt )
+		return 0;
+
+	rc = sqlite3_step( cursor->stmt );
+	if( rc == SQLITE_ROW )
+	{
+		cursor->id = (const char *) sqlite3_column_text( cursor->stmt, 0 );
+		return 1;
+	}
+
+	if( rc != SQLITE_DONE )
+		fprintf( stderr, "Error scanning: %s\n",
+				sqlite3_errmsg( cursor->dbenv->db ) );
+
+	sqlite3_finalize( cursor->stmt );
+	cursor->stmt = NULL;
+	cursor->id = NULL;
+	return rc == SQLITE_DONE ? 0 : -1;
+}
+
+struct component * cursor_component( struct vpdcursor *cursor )
+{
+	void *blob;
+
+	if( !cursor || !cursor->stmt )
+		return NULL;
+
+	blob = (void *) sqlite3_column_blob( cursor->stmt, 1 );
+	if( !packed_fits( blob, sqlite3_column_bytes( cursor->stmt, 1 ) ) )
+		return NULL;
+	return unpack_component( blob );
+}
+
+void free_cursor( struct vpdcursor *freeme )
+{
+	if( !freeme )
+		return;
+
+	if( freeme->stmt )
+		sqlite3_finalize( freeme->stmt );
+	free( freeme );
+}
+
+/*
+ * The keyword table is kept up to date by the C++ library as rows are
+ * stored, this only reads it.  Matches are appended in comp_id order.
+ */
+int find_by_keyword( struct vpddbenv *db, const char *ac, const char *value,
+		struct list **out )
+{
+	sqlite3_stmt *pstmt = NULL;
+	struct list *item, **next;
+	int rc, count = 0;
+	const char *tail;
+	char sql_value[] = "SELECT DISTINCT " ID " FROM " KEYWORD_TABLE
+		" WHERE ac = ?1 AND value = ?2 ORDER BY " ID ";";
+	char sql_any[] = "SELECT DISTINCT " ID " FROM " KEYWORD_TABLE
+		" WHERE ac = ?1 ORDER BY " ID ";";
+
+	if( !db || !ac || !out )
+		return -1;
+	*out = NULL;
+	next = out;
+
+	if( value )
+		rc = SQLITE3_PREPARE( db->db, sql_value, sizeof( sql_value ),
+				&pstmt, &tail );
+	else
+		rc = SQLITE3_PREPARE( db->db, sql_any, sizeof( sql_any ),
+				&pstmt, &tail );
+	if( rc != SQLITE_OK )
+		goto KEYWORD_ERR;
+
+	rc = sqlite3_bind_text( pstmt, 1, ac, -1, SQLITE_STATIC );
+	if( rc == SQLITE_OK && value )
+		rc = sqlite3_bind_text( pstmt, 2, value, -1, SQLITE_STATIC );
+	if( rc != SQLITE_OK )
+		goto KEYWORD_ERR;
+
+	while( ( rc = sqlite3_step( pstmt ) ) == SQLITE_ROW )
+	{
+		const char *id = (const char *) sqlite3_column_text( pstmt, 0 );
+		if( !id )
+			continue;
+		item = new_list( );
+		if( !item )
+			goto KEYWORD_ERR;
+		item->data = strdup( id );
+		*next = item;
+		next = &item->next;
+		if( !item->data )
+			goto KEYWORD_ERR;
+		count++;
+	}
+	if( rc != SQLITE_DONE )
+		goto KEYWORD_ERR;
+
+	sqlite3_finalize( pstmt );
+	return count;
+
+KEYWORD_ERR:
+	fprintf( stderr, "Error finding keyword '%s': %s\n", ac,
+			sqlite3_errmsg( db->db ) );
+	if( pstmt )
+		sqlite3_finalize( pstmt );
+	free_list( *out );
+	*out = NULL;
+	return -1;
+}
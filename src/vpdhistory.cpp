@@ -0,0 +1,666 @@
+/***************************************************************************
+ *   Copyright (C) 2006, IBM                                               *
+ *                                                                         *
+ *   Maintained By:                                                        *
+ *   Eric Munson and Brad Peters                                           *
+ *   munsone@us.ibm.com, bpeters@us.ibm.com                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the Lesser GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of the  *
+ *   License, or at your option) any later version.                        *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Lesser General Public License for more details.                   *
+ *                                                                         *
+ *   You should have received a copy of the Lesser GNU General Public      *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <libvpd-2/vpdhistory.hpp>
+#include <libvpd-2/logger.hpp>
+#include "fieldtable.hpp"
+
+#include <sstream>
+#include <cstring>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace lsvpd
+{
+	/*
+	 * versions holds one row per version of each ID, numbered from 0.  kind
+	 * says whether data is the whole packed row, a delta against the
+	 * version before it, or empty because the row was removed.  hash is of
+	 * the whole packed row, so a capture can tell if it changed without
+	 * rebuilding it.
+	 */
+	enum VersionKind {
+		VERSION_FULL = 1,
+		VERSION_DELTA = 2,
+		VERSION_REMOVED = 3
+	};
+
+	// The shortest run of bytes a delta copies rather than stores.
+	static const size_t DELTA_BLOCK = 8;
+
+	static inline u64 packedHash( const string& data )
+	{
+		return FieldTable::hash( data.data( ), data.length( ),
+				0xcbf29ce484222325ULL );
+	}
+
+	static void putVarint( string& out, u64 val )
+	{
+		while( val >= 0x80 )
+		{
+			out += (char)( ( val & 0x7f ) | 0x80 );
+			val >>= 7;
+		}
+		out += (char)val;
+	}
+
+	static bool getVarint( const string& in, size_t& pos, u64& val )
+	{
+		val = 0;
+		for( unsigned int shift = 0; pos < in.length( ) && shift < 64;
+			shift += 7 )
+		{
+			unsigned char c = in[ pos++ ];
+			val |= (u64)( c & 0x7f ) << shift;
+			if( !( c & 0x80 ) )
+				return true;
+		}
+		return false;
+	}
+
+	static inline u64 blockKey( const char* p )
+	{
+		u64 key;
+		memcpy( &key, p, sizeof( key ) );
+		return key;
+	}
+
+	/*
+	 * Encodes target as a list of operations on base: a varint of length << 1
+	 * followed by that many literal bytes, or a varint of length << 1 | 1
+	 * followed by the varint offset in base to copy them from.  Runs are
+	 * found by looking up each DELTA_BLOCK bytes of target in an index of
+	 * every block of base, and then extended as far as they match.
+	 */
+	static string encodeDelta( const string& base, const string& target )
+	{
+		unordered_map<u64, size_t> blocks;
+		string out;
+		size_t i = 0, literal = 0, n = target.length( );
+
+		for( size_t j = 0; j + DELTA_BLOCK <= base.length( ); j++ )
+			blocks.insert( make_pair( blockKey( base.data( ) + j ), j ) );
+
+		while( i + DELTA_BLOCK <= n )
+		{
+			unordered_map<u64, size_t>::const_iterator found =
+				blocks.find( blockKey( target.data( ) + i ) );
+			if( found == blocks.end( ) )
+			{
+				i++;
+				continue;
+			}
+
+			size_t from = found->second, len = DELTA_BLOCK;
+			while( i + len < n && from + len < base.length( ) &&
+				target[ i + len ] == base[ from + len ] )
+				len++;
+			// Take back what the literal run ends with if it matches too.
+			while( i > literal && from > 0 &&
+				target[ i - 1 ] == base[ from - 1 ] )
+			{
+				i--;
+				from--;
+				len++;
+			}
+
+			if( i > literal )
+			{
+				putVarint( out, (u64)( i - literal ) << 1 );
+				out.append( target, literal, i - literal );
+			}
+			putVarint( out, (u64)len << 1 | 1 );
+			putVarint( out, from );
+			i += len;
+			literal = i;
+		}
+
+		if( n > literal )
+		{
+			putVarint( out, (u64)( n - literal ) << 1 );
+			out.append( target, literal, n - literal );
+		}
+		return out;
+	}
+
+	static bool decodeDelta( const string& base, const string& delta,
+				string& out )
+	{
+		size_t pos = 0;
+		u64 op, from;
+
+		out.clear( );
+		while( pos < delta.length( ) )
+		{
+			if( !getVarint( delta, pos, op ) )
+				return false;
+			u64 len = op >> 1;
+			if( op & 1 )
+			{
+				if( !getVarint( delta, pos, from ) || from > base.length( ) ||
+					len > base.length( ) - from )
+					return false;
+				out.append( base, from, len );
+			}
+			else
+			{
+				if( len > delta.length( ) - pos )
+					return false;
+				out.append( delta, pos, len );
+				pos += len;
+			}
+		}
+		return true;
+	}
+
+	/*
+	 * History files written before captures kept the epoch of the journal
+	 * get the column added, as 0, which no journal has.
+	 */
+	static bool hasEpochColumn( sqlite3 *db )
+	{
+		const char *tail;
+		sqlite3_stmt *pstmt = NULL;
+		string sql = "SELECT epoch FROM captures LIMIT 0;";
+		int rc = SQLITE3_PREPARE( db, sql.c_str( ), sql.length( ) + 1,
+					&pstmt, &tail );
+
+		sqlite3_finalize( pstmt );
+		return rc == SQLITE_OK;
+	}
+
+	VpdHistory::VpdHistory( const string& envDir, const string& dbFileName ) :
+		mDbPath( envDir + "/" + dbFileName ),
+		mpHistDb( NULL ),
+		mpLatestStmt( NULL ),
+		mpRebuildStmt( NULL )
+	{
+		int rc;
+		ostringstream message;
+
+		rc = sqlite3_open_v2( mDbPath.c_str( ), &mpHistDb,
+				SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL );
+		if( rc != SQLITE_OK )
+		{
+			message << "SQLite Error " << rc << ": " <<
+				sqlite3_errmsg( mpHistDb ) << endl;
+			goto OPEN_ERR;
+		}
+		sqlite3_busy_timeout( mpHistDb, 60000 );
+
+		if( !execute( "CREATE TABLE IF NOT EXISTS versions ( "
+				"comp_id TEXT NOT NULL, seq INTEGER NOT NULL, "
+				"time INTEGER NOT NULL, kind INTEGER NOT NULL, "
+				"hash INTEGER NOT NULL, data BLOB, "
+				"PRIMARY KEY ( comp_id, seq ) );"
+				"CREATE TABLE IF NOT EXISTS captures ( "
+				"time INTEGER NOT NULL, generation INTEGER NOT NULL, "
+				"epoch INTEGER NOT NULL DEFAULT 0 );" ) ||
+			( !hasEpochColumn( mpHistDb ) && !execute( "ALTER TABLE "
+				"captures ADD COLUMN epoch INTEGER NOT NULL DEFAULT 0;" ) ) )
+		{
+			message << "Could not create the history tables in " <<
+				mDbPath << endl;
+			goto OPEN_ERR;
+		}
+		return;
+
+OPEN_ERR:
+		Logger( ).log( message.str( ), LOG_ERR );
+		VpdException ve( message.str( ) );
+		if( mpHistDb != NULL )
+			sqlite3_close( mpHistDb );
+		throw ve;
+	}
+
+	VpdHistory::~VpdHistory( )
+	{
+		sqlite3_finalize( mpLatestStmt );
+		sqlite3_finalize( mpRebuildStmt );
+		int rc = sqlite3_close( mpHistDb );
+		if( rc != SQLITE_OK )
+			logError( rc );
+	}
+
+	void VpdHistory::logError( int rc )
+	{
+		ostringstream message;
+		message << "SQLITE Error " << rc << ": " <<
+			sqlite3_errmsg( mpHistDb ) << endl;
+		Logger( ).log( message.str( ), LOG_ERR );
+	}
+
+	bool VpdHistory::execute( const string& sql )
+	{
+		char *err = NULL;
+		int rc = sqlite3_exec( mpHistDb, sql.c_str( ), NULL, NULL, &err );
+
+		if( rc != SQLITE_OK )
+		{
+			ostringstream message;
+			message << "SQLITE Error " << rc << ": " <<
+				( err ? err : sqlite3_errmsg( mpHistDb ) ) << endl;
+			Logger( ).log( message.str( ), LOG_ERR );
+			sqlite3_free( err );
+			return false;
+		}
+		return true;
+	}
+
+	/*
+	 * Prepares sql into stmt the first time it is needed, and resets it
+	 * for reuse after that.
+	 */
+	int VpdHistory::prepare( sqlite3_stmt*& stmt, const string& sql )
+	{
+		const char *tail;
+
+		if( stmt != NULL )
+			return sqlite3_reset( stmt );
+		return SQLITE3_PREPARE( mpHistDb, sql.c_str( ), sql.length( ) + 1,
+				&stmt, &tail );
+	}
+
+	bool VpdHistory::latest( const string& id, time_t when, Latest& out )
+	{
+		int rc;
+		sqlite3_stmt*& pstmt = mpLatestStmt;
+
+		rc = prepare( pstmt, "SELECT seq, kind, hash FROM versions WHERE "
+			"comp_id = ? AND time <= ? ORDER BY seq DESC LIMIT 1;" );
+		if( rc == SQLITE_OK )
+			rc = sqlite3_bind_text( pstmt, 1, id.c_str( ), id.length( ),
+						SQLITE_STATIC );
+		if( rc == SQLITE_OK )
+			rc = sqlite3_bind_int64( pstmt, 2, (sqlite3_int64)when );
+		if( rc == SQLITE_OK )
+			rc = sqlite3_step( pstmt );
+
+		if( rc == SQLITE_ROW )
+		{
+			out.seq = (u64)sqlite3_column_int64( pstmt, 0 );
+			out.removed = sqlite3_column_int( pstmt, 1 ) == VERSION_REMOVED;
+			out.hash = (u64)sqlite3_column_int64( pstmt, 2 );
+			sqlite3_reset( pstmt );
+			return true;
+		}
+		if( rc != SQLITE_DONE )
+			logError( rc );
+		if( pstmt != NULL )
+			sqlite3_reset( pstmt );
+		return false;
+	}
+
+	bool VpdHistory::rebuild( const string& id, u64 seq, string& out )
+	{
+		int rc;
+		sqlite3_stmt*& pstmt = mpRebuildStmt;
+		string delta;
+		bool found = false;
+
+		// Start from the last full copy at or before seq.
+		rc = prepare( pstmt, "SELECT kind, data FROM versions WHERE "
+			"comp_id = ?1 AND seq <= ?2 AND seq >= ( SELECT MAX(seq) FROM "
+			"versions WHERE comp_id = ?1 AND seq <= ?2 AND kind = 1 ) "
+			"ORDER BY seq;" );
+		if( rc == SQLITE_OK )
+			rc = sqlite3_bind_text( pstmt, 1, id.c_str( ), id.length( ),
+						SQLITE_STATIC );
+		if( rc == SQLITE_OK )
+			rc = sqlite3_bind_int64( pstmt, 2, (sqlite3_int64)seq );
+		if( rc != SQLITE_OK )
+			goto REBUILD_ERR;
+
+		while( ( rc = sqlite3_step( pstmt ) ) == SQLITE_ROW )
+		{
+			const char *data = (const char*)sqlite3_column_blob( pstmt, 1 );
+			int len = sqlite3_column_bytes( pstmt, 1 );
+
+			if( sqlite3_column_int( pstmt, 0 ) == VERSION_FULL )
+			{
+				out.assign( data ? data : "", len );
+				found = true;
+			}
+			else if( found )
+			{
+				delta.assign( data ? data : "", len );
+				string base;
+				base.swap( out );
+				if( !decodeDelta( base, delta, out ) )
+				{
+					Logger( ).log( "Corrupt history for " + id, LOG_ERR );
+					sqlite3_reset( pstmt );
+					return false;
+				}
+			}
+		}
+		if( rc != SQLITE_DONE )
+			goto REBUILD_ERR;
+		sqlite3_reset( pstmt );
+		// The decoders trust the size the row starts with.
+		if( found && !packed_fits( out.data( ), out.length( ) ) )
+		{
+			Logger( ).log( "Corrupt history for " + id, LOG_ERR );
+			return false;
+		}
+		return found;
+
+REBUILD_ERR:
+		logError( rc );
+		if( pstmt != NULL )
+			sqlite3_reset( pstmt );
+		return false;
+	}
+
+	bool VpdHistory::addVersion( const string& id, time_t when, u64 seq,
+					const string* prev, const string* data )
+	{
+		int rc;
+		const char *tail;
+		sqlite3_stmt *pstmt = NULL;
+		VersionKind kind = VERSION_REMOVED;
+		string delta;
+		const string* stored = data;
+
+		if( data != NULL )
+		{
+			kind = VERSION_FULL;
+			if( prev != NULL && seq % KEYFRAME_INTERVAL != 0 )
+			{
+				delta = encodeDelta( *prev, *data );
+				if( delta.length( ) < data->length( ) )
+				{
+					kind = VERSION_DELTA;
+					stored = &delta;
+				}
+			}
+		}
+
+		string sql = "INSERT INTO versions ( comp_id, seq, time, kind, hash, "
+			"data ) VALUES ( ?, ?, ?, ?, ?, ? );";
+		rc = SQLITE3_PREPARE( mpHistDb, sql.c_str( ), sql.length( ) + 1,
+					&pstmt, &tail );
+		if( rc == SQLITE_OK )
+			rc = sqlite3_bind_text( pstmt, 1, id.c_str( ), id.length( ),
+						SQLITE_STATIC );
+		if( rc == SQLITE_OK )
+			rc = sqlite3_bind_int64( pstmt, 2, (sqlite3_int64)seq );
+		if( rc == SQLITE_OK )
+			rc = sqlite3_bind_int64( pstmt, 3, (sqlite3_int64)when );
+		if( rc == SQLITE_OK )
+			rc = sqlite3_bind_int( pstmt, 4, kind );
+		if( rc == SQLITE_OK )
+			rc = sqlite3_bind_int64( pstmt, 5,
+					(sqlite3_int64)( data ? packedHash( *data ) : 0 ) );
+		if( rc == SQLITE_OK )
+			rc = stored ? sqlite3_bind_blob( pstmt, 6, stored->data( ),
+						stored->length( ), SQLITE_STATIC ) :
+				sqlite3_bind_null( pstmt, 6 );
+		if( rc == SQLITE_OK )
+			rc = sqlite3_step( pstmt );
+
+		sqlite3_finalize( pstmt );
+		if( rc != SQLITE_DONE )
+		{
+			logError( rc );
+			return false;
+		}
+		return true;
+	}
+
+	/*
+	 * Records a new version of id if data (NULL for a row that is gone)
+	 * differs from the latest one.
+	 */
+	bool VpdHistory::record( const string& id, time_t when,
+					const string* data, unsigned int& changed )
+	{
+		Latest last;
+		string prev;
+		bool have = latest( id, when, last );
+
+		if( data == NULL )
+		{
+			if( !have || last.removed )
+				return true;
+			changed++;
+			return addVersion( id, when, last.seq + 1, NULL, NULL );
+		}
+
+		if( have && !last.removed && last.hash == packedHash( *data ) )
+			return true;
+		if( have && !last.removed && !rebuild( id, last.seq, prev ) )
+			return false;
+		changed++;
+		return addVersion( id, when, have ? last.seq + 1 : 0,
+				have && !last.removed ? &prev : NULL, data );
+	}
+
+	bool VpdHistory::capture( VpdDbEnv& db, time_t when,
+					unsigned int* changed )
+	{
+		int rc;
+		const char *tail;
+		sqlite3_stmt *pstmt = NULL;
+		vector<VpdDbEnv::JournalEntry> entries;
+		vector<string> ids;
+		unordered_set<string> seen;
+		vector<string>::const_iterator i, end;
+		string data;
+		time_t lastTime = 0;
+		u64 lastGeneration = 0, lastEpoch = 0;
+		bool captured = false;
+		unsigned int count = 0;
+
+		// Taken first, so rows changed while we read them are seen again.
+		u64 epoch;
+		u64 generation = db.getGeneration( &epoch );
+
+		if( !execute( "BEGIN IMMEDIATE;" ) )
+			return false;
+
+		string sql = "SELECT time, generation, epoch FROM captures ORDER BY "
+			"rowid DESC LIMIT 1;";
+		rc = SQLITE3_PREPARE( mpHistDb, sql.c_str( ), sql.length( ) + 1,
+					&pstmt, &tail );
+		if( rc != SQLITE_OK )
+			goto CAPTURE_ERR;
+		if( ( rc = sqlite3_step( pstmt ) ) == SQLITE_ROW )
+		{
+			lastTime = (time_t)sqlite3_column_int64( pstmt, 0 );
+			lastGeneration = (u64)sqlite3_column_int64( pstmt, 1 );
+			lastEpoch = (u64)sqlite3_column_int64( pstmt, 2 );
+			captured = true;
+		}
+		else if( rc != SQLITE_DONE )
+			goto CAPTURE_ERR;
+		sqlite3_finalize( pstmt );
+		pstmt = NULL;
+
+		if( when < lastTime )
+		{
+			Logger( ).log( "History capture is older than the last one",
+					LOG_ERR );
+			goto CAPTURE_UNDO;
+		}
+
+		/*
+		 * The journal only says what changed if it is the one the last
+		 * capture was taken from, otherwise (another or a rebuilt
+		 * database, or a capture from before epochs) everything is
+		 * compared.
+		 */
+		if( captured && db.changesSince( lastEpoch, lastGeneration,
+							entries ) )
+		{
+			vector<VpdDbEnv::JournalEntry>::const_iterator e;
+			for( e = entries.begin( ); e != entries.end( ); ++e )
+				if( seen.insert( e->id ).second )
+					ids.push_back( e->id );
+		}
+		else
+		{
+			// Compare every row, and look for the ones that went away.
+			ids = db.getKeys( );
+			seen.insert( ids.begin( ), ids.end( ) );
+			sql = "SELECT DISTINCT comp_id FROM versions;";
+			rc = SQLITE3_PREPARE( mpHistDb, sql.c_str( ), sql.length( ) + 1,
+						&pstmt, &tail );
+			if( rc != SQLITE_OK )
+				goto CAPTURE_ERR;
+			while( ( rc = sqlite3_step( pstmt ) ) == SQLITE_ROW )
+			{
+				const char *id = (const char*)sqlite3_column_text( pstmt, 0 );
+				if( id && seen.insert( id ).second )
+					ids.push_back( id );
+			}
+			if( rc != SQLITE_DONE )
+				goto CAPTURE_ERR;
+			sqlite3_finalize( pstmt );
+			pstmt = NULL;
+		}
+
+		for( i = ids.begin( ), end = ids.end( ); i != end; ++i )
+		{
+			bool present = db.fetchPacked( *i, data );
+			if( !record( *i, when, present ? &data : NULL, count ) )
+				goto CAPTURE_UNDO;
+		}
+
+		sql = "INSERT INTO captures ( time, generation, epoch ) VALUES "
+			"( ?, ?, ? );";
+		rc = SQLITE3_PREPARE( mpHistDb, sql.c_str( ), sql.length( ) + 1,
+					&pstmt, &tail );
+		if( rc == SQLITE_OK )
+			rc = sqlite3_bind_int64( pstmt, 1, (sqlite3_int64)when );
+		if( rc == SQLITE_OK )
+			rc = sqlite3_bind_int64( pstmt, 2, (sqlite3_int64)generation );
+		if( rc == SQLITE_OK )
+			rc = sqlite3_bind_int64( pstmt, 3, (sqlite3_int64)epoch );
+		if( rc == SQLITE_OK )
+			rc = sqlite3_step( pstmt );
+		if( rc != SQLITE_DONE )
+			goto CAPTURE_ERR;
+		sqlite3_finalize( pstmt );
+
+		if( !execute( "COMMIT;" ) )
+			goto CAPTURE_UNDO;
+		if( changed != NULL )
+			*changed = count;
+		return true;
+
+CAPTURE_ERR:
+		logError( rc );
+		sqlite3_finalize( pstmt );
+CAPTURE_UNDO:
+		execute( "ROLLBACK;" );
+		return false;
+	}
+
+	Component* VpdHistory::componentAsOf( const string& id, time_t when,
+						Component::FieldMask fields )
+	{
+		Latest last;
+		string data;
+
+		if( !latest( id, when, last ) || last.removed ||
+			!rebuild( id, last.seq, data ) )
+			return NULL;
+		return new Component( data.data( ), fields );
+	}
+
+	void VpdHistory::buildSubTree( Component* root, time_t when,
+					Component::FieldMask fields )
+	{
+		const vector<string> children = root->getChildren( );
+		vector<string>::const_iterator i, end = children.end( );
+
+		for( i = children.begin( ); i != end; ++i )
+		{
+			Component* leaf = componentAsOf( *i, when, fields );
+			if( leaf == NULL )
+				continue;
+			buildSubTree( leaf, when, fields );
+			root->addLeaf( leaf );
+		}
+	}
+
+	System* VpdHistory::asOf( time_t when, Component::FieldMask fields )
+	{
+		Latest last;
+		string data;
+		System* root;
+
+		if( !latest( System::ID, when, last ) || last.removed ||
+			!rebuild( System::ID, last.seq, data ) )
+			return NULL;
+
+		root = new System( data.data( ) );
+		const vector<string> children = root->getChildren( );
+		vector<string>::const_iterator i, end = children.end( );
+
+		for( i = children.begin( ); i != end; ++i )
+		{
+			Component* leaf = componentAsOf( *i, when, fields );
+			if( leaf == NULL )
+				continue;
+			buildSubTree( leaf, when, fields );
+			root->addLeaf( leaf );
+		}
+		return root;
+	}
+
+	vector<VpdHistory::Version> VpdHistory::getVersions( const string& id )
+	{
+		vector<Version> ret;
+		Version v;
+		int rc;
+		const char *tail;
+		sqlite3_stmt *pstmt = NULL;
+		string sql = "SELECT time, kind FROM versions WHERE comp_id = ? "
+			"ORDER BY seq;";
+
+		rc = SQLITE3_PREPARE( mpHistDb, sql.c_str( ), sql.length( ) + 1,
+					&pstmt, &tail );
+		if( rc == SQLITE_OK )
+			rc = sqlite3_bind_text( pstmt, 1, id.c_str( ), id.length( ),
+						SQLITE_STATIC );
+		if( rc != SQLITE_OK )
+		{
+			logError( rc );
+			sqlite3_finalize( pstmt );
+			return ret;
+		}
+
+		while( ( rc = sqlite3_step( pstmt ) ) == SQLITE_ROW )
+		{
+			v.when = (time_t)sqlite3_column_int64( pstmt, 0 );
+			v.removed = sqlite3_column_int( pstmt, 1 ) == VERSION_REMOVED;
+			ret.push_back( v );
+		}
+		if( rc != SQLITE_DONE )
+			logError( rc );
+		sqlite3_finalize( pstmt );
+		return ret;
+	}
+}
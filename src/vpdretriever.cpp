@@ -25,6 +25,7 @@
 #include <libvpd-2/vpdretriever.hpp>
 #include <libvpd-2/logger.hpp>
 
+#include <deque>
 #include <vector>
 #include <string>
 #include <sys/types.h>
@@ -163,11 +164,20 @@ namespace lsvpd
 		}
 	}
 
-	System* VpdRetriever::getComponentTree( )
+	System* VpdRetriever::getComponentTree( Component::FieldMask fields )
 	{
 		System *root = db->fetch( );
 		if (root)
-			buildSubTree( root );
+		{
+			try {
+				buildSubTree( root, fields |
+					Component::fieldMask( Component::FIELD_CHILDREN ) );
+			}
+			catch (...) {
+				delete root;
+				throw;
+			}
+		}
 		else
 		{
 			Logger logger;
@@ -179,7 +189,62 @@ namespace lsvpd
 		return root;
 	}
 
-	void VpdRetriever::buildSubTree( System* root )
+	SnapshotPtr VpdRetriever::getSnapshot( Component::FieldMask fields )
+	{
+		Snapshot* snap = new Snapshot( );
+		SnapshotPtr ret( snap );
+		shared_ptr<Snapshot::ParentMap> parents =
+			make_shared<Snapshot::ParentMap>( );
+
+		System* root = db->fetch( );
+		if( root == NULL )
+		{
+			Logger logger;
+			logger.log( "Failed to fetch VPD DB, it may be corrupt.", LOG_ERR );
+			VpdException ve( "Failed to fetch VPD DB, it may be corrupt." );
+			throw ve;
+		}
+		snap->mpSystem = shared_ptr<const System>( root );
+
+		buildSnapshot( root->getChildren( ), System::ID, snap->mLeaves,
+			*parents, fields |
+			Component::fieldMask( Component::FIELD_ID ) |
+			Component::fieldMask( Component::FIELD_CHILDREN ) );
+		snap->mpParents = parents;
+		return ret;
+	}
+
+	void VpdRetriever::buildSnapshot( const vector<string>& children,
+				const string& parentID, vector<SnapshotNodePtr>& leaves,
+				unordered_map<string, string>& parents,
+				Component::FieldMask fields )
+	{
+		vector<string>::const_iterator i, end = children.end( );
+
+		leaves.reserve( children.size( ) );
+		for( i = children.begin( ); i != end; ++i )
+		{
+			Component* leaf = db->fetch( *i, fields );
+			if( leaf == NULL )
+			{
+				Logger logger;
+				logger.log( "Failed to fetch requested item.", LOG_ERR );
+				VpdException ve( "Failed to fetch requested item." );
+				throw ve;
+			}
+
+			shared_ptr<SnapshotNode> node = make_shared<SnapshotNode>(
+				shared_ptr<const Component>( leaf ) );
+			leaves.push_back( node );
+			parents.insert( make_pair( *i, parentID ) );
+			buildSnapshot( leaf->getChildren( ), *i, node->mLeaves, parents,
+				fields );
+			node->rehash( );
+		}
+	}
+
+	void VpdRetriever::buildSubTree( System* root,
+						Component::FieldMask fields )
 	{
 		Component* leaf;
 		const vector<string> children = root->getChildren( );
@@ -190,7 +255,7 @@ namespace lsvpd
 		for( i = children.begin( ); i != end; ++i )
 		{
 			const string next = *i;
-			leaf = db->fetch( next );
+			leaf = db->fetch( next, fields );
 			if( leaf == NULL )
 			{
 				Logger logger;
@@ -198,12 +263,21 @@ namespace lsvpd
 				VpdException ve( "Failed to fetch requested item." );
 				throw ve;
 			}
-			buildSubTree( leaf );
-			root->addLeaf( leaf );
+
+			// leaf is not owned by root until addLeaf returns.
+			try {
+				buildSubTree( leaf, fields );
+				root->addLeaf( leaf );
+			}
+			catch (...) {
+				delete leaf;
+				throw;
+			}
 		}
 	}
 
-	void VpdRetriever::buildSubTree( Component* root )
+	void VpdRetriever::buildSubTree( Component* root,
+						Component::FieldMask fields )
 	{
 		Component* leaf;
 		const vector<string> children = root->getChildren( );
@@ -214,7 +288,7 @@ namespace lsvpd
 		for( i = children.begin( ); i != end; ++i )
 		{
 			const string next = *i;
-			leaf = db->fetch( next );
+			leaf = db->fetch( next, fields );
 			if( leaf == NULL )
 			{
 				Logger logger;
@@ -222,9 +296,198 @@ namespace lsvpd
 				VpdException ve( "Failed to fetch requested item." );
 				throw ve;
 			}
-			buildSubTree( leaf );
-			root->addLeaf( leaf );
+
+			// leaf is not owned by root until addLeaf returns.
+			try {
+				buildSubTree( leaf, fields );
+				root->addLeaf( leaf );
+			}
+			catch (...) {
+				delete leaf;
+				throw;
+			}
 		}
 	}
-}
 
+	bool VpdRetriever::traverse( ComponentVisitor& visitor,
+					ComponentVisitor::Order order, Component::FieldMask fields )
+	{
+		// An ID still to be visited.
+		struct Pending
+		{
+			string id;
+			string parentID;
+			unsigned int depth;
+		};
+		deque<Pending> pending;
+		Component comp;
+
+		System *root = db->fetch( );
+		if( root == NULL )
+		{
+			Logger logger;
+			logger.log( "Failed to fetch VPD DB, it may be corrupt.", LOG_ERR );
+			VpdException ve( "Failed to fetch VPD DB, it may be corrupt." );
+			throw ve;
+		}
+
+		const vector<string>& top = root->getChildren( );
+		vector<string>::const_iterator i, end = top.end( );
+		for( i = top.begin( ); i != end; ++i )
+			pending.push_back( Pending{ *i, System::ID, 1 } );
+		delete root;
+
+		fields |= Component::fieldMask( Component::FIELD_ID ) |
+			Component::fieldMask( Component::FIELD_CHILDREN );
+
+		while( !pending.empty( ) )
+		{
+			Pending next = std::move( pending.front( ) );
+			pending.pop_front( );
+
+			if( !db->fetchInto( next.id, comp, fields ) )
+			{
+				Logger logger;
+				logger.log( "Failed to fetch requested item.", LOG_ERR );
+				VpdException ve( "Failed to fetch requested item." );
+				throw ve;
+			}
+
+			ComponentVisitor::Action act =
+				visitor.visit( comp, next.parentID, next.depth );
+			if( act == ComponentVisitor::STOP )
+				return false;
+			if( act == ComponentVisitor::SKIP_CHILDREN )
+				continue;
+
+			const vector<string>& children = comp.getChildren( );
+			if( order == ComponentVisitor::DEPTH_FIRST )
+			{
+				// In front and in reverse, so the first child is next.
+				vector<string>::const_reverse_iterator j, rend;
+				for( j = children.rbegin( ), rend = children.rend( );
+					j != rend; ++j )
+				{
+					pending.push_front(
+						Pending{ *j, next.id, next.depth + 1 } );
+				}
+			}
+			else
+			{
+				for( i = children.begin( ), end = children.end( ); i != end;
+					++i )
+				{
+					pending.push_back(
+						Pending{ *i, next.id, next.depth + 1 } );
+				}
+			}
+		}
+
+		return true;
+	}
+
+	System* VpdRetriever::getComponentTree( const ComponentFilter& filter,
+						Component::FieldMask fields )
+	{
+		System *root = db->fetch( );
+		Component* leaf;
+		Component scratch;
+		Component::FieldMask probe;
+		vector<string>::const_iterator i, end;
+
+		if( root == NULL )
+		{
+			Logger logger;
+			logger.log( "Failed to fetch VPD DB, it may be corrupt.", LOG_ERR );
+			VpdException ve( "Failed to fetch VPD DB, it may be corrupt." );
+			throw ve;
+		}
+
+		// Every Component is decoded with probe for the filter, only the
+		// ones kept get fields as well.
+		probe = filter.getFields( ) |
+			Component::fieldMask( Component::FIELD_CHILDREN );
+		fields |= probe;
+
+		try {
+			const vector<string> children = root->getChildren( );
+			end = children.end( );
+			for( i = children.begin( ); i != end; ++i )
+			{
+				leaf = buildFiltered( *i, filter, probe, fields, scratch );
+				if( leaf != NULL )
+					root->addLeaf( leaf );
+			}
+		}
+		catch (...) {
+			delete root;
+			throw;
+		}
+
+		return root;
+	}
+
+	/**
+	 * Loads id and, unless the filter prunes it, its subtree.  The filter
+	 * only ever sees scratch, decoded with just probe, so a Component that
+	 * is not kept is never allocated or fully decoded.  Returns id loaded
+	 * with fields if it matched or any descendant was kept, otherwise NULL.
+	 */
+	Component* VpdRetriever::buildFiltered( const string& id,
+		const ComponentFilter& filter, Component::FieldMask probe,
+		Component::FieldMask fields, Component& scratch )
+	{
+		Component* root = NULL;
+		vector<Component*> leaves;
+		vector<string> children;
+		vector<string>::const_iterator i, end;
+		bool keep;
+
+		if( !db->fetchInto( id, scratch, probe ) )
+		{
+			Logger logger;
+			logger.log( "Failed to fetch requested item.", LOG_ERR );
+			VpdException ve( "Failed to fetch requested item." );
+			throw ve;
+		}
+
+		keep = filter.matches( scratch );
+		// scratch is reused below, so take what is needed from it first.
+		if( filter.mayContainMatch( scratch ) )
+			children = scratch.getChildren( );
+
+		// Nothing owns the leaves until root is built, free them here if
+		// anything below throws.
+		try {
+			end = children.end( );
+			for( i = children.begin( ); i != end; ++i )
+			{
+				Component* leaf = buildFiltered( *i, filter, probe, fields,
+					scratch );
+				if( leaf != NULL )
+					leaves.push_back( leaf );
+			}
+
+			if( keep || !leaves.empty( ) )
+			{
+				root = db->fetch( id, fields );
+				if( root == NULL )
+				{
+					Logger logger;
+					logger.log( "Failed to fetch requested item.", LOG_ERR );
+					VpdException ve( "Failed to fetch requested item." );
+					throw ve;
+				}
+			}
+		}
+		catch (...) {
+			for( size_t j = 0; j < leaves.size( ); j++ )
+				delete leaves[ j ];
+			throw;
+		}
+
+		for( size_t j = 0; j < leaves.size( ); j++ )
+			root->addLeaf( leaves[ j ] );
+		return root;
+	}
+}
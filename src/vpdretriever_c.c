@@ -26,7 +26,8 @@
 
 #include "libvpd-2/vpdretriever.h"
 
-static int build_component_sub( struct vpdretriever *dbenv, struct component *root )
+static int build_component_sub( struct vpdretriever *dbenv, struct component *root,
+		u64 fields, struct vpdarena *arena )
 {
 	struct list *child;
 	struct component *addme;
@@ -34,7 +35,8 @@ static int build_component_sub( struct vpdretriever *dbenv, struct component *ro
 	child = root->childrenIDs;
 	while( child )
 	{
-		addme = get_component( dbenv, (char*)child->data );
+		addme = fetch_component_arena( dbenv->dbenv, (char*)child->data,
+				fields, arena );
 		if( !addme )
 			return 1;
 		
@@ -44,7 +46,7 @@ static int build_component_sub( struct vpdretriever *dbenv, struct component *ro
 		 */
 		addme->next = root->children;
 		root->children = addme;
-		if( build_component_sub( dbenv, addme ) )
+		if( build_component_sub( dbenv, addme, fields, arena ) )
 			return 1;
 		
 		child = child->next;
@@ -53,7 +55,8 @@ static int build_component_sub( struct vpdretriever *dbenv, struct component *ro
 	return 0;
 }
 
-static int build_system_sub( struct vpdretriever *dbenv, struct system *root )
+static int build_system_sub( struct vpdretriever *dbenv, struct system *root,
+		u64 fields, struct vpdarena *arena )
 {
 	struct list *child;
 	struct component *addme;
@@ -61,7 +64,8 @@ static int build_system_sub( struct vpdretriever *dbenv, struct system *root )
 	child = root->childrenIDs;
 	while( child )
 	{
-		addme = get_component( dbenv, (char*)child->data );
+		addme = fetch_component_arena( dbenv->dbenv, (char*)child->data,
+				fields, arena );
 		if( !addme )
 			return 1;
 		
@@ -71,7 +75,7 @@ static int build_system_sub( struct vpdretriever *dbenv, struct system *root )
 		 */
 		addme->next = root->children;
 		root->children = addme;
-		if( build_component_sub( dbenv, addme ) )
+		if( build_component_sub( dbenv, addme, fields, arena ) )
 			return 1;
 		
 		child = child->next;
@@ -80,6 +84,58 @@ static int build_system_sub( struct vpdretriever *dbenv, struct system *root )
 return 0;
 }
 
+/*
+ * Loads id and its subtree unless the filter prunes it.  *out is set to the
+ * component if it matched or a descendant was kept, otherwise it is free'd
+ * and *out is NULL.  Returns non-zero on error.
+ */
+static int build_filtered( struct vpdretriever *dbenv, const char *id,
+		const struct component_filter *filter, u64 fields,
+		struct component **out )
+{
+	struct list *child;
+	struct component *root, *addme;
+	int keep;
+
+	*out = NULL;
+	root = get_component_fields( dbenv, id, fields );
+	if( !root )
+		return 1;
+
+	keep = filter->matches( root, filter->arg );
+	if( !filter->may_contain || filter->may_contain( root, filter->arg ) )
+	{
+		child = root->childrenIDs;
+		while( child )
+		{
+			if( build_filtered( dbenv, (char*)child->data, filter, fields,
+					&addme ) )
+				goto filtererr;
+
+			if( addme )
+			{
+				addme->next = root->children;
+				root->children = addme;
+				keep = 1;
+			}
+			child = child->next;
+		}
+	}
+
+	if( !keep )
+	{
+		free_component( root );
+		return 0;
+	}
+
+	*out = root;
+	return 0;
+
+filtererr:
+	free_component( root );
+	return 1;
+}
+
 struct vpdretriever * new_vpdretriever( const char* dir, const char *file )
 {
 	struct vpdretriever *ret = NULL;
@@ -108,6 +164,12 @@ void free_vpdretriever( struct vpdretriever *freeme )
 }
 
 struct system * get_component_tree( struct vpdretriever * dbenv )
+{
+	return get_component_tree_fields( dbenv, COMP_ALL_FIELDS );
+}
+
+struct system * get_component_tree_fields( struct vpdretriever * dbenv,
+		u64 fields )
 {
 	struct system *root;
 	
@@ -119,7 +181,8 @@ struct system * get_component_tree( struct vpdretriever * dbenv )
 	if( !root )
 		return NULL;
 	
-	if( build_system_sub( dbenv, root ) )
+	if( build_system_sub( dbenv, root,
+			fields | COMP_FIELD_BIT( COMP_FIELD_CHILDREN ), NULL ) )
 		goto geterr;
 	
 	return root;
@@ -129,6 +192,90 @@ geterr:
 	return NULL;
 }
 
+struct component_tree * load_component_tree( struct vpdretriever *dbenv,
+		u64 fields )
+{
+	struct component_tree *ret;
+
+	if( !dbenv )
+		return NULL;
+
+	ret = calloc( 1, sizeof( struct component_tree ) );
+	if( !ret )
+		return NULL;
+
+	ret->arena = new_arena( );
+	if( !ret->arena )
+		goto loaderr;
+
+	ret->root = get_system( dbenv );
+	if( !ret->root )
+		goto loaderr;
+
+	if( build_system_sub( dbenv, ret->root,
+			fields | COMP_FIELD_BIT( COMP_FIELD_CHILDREN ), ret->arena ) )
+		goto loaderr;
+
+	return ret;
+
+loaderr:
+	free_component_tree( ret );
+	return NULL;
+}
+
+void free_component_tree( struct component_tree *freeme )
+{
+	if( !freeme )
+		return;
+
+	if( freeme->root )
+	{
+		/* The components below the system all live in the arena */
+		freeme->root->children = NULL;
+		free_system( freeme->root );
+	}
+	free_arena( freeme->arena );
+	free( freeme );
+}
+
+struct system * get_component_tree_filtered( struct vpdretriever * dbenv,
+		const struct component_filter *filter )
+{
+	struct system *root;
+	struct component *addme;
+	struct list *child;
+	u64 fields;
+
+	if( !dbenv || !filter || !filter->matches )
+		return NULL;
+
+	root = get_system( dbenv );
+	if( !root )
+		return NULL;
+
+	fields = filter->fields | COMP_FIELD_BIT( COMP_FIELD_CHILDREN );
+	child = root->childrenIDs;
+	while( child )
+	{
+		if( build_filtered( dbenv, (char*)child->data, filter, fields,
+				&addme ) )
+			goto geterr;
+
+		if( addme )
+		{
+			addme->next = root->children;
+			root->children = addme;
+		}
+		child = child->next;
+	}
+
+	return root;
+
+geterr:
+	free_system( root );
+	return NULL;
+}
+
 struct component * get_component( struct vpdretriever * dbenv, const char *id )
 {
 	if( !dbenv )
@@ -137,9 +284,54 @@ struct component * get_component( struct vpdretriever * dbenv, const char *id )
 	return fetch_component( dbenv->dbenv, id );
 }
 
+struct component * get_component_fields( struct vpdretriever * dbenv,
+		const char *id, u64 fields )
+{
+	if( !dbenv )
+		return NULL;
+
+	return fetch_component_fields( dbenv->dbenv, id, fields );
+}
+
+int get_components( struct vpdretriever * dbenv, const char **ids, int count,
+		struct component **out )
+{
+	if( !dbenv )
+		return -1;
+
+	return fetch_components( dbenv->dbenv, ids, count, out );
+}
+
+struct vpdcursor * get_components_by_prefix( struct vpdretriever * dbenv,
+		const char *prefix )
+{
+	if( !dbenv )
+		return NULL;
+
+	return scan_prefix( dbenv->dbenv, prefix );
+}
+
+struct vpdcursor * get_components_in_range( struct vpdretriever * dbenv,
+		const char *first, const char *last )
+{
+	if( !dbenv )
+		return NULL;
+
+	return scan_range( dbenv->dbenv, first, last );
+}
+
 struct system * get_system( struct vpdretriever * dbenv )
 {
 	if( !dbenv )
 		return NULL;
 	return fetch_system( dbenv->dbenv );
 }
+
+int get_components_by_keyword( struct vpdretriever * dbenv, const char *ac,
+		const char *value, struct list **out )
+{
+	if( !dbenv )
+		return -1;
+
+	return find_by_keyword( dbenv->dbenv, ac, value, out );
+}
@@ -0,0 +1,621 @@
+/***************************************************************************
+ *   Copyright (C) 2007, IBM                                               *
+ *                                                                         *
+ *   Maintained By:                                                        *
+ *   Eric Munson and Brad Peters                                           *
+ *   ebmunson@us.ibm.com, bpeters@us.ibm.com                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the Lesser GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of the  *
+ *   License, or at your option) any later version.                        *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Lesser General Public License for more details.                   *
+ *                                                                         *
+ *   You should have received a copy of the Lesser GNU General Public      *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "libvpd-2/vpddbenv.h"
+#include "tokenizer.h"
+#include "vpdsql.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Everything here works on the tokens of a packed component (see
+ * tokenizer.h), nothing is unpacked into a struct component.  The value of
+ * fixed field i is always token i * 3 + 2.
+ */
+
+#ifdef SQLITE_DETERMINISTIC
+#define VPD_SQL_FLAGS ( SQLITE_UTF8 | SQLITE_DETERMINISTIC )
+#else
+#define VPD_SQL_FLAGS SQLITE_UTF8
+#endif
+
+#define FIELD_NAME( name, member, slot, ac, humanName ) #name,
+static const char *field_names[ COMP_FIELD_CHILDREN ] = {
+	VPD_COMPONENT_FIELDS( FIELD_NAME )
+};
+#undef FIELD_NAME
+
+struct packed_tokens
+{
+	const char *base;
+	struct vpdtoken *tok;
+	int count;
+	struct vpdtoken stack[ TOKENIZER_STACK_TOKENS ];
+};
+
+static void release_tokens( struct packed_tokens *t )
+{
+	if( t->tok && t->tok != t->stack )
+		free( t->tok );
+	t->tok = NULL;
+}
+
+/*
+ * Splits the packed component in blob, returns non-zero if it is too short
+ * to be one.
+ */
+static int split_component( const void *blob, int bytes,
+		struct packed_tokens *t )
+{
+	u32 size, netOrder;
+
+	t->tok = NULL;
+	if( !blob || bytes < (int)sizeof( u32 ) )
+		return 1;
+
+	memcpy( &netOrder, blob, sizeof( u32 ) );
+	size = ntohl( netOrder );
+	if( size < sizeof( u32 ) || size > (u32)bytes )
+		return 1;
+
+	t->base = (const char*)blob + sizeof( u32 );
+	t->tok = tokenize( t->base, size - sizeof( u32 ), t->stack,
+			TOKENIZER_STACK_TOKENS, &t->count );
+	if( !t->tok )
+		return 1;
+	if( t->count < COMP_FIELD_CHILDREN * 3 )
+	{
+		release_tokens( t );
+		return 1;
+	}
+	return 0;
+}
+
+/*
+ * Returns the index of the first token after CHILD_START, or -1 if there
+ * is none.
+ */
+static int children_start( const struct packed_tokens *t )
+{
+	int i;
+
+	for( i = COMP_FIELD_CHILDREN * 3; i < t->count; i++ )
+		if( token_equals( t->base, &t->tok[ i ], CHILD_START,
+				strlen( CHILD_START ) ) )
+			return i + 1;
+	return -1;
+}
+
+/*
+ * Looks for keyword ac in the fixed fields and then in the device specific,
+ * user data and AIX name lists.  The first match with a value wins, an
+ * empty value is only returned when no match has one.
+ */
+static const struct vpdtoken * find_keyword( const struct packed_tokens *t,
+		const char *ac, size_t len )
+{
+	static const char *lists[][ 2 ] = {
+		{ DEVICE_START, DEVICE_END },
+		{ USER_START, USER_END },
+		{ AX_START, AX_END }
+	};
+	const struct vpdtoken *empty = NULL;
+	int i, l;
+
+	for( i = 0; i < COMP_FIELD_CHILDREN * 3; i += 3 )
+	{
+		if( !token_equals( t->base, &t->tok[ i ], ac, len ) )
+			continue;
+		if( t->tok[ i + 2 ].length > 0 )
+			return &t->tok[ i + 2 ];
+		if( !empty )
+			empty = &t->tok[ i + 2 ];
+	}
+
+	i = children_start( t );
+	if( i < 0 )
+		return empty;
+	while( i < t->count && !token_equals( t->base, &t->tok[ i ], CHILD_END,
+			strlen( CHILD_END ) ) )
+		i++;
+	i++;
+
+	for( l = 0; l < 3 && i < t->count; l++ )
+	{
+		if( !token_equals( t->base, &t->tok[ i ], lists[ l ][ 0 ],
+				strlen( lists[ l ][ 0 ] ) ) )
+			continue;
+		for( i++; i + 3 <= t->count && !token_equals( t->base, &t->tok[ i ],
+				lists[ l ][ 1 ], strlen( lists[ l ][ 1 ] ) ); i += 3 )
+		{
+			if( !token_equals( t->base, &t->tok[ i ], ac, len ) )
+				continue;
+			if( t->tok[ i + 2 ].length > 0 )
+				return &t->tok[ i + 2 ];
+			if( !empty )
+				empty = &t->tok[ i + 2 ];
+		}
+		i++;
+	}
+	return empty;
+}
+
+/*
+ * A growing buffer for the JSON text of vpd_children.
+ */
+struct json_buffer
+{
+	char *data;
+	size_t length;
+	size_t size;
+	int failed;
+};
+
+static void json_append( struct json_buffer *b, const char *str, size_t len )
+{
+	char *grown;
+	size_t size;
+
+	if( b->failed )
+		return;
+	if( b->length + len > b->size )
+	{
+		size = b->size ? b->size * 2 : 256;
+		while( size < b->length + len )
+			size *= 2;
+		grown = realloc( b->data, size );
+		if( !grown )
+		{
+			b->failed = 1;
+			return;
+		}
+		b->data = grown;
+		b->size = size;
+	}
+	memcpy( b->data + b->length, str, len );
+	b->length += len;
+}
+
+static void json_append_string( struct json_buffer *b, const char *str,
+		size_t len )
+{
+	static const char hex[] = "0123456789abcdef";
+	char escape[ 6 ] = { '\\', 'u', '0', '0' };
+	size_t i, run = 0;
+
+	json_append( b, "\"", 1 );
+	for( i = 0; i < len; i++ )
+	{
+		unsigned char c = (unsigned char)str[ i ];
+
+		if( c >= 0x20 && c != '"' && c != '\\' )
+			continue;
+		json_append( b, str + run, i - run );
+		run = i + 1;
+		if( c == '"' || c == '\\' )
+		{
+			escape[ 1 ] = c;
+			json_append( b, escape, 2 );
+			escape[ 1 ] = 'u';
+		}
+		else
+		{
+			escape[ 4 ] = hex[ c >> 4 ];
+			escape[ 5 ] = hex[ c & 0xf ];
+			json_append( b, escape, 6 );
+		}
+	}
+	json_append( b, str + run, len - run );
+	json_append( b, "\"", 1 );
+}
+
+/*
+ * Sets the result of ctx to the JSON array of the child ID's, or to NULL if
+ * the children section is missing.
+ */
+static void result_children( sqlite3_context *ctx,
+		const struct packed_tokens *t )
+{
+	struct json_buffer b = { NULL, 0, 0, 0 };
+	int i = children_start( t ), first = 1;
+
+	if( i < 0 )
+	{
+		sqlite3_result_null( ctx );
+		return;
+	}
+
+	json_append( &b, "[", 1 );
+	for( ; i < t->count && !token_equals( t->base, &t->tok[ i ], CHILD_END,
+			strlen( CHILD_END ) ); i++ )
+	{
+		if( t->tok[ i ].length == 0 )
+			continue;
+		if( !first )
+			json_append( &b, ",", 1 );
+		json_append_string( &b, t->base + t->tok[ i ].offset,
+				t->tok[ i ].length );
+		first = 0;
+	}
+	json_append( &b, "]", 1 );
+
+	if( i >= t->count )
+		sqlite3_result_null( ctx );
+	else if( b.failed )
+		sqlite3_result_error_nomem( ctx );
+	else
+	{
+		sqlite3_result_text( ctx, b.data, b.length, free );
+		return;
+	}
+	free( b.data );
+}
+
+static void result_token( sqlite3_context *ctx, const struct packed_tokens *t,
+		const struct vpdtoken *tok )
+{
+	if( tok )
+		sqlite3_result_text( ctx, t->base + tok->offset, tok->length,
+				SQLITE_TRANSIENT );
+	else
+		sqlite3_result_null( ctx );
+}
+
+/*
+ * vpd_field( comp_data, key ): key is a field name (e.g. 'SERIAL_NUMBER')
+ * or a keyword (e.g. 'SN'), see find_keyword.
+ */
+static void vpd_field_func( sqlite3_context *ctx, int argc,
+		sqlite3_value **argv )
+{
+	struct packed_tokens t;
+	const char *key = (const char*)sqlite3_value_text( argv[ 1 ] );
+	const void *blob = sqlite3_value_blob( argv[ 0 ] );
+	int i;
+
+	(void)argc;
+
+	if( !key || split_component( blob, sqlite3_value_bytes( argv[ 0 ] ),
+			&t ) )
+	{
+		sqlite3_result_null( ctx );
+		return;
+	}
+
+	for( i = 0; i < COMP_FIELD_CHILDREN; i++ )
+		if( sqlite3_stricmp( key, field_names[ i ] ) == 0 )
+			break;
+	if( i < COMP_FIELD_CHILDREN )
+		result_token( ctx, &t, &t.tok[ i * 3 + 2 ] );
+	else
+		result_token( ctx, &t, find_keyword( &t, key, strlen( key ) ) );
+	release_tokens( &t );
+}
+
+static void vpd_children_func( sqlite3_context *ctx, int argc,
+		sqlite3_value **argv )
+{
+	struct packed_tokens t;
+	const void *blob = sqlite3_value_blob( argv[ 0 ] );
+
+	(void)argc;
+	if( split_component( blob, sqlite3_value_bytes( argv[ 0 ] ), &t ) )
+	{
+		sqlite3_result_null( ctx );
+		return;
+	}
+	result_children( ctx, &t );
+	release_tokens( &t );
+}
+
+/*
+ * The vpd_components virtual table, one row per component in TABLE_NAME.
+ * A comp_id = ? constraint is answered with the index, anything else scans
+ * the table.  A row is only split when one of its fields is asked for.
+ */
+#define VTAB_COLUMN_ID       0
+#define VTAB_COLUMN_FIELDS   1
+#define VTAB_COLUMN_CHILDREN ( VTAB_COLUMN_FIELDS + COMP_FIELD_CHILDREN )
+
+#define VTAB_SCAN  0
+#define VTAB_EQUAL 1
+
+#define FIELD_COLUMN( name, member, slot, ac, humanName ) ", " #name " TEXT"
+static const char vtab_schema[] = "CREATE TABLE x ( " ID " TEXT"
+	VPD_COMPONENT_FIELDS( FIELD_COLUMN ) ", children TEXT )";
+#undef FIELD_COLUMN
+
+static const char *vtab_queries[] = {
+	"SELECT rowid, " ID ", " DATA " FROM " TABLE_NAME " WHERE " ID
+		" != '" SYS_ID "'",
+	"SELECT rowid, " ID ", " DATA " FROM " TABLE_NAME " WHERE " ID
+		" = ?1 AND " ID " != '" SYS_ID "'"
+};
+
+struct vpd_vtab
+{
+	sqlite3_vtab base;
+	sqlite3 *db;
+};
+
+struct vpd_vtab_cursor
+{
+	sqlite3_vtab_cursor base;
+	sqlite3_stmt *stmt;
+	int query;
+	int eof;
+	int split;	/* 0 not yet, 1 split, -1 not a component */
+	struct packed_tokens tokens;
+};
+
+static int vtab_connect( sqlite3 *db, void *aux, int argc,
+		const char *const *argv, sqlite3_vtab **out, char **err )
+{
+	struct vpd_vtab *vtab;
+	int rc;
+
+	(void)aux;
+	(void)argc;
+	(void)argv;
+	(void)err;
+	rc = sqlite3_declare_vtab( db, vtab_schema );
+	if( rc != SQLITE_OK )
+		return rc;
+
+	vtab = sqlite3_malloc( sizeof( struct vpd_vtab ) );
+	if( !vtab )
+		return SQLITE_NOMEM;
+	memset( vtab, 0, sizeof( struct vpd_vtab ) );
+	vtab->db = db;
+	*out = &vtab->base;
+	return SQLITE_OK;
+}
+
+static int vtab_disconnect( sqlite3_vtab *vtab )
+{
+	sqlite3_free( vtab );
+	return SQLITE_OK;
+}
+
+static int vtab_best_index( sqlite3_vtab *vtab, sqlite3_index_info *info )
+{
+	int i;
+
+	(void)vtab;
+	for( i = 0; i < info->nConstraint; i++ )
+	{
+		if( !info->aConstraint[ i ].usable ||
+			info->aConstraint[ i ].iColumn != VTAB_COLUMN_ID ||
+			info->aConstraint[ i ].op != SQLITE_INDEX_CONSTRAINT_EQ )
+			continue;
+
+		info->aConstraintUsage[ i ].argvIndex = 1;
+		info->aConstraintUsage[ i ].omit = 1;
+		info->idxNum = VTAB_EQUAL;
+		info->estimatedCost = 10;
+#if SQLITE_VERSION_NUMBER >= 3008002
+		info->estimatedRows = 1;
+#endif
+		return SQLITE_OK;
+	}
+
+	info->idxNum = VTAB_SCAN;
+	info->estimatedCost = 100000;
+	return SQLITE_OK;
+}
+
+static int vtab_open( sqlite3_vtab *vtab, sqlite3_vtab_cursor **out )
+{
+	struct vpd_vtab_cursor *cur;
+
+	(void)vtab;
+	cur = sqlite3_malloc( sizeof( struct vpd_vtab_cursor ) );
+	if( !cur )
+		return SQLITE_NOMEM;
+	memset( cur, 0, sizeof( struct vpd_vtab_cursor ) );
+	cur->eof = 1;
+	*out = &cur->base;
+	return SQLITE_OK;
+}
+
+static int vtab_close( sqlite3_vtab_cursor *base )
+{
+	struct vpd_vtab_cursor *cur = (struct vpd_vtab_cursor*)base;
+
+	release_tokens( &cur->tokens );
+	sqlite3_finalize( cur->stmt );
+	sqlite3_free( cur );
+	return SQLITE_OK;
+}
+
+static int vtab_next( sqlite3_vtab_cursor *base )
+{
+	struct vpd_vtab_cursor *cur = (struct vpd_vtab_cursor*)base;
+	struct vpd_vtab *vtab = (struct vpd_vtab*)base->pVtab;
+	int rc;
+
+	release_tokens( &cur->tokens );
+	cur->split = 0;
+
+	rc = sqlite3_step( cur->stmt );
+	if( rc == SQLITE_ROW )
+	{
+		cur->eof = 0;
+		return SQLITE_OK;
+	}
+
+	cur->eof = 1;
+	if( rc == SQLITE_DONE )
+		return SQLITE_OK;
+	sqlite3_free( vtab->base.zErrMsg );
+	vtab->base.zErrMsg = sqlite3_mprintf( "%s", sqlite3_errmsg( vtab->db ) );
+	return rc;
+}
+
+/*
+ * The statement is kept between calls, so the lookups of a join only
+ * prepare it once.
+ */
+static int vtab_filter( sqlite3_vtab_cursor *base, int idxNum,
+		const char *idxStr, int argc, sqlite3_value **argv )
+{
+	struct vpd_vtab_cursor *cur = (struct vpd_vtab_cursor*)base;
+	struct vpd_vtab *vtab = (struct vpd_vtab*)base->pVtab;
+	int rc;
+
+	(void)idxStr;
+	(void)argc;
+	if( cur->stmt && cur->query != idxNum )
+	{
+		sqlite3_finalize( cur->stmt );
+		cur->stmt = NULL;
+	}
+
+	if( cur->stmt )
+		sqlite3_reset( cur->stmt );
+	else
+	{
+		rc = SQLITE3_PREPARE( vtab->db, vtab_queries[ idxNum ], -1,
+				&cur->stmt, NULL );
+		if( rc != SQLITE_OK )
+		{
+			sqlite3_free( vtab->base.zErrMsg );
+			vtab->base.zErrMsg = sqlite3_mprintf( "%s",
+					sqlite3_errmsg( vtab->db ) );
+			return rc;
+		}
+		cur->query = idxNum;
+	}
+
+	if( idxNum == VTAB_EQUAL )
+	{
+		rc = sqlite3_bind_value( cur->stmt, 1, argv[ 0 ] );
+		if( rc != SQLITE_OK )
+			return rc;
+	}
+
+	return vtab_next( base );
+}
+
+static int vtab_eof( sqlite3_vtab_cursor *base )
+{
+	return ((struct vpd_vtab_cursor*)base)->eof;
+}
+
+static int vtab_column( sqlite3_vtab_cursor *base, sqlite3_context *ctx,
+		int column )
+{
+	struct vpd_vtab_cursor *cur = (struct vpd_vtab_cursor*)base;
+	const void *blob;
+
+	if( column == VTAB_COLUMN_ID )
+	{
+		sqlite3_result_value( ctx, sqlite3_column_value( cur->stmt, 1 ) );
+		return SQLITE_OK;
+	}
+
+	if( cur->split == 0 )
+	{
+		blob = sqlite3_column_blob( cur->stmt, 2 );
+		cur->split = split_component( blob,
+				sqlite3_column_bytes( cur->stmt, 2 ), &cur->tokens ) ? -1 : 1;
+	}
+
+	if( cur->split < 0 )
+		sqlite3_result_null( ctx );
+	else if( column == VTAB_COLUMN_CHILDREN )
+		result_children( ctx, &cur->tokens );
+	else
+		result_token( ctx, &cur->tokens,
+				&cur->tokens.tok[ ( column - VTAB_COLUMN_FIELDS ) * 3 + 2 ] );
+	return SQLITE_OK;
+}
+
+static int vtab_rowid( sqlite3_vtab_cursor *base, sqlite3_int64 *rowid )
+{
+	*rowid = sqlite3_column_int64( ((struct vpd_vtab_cursor*)base)->stmt, 0 );
+	return SQLITE_OK;
+}
+
+/*
+ * With no xCreate the table is eponymous only: it exists in every schema
+ * as vpd_components and cannot be created under another name.  It is read
+ * only and has no transactions, so every later slot is empty; each one is
+ * still spelled out, for the SQLite the library is built against.
+ */
+static sqlite3_module vtab_module = {
+	0,					/* iVersion */
+	NULL,				/* xCreate */
+	vtab_connect,		/* xConnect */
+	vtab_best_index,	/* xBestIndex */
+	vtab_disconnect,	/* xDisconnect */
+	NULL,				/* xDestroy */
+	vtab_open,			/* xOpen */
+	vtab_close,			/* xClose */
+	vtab_filter,		/* xFilter */
+	vtab_next,			/* xNext */
+	vtab_eof,			/* xEof */
+	vtab_column,		/* xColumn */
+	vtab_rowid,			/* xRowid */
+	NULL,				/* xUpdate */
+	NULL,				/* xBegin */
+	NULL,				/* xSync */
+	NULL,				/* xCommit */
+	NULL,				/* xRollback */
+	NULL,				/* xFindFunction */
+	NULL				/* xRename */
+#if SQLITE_VERSION_NUMBER >= 3007007
+	,
+	NULL,				/* xSavepoint */
+	NULL,				/* xRelease */
+	NULL				/* xRollbackTo */
+#endif
+#if SQLITE_VERSION_NUMBER >= 3026000
+	,
+	NULL				/* xShadowName */
+#endif
+#if SQLITE_VERSION_NUMBER >= 3044000
+	,
+	NULL				/* xIntegrity */
+#endif
+};
+
+int register_vpd_sql( sqlite3 *db )
+{
+	int rc;
+
+	rc = sqlite3_create_function( db, "vpd_field", 2, VPD_SQL_FLAGS, NULL,
+			vpd_field_func, NULL, NULL );
+	if( rc != SQLITE_OK )
+		return rc;
+
+	rc = sqlite3_create_function( db, "vpd_children", 1, VPD_SQL_FLAGS, NULL,
+			vpd_children_func, NULL, NULL );
+	if( rc != SQLITE_OK )
+		return rc;
+
+	return sqlite3_create_module( db, "vpd_components", &vtab_module, NULL );
+}
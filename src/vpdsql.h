@@ -0,0 +1,47 @@
+/***************************************************************************
+ *   Copyright (C) 2007, IBM                                               *
+ *                                                                         *
+ *   Maintained By:                                                        *
+ *   Eric Munson and Brad Peters                                           *
+ *   ebmunson@us.ibm.com, bpeters@us.ibm.com                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the Lesser GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of the  *
+ *   License, or at your option) any later version.                        *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Lesser General Public License for more details.                   *
+ *                                                                         *
+ *   You should have received a copy of the Lesser GNU General Public      *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef VPDSQL_H_
+#define VPDSQL_H_
+
+#include <sqlite3.h>
+
+/*
+ * The SQL functions and the virtual table that both libraries register on
+ * their connections, implemented in vpdsql.c and documented with the C
+ * declaration in vpddbenv.h.
+ *
+ * This header is private to the libraries and is not installed.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int register_vpd_sql( sqlite3 *db );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*VPDSQL_H_*/
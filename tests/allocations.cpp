@@ -0,0 +1,66 @@
+/***************************************************************************
+ *   Copyright (C) 2006, IBM                                               *
+ *                                                                         *
+ *   Maintained By:                                                        *
+ *   Eric Munson and Brad Peters                                           *
+ *   munsone@us.ibm.com, bpeters@us.ibm.com                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the Lesser GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of the  *
+ *   License, or at your option) any later version.                        *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Lesser General Public License for more details.                   *
+ *                                                                         *
+ *   You should have received a copy of the Lesser GNU General Public      *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+ * A global operator new that counts its calls and the bytes asked of it,
+ * for the tests and benchmarks that check what allocates.  It is in a
+ * file of its own so that the compiler cannot see through it to malloc.
+ */
+
+#include "testutil.hpp"
+
+#include <atomic>
+#include <new>
+
+static atomic<long> sNewCalls( 0 );
+static atomic<long> sNewBytes( 0 );
+
+void* operator new( size_t size )
+{
+	sNewCalls++;
+	sNewBytes += size;
+	void* p = malloc( size ? size : 1 );
+	if( p == NULL )
+		throw bad_alloc( );
+	return p;
+}
+
+void operator delete( void* p ) noexcept
+{
+	free( p );
+}
+
+void operator delete( void* p, size_t ) noexcept
+{
+	free( p );
+}
+
+long vpdtest::newCalls( )
+{
+	return sNewCalls;
+}
+
+long vpdtest::newBytes( )
+{
+	return sNewBytes;
+}
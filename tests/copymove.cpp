@@ -0,0 +1,161 @@
+/***************************************************************************
+ *   Copyright (C) 2006, IBM                                               *
+ *                                                                         *
+ *   Maintained By:                                                        *
+ *   Eric Munson and Brad Peters                                           *
+ *   munsone@us.ibm.com, bpeters@us.ibm.com                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the Lesser GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of the  *
+ *   License, or at your option) any later version.                        *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Lesser General Public License for more details.                   *
+ *                                                                         *
+ *   You should have received a copy of the Lesser GNU General Public      *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+ * Copies of a Component, by copy constructor, copy assignment or clone,
+ * own their lists and leaves, and moving one, by constructor, assignment
+ * or returning it by value, allocates nothing.
+ */
+
+#include "testutil.hpp"
+
+using namespace vpdtest;
+
+/*
+ * A Component with lists long enough to be indexed and two leaves with
+ * leaves of their own.
+ */
+static Component* tree( )
+{
+	Component* top = Gatherer::make( "/sys/devices/top", System::ID, 1 );
+
+	for( int i = 0; i < 40; i++ )
+	{
+		Gatherer::addDeviceSpecific( top, "D" + to_string( i ),
+			"v" + to_string( i ) );
+		Gatherer::addUserData( top, "U" + to_string( i ),
+			"u" + to_string( i ), false );
+		Gatherer::addAIXName( top, "name" + to_string( i ) );
+	}
+	for( int i = 0; i < 2; i++ )
+	{
+		string id = top->getID( ) + "/c" + to_string( i );
+		Component* leaf = Gatherer::make( id, top->getID( ), 2 + i );
+		leaf->addLeaf( Gatherer::make( id + "/d", id, 4 + i ) );
+		top->addLeaf( leaf );
+	}
+	return top;
+}
+
+/*
+ * The packed form of c and of every Component below it.
+ */
+static string packedTree( Component& c )
+{
+	string ret = packed( c );
+	for( size_t i = 0; i < c.getLeaves( ).size( ); i++ )
+		ret += packedTree( *c.getLeaves( )[ i ] );
+	return ret;
+}
+
+/*
+ * Leaves below c name the Component they hang from.
+ */
+static void checkParents( Component& c )
+{
+	for( size_t i = 0; i < c.getLeaves( ).size( ); i++ )
+	{
+		CHECK( c.getLeaves( )[ i ]->getParentComponent( ) == &c );
+		checkParents( *c.getLeaves( )[ i ] );
+	}
+}
+
+/*
+ * Changes every list of c, and of its first leaf.
+ */
+static void mutate( Component& c )
+{
+	Gatherer::updateDeviceSpecific( &c, "D7", "changed", 90 );
+	Gatherer::addDeviceSpecific( &c, "NEW", "new" );
+	Gatherer::addUserData( &c, "U3", "changed", true );
+	Gatherer::addAIXName( &c, "another" );
+	Gatherer::setSerial( &c, "CHANGED" );
+	Component& leaf = *c.getLeaves( )[ 0 ];
+	Gatherer::updateDeviceSpecific( &leaf, "Z0", "changed", 90 );
+	Gatherer::addAIXName( &leaf, "another" );
+}
+
+static Component pass( Component c )
+{
+	return c;
+}
+
+int main( )
+{
+	Component* original = tree( );
+	string before = packedTree( *original );
+	const DataItem* d7 = original->getDeviceSpecific( )[ 7 ];
+
+	// Each kind of copy is equal to the original, and changing it leaves
+	// the original as it was.
+	{
+		Component* copy = original->clone( );
+		CHECK( packedTree( *copy ) == before );
+		checkParents( *copy );
+		mutate( *copy );
+		CHECK( packedTree( *copy ) != before );
+		CHECK( copy->getDeviceSpecific( "D7" )->getValue( ) == "changed" );
+		delete copy;
+	}
+	CHECK( packedTree( *original ) == before );
+	CHECK( original->getDeviceSpecific( )[ 7 ] == d7 );
+	CHECK( original->getDeviceSpecific( "D7" )->getValue( ) == "v7" );
+	{
+		Component copy( *original );
+		checkParents( copy );
+		mutate( copy );
+		CHECK( packedTree( copy ) != before );
+	}
+	CHECK( packedTree( *original ) == before );
+	{
+		Component* copy = Gatherer::make( "/sys/devices/other", System::ID, 9 );
+		*copy = *original;
+		checkParents( *copy );
+		CHECK( packedTree( *copy ) == before );
+		mutate( *copy );
+		CHECK( packedTree( *original ) == before );
+
+		// Nor does the copy see the original change.
+		*copy = *original;
+		mutate( *original );
+		CHECK( packedTree( *copy ) == before );
+		delete copy;
+		delete original;
+		original = tree( );
+	}
+	CHECK( packedTree( *original ) == before );
+	CHECK( original->getDeviceSpecific( "D7" )->getValue( ) == "v7" );
+
+	// Moves take the lists and leaves as they are.
+	Component a( *original ), c;
+	long calls = newCalls( );
+	Component b( std::move( a ) );
+	c = std::move( b );
+	Component d = pass( std::move( c ) );
+	CHECK( newCalls( ) == calls );
+	checkParents( d );
+	CHECK( packedTree( d ) == before );
+
+	delete original;
+	return 0;
+}
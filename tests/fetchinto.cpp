@@ -0,0 +1,75 @@
+/***************************************************************************
+ *   Copyright (C) 2006, IBM                                               *
+ *                                                                         *
+ *   Maintained By:                                                        *
+ *   Eric Munson and Brad Peters                                           *
+ *   munsone@us.ibm.com, bpeters@us.ibm.com                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the Lesser GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of the  *
+ *   License, or at your option) any later version.                        *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Lesser General Public License for more details.                   *
+ *                                                                         *
+ *   You should have received a copy of the Lesser GNU General Public      *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+ * fetchInto decodes what fetch does into an existing Component, stops
+ * allocating once the Component has grown to fit, and its cached lookup
+ * statement survives another connection changing the schema.
+ */
+
+#include "testutil.hpp"
+
+using namespace vpdtest;
+
+int main( )
+{
+	TempDir dir;
+	vector<string> ids;
+
+	{
+		VpdDbEnv db( dir.path, "vpd.db", false );
+		ids = buildTree( db, 8, 3 );
+	}
+
+	VpdDbEnv db( dir.path, "vpd.db", true );
+	Component into;
+
+	for( size_t i = 0; i < ids.size( ); i++ )
+	{
+		Component* c = db.fetch( ids[ i ] );
+		CHECK( db.fetchInto( ids[ i ], into ) );
+		CHECK( packed( into ) == packed( *c ) );
+		delete c;
+	}
+
+	// Not found leaves out alone.
+	string last = packed( into );
+	CHECK( !db.fetchInto( "/no/such/device", into ) );
+	CHECK( packed( into ) == last );
+
+	// Once into has held every shape, a second pass does not allocate.
+	long before = newCalls( );
+	for( size_t i = 0; i < ids.size( ); i++ )
+		CHECK( db.fetchInto( ids[ i ], into ) );
+	CHECK( newCalls( ) == before );
+
+	// Another connection changing the schema expires the cached statement.
+	execute( dir.path + "/vpd.db", "CREATE TABLE other ( x ); "
+		"DROP TABLE other;" );
+	CHECK( db.fetchInto( ids.back( ), into ) );
+	CHECK( into.getID( ) == ids.back( ) );
+	Component* c = db.fetch( ids.front( ) );
+	CHECK( c != NULL && c->getID( ) == ids.front( ) );
+	delete c;
+	return 0;
+}
@@ -0,0 +1,170 @@
+/***************************************************************************
+ *   Copyright (C) 2006, IBM                                               *
+ *                                                                         *
+ *   Maintained By:                                                        *
+ *   Eric Munson and Brad Peters                                           *
+ *   munsone@us.ibm.com, bpeters@us.ibm.com                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the Lesser GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of the  *
+ *   License, or at your option) any later version.                        *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Lesser General Public License for more details.                   *
+ *                                                                         *
+ *   You should have received a copy of the Lesser GNU General Public      *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+ * getComponentTree with a FieldFilter keeps the same Components as the
+ * whole tree filtered after loading, decodes the ones it drops with the
+ * filter's fields only, and prunes below a match on an ID or a parent.
+ */
+
+#include "testutil.hpp"
+
+#include <libvpd-2/vpdretriever.hpp>
+#include <libvpd-2/componentfilter.hpp>
+
+using namespace vpdtest;
+
+/*
+ * Counts the Components the loader visits and checks each was decoded
+ * with just the fields the filter asked for.
+ */
+class Probe : public FieldFilter
+{
+	public:
+		mutable int visited;
+
+		Probe( Component::Field f ) : FieldFilter( f ), visited( 0 ) { }
+		Probe( Component::Field f, const string& value ) :
+			FieldFilter( f, value ), visited( 0 ) { }
+
+		virtual bool mayContainMatch( const Component& c ) const
+		{
+			visited++;
+			CHECK( c.getLoadedFields( ) == ( getFields( ) |
+				Component::fieldMask( Component::FIELD_CHILDREN ) ) );
+			return FieldFilter::mayContainMatch( c );
+		}
+};
+
+static bool kept( const Component* c, const ComponentFilter& f )
+{
+	bool ret = f.matches( *c );
+	for( size_t i = 0; i < c->getLeaves( ).size( ); i++ )
+		ret = kept( c->getLeaves( )[ i ], f ) || ret;
+	return ret;
+}
+
+/*
+ * got must hold, in order, the leaves of full that f keeps, each decoded
+ * with mask.
+ */
+static void compare( const vector<Component*>& full,
+	const vector<Component*>& got, const ComponentFilter& f,
+	Component::FieldMask mask )
+{
+	size_t j = 0;
+
+	for( size_t i = 0; i < full.size( ); i++ )
+	{
+		Component* c = full[ i ];
+		if( !kept( c, f ) )
+			continue;
+		CHECK( j < got.size( ) && got[ j ]->getID( ) == c->getID( ) );
+		CHECK( got[ j ]->getLoadedFields( ) == mask );
+		CHECK( got[ j ]->getChildren( ) == c->getChildren( ) );
+		if( mask == Component::ALL_FIELDS )
+			CHECK( packed( *got[ j ] ) == packed( *c ) );
+		compare( c->getLeaves( ), got[ j ]->getLeaves( ), f, mask );
+		j++;
+	}
+	CHECK( j == got.size( ) );
+}
+
+static size_t count( const vector<Component*>& leaves )
+{
+	size_t ret = leaves.size( );
+	for( size_t i = 0; i < leaves.size( ); i++ )
+		ret += count( leaves[ i ]->getLeaves( ) );
+	return ret;
+}
+
+/*
+ * Loads the tree through f both ways and returns the number of
+ * Components kept, checking the loader visited visits of them.
+ */
+static size_t check( VpdRetriever& r, System* full, Probe& f, int visits )
+{
+	// Nothing but the filter's fields by default, so ask for the IDs.
+	const Component::FieldMask masks[ ] = {
+		Component::fieldMask( Component::FIELD_ID ), Component::ALL_FIELDS };
+	size_t ret = 0;
+
+	for( int m = 0; m < 2; m++ )
+	{
+		Component::FieldMask mask = masks[ m ] | f.getFields( ) |
+			Component::fieldMask( Component::FIELD_CHILDREN );
+
+		f.visited = 0;
+		System* s = r.getComponentTree( f, masks[ m ] );
+		CHECK( f.visited == visits );
+		compare( full->getLeaves( ), s->getLeaves( ), f, mask );
+		ret = count( s->getLeaves( ) );
+		delete s;
+	}
+	return ret;
+}
+
+int main( )
+{
+	TempDir dir;
+	vector<string> ids;
+
+	{
+		VpdDbEnv db( dir.path, "vpd.db", false );
+		ids = buildTree( db, 4, 3 );
+	}
+	const int all = ids.size( );
+
+	VpdRetriever r( dir.path, "vpd.db" );
+	System* full = r.getComponentTree( );
+	CHECK( count( full->getLeaves( ) ) == ids.size( ) );
+
+	// Matches spread over the tree, with their ancestors.
+	Probe part( Component::FIELD_PART_NUMBER, "PN7" );
+	CHECK( check( r, full, part, all ) > 2 );
+
+	Probe fru( Component::FIELD_FRU );
+	CHECK( check( r, full, fru, all ) == 0 );
+
+	Probe serial( Component::FIELD_SERIAL_NUMBER );
+	CHECK( check( r, full, serial, all ) == ids.size( ) );
+
+	// ids[ 0 ] has 4 children and 16 grandchildren, none of which can
+	// have its ID.
+	Probe id( Component::FIELD_ID, ids[ 0 ] );
+	CHECK( check( r, full, id, all - 20 ) == 1 );
+
+	Probe leaf( Component::FIELD_ID, ids.back( ) );
+	CHECK( check( r, full, leaf, all ) == 3 );
+
+	// The children of ids[ 1 ] match, theirs are not read.
+	Probe parent( Component::FIELD_PARENT, ids[ 1 ] );
+	CHECK( check( r, full, parent, all - 16 ) == 5 );
+
+	// Any ID matches everywhere, so it cannot prune.
+	Probe anyID( Component::FIELD_ID );
+	CHECK( check( r, full, anyID, all ) == ids.size( ) );
+
+	delete full;
+	return 0;
+}
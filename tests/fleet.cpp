@@ -0,0 +1,158 @@
+/***************************************************************************
+ *   Copyright (C) 2006, IBM                                               *
+ *                                                                         *
+ *   Maintained By:                                                        *
+ *   Eric Munson and Brad Peters                                           *
+ *   munsone@us.ibm.com, bpeters@us.ibm.com                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the Lesser GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of the  *
+ *   License, or at your option) any later version.                        *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Lesser General Public License for more details.                   *
+ *                                                                         *
+ *   You should have received a copy of the Lesser GNU General Public      *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+ * FleetAggregator over local files: whole databases of three hosts read
+ * by several threads, rows shared between hosts stored once, a corrupt
+ * host skipped, and a delta that removes rows.
+ */
+
+#include "testutil.hpp"
+
+#include <libvpd-2/fleetaggregator.hpp>
+
+using namespace vpdtest;
+
+typedef FleetAggregator::Source FleetSource;
+
+static FleetSource source( const string& host, const string& path )
+{
+	FleetSource s;
+	s.host = host;
+	s.path = path;
+	return s;
+}
+
+static long long hostRows( const string& fleet, const string& host )
+{
+	return queryInt( fleet, "SELECT count( * ) FROM inventory JOIN hosts "
+		"USING ( host_id ) WHERE name = '" + host + "';" );
+}
+
+static void setSerial( VpdDbEnv& db, const string& id, const string& value )
+{
+	Component* c = db.fetch( id );
+	CHECK( c != NULL );
+	Gatherer::setSerial( c, value );
+	CHECK( db.upsert( c ) );
+	delete c;
+}
+
+int main( )
+{
+	TempDir dir;
+	string fleet = dir.path + "/fleet.db";
+	vector<string> ids;
+	FleetAggregator::Stats stats;
+
+	{
+		VpdDbEnv db( dir.path, "h1.db", false );
+		ids = buildTree( db, 4, 3 );
+	}
+	// With the System, every host has this many rows.
+	const long long rows = ids.size( ) + 1;
+	copyFile( dir.path + "/h1.db", dir.path + "/h2.db" );
+	copyFile( dir.path + "/h1.db", dir.path + "/h3.db" );
+	copyFile( dir.path + "/h1.db", dir.path + "/bad.db" );
+
+	// h2 differs from h1 in five rows, h3 in one.
+	{
+		VpdDbEnv db( dir.path, "h2.db", false );
+		for( int i = 10; i < 15; i++ )
+			setSerial( db, ids[ i ], "F" + to_string( i ) );
+	}
+	{
+		VpdDbEnv db( dir.path, "h3.db", false );
+		setSerial( db, ids[ 20 ], "ONLY3" );
+	}
+	corrupt( dir.path + "/bad.db", ids[ 3 ] );
+
+	FleetAggregator agg( dir.path, "fleet.db" );
+	vector<FleetSource> sources;
+	sources.push_back( source( "h1", dir.path + "/h1.db" ) );
+	sources.push_back( source( "bad", dir.path + "/bad.db" ) );
+	sources.push_back( source( "h2", dir.path + "/h2.db" ) );
+	sources.push_back( source( "h3", dir.path + "/h3.db" ) );
+	// Small batches, so hosts land in more than one commit.
+	agg.setBatchRows( 50 );
+	CHECK( agg.ingest( sources, 3, &stats ) );
+
+	CHECK( stats.hosts == 3 && stats.failed == 1 );
+	CHECK( stats.rows == (u64)( 3 * rows ) );
+	CHECK( stats.newBlobs == (u64)( rows + 5 + 1 ) );
+	CHECK( stats.newBlobs < stats.rows );
+
+	vector<string> hosts = agg.getHosts( );
+	CHECK( hosts.size( ) == 3 );
+	CHECK( queryInt( fleet, "SELECT count( * ) FROM hosts;" ) == 3 );
+	CHECK( queryInt( fleet, "SELECT count( * ) FROM hosts WHERE "
+		"name = 'bad';" ) == 0 );
+	CHECK( query( fleet, "SELECT serial FROM hosts WHERE name = 'h2';" ) ==
+		"SYS123" );
+	CHECK( query( fleet, "SELECT machine_type FROM hosts WHERE "
+		"name = 'h1';" ) == "9009-42A" );
+	CHECK( hostRows( fleet, "h1" ) == rows && hostRows( fleet, "h2" ) == rows &&
+		hostRows( fleet, "h3" ) == rows );
+	CHECK( queryInt( fleet, "SELECT count( * ) FROM blobs;" ) ==
+		(long long)stats.newBlobs );
+
+	// The copied out columns and the blob behind them.
+	CHECK( query( fleet, "SELECT inventory.serial FROM inventory JOIN hosts USING "
+		"( host_id ) WHERE name = 'h2' AND comp_id = '" + ids[ 10 ] + "';" ) ==
+		"F10" );
+	CHECK( queryInt( fleet, "SELECT count( DISTINCT blob_id ) FROM inventory "
+		"WHERE comp_id = '" + ids[ 40 ] + "';" ) == 1 );
+	{
+		Component* c = agg.fetch( "h2", ids[ 11 ] );
+		CHECK( c != NULL && c->getSerialNumber( ) == "F11" );
+		delete c;
+		c = agg.fetch( "h1", ids[ 11 ] );
+		CHECK( c != NULL && c->getSerialNumber( ) == "SER100011" );
+		delete c;
+		CHECK( agg.fetch( "bad", ids[ 11 ] ) == NULL );
+	}
+
+	// A delta of h3 removing its one row of its own and one it shares.
+	{
+		VpdDbEnv db( dir.path, "h3.db", false );
+		u64 epoch, generation = db.getGeneration( &epoch );
+		CHECK( db.remove( ids[ 20 ] ) && db.remove( ids[ 21 ] ) );
+		CHECK( db.exportDelta( epoch, generation, dir.path + "/h3.delta" ) );
+	}
+	sources.clear( );
+	sources.push_back( source( "h3", dir.path + "/h3.delta" ) );
+	CHECK( agg.ingest( sources, 2, &stats ) );
+	CHECK( stats.hosts == 1 && stats.failed == 0 && stats.rows == 2 &&
+		stats.newBlobs == 0 );
+	CHECK( hostRows( fleet, "h3" ) == rows - 2 );
+	CHECK( hostRows( fleet, "h1" ) == rows );
+	CHECK( queryInt( fleet, "SELECT count( * ) FROM inventory JOIN hosts "
+		"USING ( host_id ) WHERE name = 'h3' AND comp_id IN ( '" +
+		ids[ 20 ] + "', '" + ids[ 21 ] + "' );" ) == 0 );
+	// Only the row no other host has is gone from blobs.
+	CHECK( queryInt( fleet, "SELECT count( * ) FROM blobs;" ) == rows + 5 );
+	CHECK( queryInt( fleet, "SELECT count( * ) FROM blobs WHERE blob_id NOT IN "
+		"( SELECT blob_id FROM inventory );" ) == 0 );
+	CHECK( agg.fetch( "h3", ids[ 20 ] ) == NULL );
+	return 0;
+}
@@ -0,0 +1,183 @@
+/***************************************************************************
+ *   Copyright (C) 2006, IBM                                               *
+ *                                                                         *
+ *   Maintained By:                                                        *
+ *   Eric Munson and Brad Peters                                           *
+ *   munsone@us.ibm.com, bpeters@us.ibm.com                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the Lesser GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of the  *
+ *   License, or at your option) any later version.                        *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Lesser General Public License for more details.                   *
+ *                                                                         *
+ *   You should have received a copy of the Lesser GNU General Public      *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+ * VpdHistory: captures of a changing database rebuilt as they were at
+ * each time, removed rows, the full comparison taken when the journal
+ * cannot be trusted, and history files from before the journal epoch.
+ */
+
+#include "testutil.hpp"
+
+#include <libvpd-2/vpdhistory.hpp>
+#include <libvpd-2/vpdretriever.hpp>
+
+#include <unistd.h>
+
+using namespace vpdtest;
+
+static void serialize( Component* c, string& out )
+{
+	out += packed( *c );
+	for( size_t i = 0; i < c->getLeaves( ).size( ); i++ )
+		serialize( c->getLeaves( )[ i ], out );
+}
+
+/*
+ * The packed rows of a whole tree, to compare two trees.
+ */
+static string serialize( System* s )
+{
+	void* buf = NULL;
+	unsigned int len = s->pack( &buf );
+	string out( (const char*)buf, len );
+	delete[] (char*)buf;
+
+	for( size_t i = 0; i < s->getLeaves( ).size( ); i++ )
+		serialize( s->getLeaves( )[ i ], out );
+	return out;
+}
+
+static void setSerial( VpdDbEnv& db, const string& id, const string& value )
+{
+	Component* c = db.fetch( id );
+	CHECK( c != NULL );
+	Gatherer::setSerial( c, value );
+	CHECK( db.upsert( c ) );
+	delete c;
+}
+
+int main( )
+{
+	TempDir dir;
+	vector<string> ids;
+	vector<string> states;
+	vector<time_t> times;
+	unsigned int changed = 0;
+	unsigned int seed = 7;
+
+	VpdHistory h( dir.path, "hist.db" );
+	VpdDbEnv db( dir.path, "vpd.db", false );
+	ids = buildTree( db, 4, 3 );
+
+	// More rounds than KEYFRAME_INTERVAL, so rows are rebuilt from full
+	// copies and from deltas.
+	for( int r = 0; r <= 20; r++ )
+	{
+		time_t when = 1000 + r * 100;
+		for( int k = 0; r > 0 && k < 10; k++ )
+		{
+			seed = seed * 1103515245 + 12345;
+			setSerial( db, ids[ ( seed >> 8 ) % ids.size( ) ],
+				"R" + to_string( r ) + "." + to_string( k ) );
+		}
+		CHECK( h.capture( db, when, &changed ) );
+		CHECK( r > 0 || changed == ids.size( ) + 1 );
+
+		VpdRetriever ret( dir.path, "vpd.db" );
+		System* s = ret.getComponentTree( );
+		states.push_back( serialize( s ) );
+		times.push_back( when );
+		delete s;
+	}
+
+	// Nothing changed, nothing recorded; time does not go backwards.
+	CHECK( h.capture( db, times.back( ) + 1, &changed ) && changed == 0 );
+	CHECK( !h.capture( db, 5 ) );
+
+	for( size_t i = 0; i < states.size( ); i++ )
+	{
+		System* s = h.asOf( times[ i ] + 50 );
+		CHECK( s != NULL && serialize( s ) == states[ i ] );
+		delete s;
+	}
+	CHECK( h.asOf( 999 ) == NULL );
+
+	// A row removed and stored again.
+	string victim = ids[ 5 ];
+	Component* saved = db.fetch( victim );
+	time_t removed = times.back( ) + 1000;
+	CHECK( db.remove( victim ) );
+	CHECK( h.capture( db, removed, &changed ) && changed == 1 );
+	CHECK( h.componentAsOf( victim, removed ) == NULL );
+	{
+		Component* old = h.componentAsOf( victim, removed - 1 );
+		CHECK( old != NULL && packed( *old ) == packed( *saved ) );
+		delete old;
+	}
+	CHECK( db.store( saved ) );
+	CHECK( h.capture( db, removed + 10, &changed ) && changed == 1 );
+	{
+		Component* back = h.componentAsOf( victim, removed + 10 );
+		CHECK( back != NULL && packed( *back ) == packed( *saved ) );
+		delete back;
+	}
+	delete saved;
+	vector<VpdHistory::Version> v = h.getVersions( victim );
+	CHECK( v.size( ) >= 3 && v[ v.size( ) - 2 ].removed &&
+		!v.back( ).removed );
+
+	// A journal compacted past the last capture, every row is compared.
+	// It is compacted every 256 generations.
+	db.setJournalRetention( 1 );
+	for( int pass = 0; pass < 4; pass++ )
+	{
+		for( size_t i = 0; i < ids.size( ); i++ )
+			setSerial( db, ids[ i ], "S" + to_string( pass ) );
+	}
+	CHECK( h.capture( db, removed + 20, &changed ) &&
+		changed == ids.size( ) );
+
+	{
+		// A database built anew has another epoch, so its journal says
+		// nothing about what changed since the last capture.
+		VpdHistory h2( dir.path, "hist2.db" );
+		{
+			VpdDbEnv a( dir.path, "anew.db", false );
+			buildTree( a, 4, 3 );
+			CHECK( h2.capture( a, 100, &changed ) );
+			for( int k = 0; k < 5; k++ )
+				setSerial( a, ids[ k ], "A" + to_string( k ) );
+			CHECK( h2.capture( a, 200, &changed ) && changed == 5 );
+		}
+		CHECK( unlink( ( dir.path + "/anew.db" ).c_str( ) ) == 0 );
+
+		VpdDbEnv b( dir.path, "anew.db", false );
+		buildTree( b, 4, 3 );
+		for( int k = 10; k < 16; k++ )
+			setSerial( b, ids[ k ], "B" + to_string( k ) );
+		// The five put back as they were and the six changed.
+		CHECK( h2.capture( b, 300, &changed ) && changed == 11 );
+	}
+
+	{
+		// A history file from before the epoch gets the column, then
+		// compares every row once.
+		execute( dir.path + "/hist3.db", "CREATE TABLE captures ( "
+			"time INTEGER NOT NULL, generation INTEGER NOT NULL );" );
+		VpdHistory h3( dir.path, "hist3.db" );
+		CHECK( h3.capture( db, removed + 30, &changed ) && changed > 0 );
+		CHECK( h3.capture( db, removed + 40, &changed ) && changed == 0 );
+	}
+	return 0;
+}
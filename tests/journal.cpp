@@ -0,0 +1,186 @@
+/***************************************************************************
+ *   Copyright (C) 2006, IBM                                               *
+ *                                                                         *
+ *   Maintained By:                                                        *
+ *   Eric Munson and Brad Peters                                           *
+ *   munsone@us.ibm.com, bpeters@us.ibm.com                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the Lesser GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of the  *
+ *   License, or at your option) any later version.                        *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Lesser General Public License for more details.                   *
+ *                                                                         *
+ *   You should have received a copy of the Lesser GNU General Public      *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+ * The change journal: generations and the epoch they belong to, the
+ * entries changesSince lists, and deltas written by exportDelta and
+ * applied to a copy of the database, whole or not at all.
+ */
+
+#include "testutil.hpp"
+
+#include <algorithm>
+#include <fstream>
+
+using namespace vpdtest;
+
+static string blob( VpdDbEnv& db, const string& id )
+{
+	Component* c = db.fetch( id );
+	CHECK( c != NULL );
+	string ret = packed( *c );
+	delete c;
+	return ret;
+}
+
+int main( )
+{
+	TempDir dir;
+	vector<string> ids;
+	vector<VpdDbEnv::JournalEntry> ch;
+	u64 epoch = 0, start;
+
+	{
+		VpdDbEnv a( dir.path, "a.db", false );
+		ids = buildTree( a, 4, 3 );
+		start = a.getGeneration( &epoch );
+		CHECK( start > 0 && epoch != 0 && epoch == a.getEpoch( ) );
+		CHECK( a.changesSince( epoch, start, ch ) && ch.empty( ) );
+	}
+	copyFile( dir.path + "/a.db", dir.path + "/b.db" );
+
+	{
+		VpdDbEnv a( dir.path, "a.db", false );
+
+		// Five changed, three removed, one removal of nothing, two new
+		// and the first changed again.
+		for( int i = 1; i <= 5; i++ )
+		{
+			Component* c = a.fetch( ids[ i * 10 ] );
+			Gatherer::setSerial( c, "J" + to_string( i ) );
+			CHECK( a.upsert( c ) );
+			delete c;
+		}
+		for( int i = 1; i <= 3; i++ )
+			CHECK( a.remove( ids[ i * 10 + 1 ] ) );
+		CHECK( a.remove( "/does/not/exist" ) );
+		for( int i = 0; i < 2; i++ )
+		{
+			Component* c = Gatherer::make( "/journal/new" + to_string( i ),
+				System::ID, i );
+			CHECK( a.store( c ) );
+			delete c;
+		}
+		{
+			Component* c = a.fetch( ids[ 10 ] );
+			Gatherer::setSerial( c, "JX" );
+			CHECK( a.upsert( c ) );
+			delete c;
+		}
+		// A failed store leaves no entry.
+		{
+			Component* c = Gatherer::make( "/journal/new0", System::ID, 0 );
+			CHECK( !a.store( c ) );
+			delete c;
+		}
+
+		CHECK( a.getGeneration( ) == start + 11 );
+		CHECK( a.changesSince( epoch, start, ch ) && ch.size( ) == 11 );
+		for( size_t i = 0; i < ch.size( ); i++ )
+			CHECK( ch[ i ].generation == start + i + 1 );
+		CHECK( ch[ 0 ].op == VpdDbEnv::JOURNAL_STORE && ch[ 0 ].hash != 0 &&
+			ch[ 0 ].id == ids[ 10 ] );
+		CHECK( ch[ 5 ].op == VpdDbEnv::JOURNAL_REMOVE && ch[ 5 ].hash == 0 &&
+			ch[ 5 ].id == ids[ 11 ] );
+		CHECK( a.changesSince( epoch, start + 8, ch ) && ch.size( ) == 3 &&
+			ch[ 0 ].generation == start + 9 );
+		CHECK( a.changesSince( epoch, start + 11, ch ) && ch.empty( ) );
+
+		// Generations from the future or from another epoch.
+		CHECK( !a.changesSince( epoch, start + 12, ch ) );
+		CHECK( !a.changesSince( epoch + 1, start, ch ) );
+		CHECK( !a.exportDelta( epoch ^ 2, start, dir.path + "/x.delta" ) );
+
+		u64 upTo = 0;
+		CHECK( a.exportDelta( epoch, start, dir.path + "/a.delta", &upTo ) &&
+			upTo == start + 11 );
+	}
+
+	{
+		VpdDbEnv b( dir.path, "b.db", false );
+		VpdDbEnv a( dir.path, "a.db", true );
+		u64 upTo = 0, from = 0;
+
+		CHECK( b.applyDelta( dir.path + "/a.delta", &upTo, &from ) &&
+			upTo == start + 11 && from == epoch );
+
+		vector<string> ka = a.getKeys( ), kb = b.getKeys( );
+		sort( ka.begin( ), ka.end( ) );
+		sort( kb.begin( ), kb.end( ) );
+		CHECK( ka == kb );
+		CHECK( ka.size( ) == ids.size( ) + 1 - 3 + 2 );
+		for( size_t i = 0; i < ka.size( ); i++ )
+		{
+			if( ka[ i ] != System::ID )
+				CHECK( blob( a, ka[ i ] ) == blob( b, ka[ i ] ) );
+		}
+
+		// A cut short, a foreign or a missing file changes nothing.
+		{
+			ifstream in( ( dir.path + "/a.delta" ).c_str( ), ios::binary );
+			string all( ( istreambuf_iterator<char>( in ) ),
+				istreambuf_iterator<char>( ) );
+			ofstream( ( dir.path + "/short.delta" ).c_str( ), ios::binary ) <<
+				all.substr( 0, all.size( ) / 2 );
+			ofstream( ( dir.path + "/garbage.delta" ).c_str( ) ) << "garbage\n";
+		}
+		u64 g = b.getGeneration( );
+		CHECK( !b.applyDelta( dir.path + "/short.delta" ) );
+		CHECK( !b.applyDelta( dir.path + "/garbage.delta" ) );
+		CHECK( !b.applyDelta( dir.path + "/missing.delta" ) );
+		CHECK( b.getGeneration( ) == g );
+	}
+
+	{
+		// Only the newest entries are kept, older generations are refused.
+		// The journal is compacted every 256 generations, the upserts
+		// below go past that.
+		VpdDbEnv a( dir.path, "a.db", false );
+		Component* c = a.fetch( ids[ 50 ] );
+
+		a.setJournalRetention( 20 );
+		for( int i = 0; i < 300; i++ )
+		{
+			Gatherer::setSerial( c, "R" + to_string( i ) );
+			CHECK( a.upsert( c ) );
+		}
+		delete c;
+
+		u64 g = a.getGeneration( );
+		CHECK( g == start + 311 );
+		CHECK( !a.changesSince( epoch, start + 11, ch ) );
+		CHECK( a.changesSince( epoch, g - 20, ch ) && ch.size( ) == 20 );
+		CHECK( !a.exportDelta( epoch, start + 11, dir.path + "/old.delta" ) );
+	}
+
+	{
+		// A database built anew has an epoch of its own.
+		VpdDbEnv c( dir.path, "c.db", false );
+		buildTree( c, 2, 2 );
+		u64 other = c.getEpoch( );
+		CHECK( other != 0 && other != epoch );
+		CHECK( !c.changesSince( epoch, 0, ch ) );
+		CHECK( c.changesSince( other, 0, ch ) && !ch.empty( ) );
+	}
+	return 0;
+}
@@ -0,0 +1,247 @@
+/***************************************************************************
+ *   Copyright (C) 2006, IBM                                               *
+ *                                                                         *
+ *   Maintained By:                                                        *
+ *   Eric Munson and Brad Peters                                           *
+ *   munsone@us.ibm.com, bpeters@us.ibm.com                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the Lesser GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of the  *
+ *   License, or at your option) any later version.                        *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Lesser General Public License for more details.                   *
+ *                                                                         *
+ *   You should have received a copy of the Lesser GNU General Public      *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+ * findByKeyword, findWithKeyword and the C find_by_keyword find the same
+ * Components as reading every row and looking through its lists, for
+ * each list on its own and all of them, after upserts and removals, and
+ * after a database written without the keyword table is opened.
+ */
+
+#include "testutil.hpp"
+
+extern "C" {
+#include <libvpd-2/vpddbenv.h>
+}
+
+#include <map>
+#include <set>
+
+using namespace vpdtest;
+
+static const int LISTS[ ] = { VpdDbEnv::KEYWORD_DEVICE_SPECIFIC,
+	VpdDbEnv::KEYWORD_USER_DATA, VpdDbEnv::KEYWORD_AIX_NAME,
+	VpdDbEnv::KEYWORD_DEVICE_SPECIFIC | VpdDbEnv::KEYWORD_AIX_NAME,
+	VpdDbEnv::ALL_KEYWORD_LISTS };
+static const size_t LIST_COUNT = sizeof( LISTS ) / sizeof( LISTS[ 0 ] );
+
+/*
+ * A Component whose lists share AC's and values with each other and with
+ * the other Components, so that the list bits are what tell them apart.
+ */
+static Component* device( const string& id, int n, int shift )
+{
+	Component* c = Gatherer::make( id, SYS_ID, n + shift );
+	if( n % 3 == 0 )
+		Gatherer::addUserData( c, "Z0", "zval" + to_string( n % 4 ), false );
+	if( n % 4 == 1 )
+		Gatherer::addDeviceSpecific( c, "AX", "hdisk" + to_string( n % 6 ) );
+	if( n % 5 == 2 )
+		Gatherer::addAIXName( c, "zval" + to_string( n % 10 ) );
+	return c;
+}
+
+typedef map<pair<string, string>, vector<string> > Expected;
+
+static void add( Expected& want, int list, const vector<DataItem*>& items,
+	const string& id )
+{
+	for( size_t i = 0; i < items.size( ); i++ )
+	{
+		const string& ac = items[ i ]->getAC( );
+		const string& value = items[ i ]->getValue( );
+		for( size_t l = 0; l < LIST_COUNT; l++ )
+		{
+			if( !( LISTS[ l ] & list ) )
+				continue;
+			vector<string>& any = want[ make_pair( ac, to_string( l ) ) ];
+			if( any.empty( ) || any.back( ) != id )
+				any.push_back( id );
+			vector<string>& exact = want[ make_pair( ac + "=" + value,
+				to_string( l ) ) ];
+			if( exact.empty( ) || exact.back( ) != id )
+				exact.push_back( id );
+		}
+	}
+}
+
+/*
+ * The C library's answer, as a vector.
+ */
+static vector<string> findC( struct vpddbenv* cdb, const string& ac,
+	const string* value )
+{
+	struct list* out = NULL;
+	vector<string> ret;
+	int count = find_by_keyword( cdb, ac.c_str( ),
+		value ? value->c_str( ) : NULL, &out );
+
+	CHECK( count >= 0 );
+	for( struct list* i = out; i != NULL; i = i->next )
+		ret.push_back( (const char*)i->data );
+	CHECK( (int)ret.size( ) == count );
+	free_list( out );
+	return ret;
+}
+
+/*
+ * Every (AC, list) and (AC, value, list) that a scan of every row finds
+ * against the keyword index, and a few that are in no row.
+ */
+static void crossCheck( VpdDbEnv& db, const string& dir )
+{
+	Expected want;
+	set<string> acs;
+	set<pair<string, string> > pairs;
+	VpdDbEnv::Cursor* cur = db.scanPrefix( "" );
+
+	// Cursors come back in ID order, so each ID list is sorted.
+	CHECK( cur != NULL );
+	while( cur->next( ) )
+	{
+		Component* c = cur->getComponent( );
+		add( want, VpdDbEnv::KEYWORD_DEVICE_SPECIFIC,
+			c->getDeviceSpecific( ), c->getID( ) );
+		add( want, VpdDbEnv::KEYWORD_USER_DATA, c->getUserData( ),
+			c->getID( ) );
+		add( want, VpdDbEnv::KEYWORD_AIX_NAME, c->getAIXNames( ),
+			c->getID( ) );
+		const vector<DataItem*>* lists[ ] = { &c->getDeviceSpecific( ),
+			&c->getUserData( ), &c->getAIXNames( ) };
+		for( size_t l = 0; l < 3; l++ )
+		{
+			for( size_t i = 0; i < lists[ l ]->size( ); i++ )
+			{
+				acs.insert( ( *lists[ l ] )[ i ]->getAC( ) );
+				pairs.insert( make_pair( ( *lists[ l ] )[ i ]->getAC( ),
+					( *lists[ l ] )[ i ]->getValue( ) ) );
+			}
+		}
+		delete c;
+	}
+	CHECK( !cur->failed( ) );
+	delete cur;
+	acs.insert( "QQ" );
+	pairs.insert( make_pair( "Z0", "no such value" ) );
+	pairs.insert( make_pair( "QQ", "zval1" ) );
+
+	struct vpddbenv* cdb = new_vpddbenv( dir.c_str( ), "vpd.db" );
+	CHECK( cdb != NULL );
+	size_t found = 0;
+
+	for( set<string>::const_iterator a = acs.begin( ); a != acs.end( ); ++a )
+	{
+		for( size_t l = 0; l < LIST_COUNT; l++ )
+		{
+			const vector<string>& ids = want[ make_pair( *a,
+				to_string( l ) ) ];
+			CHECK( db.findWithKeyword( *a, LISTS[ l ] ) == ids );
+			found += ids.size( );
+		}
+		CHECK( db.findWithKeyword( *a ) ==
+			want[ make_pair( *a, to_string( LIST_COUNT - 1 ) ) ] );
+		CHECK( findC( cdb, *a, NULL ) ==
+			want[ make_pair( *a, to_string( LIST_COUNT - 1 ) ) ] );
+	}
+	for( set<pair<string, string> >::const_iterator p = pairs.begin( );
+		p != pairs.end( ); ++p )
+	{
+		string key = p->first + "=" + p->second;
+		for( size_t l = 0; l < LIST_COUNT; l++ )
+		{
+			const vector<string>& ids = want[ make_pair( key,
+				to_string( l ) ) ];
+			CHECK( db.findByKeyword( p->first, p->second, LISTS[ l ] ) ==
+				ids );
+			found += ids.size( );
+		}
+		CHECK( findC( cdb, p->first, &p->second ) ==
+			want[ make_pair( key, to_string( LIST_COUNT - 1 ) ) ] );
+	}
+	free_vpddbenv( cdb );
+
+	// The shared AC's are found in one list and not another.
+	CHECK( found > 0 );
+	CHECK( db.findByKeyword( "Z0", "zval0",
+		VpdDbEnv::KEYWORD_USER_DATA ) !=
+		db.findByKeyword( "Z0", "zval0",
+		VpdDbEnv::KEYWORD_DEVICE_SPECIFIC ) );
+	CHECK( !db.findWithKeyword( "AX", VpdDbEnv::KEYWORD_AIX_NAME ).empty( ) );
+	CHECK( db.findWithKeyword( "UD", VpdDbEnv::KEYWORD_AIX_NAME ).empty( ) );
+}
+
+int main( )
+{
+	TempDir dir;
+	string path = dir.path + "/vpd.db";
+	vector<string> ids;
+
+	{
+		VpdDbEnv db( dir.path, "vpd.db", false );
+		System* sys = Gatherer::makeSystem( );
+
+		for( int n = 0; n < 60; n++ )
+		{
+			Component* c = device( "/sys/devices/d" + to_string( n ), n, 0 );
+			Gatherer::addChild( sys, c->getID( ) );
+			CHECK( db.store( c ) );
+			ids.push_back( c->getID( ) );
+			delete c;
+		}
+		CHECK( db.store( sys ) );
+		delete sys;
+		crossCheck( db, dir.path );
+
+		// Other values for some, the rows of others gone.
+		for( int n = 0; n < 60; n += 4 )
+		{
+			Component* c = device( ids[ n ], n, 7 );
+			if( n % 8 == 0 )
+				CHECK( db.upsert( c ) );
+			else
+				CHECK( db.remove( ids[ n ] ) && db.store( c ) );
+			delete c;
+		}
+		for( int n = 1; n < 60; n += 6 )
+			CHECK( db.remove( ids[ n ] ) );
+		crossCheck( db, dir.path );
+	}
+
+	// A database from before the keyword table: a read only open finds
+	// nothing, the first open for writing indexes every row.
+	long long rows = queryInt( path,
+		"SELECT COUNT(*) FROM " KEYWORD_TABLE ";" );
+	CHECK( rows > 0 );
+	execute( path, "DROP TABLE " KEYWORD_TABLE ";" );
+	{
+		VpdDbEnv db( dir.path, "vpd.db", true );
+		CHECK( db.findWithKeyword( "Z0" ).empty( ) );
+	}
+	{
+		VpdDbEnv db( dir.path, "vpd.db", false );
+		CHECK( queryInt( path, "SELECT COUNT(*) FROM " KEYWORD_TABLE ";" ) ==
+			rows );
+		crossCheck( db, dir.path );
+	}
+	return 0;
+}
@@ -0,0 +1,241 @@
+/***************************************************************************
+ *   Copyright (C) 2006, IBM                                               *
+ *                                                                         *
+ *   Maintained By:                                                        *
+ *   Eric Munson and Brad Peters                                           *
+ *   munsone@us.ibm.com, bpeters@us.ibm.com                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the Lesser GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of the  *
+ *   License, or at your option) any later version.                        *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Lesser General Public License for more details.                   *
+ *                                                                         *
+ *   You should have received a copy of the Lesser GNU General Public      *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+ * The indexed list lookups of Component, and the KeyIndex behind them,
+ * against plain scans of the same lists.  The lists are taken through
+ * random adds, updates and removals, short and long enough to be indexed.
+ */
+
+#include "testutil.hpp"
+
+#include "listindex.hpp"
+
+#include <cstdlib>
+
+using namespace vpdtest;
+
+static unsigned int seed = 1;
+
+static size_t pick( size_t n )
+{
+	seed = seed * 1103515245 + 12345;
+	return ( seed >> 8 ) % n;
+}
+
+static string key( size_t n )
+{
+	return "K" + to_string( pick( n ) );
+}
+
+/*
+ * A KeyIndex over a bare list, through appends, reported erases,
+ * unreported shrinking and clears.
+ */
+static void checkKeyIndex( size_t pool, size_t ops )
+{
+	vector<string> list;
+	KeyIndex index;
+	auto keyOf = [ &list ]( size_t i ) -> const string& { return list[ i ]; };
+
+	for( size_t op = 0; op < ops; op++ )
+	{
+		size_t what = pick( 10 );
+		if( what < 4 || list.empty( ) )
+			list.push_back( key( pool ) );
+		else if( what < 6 )
+		{
+			size_t pos = pick( list.size( ) );
+			index.erase( pos, list[ pos ] );
+			list.erase( list.begin( ) + pos );
+		}
+		else if( what == 6 )
+			list.pop_back( );
+		else if( what == 7 && pick( 20 ) == 0 )
+		{
+			list[ pick( list.size( ) ) ] = key( pool );
+			index.clear( );
+		}
+
+		string k = key( pool + 2 );
+		CHECK( index.find( k, list.size( ), keyOf ) ==
+			KeyIndex::scan( k, list.size( ), keyOf ) );
+	}
+}
+
+/*
+ * What the Component lists should hold, kept by plain scans.
+ */
+struct Model
+{
+	vector<pair<string, string> > device, user;
+	vector<string> aix, children;
+
+	static int find( const vector<pair<string, string> >& list,
+		const string& ac )
+	{
+		for( size_t i = 0; i < list.size( ); i++ )
+		{
+			if( list[ i ].first == ac )
+				return i;
+		}
+		return -1;
+	}
+
+	static int find( const vector<string>& list, const string& value )
+	{
+		for( size_t i = 0; i < list.size( ); i++ )
+		{
+			if( list[ i ] == value )
+				return i;
+		}
+		return -1;
+	}
+};
+
+static void checkLists( const vector<DataItem*>& items,
+	const vector<pair<string, string> >& model )
+{
+	CHECK( items.size( ) == model.size( ) );
+	for( size_t i = 0; i < items.size( ); i++ )
+	{
+		CHECK( items[ i ]->getAC( ) == model[ i ].first );
+		CHECK( items[ i ]->getValue( ) == model[ i ].second );
+	}
+}
+
+static void checkComponent( Component* c, const Model& m, size_t pool )
+{
+	checkLists( c->getDeviceSpecific( ), m.device );
+	checkLists( c->getUserData( ), m.user );
+	CHECK( c->getAIXNames( ).size( ) == m.aix.size( ) );
+	for( size_t i = 0; i < m.aix.size( ); i++ )
+		CHECK( c->getAIXNames( )[ i ]->getValue( ) == m.aix[ i ] );
+	CHECK( c->getChildren( ) == m.children );
+
+	for( size_t i = 0; i < pool + 2; i++ )
+	{
+		string k = "K" + to_string( i );
+		int d = Model::find( m.device, k );
+		const DataItem* got = c->getDeviceSpecific( k );
+		CHECK( ( got == NULL ) == ( d < 0 ) );
+		CHECK( got == NULL || got == c->getDeviceSpecific( )[ d ] );
+		CHECK( Gatherer::isChild( c, k ) ==
+			( Model::find( m.children, k ) >= 0 ) );
+	}
+}
+
+/*
+ * A Component through random list mutations, then copied and unpacked
+ * again over itself.
+ */
+static void checkComponentLists( size_t pool, size_t ops )
+{
+	Component* c = new Component( );
+	Model m;
+	int lvl = 100;
+
+	for( size_t op = 0; op < ops; op++ )
+	{
+		string k = key( pool ), v = "v" + to_string( op );
+		int i;
+
+		switch( pick( 7 ) )
+		{
+			case 0:
+				Gatherer::addDeviceSpecific( c, k, v );
+				m.device.push_back( make_pair( k, v ) );
+				break;
+			case 1:
+				Gatherer::updateDeviceSpecific( c, k, v, ++lvl );
+				if( ( i = Model::find( m.device, k ) ) >= 0 )
+					m.device[ i ].second = v;
+				else
+					m.device.push_back( make_pair( k, v ) );
+				break;
+			case 2:
+			{
+				bool clobber = pick( 2 ) == 0;
+				Gatherer::addUserData( c, k, v, clobber );
+				if( ( i = Model::find( m.user, k ) ) < 0 )
+					m.user.push_back( make_pair( k, v ) );
+				else if( clobber )
+					m.user[ i ].second = v;
+				break;
+			}
+			case 3:
+				Gatherer::addAIXName( c, k );
+				if( Model::find( m.aix, k ) < 0 )
+					m.aix.push_back( k );
+				break;
+			case 4:
+			case 5:
+				Gatherer::addChild( c, k );
+				m.children.push_back( k );
+				break;
+			case 6:
+				c->removeChild( k );
+				if( ( i = Model::find( m.children, k ) ) >= 0 )
+					m.children.erase( m.children.begin( ) + i );
+				break;
+		}
+		if( pick( 8 ) == 0 )
+			checkComponent( c, m, pool );
+	}
+	checkComponent( c, m, pool );
+
+	Component copy( *c );
+	checkComponent( &copy, m, pool );
+
+	string buf = packed( *c );
+	c->unpack( buf.data( ) );
+	checkComponent( c, m, pool );
+
+	// Cut the lists short, back under the size that is indexed.
+	Component small;
+	small.unpack( buf.data( ) );
+	while( !m.children.empty( ) )
+	{
+		// The first child with the ID goes, as with any removal.
+		string id = m.children.back( );
+		small.removeChild( id );
+		m.children.erase( m.children.begin( ) +
+			Model::find( m.children, id ) );
+		CHECK( small.getChildren( ) == m.children );
+		CHECK( m.children.empty( ) ||
+			Gatherer::isChild( &small, m.children[ 0 ] ) );
+	}
+	delete c;
+}
+
+int main( )
+{
+	const size_t pools[ ] = { 4, 15, 16, 17, 40, 300 };
+
+	for( size_t p = 0; p < sizeof( pools ) / sizeof( pools[ 0 ] ); p++ )
+	{
+		checkKeyIndex( pools[ p ], 5000 );
+		checkComponentLists( pools[ p ], 3000 );
+	}
+	return 0;
+}
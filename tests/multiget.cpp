@@ -0,0 +1,140 @@
+/***************************************************************************
+ *   Copyright (C) 2006, IBM                                               *
+ *                                                                         *
+ *   Maintained By:                                                        *
+ *   Eric Munson and Brad Peters                                           *
+ *   munsone@us.ibm.com, bpeters@us.ibm.com                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the Lesser GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of the  *
+ *   License, or at your option) any later version.                        *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Lesser General Public License for more details.                   *
+ *                                                                         *
+ *   You should have received a copy of the Lesser GNU General Public      *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+ * The multi-get of both libraries: one pointer per ID in order, NULL and
+ * missing for the ones not stored, and all or nothing when a row cannot
+ * be read.
+ */
+
+#include "testutil.hpp"
+
+#include <libvpd-2/vpdretriever.hpp>
+
+extern "C" {
+#include <libvpd-2/component.h>
+#include <libvpd-2/vpddbenv.h>
+}
+
+#include <algorithm>
+
+using namespace vpdtest;
+
+static void checkFound( const vector<string>& ids, vector<Component*>& got )
+{
+	CHECK( got.size( ) == ids.size( ) );
+	for( size_t i = 0; i < ids.size( ); i++ )
+	{
+		if( ids[ i ].compare( 0, 8, "/missing" ) == 0 )
+			CHECK( got[ i ] == NULL );
+		else
+			CHECK( got[ i ] != NULL && got[ i ]->getID( ) == ids[ i ] );
+		delete got[ i ];
+	}
+}
+
+int main( )
+{
+	TempDir dir;
+	vector<string> stored, ids;
+
+	{
+		VpdDbEnv db( dir.path, "vpd.db", false );
+		// Two levels of 30 are more than one BATCH_SIZE of ID's.
+		stored = buildTree( db, 30, 2 );
+	}
+	CHECK( stored.size( ) > VpdDbEnv::BATCH_SIZE );
+
+	// Out of order, repeated and missing ID's.
+	ids = stored;
+	reverse( ids.begin( ), ids.end( ) );
+	ids.insert( ids.begin( ) + 3, "/missing/a" );
+	ids.push_back( stored[ 0 ] );
+	ids.push_back( "/missing/b" );
+
+	{
+		VpdRetriever ret( dir.path, "vpd.db" );
+		vector<string> missing;
+		vector<Component*> got = ret.getComponents( ids, &missing );
+		checkFound( ids, got );
+		CHECK( missing.size( ) == 2 );
+	}
+
+	{
+		struct vpddbenv* db = new_vpddbenv( dir.path.c_str( ), "vpd.db" );
+		vector<const char*> cids;
+		vector<struct component*> out( ids.size( ) );
+		CHECK( db != NULL );
+		for( size_t i = 0; i < ids.size( ); i++ )
+			cids.push_back( ids[ i ].c_str( ) );
+		CHECK( fetch_components( db, &cids[ 0 ], cids.size( ),
+			&out[ 0 ] ) == (int)ids.size( ) - 2 );
+		for( size_t i = 0; i < ids.size( ); i++ )
+		{
+			CHECK( ( out[ i ] == NULL ) ==
+				( ids[ i ].compare( 0, 8, "/missing" ) == 0 ) );
+			if( out[ i ] )
+				free_component( out[ i ] );
+		}
+		free_vpddbenv( db );
+	}
+
+	// One unreadable row, in the last batch, fails the whole call.
+	corrupt( dir.path + "/vpd.db", stored[ 0 ] );
+
+	{
+		VpdRetriever ret( dir.path, "vpd.db" );
+		vector<string> missing;
+		bool threw = false;
+		try {
+			vector<Component*> got = ret.getComponents( ids, &missing );
+			for( size_t i = 0; i < got.size( ); i++ )
+				delete got[ i ];
+		}
+		catch( VpdException& ) {
+			threw = true;
+		}
+		CHECK( threw );
+		CHECK( missing.empty( ) );
+
+		ids.pop_back( );
+		ids.pop_back( );
+		ids.erase( find( ids.begin( ), ids.end( ), stored[ 0 ] ) );
+		vector<Component*> got = ret.getComponents( ids, &missing );
+		checkFound( ids, got );
+	}
+
+	{
+		struct vpddbenv* db = new_vpddbenv( dir.path.c_str( ), "vpd.db" );
+		vector<const char*> cids;
+		vector<struct component*> out( stored.size( ) );
+		for( size_t i = 0; i < stored.size( ); i++ )
+			cids.push_back( stored[ i ].c_str( ) );
+		CHECK( fetch_components( db, &cids[ 0 ], cids.size( ),
+			&out[ 0 ] ) == -1 );
+		for( size_t i = 0; i < out.size( ); i++ )
+			CHECK( out[ i ] == NULL );
+		free_vpddbenv( db );
+	}
+	return 0;
+}
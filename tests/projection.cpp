@@ -0,0 +1,232 @@
+/***************************************************************************
+ *   Copyright (C) 2006, IBM                                               *
+ *                                                                         *
+ *   Maintained By:                                                        *
+ *   Eric Munson and Brad Peters                                           *
+ *   munsone@us.ibm.com, bpeters@us.ibm.com                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the Lesser GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of the  *
+ *   License, or at your option) any later version.                        *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Lesser General Public License for more details.                   *
+ *                                                                         *
+ *   You should have received a copy of the Lesser GNU General Public      *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+ * A fetch or unpack of some of the fields, with the C++ library and the C
+ * library, decodes what a full fetch does for the fields asked for and
+ * leaves the others empty and marked as not loaded, and both libraries
+ * agree on what a mask decodes.
+ */
+
+#include "testutil.hpp"
+
+extern "C" {
+#include <libvpd-2/component.h>
+#include <libvpd-2/vpddbenv.h>
+}
+
+#include <cstddef>
+
+using namespace vpdtest;
+
+// Where each single field is in struct component, -1 for those it lacks.
+#define CSLOT( member ) (long)offsetof( struct component, member )
+#define CNONE -1L
+#define SLOT_OF( name, member, slot, ac, humanName ) slot,
+static const long SLOTS[ ] = { VPD_COMPONENT_FIELDS( SLOT_OF ) };
+#undef SLOT_OF
+#undef CNONE
+#undef CSLOT
+
+static Component::FieldMask bit( Component::Field f )
+{
+	return Component::fieldMask( f );
+}
+
+static string value( const struct dataitem* d )
+{
+	return d && d->dataValue ? d->dataValue : "";
+}
+
+/*
+ * A C list holds the same AC's and values as a C++ one.
+ */
+static void checkList( const struct dataitem* head,
+	const vector<DataItem*>& items )
+{
+	size_t i = 0;
+	for( ; head != NULL; head = head->next, i++ )
+	{
+		CHECK( i < items.size( ) );
+		CHECK( string( head->ac ? head->ac : "" ) == items[ i ]->getAC( ) );
+		CHECK( value( head ) == items[ i ]->getValue( ) );
+	}
+	CHECK( i == items.size( ) );
+}
+
+static void checkChildren( const struct list* head,
+	const vector<string>& children )
+{
+	size_t i = 0;
+	for( ; head != NULL; head = head->next, i++ )
+	{
+		CHECK( i < children.size( ) );
+		CHECK( (const char*)head->data == children[ i ] );
+	}
+	CHECK( i == children.size( ) );
+}
+
+static void checkSame( const vector<DataItem*>& a, const vector<DataItem*>& b )
+{
+	CHECK( a.size( ) == b.size( ) );
+	for( size_t i = 0; i < a.size( ); i++ )
+		CHECK( a[ i ]->getAC( ) == b[ i ]->getAC( ) &&
+			a[ i ]->getValue( ) == b[ i ]->getValue( ) );
+}
+
+/*
+ * part holds what full does for the fields in mask and nothing else.
+ */
+static void checkCxx( Component& part, Component& full,
+	Component::FieldMask mask )
+{
+	static const vector<DataItem*> none;
+
+	CHECK( part.getLoadedFields( ) == mask );
+	for( int f = 0; f < Component::FIELD_COUNT; f++ )
+	{
+		Component::Field field = (Component::Field)f;
+		bool loaded = ( mask & bit( field ) ) != 0;
+		CHECK( part.isLoaded( field ) == loaded );
+		if( f < Component::FIELD_CHILDREN )
+			CHECK( part.getField( field )->getValue( ) ==
+				( loaded ? full.getField( field )->getValue( ) : "" ) );
+	}
+	CHECK( part.getChildren( ) == ( part.isLoaded( Component::FIELD_CHILDREN ) ?
+		full.getChildren( ) : vector<string>( ) ) );
+	checkSame( part.getDeviceSpecific( ),
+		part.isLoaded( Component::FIELD_DEVICE_SPECIFIC ) ?
+		full.getDeviceSpecific( ) : none );
+	checkSame( part.getUserData( ),
+		part.isLoaded( Component::FIELD_USER_DATA ) ?
+		full.getUserData( ) : none );
+	checkSame( part.getAIXNames( ),
+		part.isLoaded( Component::FIELD_AIX_NAMES ) ?
+		full.getAIXNames( ) : none );
+}
+
+/*
+ * c holds what the C++ decoder does for mask, the fields left out are
+ * NULL.
+ */
+static void checkC( const struct component* c, Component& part, u64 mask )
+{
+	CHECK( c != NULL );
+	CHECK( c->loaded == mask );
+	for( int f = 0; f < COMP_FIELD_CHILDREN; f++ )
+	{
+		CHECK( part.isLoaded( (Component::Field)f ) ==
+			( ( c->loaded & COMP_FIELD_BIT( f ) ) != 0 ) );
+		if( SLOTS[ f ] < 0 )
+			continue;
+		const struct dataitem* d =
+			*(struct dataitem* const*)( (const char*)c + SLOTS[ f ] );
+		if( !( mask & COMP_FIELD_BIT( f ) ) )
+			CHECK( d == NULL );
+		else
+			CHECK( d != NULL && value( d ) ==
+				part.getField( (Component::Field)f )->getValue( ) );
+	}
+	checkChildren( c->childrenIDs, part.getChildren( ) );
+	checkList( c->deviceSpecific, part.getDeviceSpecific( ) );
+	checkList( c->userData, part.getUserData( ) );
+	checkList( c->aixNames, part.getAIXNames( ) );
+}
+
+int main( )
+{
+	TempDir dir;
+	vector<string> ids;
+
+	{
+		VpdDbEnv db( dir.path, "vpd.db", false );
+		ids = buildTree( db, 4, 3 );
+	}
+
+	// Each with one list field, or none, or all of them.
+	const Component::FieldMask masks[ ] = {
+		bit( Component::FIELD_SERIAL_NUMBER ) |
+			bit( Component::FIELD_DEVICE_SPECIFIC ),
+		bit( Component::FIELD_ID ) | bit( Component::FIELD_PART_NUMBER ) |
+			bit( Component::FIELD_USER_DATA ),
+		bit( Component::FIELD_PHYSICAL_LOCATION ) |
+			bit( Component::FIELD_AIX_NAMES ),
+		bit( Component::FIELD_PARENT ) | bit( Component::FIELD_CHILDREN ),
+		// N5 is packed but has no member in struct component.
+		bit( Component::FIELD_N5 ) | bit( Component::FIELD_DEVICE_SPECIFIC ) |
+			bit( Component::FIELD_FIRMWARE_LEVEL ),
+		0,
+		Component::ALL_FIELDS
+	};
+
+	VpdDbEnv db( dir.path, "vpd.db", true );
+	struct vpddbenv* cdb = new_vpddbenv( dir.path.c_str( ), "vpd.db" );
+	CHECK( cdb != NULL );
+
+	for( size_t i = 0; i < ids.size( ); i++ )
+	{
+		Component* full = db.fetch( ids[ i ] );
+		string data;
+		CHECK( db.fetchPacked( ids[ i ], data ) );
+
+		for( size_t m = 0; m < sizeof( masks ) / sizeof( masks[ 0 ] ); m++ )
+		{
+			Component::FieldMask mask = masks[ m ];
+			Component* fetched = db.fetch( ids[ i ], mask );
+			Component unpacked( data.data( ), mask );
+			checkCxx( *fetched, *full, mask );
+			checkCxx( unpacked, *full, mask );
+
+			struct component* c = unpack_component_fields( &data[ 0 ], mask );
+			checkC( c, unpacked, mask );
+			free_component( c );
+
+			c = fetch_component_fields( cdb, ids[ i ].c_str( ), mask );
+			checkC( c, *fetched, mask );
+			free_component( c );
+
+			struct vpdarena* arena = new_arena( );
+			CHECK( arena != NULL );
+			c = fetch_component_arena( cdb, ids[ i ].c_str( ), mask, arena );
+			checkC( c, *fetched, mask );
+			free_arena( arena );
+			delete fetched;
+		}
+		delete full;
+	}
+	free_vpddbenv( cdb );
+
+	// Only a fully loaded Component may be packed.
+	Component* part = db.fetch( ids[ 0 ], masks[ 0 ] );
+	void* buf = NULL;
+	bool threw = false;
+	try {
+		part->pack( &buf );
+	}
+	catch( VpdException& ) {
+		threw = true;
+	}
+	CHECK( threw );
+	delete part;
+	return 0;
+}
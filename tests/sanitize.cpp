@@ -0,0 +1,108 @@
+/***************************************************************************
+ *   Copyright (C) 2006, IBM                                               *
+ *                                                                         *
+ *   Maintained By:                                                        *
+ *   Eric Munson and Brad Peters                                           *
+ *   munsone@us.ibm.com, bpeters@us.ibm.com                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the Lesser GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of the  *
+ *   License, or at your option) any later version.                        *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Lesser General Public License for more details.                   *
+ *                                                                         *
+ *   You should have received a copy of the Lesser GNU General Public      *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+ * DataItem::setValue against the plain erase and trim it replaced, on
+ * random values short and long, clean and not, with bytes above 0x7f.
+ */
+
+#include "testutil.hpp"
+
+#include <cstring>
+
+using namespace vpdtest;
+
+/*
+ * What setValue did before it had a scanner of its own.
+ */
+static string reference( const string& in )
+{
+	string ret;
+
+	for( size_t i = 0; i < in.length( ); i++ )
+	{
+		if( in[ i ] != '\0' && in[ i ] != '\n' && in[ i ] != '\r' )
+			ret += in[ i ];
+	}
+	while( !ret.empty( ) && strchr( " \t\v\f", ret[ 0 ] ) != NULL )
+		ret.erase( 0, 1 );
+	while( !ret.empty( ) &&
+		strchr( " \t\v\f", ret[ ret.length( ) - 1 ] ) != NULL )
+		ret.erase( ret.length( ) - 1, 1 );
+	return ret;
+}
+
+static void check( const string& in )
+{
+	DataItem d;
+	Gatherer::setValue( d, in );
+	CHECK( d.getValue( ) == reference( in ) );
+
+	// And again over a value that is already there.
+	Gatherer::setValue( d, "old value" );
+	Gatherer::setValue( d, in );
+	CHECK( in.empty( ) || d.getValue( ) == reference( in ) );
+}
+
+int main( )
+{
+	const char bytes[ ] = { 'a', 'Z', ' ', '\t', '\v', '\f', '\0', '\n', '\r',
+		(char)0xc3, (char)0xa9, (char)0xff };
+	// Around the SIMD steps and the length where memchr takes over.
+	const size_t lengths[ ] = { 0, 1, 2, 7, 8, 15, 16, 17, 63, 64, 65, 255,
+		256, 257, 1000, 4096, 16384 };
+	unsigned int seed = 1;
+
+	for( size_t l = 0; l < sizeof( lengths ) / sizeof( lengths[ 0 ] ); l++ )
+	{
+		for( int density = 1; density <= 4096; density *= 4 )
+		{
+			for( int r = 0; r < 20; r++ )
+			{
+				string in;
+				for( size_t i = 0; i < lengths[ l ]; i++ )
+				{
+					seed = seed * 1103515245 + 12345;
+					if( ( seed >> 16 ) % density == 0 )
+						in += bytes[ ( seed >> 8 ) % sizeof( bytes ) ];
+					else
+						in += 'a' + ( seed >> 8 ) % 26;
+				}
+				check( in );
+			}
+		}
+
+		// One dropped byte of each kind alone at every end and middle.
+		for( size_t k = 6; k < 9 && lengths[ l ] > 0; k++ )
+		{
+			size_t at[ ] = { 0, lengths[ l ] / 2, lengths[ l ] - 1 };
+			for( size_t p = 0; p < 3; p++ )
+			{
+				string in( lengths[ l ], 'x' );
+				in[ at[ p ] ] = bytes[ k ];
+				check( in );
+			}
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,233 @@
+/***************************************************************************
+ *   Copyright (C) 2006, IBM                                               *
+ *                                                                         *
+ *   Maintained By:                                                        *
+ *   Eric Munson and Brad Peters                                           *
+ *   munsone@us.ibm.com, bpeters@us.ibm.com                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the Lesser GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of the  *
+ *   License, or at your option) any later version.                        *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Lesser General Public License for more details.                   *
+ *                                                                         *
+ *   You should have received a copy of the Lesser GNU General Public      *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+ * scanPrefix, scanRange and the paged getKeys, and the same scans through
+ * the C library, against a sorted list of the IDs stored: prefixes ending
+ * in 0xff bytes, the empty prefix, the System row left out, the page that
+ * ends on the last key, and a scan that fails part way through.
+ */
+
+#include "testutil.hpp"
+
+extern "C" {
+#include <libvpd-2/component.h>
+#include <libvpd-2/system.h>
+#include <libvpd-2/vpddbenv.h>
+}
+
+#include <algorithm>
+#include <set>
+#include <unistd.h>
+
+using namespace vpdtest;
+
+static const char* const IDS[ ] = {
+	"/sys/bus/pci", "/sys/devices/a", "/sys/devices/a/b", "/sys/devices/ab",
+	"/sys/devices/b", "x", "x\xff", "x\xff\xff", "x\xff" "a", "y",
+	"\xff\xff", "\xff\xff\x01"
+};
+
+static vector<string> expectRange( const set<string>& ids,
+	const string& first, const string& last )
+{
+	vector<string> ret;
+	for( set<string>::const_iterator i = ids.lower_bound( first );
+		i != ids.end( ) && ( last.empty( ) || *i < last ); ++i )
+		ret.push_back( *i );
+	return ret;
+}
+
+static vector<string> expectPrefix( const set<string>& ids,
+	const string& prefix )
+{
+	vector<string> ret;
+	for( set<string>::const_iterator i = ids.begin( ); i != ids.end( ); ++i )
+		if( i->compare( 0, prefix.length( ), prefix ) == 0 )
+			ret.push_back( *i );
+	return ret;
+}
+
+static vector<string> drain( VpdDbEnv::Cursor* c )
+{
+	vector<string> ret;
+
+	CHECK( c != NULL );
+	while( c->next( ) )
+	{
+		Component* comp = c->getComponent( );
+		CHECK( comp != NULL && comp->getID( ) == c->getID( ) );
+		delete comp;
+		ret.push_back( c->getID( ) );
+	}
+	CHECK( !c->failed( ) );
+	CHECK( !c->next( ) && !c->failed( ) );
+	delete c;
+	return ret;
+}
+
+static vector<string> drain( struct vpdcursor* c )
+{
+	vector<string> ret;
+	int rc;
+
+	CHECK( c != NULL );
+	while( ( rc = cursor_next( c ) ) == 1 )
+	{
+		struct component* comp = cursor_component( c );
+		CHECK( comp != NULL && string( comp->id->dataValue ) == c->id );
+		free_component( comp );
+		ret.push_back( c->id );
+	}
+	CHECK( rc == 0 && c->id == NULL );
+	CHECK( cursor_next( c ) == 0 );
+	free_cursor( c );
+	return ret;
+}
+
+int main( )
+{
+	TempDir dir;
+	set<string> ids;
+	const size_t count = sizeof( IDS ) / sizeof( IDS[ 0 ] );
+
+	{
+		VpdDbEnv db( dir.path, "vpd.db", false );
+		System* sys = Gatherer::makeSystem( );
+		CHECK( db.store( sys ) );
+		delete sys;
+		for( size_t i = 0; i < count; i++ )
+		{
+			Component* c = Gatherer::make( IDS[ i ], SYS_ID, i );
+			CHECK( db.store( c ) );
+			delete c;
+			ids.insert( IDS[ i ] );
+		}
+	}
+	CHECK( ids.count( SYS_ID ) == 0 );
+
+	const string prefixes[ ] = {
+		"", "/sys/devices/a", "/sys/bus", "x\xff", "x\xff\xff", "\xff",
+		"\xff\xff", "/sys/devices/c", "z"
+	};
+	const string ranges[ ][ 2 ] = {
+		{ "", "" }, { "/sys/devices/a", "/sys/devices/b" },
+		{ "/sys/devices/b", "" }, { "x", "x\xff\xff" }, { "y", "x" },
+		{ "", "/sys/bus/pci" }
+	};
+
+	{
+		VpdDbEnv db( dir.path, "vpd.db", true );
+		struct vpddbenv* c = new_vpddbenv( dir.path.c_str( ), "vpd.db" );
+		CHECK( c != NULL );
+
+		for( size_t i = 0; i < sizeof( prefixes ) / sizeof( prefixes[ 0 ] );
+			i++ )
+		{
+			vector<string> want = expectPrefix( ids, prefixes[ i ] );
+			CHECK( drain( db.scanPrefix( prefixes[ i ] ) ) == want );
+			CHECK( drain( scan_prefix( c, prefixes[ i ].c_str( ) ) ) == want );
+		}
+		CHECK( drain( db.scanPrefix( "" ) ).size( ) == count );
+		CHECK( expectPrefix( ids, "x\xff" ).size( ) == 3 );
+		CHECK( expectPrefix( ids, "\xff" ).size( ) == 2 );
+
+		for( size_t i = 0; i < sizeof( ranges ) / sizeof( ranges[ 0 ] ); i++ )
+		{
+			vector<string> want = expectRange( ids, ranges[ i ][ 0 ],
+				ranges[ i ][ 1 ] );
+			CHECK( drain( db.scanRange( ranges[ i ][ 0 ],
+				ranges[ i ][ 1 ] ) ) == want );
+			CHECK( drain( scan_range( c, ranges[ i ][ 0 ].c_str( ),
+				ranges[ i ][ 1 ].c_str( ) ) ) == want );
+		}
+		CHECK( drain( scan_range( c, NULL, NULL ) ).size( ) == count );
+		free_vpddbenv( c );
+
+		// getKeys pages through every key, the System's too.
+		vector<string> all = db.getKeys( );
+		CHECK( all.size( ) == count + 1 );
+		CHECK( is_sorted( all.begin( ), all.end( ) ) );
+		for( unsigned int size = 1; size <= all.size( ) + 1; size++ )
+		{
+			vector<string> got;
+			string token, next;
+			unsigned int pages = 0;
+
+			do {
+				vector<string> page = db.getKeys( token, size, next );
+				CHECK( page.size( ) <= size );
+				// Only the last page is short, and a full one that ends
+				// on the last key has no next page either.
+				CHECK( next.empty( ) || page.size( ) == size );
+				CHECK( next.empty( ) || next == page.back( ) );
+				got.insert( got.end( ), page.begin( ), page.end( ) );
+				token = next;
+				pages++;
+			} while( !next.empty( ) );
+			CHECK( got == all );
+			CHECK( pages == ( all.size( ) + size - 1 ) / size );
+		}
+		string next = "unchanged";
+		CHECK( db.getKeys( "", 0, next ).empty( ) && next.empty( ) );
+		CHECK( db.getKeys( all.back( ), 5, next ).empty( ) && next.empty( ) );
+	}
+
+	// A database the scan cannot read to the end: the rows are spread
+	// over many pages and the file is cut short under an open
+	// connection.
+	{
+		VpdDbEnv db( dir.path, "big.db", false );
+		buildTree( db, 16, 3 );
+	}
+	{
+		string path = dir.path + "/big.db";
+		VpdDbEnv db( dir.path, "big.db", true );
+		struct vpddbenv* c = new_vpddbenv( dir.path.c_str( ), "big.db" );
+		CHECK( c != NULL );
+		// Both scans are prepared while the schema can still be read.
+		VpdDbEnv::Cursor* cur = db.scanPrefix( "" );
+		struct vpdcursor* ccur = scan_prefix( c, "" );
+		CHECK( cur != NULL && ccur != NULL );
+
+		FILE* f = fopen( path.c_str( ), "r" );
+		CHECK( f != NULL && fseek( f, 0, SEEK_END ) == 0 );
+		long size = ftell( f );
+		fclose( f );
+		CHECK( truncate( path.c_str( ), size / 2 ) == 0 );
+
+		size_t rows = 0;
+		while( cur->next( ) )
+			rows++;
+		CHECK( cur->failed( ) && rows < 16 * 16 + 16 * 16 * 16 );
+		delete cur;
+
+		int rc;
+		while( ( rc = cursor_next( ccur ) ) == 1 )
+			;
+		CHECK( rc == -1 );
+		free_cursor( ccur );
+		free_vpddbenv( c );
+	}
+	return 0;
+}
@@ -0,0 +1,126 @@
+/***************************************************************************
+ *   Copyright (C) 2006, IBM                                               *
+ *                                                                         *
+ *   Maintained By:                                                        *
+ *   Eric Munson and Brad Peters                                           *
+ *   munsone@us.ibm.com, bpeters@us.ibm.com                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the Lesser GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of the  *
+ *   License, or at your option) any later version.                        *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Lesser General Public License for more details.                   *
+ *                                                                         *
+ *   You should have received a copy of the Lesser GNU General Public      *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+ * search( ) with and without the full text index: both give the same
+ * Components for the same words, and the index follows every store,
+ * upsert and remove.  The index needs FTS5, without it only the scan is
+ * checked and the test is skipped.
+ */
+
+#include "testutil.hpp"
+
+#include <libvpd-2/vpdretriever.hpp>
+
+#include <set>
+
+using namespace vpdtest;
+
+static set<string> asSet( const vector<string>& ids )
+{
+	return set<string>( ids.begin( ), ids.end( ) );
+}
+
+static bool only( const vector<string>& ids, const string& id )
+{
+	return ids.size( ) == 1 && ids[ 0 ] == id;
+}
+
+int main( )
+{
+	TempDir dir;
+	vector<string> ids;
+	const char* queries[] = { "SER1000", "ser10001", "PN4", "Test device 12",
+		"test DEVICE 23", "hdisk7", "u3", "WZS0ABC-P1-C3", "nomatchzzz",
+		"zval3 u12", "FW10.2", "/sys/devices/n1/c2" };
+
+	{
+		VpdDbEnv db( dir.path, "indexed.db", false );
+		ids = buildTree( db, 4, 3 );
+	}
+	copyFile( dir.path + "/indexed.db", dir.path + "/plain.db" );
+
+	VpdDbEnv plain( dir.path, "plain.db", false );
+	CHECK( !plain.hasSearchIndex( ) );
+	CHECK( plain.search( "ser10001" ).size( ) == 10 );
+	CHECK( plain.search( "Test", 10 ).size( ) == 10 );
+	CHECK( plain.search( "" ).empty( ) && plain.search( "  " ).empty( ) );
+
+	VpdDbEnv db( dir.path, "indexed.db", false );
+	if( !db.setSearchIndex( true ) )
+	{
+		// Only SQLite without FTS5 is a reason to fail here.
+		CHECK( !sqlite3_compileoption_used( "ENABLE_FTS5" ) );
+		return 77;
+	}
+	CHECK( db.hasSearchIndex( ) );
+
+	for( size_t q = 0; q < sizeof( queries ) / sizeof( queries[ 0 ] ); q++ )
+		CHECK( asSet( db.search( queries[ q ] ) ) ==
+			asSet( plain.search( queries[ q ] ) ) );
+	CHECK( db.search( "SER1000" ).size( ) == ids.size( ) );
+	CHECK( db.search( "Test", 10 ).size( ) == 10 );
+	CHECK( db.search( "" ).empty( ) && db.search( "  " ).empty( ) );
+
+	// The index follows the rows.
+	string id = ids[ 5 ];
+	{
+		Component* c = db.fetch( id );
+		Gatherer::setSerial( c, "QQZZY987" );
+		CHECK( db.upsert( c ) );
+		delete c;
+	}
+	CHECK( only( db.search( "qqzzy98" ), id ) );
+	CHECK( db.search( "SER100005" ).empty( ) );
+	CHECK( db.remove( id ) );
+	CHECK( db.search( "qqzzy98" ).empty( ) );
+	{
+		Component* c = Gatherer::make( "/search/new", System::ID, 3 );
+		Gatherer::addDeviceSpecific( c, "Z9", "weirdvalue\"q" );
+		CHECK( db.store( c ) );
+		delete c;
+	}
+	CHECK( only( db.search( "dvalue\"q" ), "/search/new" ) );
+	CHECK( only( db.search( "WEIRDVAL" ), "/search/new" ) );
+	CHECK( db.rebuildSearch( ) );
+	CHECK( only( db.search( "weirdval" ), "/search/new" ) );
+	{
+		VpdRetriever ret( dir.path, "indexed.db" );
+		CHECK( ret.search( "weirdval", 5 ).size( ) == 1 );
+	}
+
+	// The index stays with the file, and only a writer may drop it.
+	{
+		VpdDbEnv ro( dir.path, "indexed.db", true );
+		CHECK( ro.hasSearchIndex( ) );
+		CHECK( !ro.setSearchIndex( false ) );
+		CHECK( only( ro.search( "weirdval" ), "/search/new" ) );
+	}
+	CHECK( db.setSearchIndex( false ) && !db.hasSearchIndex( ) );
+	CHECK( only( db.search( "weirdval" ), "/search/new" ) );
+	{
+		VpdDbEnv again( dir.path, "indexed.db", false );
+		CHECK( !again.hasSearchIndex( ) );
+	}
+	return 0;
+}
@@ -0,0 +1,251 @@
+/***************************************************************************
+ *   Copyright (C) 2006, IBM                                               *
+ *                                                                         *
+ *   Maintained By:                                                        *
+ *   Eric Munson and Brad Peters                                           *
+ *   munsone@us.ibm.com, bpeters@us.ibm.com                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the Lesser GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of the  *
+ *   License, or at your option) any later version.                        *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Lesser General Public License for more details.                   *
+ *                                                                         *
+ *   You should have received a copy of the Lesser GNU General Public      *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+ * Snapshots made by a SnapshotEditor share what the edit did not touch
+ * with the one they came from and leave it as it was, find every
+ * Component across commits that fold the edited parents back into the
+ * base map, and stay usable by readers of a SnapshotPublisher while
+ * newer ones are published from another thread.
+ */
+
+#include "testutil.hpp"
+
+#include <libvpd-2/vpdretriever.hpp>
+
+#include <map>
+#include <thread>
+
+using namespace vpdtest;
+
+typedef map<string, string> Parents;
+
+static Component* copyOf( const SnapshotPtr& snap, const string& id )
+{
+	SnapshotNodePtr node = snap->find( id );
+	CHECK( node );
+	return node->getComponent( ).clone( );
+}
+
+/*
+ * snap holds exactly the Components of parents, each below its parent,
+ * and none of gone.
+ */
+static void checkParents( const SnapshotPtr& snap, const Parents& parents,
+	const vector<string>& gone )
+{
+	for( Parents::const_iterator i = parents.begin( ); i != parents.end( );
+		++i )
+	{
+		SnapshotNodePtr node = snap->find( i->first );
+		CHECK( node && node->getComponent( ).getID( ) == i->first );
+		if( i->second == System::ID )
+			continue;
+		SnapshotNodePtr parent = snap->find( i->second );
+		CHECK( parent );
+		bool below = false;
+		for( size_t j = 0; j < parent->getLeaves( ).size( ); j++ )
+			below = below || parent->getLeaves( )[ j ] == node;
+		CHECK( below );
+	}
+	for( size_t i = 0; i < gone.size( ); i++ )
+		CHECK( !snap->find( gone[ i ] ) );
+}
+
+int main( )
+{
+	TempDir dir;
+	vector<string> ids;
+
+	{
+		VpdDbEnv db( dir.path, "vpd.db", false );
+		ids = buildTree( db, 4, 3 );
+	}
+	// The parent of ids[ k ] is ids[ ( k - 4 ) / 4 ] below the top four.
+	VpdRetriever r( dir.path, "vpd.db" );
+	SnapshotPtr s0 = r.getSnapshot( );
+	Parents parents;
+	for( size_t k = 0; k < ids.size( ); k++ )
+		parents[ ids[ k ] ] = k < 4 ? System::ID : ids[ ( k - 4 ) / 4 ];
+
+	// N + 1 shares every node off the path to the edited one with N.
+	SnapshotEditor e( s0 );
+	Component* c = copyOf( s0, ids[ 83 ] );
+	Gatherer::setSerial( c, "EDITED" );
+	CHECK( e.upsert( c, ids[ 19 ] ) );
+	SnapshotPtr s1 = e.commit( );
+
+	CHECK( s1->getGeneration( ) > s0->getGeneration( ) );
+	CHECK( &s1->getSystem( ) == &s0->getSystem( ) );
+	for( int k = 0; k < 3; k++ )
+		CHECK( s1->getLeaves( )[ k ] == s0->getLeaves( )[ k ] );
+	CHECK( s1->find( ids[ 3 ] ) != s0->find( ids[ 3 ] ) );
+	for( int k = 16; k < 19; k++ )
+		CHECK( s1->find( ids[ k ] ) == s0->find( ids[ k ] ) );
+	CHECK( s1->find( ids[ 19 ] ) != s0->find( ids[ 19 ] ) );
+	for( int k = 80; k < 83; k++ )
+		CHECK( s1->find( ids[ k ] ) == s0->find( ids[ k ] ) );
+	CHECK( &s1->find( ids[ 19 ] )->getComponent( ) ==
+		&s0->find( ids[ 19 ] )->getComponent( ) );
+	CHECK( s1->find( ids[ 83 ] )->getComponent( ).getSerialNumber( ) ==
+		"EDITED" );
+	CHECK( s0->find( ids[ 83 ] )->getComponent( ).getSerialNumber( ) ==
+		"SER100083" );
+	CHECK( s1->find( ids[ 19 ] )->getHash( ) !=
+		s0->find( ids[ 19 ] )->getHash( ) );
+	checkParents( s0, parents, vector<string>( ) );
+	checkParents( s1, parents, vector<string>( ) );
+	const Parents original = parents;
+
+	// Past 256 edited parents a commit folds them into the base map.
+	// Adds, moves and removals committed a few at a time are all found,
+	// by the newest Snapshot and by the ones kept along the way.
+	vector<string> gone;
+	vector<pair<SnapshotPtr, Parents> > kept;
+	int n = 1000;
+	for( int round = 0; round < 40; round++ )
+	{
+		for( int k = 0; k < 10; k++, n++ )
+		{
+			string id = "/sys/devices/extra" + to_string( n );
+			string parent = ids[ n % ids.size( ) ];
+			CHECK( e.upsert( Gatherer::make( id, parent, n ), parent ) );
+			parents[ id ] = parent;
+		}
+		// Move one added in the round before, remove another.
+		if( round > 0 )
+		{
+			string moved = "/sys/devices/extra" + to_string( n - 15 );
+			string to = ids[ ( n * 7 ) % ids.size( ) ];
+			CHECK( e.upsert( Gatherer::make( moved, to, n ), to ) );
+			parents[ moved ] = to;
+
+			string removed = "/sys/devices/extra" + to_string( n - 13 );
+			CHECK( e.remove( removed ) );
+			parents.erase( removed );
+			gone.push_back( removed );
+		}
+		SnapshotPtr s = e.commit( );
+		checkParents( s, parents, gone );
+		if( round % 8 == 0 )
+			kept.push_back( make_pair( s, parents ) );
+	}
+	CHECK( !e.remove( gone[ 0 ] ) );
+	CHECK( !e.upsert( Gatherer::make( "/sys/devices/orphan", gone[ 0 ], 1 ),
+		gone[ 0 ] ) );
+	for( size_t i = 0; i < kept.size( ); i++ )
+	{
+		// What was removed before it or added after it is not there.
+		vector<string> absent;
+		for( size_t j = 0; j < gone.size( ); j++ )
+			if( !kept[ i ].second.count( gone[ j ] ) )
+				absent.push_back( gone[ j ] );
+		for( Parents::const_iterator j = parents.begin( );
+			j != parents.end( ); ++j )
+			if( !kept[ i ].second.count( j->first ) )
+				absent.push_back( j->first );
+		checkParents( kept[ i ].first, kept[ i ].second, absent );
+	}
+	checkParents( s0, original, vector<string>( ) );
+
+	// A reader keeps the Snapshot it took for as long as it holds it.
+	{
+		SnapshotPublisher p;
+		CHECK( !p.current( ) );
+		CHECK( p.publish( s0 ) );
+		SnapshotPtr reader = p.current( );
+		weak_ptr<const Snapshot> old( s0 );
+		s0.reset( );
+		kept.clear( );
+
+		CHECK( p.publish( s1 ) );
+		CHECK( p.current( ) == s1 );
+		CHECK( !old.expired( ) );
+		CHECK( reader->find( ids[ 83 ] )->getComponent( ).getSerialNumber( ) ==
+			"SER100083" );
+		// Not replaced by an older one.
+		CHECK( !p.publish( reader ) && p.current( ) == s1 );
+		reader.reset( );
+		CHECK( old.expired( ) );
+	}
+
+	// One thread publishes a Snapshot for every edit while others read.
+	// Each edit sets two serial numbers to the same value, so a reader
+	// sees both or neither.
+	{
+		SnapshotPublisher p;
+		SnapshotEditor w( s1 );
+		const int EDITS = 300;
+
+		CHECK( p.publish( s1 ) );
+		thread writer( [ & ]( ) {
+			for( int i = 1; i <= EDITS; i++ )
+			{
+				const string& a = ids[ 20 + i % 64 ];
+				const string& b = ids[ 4 + i % 16 ];
+				Component* x = copyOf( p.current( ), a );
+				Component* y = copyOf( p.current( ), b );
+				Gatherer::setSerial( x, "E" + to_string( i ) );
+				Gatherer::setSerial( y, "E" + to_string( i ) );
+				CHECK( w.upsert( x, x->getParent( ) ) );
+				CHECK( w.upsert( y, y->getParent( ) ) );
+				CHECK( p.publish( w.commit( ) ) );
+			}
+		} );
+
+		vector<thread> readers;
+		for( int t = 0; t < 3; t++ )
+		{
+			readers.push_back( thread( [ & ]( ) {
+				u64 last = 0;
+				for( ;; )
+				{
+					SnapshotPtr s = p.current( );
+					CHECK( s->getGeneration( ) >= last );
+					last = s->getGeneration( );
+					int i = 0;
+					if( s != s1 )
+					{
+						// The newest edit in s is the one both saw.
+						for( i = EDITS; i > 0; i-- )
+						{
+							SnapshotNodePtr x = s->find( ids[ 20 + i % 64 ] );
+							if( x->getComponent( ).getSerialNumber( ) ==
+								"E" + to_string( i ) )
+								break;
+						}
+						CHECK( i > 0 );
+						CHECK( s->find( ids[ 4 + i % 16 ] )->getComponent( )
+							.getSerialNumber( ) == "E" + to_string( i ) );
+					}
+					if( i == EDITS )
+						break;
+				}
+			} ) );
+		}
+		writer.join( );
+		for( size_t t = 0; t < readers.size( ); t++ )
+			readers[ t ].join( );
+	}
+	return 0;
+}
@@ -0,0 +1,305 @@
+/***************************************************************************
+ *   Copyright (C) 2006, IBM                                               *
+ *                                                                         *
+ *   Maintained By:                                                        *
+ *   Eric Munson and Brad Peters                                           *
+ *   munsone@us.ibm.com, bpeters@us.ibm.com                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the Lesser GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of the  *
+ *   License, or at your option) any later version.                        *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Lesser General Public License for more details.                   *
+ *                                                                         *
+ *   You should have received a copy of the Lesser GNU General Public      *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+ * SnapshotDiff between Snapshots made with a SnapshotEditor: what is
+ * added, removed, moved and changed, down to the values of each field,
+ * the subtrees it skips because they hash the same, the entries with the
+ * same AC in a list, and the ChangeNotifier passing on only the fields a
+ * listener asked for.
+ */
+
+#include "testutil.hpp"
+
+#include <libvpd-2/vpdretriever.hpp>
+#include <libvpd-2/snapshotdiff.hpp>
+
+#include <algorithm>
+#include <map>
+
+using namespace vpdtest;
+
+typedef ComponentChange Change;
+
+static Component* copyOf( const SnapshotPtr& snap, const string& id )
+{
+	SnapshotNodePtr node = snap->find( id );
+	CHECK( node );
+	return node->getComponent( ).clone( );
+}
+
+static const Change* changeOf( const SnapshotDiff& diff, const string& id )
+{
+	for( size_t i = 0; i < diff.getChanges( ).size( ); i++ )
+		if( diff.getChanges( )[ i ].id == id )
+			return &diff.getChanges( )[ i ];
+	return NULL;
+}
+
+/*
+ * The FieldChanges of c, as "field ac before>after" in their order.
+ */
+static vector<string> values( const Change* c )
+{
+	vector<string> ret;
+	for( size_t i = 0; i < c->fieldChanges.size( ); i++ )
+	{
+		const FieldChange& f = c->fieldChanges[ i ];
+		ret.push_back( to_string( f.field ) + " " + f.ac + " " + f.before +
+			">" + f.after );
+	}
+	return ret;
+}
+
+static string value( int field, const string& ac, const string& before,
+	const string& after )
+{
+	return to_string( field ) + " " + ac + " " + before + ">" + after;
+}
+
+class Recorder : public ChangeListener
+{
+	public:
+		vector<string> heard;
+
+		virtual void changed( const ComponentChange& change )
+			{ heard.push_back( change.id ); }
+};
+
+int main( )
+{
+	TempDir dir;
+	vector<string> ids;
+
+	{
+		VpdDbEnv db( dir.path, "vpd.db", false );
+		ids = buildTree( db, 4, 3 );
+	}
+	// ids[ 0 .. 3 ] are on top, ids[ 4 .. 19 ] below them four each and
+	// ids[ 20 .. 83 ] below those: the parent of ids[ k ] is
+	// ids[ ( k - 4 ) / 4 ].
+	VpdRetriever r( dir.path, "vpd.db" );
+	SnapshotPtr s0 = r.getSnapshot( );
+
+	// The same tree loaded twice is told equal by the hashes alone, from
+	// the top level.
+	{
+		SnapshotDiff same( s0, r.getSnapshot( ) );
+		CHECK( same.empty( ) && same.getVisited( ) == 4 );
+	}
+
+	SnapshotEditor e( s0 );
+	Component* c;
+
+	// ids[ 5 ] changed in place.
+	c = copyOf( s0, ids[ 5 ] );
+	Gatherer::setSerial( c, "NEWSERIAL" );
+	Gatherer::updateDeviceSpecific( c, "Z0", "znew", 60 );
+	Gatherer::addDeviceSpecific( c, "Y1", "added" );
+	CHECK( e.upsert( c, ids[ 0 ] ) );
+
+	// ids[ 83 ] moved from ids[ 19 ] to ids[ 4 ].
+	CHECK( e.upsert( Gatherer::make( ids[ 83 ], ids[ 4 ], 83 ), ids[ 4 ] ) );
+
+	// A new Component below ids[ 2 ], a leaf and a subtree removed.
+	CHECK( e.upsert( Gatherer::make( "/sys/devices/new", ids[ 2 ], 500 ),
+		ids[ 2 ] ) );
+	CHECK( e.remove( ids[ 60 ] ) );
+	CHECK( e.remove( ids[ 7 ] ) );
+	SnapshotPtr s1 = e.commit( );
+
+	SnapshotDiff diff( s0, s1 );
+	map<string, Change::Kind> kinds;
+	for( size_t i = 0; i < diff.getChanges( ).size( ); i++ )
+	{
+		const Change& ch = diff.getChanges( )[ i ];
+		CHECK( i == 0 || diff.getChanges( )[ i - 1 ].id < ch.id );
+		kinds[ ch.id ] = ch.kind;
+	}
+	map<string, Change::Kind> want;
+	want[ ids[ 5 ] ] = Change::CHANGED;
+	want[ ids[ 83 ] ] = Change::MOVED;
+	want[ ids[ 19 ] ] = Change::CHANGED;
+	want[ ids[ 4 ] ] = Change::CHANGED;
+	want[ "/sys/devices/new" ] = Change::ADDED;
+	want[ ids[ 2 ] ] = Change::CHANGED;
+	want[ ids[ 60 ] ] = Change::REMOVED;
+	want[ ids[ 14 ] ] = Change::CHANGED;
+	want[ ids[ 7 ] ] = Change::REMOVED;
+	for( int i = 32; i < 36; i++ )
+		want[ ids[ i ] ] = Change::REMOVED;
+	want[ ids[ 0 ] ] = Change::CHANGED;
+	CHECK( kinds == want );
+	CHECK( diff.getSystemChanges( ).empty( ) );
+
+	const Change* ch = changeOf( diff, ids[ 5 ] );
+	CHECK( ch->parentBefore == ids[ 0 ] && ch->parentAfter == ids[ 0 ] );
+	CHECK( ch->fields == ( Component::fieldMask(
+		Component::FIELD_SERIAL_NUMBER ) | Component::fieldMask(
+		Component::FIELD_DEVICE_SPECIFIC ) ) );
+	vector<string> v;
+	v.push_back( value( Component::FIELD_SERIAL_NUMBER, "SN", "SER100005",
+		"NEWSERIAL" ) );
+	v.push_back( value( Component::FIELD_DEVICE_SPECIFIC, "Z0", "zval5",
+		"znew" ) );
+	v.push_back( value( Component::FIELD_DEVICE_SPECIFIC, "Y1", "",
+		"added" ) );
+	CHECK( values( ch ) == v );
+	CHECK( ch->before->getSerialNumber( ) == "SER100005" &&
+		ch->after->getSerialNumber( ) == "NEWSERIAL" );
+
+	ch = changeOf( diff, ids[ 83 ] );
+	CHECK( ch->parentBefore == ids[ 19 ] && ch->parentAfter == ids[ 4 ] );
+	CHECK( ch->fields == Component::fieldMask( Component::FIELD_PARENT ) );
+	v.clear( );
+	v.push_back( value( Component::FIELD_PARENT, "Parent Node", ids[ 19 ],
+		ids[ 4 ] ) );
+	CHECK( values( ch ) == v );
+
+	ch = changeOf( diff, ids[ 19 ] );
+	CHECK( ch->fields == Component::fieldMask( Component::FIELD_CHILDREN ) );
+	v.clear( );
+	v.push_back( value( Component::FIELD_CHILDREN, ids[ 83 ], ids[ 83 ],
+		"" ) );
+	CHECK( values( ch ) == v );
+
+	ch = changeOf( diff, ids[ 4 ] );
+	v.clear( );
+	v.push_back( value( Component::FIELD_CHILDREN, ids[ 83 ], "",
+		ids[ 83 ] ) );
+	CHECK( values( ch ) == v );
+
+	ch = changeOf( diff, "/sys/devices/new" );
+	CHECK( ch->parentBefore.empty( ) && ch->parentAfter == ids[ 2 ] );
+	CHECK( !ch->before && ch->after && ch->fieldChanges.empty( ) );
+	CHECK( ch->fields == Component::ALL_FIELDS );
+
+	ch = changeOf( diff, ids[ 33 ] );
+	CHECK( ch->parentBefore == ids[ 7 ] && ch->parentAfter.empty( ) );
+	CHECK( ch->before && !ch->after && ch->fields == Component::ALL_FIELDS );
+	CHECK( changeOf( diff, ids[ 7 ] )->parentBefore == ids[ 0 ] );
+	ch = changeOf( diff, ids[ 0 ] );
+	v.clear( );
+	v.push_back( value( Component::FIELD_CHILDREN, ids[ 7 ], ids[ 7 ], "" ) );
+	CHECK( values( ch ) == v );
+
+	// ids[ 1 ] and the 20 nodes below it were not touched: the diff
+	// stops at the top of them.
+	CHECK( s1->find( ids[ 1 ] ) == s0->find( ids[ 1 ] ) );
+	CHECK( diff.getVisited( ) < ids.size( ) - 20 );
+
+	// One leaf changed: the top level, then the four children of each
+	// node on the way down to it.
+	{
+		SnapshotEditor one( s0 );
+		c = copyOf( s0, ids[ 83 ] );
+		Gatherer::setSerial( c, "ONE" );
+		CHECK( one.upsert( c, ids[ 19 ] ) );
+		SnapshotDiff d( s0, one.commit( ) );
+		CHECK( d.getChanges( ).size( ) == 1 && d.getVisited( ) == 12 );
+	}
+
+	// Two device specific entries with the same AC: only the first one
+	// of each list is compared.
+	{
+		SnapshotEditor dup( s0 );
+		c = copyOf( s0, ids[ 6 ] );
+		Gatherer::addDeviceSpecific( c, "DU", "first" );
+		Gatherer::addDeviceSpecific( c, "DU", "second" );
+		CHECK( c->getDeviceSpecific( ).size( ) == 4 );
+		CHECK( dup.upsert( c, ids[ 0 ] ) );
+		SnapshotPtr a = dup.commit( );
+
+		c = copyOf( s0, ids[ 6 ] );
+		Gatherer::addDeviceSpecific( c, "DU", "first" );
+		Gatherer::addDeviceSpecific( c, "DU", "other" );
+		CHECK( dup.upsert( c, ids[ 0 ] ) );
+		SnapshotPtr b = dup.commit( );
+		CHECK( SnapshotDiff( a, b ).empty( ) );
+
+		c = copyOf( s0, ids[ 6 ] );
+		Gatherer::addDeviceSpecific( c, "DU", "changed" );
+		Gatherer::addDeviceSpecific( c, "DU", "second" );
+		Gatherer::addDeviceSpecific( c, "DU", "third" );
+		CHECK( dup.upsert( c, ids[ 0 ] ) );
+		SnapshotDiff d( a, dup.commit( ) );
+		CHECK( d.getChanges( ).size( ) == 1 );
+		v.clear( );
+		v.push_back( value( Component::FIELD_DEVICE_SPECIFIC, "DU", "first",
+			"changed" ) );
+		CHECK( values( &d.getChanges( )[ 0 ] ) == v );
+
+		// Gone from the list altogether is told once.
+		SnapshotDiff gone( a, s0 );
+		v.clear( );
+		v.push_back( value( Component::FIELD_DEVICE_SPECIFIC, "DU", "first",
+			"" ) );
+		CHECK( gone.getChanges( ).size( ) == 1 &&
+			values( &gone.getChanges( )[ 0 ] ) == v );
+	}
+
+	// Each listener hears the changes that touch its fields, in ID order,
+	// added and removed Components touching every field.
+	{
+		ChangeNotifier n;
+		Recorder serial, parent, lists, none;
+		const Component::FieldMask masks[ ] = {
+			Component::fieldMask( Component::FIELD_SERIAL_NUMBER ),
+			Component::fieldMask( Component::FIELD_PARENT ),
+			Component::fieldMask( Component::FIELD_CHILDREN ) |
+				Component::fieldMask( Component::FIELD_DEVICE_SPECIFIC ),
+			Component::fieldMask( Component::FIELD_FRU )
+		};
+		Recorder* listeners[ ] = { &serial, &parent, &lists, &none };
+		size_t calls = 0;
+
+		for( int i = 0; i < 4; i++ )
+			n.subscribe( listeners[ i ], masks[ i ] );
+		size_t made = n.notify( diff );
+
+		for( int i = 0; i < 4; i++ )
+		{
+			vector<string> heard;
+			for( size_t j = 0; j < diff.getChanges( ).size( ); j++ )
+				if( diff.getChanges( )[ j ].fields & masks[ i ] )
+					heard.push_back( diff.getChanges( )[ j ].id );
+			CHECK( listeners[ i ]->heard == heard );
+			calls += heard.size( );
+		}
+		CHECK( made == calls );
+		// Only the added and removed Components have a FRU field change.
+		CHECK( none.heard.size( ) == 7 );
+		CHECK( find( serial.heard.begin( ), serial.heard.end( ), ids[ 5 ] ) !=
+			serial.heard.end( ) );
+		CHECK( find( serial.heard.begin( ), serial.heard.end( ),
+			ids[ 83 ] ) == serial.heard.end( ) );
+		CHECK( find( parent.heard.begin( ), parent.heard.end( ),
+			ids[ 83 ] ) != parent.heard.end( ) );
+
+		n.unsubscribe( &serial );
+		serial.heard.clear( );
+		CHECK( n.notify( diff ) == calls - 7 - 1 );
+		CHECK( serial.heard.empty( ) );
+	}
+	return 0;
+}
@@ -0,0 +1,198 @@
+/***************************************************************************
+ *   Copyright (C) 2006, IBM                                               *
+ *                                                                         *
+ *   Maintained By:                                                        *
+ *   Eric Munson and Brad Peters                                           *
+ *   munsone@us.ibm.com, bpeters@us.ibm.com                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the Lesser GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of the  *
+ *   License, or at your option) any later version.                        *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Lesser General Public License for more details.                   *
+ *                                                                         *
+ *   You should have received a copy of the Lesser GNU General Public      *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+ * The SQL functions and the vpd_components virtual table: every column
+ * of every row against the Component the library fetches, a GROUP BY
+ * against a walk of the tree, lookups by ID and rows that cannot be
+ * read.
+ */
+
+#include "testutil.hpp"
+
+#include <libvpd-2/fields.h>
+#include <libvpd-2/vpdretriever.hpp>
+
+#include <map>
+
+using namespace vpdtest;
+
+#define FIELD_COLUMN( NAME, member, slot, ac, humanName ) ", v." #NAME
+static const char COLUMNS[] = "v.comp_id" VPD_COMPONENT_FIELDS( FIELD_COLUMN )
+	", v.children";
+#undef FIELD_COLUMN
+
+static string column( sqlite3_stmt* s, int i )
+{
+	const unsigned char* text = sqlite3_column_text( s, i );
+	return text ? string( (const char*)text ) : string( "<NULL>" );
+}
+
+static string json( const vector<string>& ids )
+{
+	string ret = "[";
+	for( size_t i = 0; i < ids.size( ); i++ )
+	{
+		ret += i > 0 ? ",\"" : "\"";
+		for( size_t k = 0; k < ids[ i ].length( ); k++ )
+		{
+			if( ids[ i ][ k ] == '"' || ids[ i ][ k ] == '\\' )
+				ret += '\\';
+			ret += ids[ i ][ k ];
+		}
+		ret += "\"";
+	}
+	return ret + "]";
+}
+
+static sqlite3_stmt* prepare( sqlite3* db, const string& sql )
+{
+	sqlite3_stmt* s = NULL;
+	if( sqlite3_prepare_v2( db, sql.c_str( ), -1, &s, NULL ) != SQLITE_OK )
+	{
+		fprintf( stderr, "%s: %s\n", sql.c_str( ), sqlite3_errmsg( db ) );
+		exit( 1 );
+	}
+	return s;
+}
+
+static int count( sqlite3* db, const string& sql )
+{
+	sqlite3_stmt* s = prepare( db, sql );
+	CHECK( sqlite3_step( s ) == SQLITE_ROW );
+	int ret = sqlite3_column_int( s, 0 );
+	sqlite3_finalize( s );
+	return ret;
+}
+
+int main( )
+{
+	TempDir dir;
+	string path = dir.path + "/vpd.db";
+	vector<string> ids;
+	sqlite3* db = NULL;
+
+	{
+		VpdDbEnv env( dir.path, "vpd.db", false );
+		ids = buildTree( env, 4, 3 );
+	}
+
+	VpdDbEnv env( dir.path, "vpd.db", true );
+	CHECK( sqlite3_open_v2( path.c_str( ), &db, SQLITE_OPEN_READONLY,
+		NULL ) == SQLITE_OK );
+	CHECK( VpdDbEnv::registerSqlFunctions( db ) );
+
+	// Every column of every row, and the functions on the same rows.
+	sqlite3_stmt* s = prepare( db, string( "SELECT " ) + COLUMNS +
+		", vpd_field( c." + VpdDbEnv::DATA + ", 'Z0' )"
+		", vpd_field( c." + VpdDbEnv::DATA + ", 'AX' )"
+		", vpd_children( c." + VpdDbEnv::DATA + " )"
+		", vpd_field( c." + VpdDbEnv::DATA + ", 'physical_location' )"
+		", vpd_field( c." + VpdDbEnv::DATA + ", 'NOPE' )"
+		" FROM vpd_components v JOIN " + VpdDbEnv::TABLE_NAME + " c ON "
+		"v.comp_id = c." + VpdDbEnv::ID + ";" );
+	const int children = 1 + Component::FIELD_CHILDREN;
+	size_t rows = 0;
+	while( sqlite3_step( s ) == SQLITE_ROW )
+	{
+		Component* c = env.fetch( column( s, 0 ) );
+		CHECK( c != NULL );
+		for( int f = 0; f < Component::FIELD_CHILDREN; f++ )
+			CHECK( column( s, f + 1 ) ==
+				c->getField( (Component::Field)f )->getValue( ) );
+		CHECK( column( s, children ) == json( c->getChildren( ) ) );
+		CHECK( column( s, children + 1 ) ==
+			c->getDeviceSpecific( "Z0" )->getValue( ) );
+		CHECK( column( s, children + 2 ) ==
+			c->getAIXNames( )[ 0 ]->getValue( ) );
+		CHECK( column( s, children + 3 ) == column( s, children ) );
+		CHECK( column( s, children + 4 ) ==
+			c->getField( Component::FIELD_PHYSICAL_LOCATION )->getValue( ) );
+		CHECK( sqlite3_column_type( s, children + 5 ) == SQLITE_NULL );
+		delete c;
+		rows++;
+	}
+	sqlite3_finalize( s );
+	// The System row is not a Component.
+	CHECK( rows == ids.size( ) );
+
+	// A GROUP BY inside SQLite against a walk of the loaded tree.
+	map<pair<string, string>, int> bySql, byTree;
+	s = prepare( db, "SELECT part_number, firmware_level, count( * ) "
+		"FROM vpd_components GROUP BY 1, 2;" );
+	while( sqlite3_step( s ) == SQLITE_ROW )
+		bySql[ make_pair( column( s, 0 ), column( s, 1 ) ) ] =
+			sqlite3_column_int( s, 2 );
+	sqlite3_finalize( s );
+	{
+		VpdRetriever ret( dir.path, "vpd.db" );
+		System* sys = ret.getComponentTree( );
+		vector<Component*> stack( sys->getLeaves( ).begin( ),
+			sys->getLeaves( ).end( ) );
+		while( !stack.empty( ) )
+		{
+			Component* c = stack.back( );
+			stack.pop_back( );
+			byTree[ make_pair( c->getPartNumber( ),
+				c->getFirmwareLevel( ) ) ]++;
+			stack.insert( stack.end( ), c->getLeaves( ).begin( ),
+				c->getLeaves( ).end( ) );
+		}
+		delete sys;
+	}
+	CHECK( !bySql.empty( ) && bySql == byTree );
+
+	// Lookups by ID, and filters on a field.
+	CHECK( count( db, "SELECT count( * ) FROM vpd_components WHERE "
+		"comp_id = '" + ids[ 7 ] + "';" ) == 1 );
+	CHECK( count( db, "SELECT count( * ) FROM vpd_components WHERE "
+		"comp_id = '/sys/none';" ) == 0 );
+	CHECK( count( db, "SELECT count( * ) FROM " + VpdDbEnv::TABLE_NAME +
+		" WHERE vpd_field( " + VpdDbEnv::DATA + ", 'SN' ) = 'SER100007';" ) ==
+		1 );
+
+	// Anything that is not a packed Component gives NULL.
+	s = prepare( db, "SELECT vpd_field( x'00', 'SN' ), vpd_field( NULL, 'SN' ), "
+		"vpd_children( x'00000008616263' ), vpd_children( 'text' );" );
+	CHECK( sqlite3_step( s ) == SQLITE_ROW );
+	for( int i = 0; i < 4; i++ )
+		CHECK( sqlite3_column_type( s, i ) == SQLITE_NULL );
+	sqlite3_finalize( s );
+	sqlite3_close( db );
+
+	// A row cut short keeps its ID, the rest of its columns are NULL.
+	corrupt( path, ids[ 3 ] );
+	CHECK( sqlite3_open_v2( path.c_str( ), &db, SQLITE_OPEN_READONLY,
+		NULL ) == SQLITE_OK );
+	CHECK( VpdDbEnv::registerSqlFunctions( db ) );
+	s = prepare( db, "SELECT serial_number, children FROM vpd_components "
+		"WHERE comp_id = '" + ids[ 3 ] + "';" );
+	CHECK( sqlite3_step( s ) == SQLITE_ROW );
+	CHECK( sqlite3_column_type( s, 0 ) == SQLITE_NULL &&
+		sqlite3_column_type( s, 1 ) == SQLITE_NULL );
+	sqlite3_finalize( s );
+	CHECK( count( db, "SELECT count( serial_number ) FROM vpd_components;" ) ==
+		(int)ids.size( ) - 1 );
+	sqlite3_close( db );
+	return 0;
+}
@@ -0,0 +1,342 @@
+/***************************************************************************
+ *   Copyright (C) 2006, IBM                                               *
+ *                                                                         *
+ *   Maintained By:                                                        *
+ *   Eric Munson and Brad Peters                                           *
+ *   munsone@us.ibm.com, bpeters@us.ibm.com                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the Lesser GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of the  *
+ *   License, or at your option) any later version.                        *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Lesser General Public License for more details.                   *
+ *                                                                         *
+ *   You should have received a copy of the Lesser GNU General Public      *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#ifndef LIBVPDTESTUTIL_HPP
+#define LIBVPDTESTUTIL_HPP
+
+#include <libvpd-2/component.hpp>
+#include <libvpd-2/system.hpp>
+#include <libvpd-2/vpddbenv.hpp>
+#include <libvpd-2/vpdexception.hpp>
+
+#include <sqlite3.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/*
+ * What the tests and benchmarks share: a CHECK that is not compiled out
+ * with NDEBUG, a scratch directory, and a stand in for the Gatherer of
+ * lsvpd, which the libraries name as a friend, to fill in Components the
+ * way the collectors do.
+ *
+ * This header is private to the tests and is not installed.
+ */
+
+#define CHECK( cond )							\
+	do {								\
+		if( !( cond ) )						\
+		{							\
+			fprintf( stderr, "%s:%d: CHECK( %s ) failed\n",	\
+				__FILE__, __LINE__, #cond );		\
+			exit( 1 );					\
+		}							\
+	} while( 0 )
+
+using namespace std;
+
+namespace lsvpd
+{
+	class Gatherer
+	{
+		public:
+			static void set( DataItem& d, const string& value )
+			{
+				d.prefLevelUsed = 0;
+				d.setValue( value, 1, __FILE__, __LINE__ );
+			}
+
+			/*
+			 * A Component as a collector would fill it in, with the
+			 * fields and lists that differ from one n to the next.
+			 */
+			static Component* make( const string& id, const string& parent,
+						int n )
+			{
+				Component* c = new Component( );
+				set( c->idNode, id );
+				set( c->mParent, parent );
+				set( c->sysFsNode, id );
+				set( c->devBus, n % 2 == 0 ? "pci" : "scsi" );
+				set( c->mSerialNumber, "SER" + to_string( 100000 + n ) );
+				set( c->mPartNumber, "PN" + to_string( n % 50 ) );
+				set( c->mFirmwareLevel, to_string( n % 7 ) + "." +
+					to_string( n % 13 ) + ".1" );
+				set( c->mDescription, "Test device " + to_string( n ) );
+				set( c->mPhysicalLocation, "U78D2.001.WZS0ABC-P1-C" +
+					to_string( n % 9 ) + "-T" + to_string( n % 4 ) );
+				c->addDeviceSpecific( "Z0", "Device Specific",
+					"zval" + to_string( n % 10 ), 50 );
+				c->addDeviceSpecific( "ML", "Microcode Level",
+					"FW" + to_string( n % 11 ) + ".2", 50 );
+				c->addUserData( "UD", "User data", "u" + to_string( n ), 50,
+					false );
+				c->addAIXName( "hdisk" + to_string( n ), 50 );
+				c->devMajor = n;
+				c->devMinor = n * 2;
+				return c;
+			}
+
+			static System* makeSystem( )
+			{
+				System* s = new System( );
+				set( s->mSerialNum1, "SYS123" );
+				set( s->mLocationCode, "U78D2.001.WZS0ABC" );
+				set( s->mMachineType, "9009-42A" );
+				return s;
+			}
+
+			static void addChild( System* s, const string& id )
+				{ s->addChild( id ); }
+			static void addChild( Component* c, const string& id )
+				{ c->addChild( id ); }
+			static void setSerial( Component* c, const string& value )
+				{ set( c->mSerialNumber, value ); }
+			static void setLocation( Component* c, const string& physical,
+				const string& second )
+			{
+				set( c->mPhysicalLocation, physical );
+				set( c->mSecondLocation, second );
+			}
+			static void setFRU( Component* c, const string& value )
+				{ set( c->mFRU, value ); }
+			static void setBusAddr( Component* c, const string& value )
+				{ set( c->devBusAddr, value ); }
+			static void setFirmware( Component* c, const string& level,
+				const string& version )
+			{
+				set( c->mFirmwareLevel, level );
+				set( c->mFirmwareVersion, version );
+			}
+			static void setValue( DataItem& d, const string& value )
+				{ d.setValue( value, d.prefLevelUsed + 1, __FILE__, __LINE__ ); }
+
+			// The list mutators that only the collectors may call.
+			static void addDeviceSpecific( Component* c, const string& ac,
+				const string& value )
+				{ c->addDeviceSpecific( ac, "Device Specific", value, 50 ); }
+			static void updateDeviceSpecific( Component* c,
+				const string& ac, const string& value, int lvl )
+				{ c->updateDeviceSpecific( ac, "Device Specific", value, lvl ); }
+			static void addUserData( Component* c, const string& ac,
+				const string& value, bool clobber )
+				{ c->addUserData( ac, "User data", value, 50, clobber ); }
+			static void addAIXName( Component* c, const string& value )
+				{ c->addAIXName( value, 50 ); }
+			static bool isChild( Component* c, const string& id )
+				{ return c->isChild( id ); }
+	};
+}
+
+namespace vpdtest
+{
+	using namespace lsvpd;
+
+	/*
+	 * A directory of its own for each test, removed with everything in
+	 * it when the test is done.
+	 */
+	class TempDir
+	{
+		public:
+			string path;
+
+			TempDir( )
+			{
+				const char* base = getenv( "TMPDIR" );
+				string templ = string( base ? base : "/tmp" ) +
+					"/libvpd-test.XXXXXX";
+				vector<char> buf( templ.begin( ), templ.end( ) );
+				buf.push_back( '\0' );
+				CHECK( mkdtemp( &buf[ 0 ] ) != NULL );
+				path = &buf[ 0 ];
+			}
+
+			~TempDir( )
+			{
+				string cmd = "rm -rf '" + path + "'";
+				if( system( cmd.c_str( ) ) != 0 )
+					fprintf( stderr, "could not remove %s\n", path.c_str( ) );
+			}
+	};
+
+	/*
+	 * Stores a System with fanout children, each with fanout children of
+	 * its own down to depth levels, and returns the IDs of the Components
+	 * in the order they were stored, parents first.
+	 */
+	inline vector<string> buildTree( VpdDbEnv& db, int fanout, int depth )
+	{
+		vector<string> ids;
+		vector<Component*> level, next;
+		System* sys = Gatherer::makeSystem( );
+		int n = 0;
+
+		for( int i = 0; i < fanout; i++ )
+		{
+			string id = "/sys/devices/n" + to_string( i );
+			Gatherer::addChild( sys, id );
+			level.push_back( Gatherer::make( id, System::ID, n++ ) );
+		}
+		CHECK( db.store( sys ) );
+		delete sys;
+
+		for( int d = 1; !level.empty( ); d++ )
+		{
+			for( size_t i = 0; i < level.size( ); i++ )
+			{
+				Component* c = level[ i ];
+				for( int k = 0; d < depth && k < fanout; k++ )
+				{
+					string id = c->getID( ) + "/c" + to_string( k );
+					Gatherer::addChild( c, id );
+					next.push_back( Gatherer::make( id, c->getID( ), n++ ) );
+				}
+				CHECK( db.store( c ) );
+				ids.push_back( c->getID( ) );
+				delete c;
+			}
+			level.swap( next );
+			next.clear( );
+		}
+		return ids;
+	}
+
+	/*
+	 * The packed form of c, to compare two Components whole.
+	 */
+	inline string packed( Component& c )
+	{
+		void* buf = NULL;
+		unsigned int len = c.pack( &buf );
+		string ret( (const char*)buf, len );
+		delete[] (char*)buf;
+		return ret;
+	}
+
+	/*
+	 * Copies a database file, to start two databases out the same.
+	 */
+	inline void copyFile( const string& from, const string& to )
+	{
+		ifstream in( from.c_str( ), ios::binary );
+		ofstream out( to.c_str( ), ios::binary );
+		CHECK( in && out );
+		out << in.rdbuf( );
+		CHECK( out );
+	}
+
+	/*
+	 * Runs sql on the database file behind the library's back, the way
+	 * another process would.
+	 */
+	inline void execute( const string& path, const string& sql )
+	{
+		sqlite3* db = NULL;
+		CHECK( sqlite3_open( path.c_str( ), &db ) == SQLITE_OK );
+		CHECK( sqlite3_exec( db, sql.c_str( ), NULL, NULL, NULL ) == SQLITE_OK );
+		sqlite3_close( db );
+	}
+
+	/*
+	 * The first column of the first row sql returns from the database file,
+	 * as text, "<NULL>" for NULL.
+	 */
+	inline string query( const string& path, const string& sql )
+	{
+		sqlite3* db = NULL;
+		sqlite3_stmt* s = NULL;
+		string ret;
+
+		CHECK( sqlite3_open( path.c_str( ), &db ) == SQLITE_OK );
+		CHECK( sqlite3_prepare_v2( db, sql.c_str( ), -1, &s, NULL ) ==
+			SQLITE_OK );
+		CHECK( sqlite3_step( s ) == SQLITE_ROW );
+		const unsigned char* text = sqlite3_column_text( s, 0 );
+		ret = text ? string( (const char*)text ) : string( "<NULL>" );
+		sqlite3_finalize( s );
+		sqlite3_close( db );
+		return ret;
+	}
+
+	inline long long queryInt( const string& path, const string& sql )
+	{
+		return atoll( query( path, sql ).c_str( ) );
+	}
+
+	/*
+	 * Cuts the stored row of id short, so that unpacking it fails.
+	 */
+	inline void corrupt( const string& path, const string& id )
+	{
+		execute( path, "UPDATE " + VpdDbEnv::TABLE_NAME + " SET " +
+			VpdDbEnv::DATA + " = substr( " + VpdDbEnv::DATA + ", 1, 24 ) "
+			"WHERE " + VpdDbEnv::ID + " = '" + id + "';" );
+	}
+
+	/*
+	 * Deletes the stored row of id, leaving its parent naming it.
+	 */
+	inline void dropRow( const string& path, const string& id )
+	{
+		execute( path, "DELETE FROM " + VpdDbEnv::TABLE_NAME + " WHERE " +
+			VpdDbEnv::ID + " = '" + id + "';" );
+	}
+
+	/*
+	 * The number of calls to operator new so far, for the programs linked
+	 * with tests/allocations.cpp.
+	 */
+	long newCalls( );
+
+	/*
+	 * The bytes asked of operator new so far, likewise.
+	 */
+	long newBytes( );
+
+	/*
+	 * The fastest of runs timings of body, in nanoseconds per call.
+	 */
+	template<typename Body>
+	double bestOf( int runs, int calls, Body body )
+	{
+		double best = 0;
+		for( int r = 0; r < runs; r++ )
+		{
+			chrono::steady_clock::time_point start =
+				chrono::steady_clock::now( );
+			for( int i = 0; i < calls; i++ )
+				body( );
+			double ns = chrono::duration<double, nano>(
+				chrono::steady_clock::now( ) - start ).count( ) / calls;
+			if( r == 0 || ns < best )
+				best = ns;
+		}
+		return best;
+	}
+}
+
+#endif /*LIBVPDTESTUTIL_HPP*/
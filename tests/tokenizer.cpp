@@ -0,0 +1,163 @@
+/***************************************************************************
+ *   Copyright (C) 2006, IBM                                               *
+ *                                                                         *
+ *   Maintained By:                                                        *
+ *   Eric Munson and Brad Peters                                           *
+ *   munsone@us.ibm.com, bpeters@us.ibm.com                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the Lesser GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of the  *
+ *   License, or at your option) any later version.                        *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Lesser General Public License for more details.                   *
+ *                                                                         *
+ *   You should have received a copy of the Lesser GNU General Public      *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+ * The tokenizer the decoders of both libraries share, against a plain
+ * byte by byte split, and both decoders on packed Components that are
+ * intact, cut short or have their terminators overwritten.
+ */
+
+#include "testutil.hpp"
+
+#include "tokenizer.h"
+
+extern "C" {
+#include <libvpd-2/component.h>
+}
+
+#include <arpa/inet.h>
+
+using namespace vpdtest;
+
+static vector<vpdtoken> reference( const string& buf )
+{
+	vector<vpdtoken> ret;
+	vpdtoken tok;
+	size_t start = 0;
+
+	for( size_t i = 0; i < buf.length( ); i++ )
+	{
+		if( buf[ i ] != '\0' )
+			continue;
+		tok.offset = start;
+		tok.length = i - start;
+		ret.push_back( tok );
+		start = i + 1;
+	}
+	return ret;
+}
+
+static void checkTokens( const string& buf )
+{
+	vector<vpdtoken> want = reference( buf );
+	vpdtoken stack[ 4 ];
+	vpdtoken* got;
+	int count = -1;
+
+	// Too few slots: the full count comes back and only max are filled.
+	vector<vpdtoken> few( 2 );
+	CHECK( tokenize_fields( buf.data( ), buf.length( ), &few[ 0 ], 2 ) ==
+		(int)want.size( ) );
+
+	got = tokenize( buf.data( ), buf.length( ), stack, 4, &count );
+	CHECK( got != NULL && count == (int)want.size( ) );
+	CHECK( ( got == stack ) == ( want.size( ) <= 4 ) );
+	for( size_t i = 0; i < want.size( ); i++ )
+	{
+		CHECK( got[ i ].offset == want[ i ].offset );
+		CHECK( got[ i ].length == want[ i ].length );
+		if( i < 2 )
+			CHECK( few[ i ].offset == want[ i ].offset &&
+				few[ i ].length == want[ i ].length );
+	}
+	if( got != stack )
+		free( got );
+}
+
+/*
+ * Both decoders on blob, which may be corrupt: they must fail cleanly or
+ * agree on what they decoded.
+ */
+static void decode( string blob )
+{
+	string cxxID;
+	bool cxxOK = true;
+
+	try {
+		Component c( blob.data( ) );
+		cxxID = c.getID( );
+	}
+	catch( VpdException& ) {
+		cxxOK = false;
+	}
+
+	struct component* c = unpack_component( &blob[ 0 ] );
+	CHECK( ( c != NULL ) == cxxOK );
+	if( c != NULL )
+	{
+		CHECK( c->id && cxxID == c->id->dataValue );
+		free_component( c );
+	}
+}
+
+static void setSize( string& blob, u32 size )
+{
+	u32 netOrder = htonl( size );
+	memcpy( &blob[ 0 ], &netOrder, sizeof( netOrder ) );
+}
+
+int main( )
+{
+	srand( 1 );
+
+	// Every length around the 16 byte steps, with few and many '\0'.
+	for( size_t len = 0; len < 100; len++ )
+		for( int density = 1; density <= 16; density *= 4 )
+		{
+			string buf( len, 'a' );
+			for( size_t i = 0; i < len; i++ )
+				if( rand( ) % density == 0 )
+					buf[ i ] = '\0';
+			checkTokens( buf );
+		}
+	checkTokens( string( 1000, '\0' ) );
+	checkTokens( string( 1000, 'x' ) );
+
+	Component* c = Gatherer::make( "/sys/devices/test", System::ID, 7 );
+	for( int i = 0; i < 300; i++ )
+		Gatherer::addChild( c, "/sys/devices/test/c" + to_string( i ) );
+	string blob = packed( *c );
+	delete c;
+
+	// Intact, then through every shorter size.
+	Component round( blob.data( ) );
+	CHECK( packed( round ) == blob );
+	decode( blob );
+	for( u32 size = 0; size < blob.length( ); size++ )
+	{
+		string cut( blob );
+		setSize( cut, size );
+		decode( cut );
+	}
+
+	// Every terminator overwritten in turn.
+	for( size_t i = sizeof( u32 ); i < blob.length( ); i++ )
+	{
+		if( blob[ i ] != '\0' )
+			continue;
+		string bad( blob );
+		bad[ i ] = 'x';
+		decode( bad );
+	}
+	return 0;
+}
@@ -0,0 +1,200 @@
+/***************************************************************************
+ *   Copyright (C) 2006, IBM                                               *
+ *                                                                         *
+ *   Maintained By:                                                        *
+ *   Eric Munson and Brad Peters                                           *
+ *   munsone@us.ibm.com, bpeters@us.ibm.com                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the Lesser GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of the  *
+ *   License, or at your option) any later version.                        *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Lesser General Public License for more details.                   *
+ *                                                                         *
+ *   You should have received a copy of the Lesser GNU General Public      *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+ * VpdRetriever::traverse against a walk over the loaded tree: the order
+ * depth and breadth first, the depth and parent of each Component, STOP
+ * and SKIP_CHILDREN, over a tree with a chain hundreds of levels deep
+ * hanging off it.
+ */
+
+#include "testutil.hpp"
+
+#include <libvpd-2/vpdretriever.hpp>
+#include <libvpd-2/componentvisitor.hpp>
+
+#include <deque>
+#include <set>
+
+using namespace vpdtest;
+
+static const int CHAIN = 300;
+
+static string visit( const string& id, const string& parentID,
+	unsigned int depth )
+{
+	return id + "|" + parentID + "|" + to_string( depth );
+}
+
+class Recorder : public ComponentVisitor
+{
+	public:
+		vector<string> visits;
+		size_t stopAfter;
+		set<string> skip;
+		Component::FieldMask loaded;
+
+		Recorder( ) : stopAfter( 0 ), loaded( Component::ALL_FIELDS ) { }
+
+		virtual Action visit( const Component& c, const string& parentID,
+			unsigned int depth )
+		{
+			CHECK( c.getLoadedFields( ) == loaded );
+			visits.push_back( ::visit( c.getID( ), parentID, depth ) );
+			if( visits.size( ) == stopAfter )
+				return STOP;
+			return skip.count( c.getID( ) ) ? SKIP_CHILDREN : CONTINUE;
+		}
+};
+
+/*
+ * Preorder, leaving out what is below the IDs in skip.
+ */
+static void depthFirst( const vector<Component*>& leaves,
+	const string& parentID, unsigned int depth, const set<string>& skip,
+	vector<string>& out )
+{
+	for( size_t i = 0; i < leaves.size( ); i++ )
+	{
+		out.push_back( visit( leaves[ i ]->getID( ), parentID, depth ) );
+		if( !skip.count( leaves[ i ]->getID( ) ) )
+			depthFirst( leaves[ i ]->getLeaves( ), leaves[ i ]->getID( ),
+				depth + 1, skip, out );
+	}
+}
+
+static vector<string> breadthFirst( System* sys )
+{
+	vector<string> ret;
+	deque<pair<Component*, unsigned int> > queue;
+	const vector<Component*>& top = sys->getLeaves( );
+
+	for( size_t i = 0; i < top.size( ); i++ )
+		queue.push_back( make_pair( top[ i ], 1u ) );
+	while( !queue.empty( ) )
+	{
+		Component* c = queue.front( ).first;
+		unsigned int depth = queue.front( ).second;
+		queue.pop_front( );
+		ret.push_back( visit( c->getID( ), depth == 1 ? System::ID :
+			c->getParent( ), depth ) );
+		for( size_t i = 0; i < c->getLeaves( ).size( ); i++ )
+			queue.push_back( make_pair( c->getLeaves( )[ i ], depth + 1 ) );
+	}
+	return ret;
+}
+
+int main( )
+{
+	TempDir dir;
+	vector<string> ids;
+
+	{
+		VpdDbEnv db( dir.path, "vpd.db", false );
+		ids = buildTree( db, 3, 3 );
+
+		// A chain below ids[ 0 ], one Component on each level.
+		Component* top = db.fetch( ids[ 0 ] );
+		Gatherer::addChild( top, ids[ 0 ] + "/chain0" );
+		CHECK( db.upsert( top ) );
+		delete top;
+		for( int i = 0; i < CHAIN; i++ )
+		{
+			string id = ids[ 0 ] + "/chain" + to_string( i );
+			Component* c = Gatherer::make( id, i == 0 ? ids[ 0 ] :
+				ids[ 0 ] + "/chain" + to_string( i - 1 ), 1000 + i );
+			if( i + 1 < CHAIN )
+				Gatherer::addChild( c, ids[ 0 ] + "/chain" + to_string( i + 1 ) );
+			CHECK( db.store( c ) );
+			delete c;
+		}
+	}
+
+	VpdRetriever r( dir.path, "vpd.db" );
+	System* sys = r.getComponentTree( );
+	vector<string> dfs, bfs = breadthFirst( sys );
+	depthFirst( sys->getLeaves( ), System::ID, 1, set<string>( ), dfs );
+	CHECK( dfs.size( ) == ids.size( ) + CHAIN );
+	CHECK( bfs.size( ) == dfs.size( ) );
+	CHECK( dfs.back( ) != bfs.back( ) );
+	CHECK( bfs.back( ) == visit( ids[ 0 ] + "/chain" + to_string( CHAIN - 1 ),
+		ids[ 0 ] + "/chain" + to_string( CHAIN - 2 ), CHAIN + 1 ) );
+
+	{
+		Recorder v;
+		CHECK( r.traverse( v ) );
+		CHECK( v.visits == dfs );
+	}
+	{
+		Recorder v;
+		CHECK( r.traverse( v, ComponentVisitor::BREADTH_FIRST ) );
+		CHECK( v.visits == bfs );
+	}
+
+	// STOP ends the traversal right there, in either order.
+	{
+		Recorder v;
+		v.stopAfter = 50;
+		CHECK( !r.traverse( v ) );
+		CHECK( v.visits == vector<string>( dfs.begin( ), dfs.begin( ) + 50 ) );
+	}
+	{
+		Recorder v;
+		v.stopAfter = 1;
+		CHECK( !r.traverse( v, ComponentVisitor::BREADTH_FIRST ) );
+		CHECK( v.visits.size( ) == 1 && v.visits[ 0 ] == bfs[ 0 ] );
+	}
+
+	// SKIP_CHILDREN leaves out the subtree, halfway down the chain and at
+	// the top of it.
+	{
+		Recorder v;
+		v.skip.insert( ids[ 0 ] + "/chain" + to_string( CHAIN / 2 ) );
+		v.skip.insert( ids[ 5 ] );
+		vector<string> want;
+		depthFirst( sys->getLeaves( ), System::ID, 1, v.skip, want );
+		CHECK( want.size( ) == dfs.size( ) - ( CHAIN / 2 - 1 ) - 3 );
+		CHECK( r.traverse( v ) );
+		CHECK( v.visits == want );
+	}
+	{
+		Recorder v;
+		v.skip.insert( ids[ 0 ] );
+		CHECK( r.traverse( v, ComponentVisitor::BREADTH_FIRST ) );
+		CHECK( v.visits.size( ) == dfs.size( ) - 3 - 9 - CHAIN );
+	}
+
+	// Only the fields asked for are decoded, the ID and children always.
+	{
+		Recorder v;
+		Component::FieldMask fields =
+			Component::fieldMask( Component::FIELD_SERIAL_NUMBER );
+		v.loaded = fields | Component::fieldMask( Component::FIELD_ID ) |
+			Component::fieldMask( Component::FIELD_CHILDREN );
+		CHECK( r.traverse( v, ComponentVisitor::BREADTH_FIRST, fields ) );
+		CHECK( v.visits == bfs );
+	}
+
+	delete sys;
+	return 0;
+}
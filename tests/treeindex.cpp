@@ -0,0 +1,313 @@
+/***************************************************************************
+ *   Copyright (C) 2006, IBM                                               *
+ *                                                                         *
+ *   Maintained By:                                                        *
+ *   Eric Munson and Brad Peters                                           *
+ *   munsone@us.ibm.com, bpeters@us.ibm.com                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the Lesser GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of the  *
+ *   License, or at your option) any later version.                        *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Lesser General Public License for more details.                   *
+ *                                                                         *
+ *   You should have received a copy of the Lesser GNU General Public      *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+ * TreeIndex and LocationTrie over a loaded tree, against a walk over the
+ * leaves that collects the same keys: every lookup, the parent pointers,
+ * prefixes cut in the middle of a segment, second locations and the
+ * nearest Component above a location with and without a filter.
+ */
+
+#include "testutil.hpp"
+
+#include <libvpd-2/vpdretriever.hpp>
+#include <libvpd-2/treeindex.hpp>
+#include <libvpd-2/locationtrie.hpp>
+#include <libvpd-2/componentfilter.hpp>
+
+#include <algorithm>
+#include <map>
+
+using namespace vpdtest;
+
+typedef vector<Component*> Matches;
+
+struct Walked
+{
+	Component* comp;
+	Component* parent;
+};
+
+static void walk( const vector<Component*>& leaves, Component* parent,
+	vector<Walked>& out )
+{
+	for( size_t i = 0; i < leaves.size( ); i++ )
+	{
+		out.push_back( Walked{ leaves[ i ], parent } );
+		walk( leaves[ i ]->getLeaves( ), leaves[ i ], out );
+	}
+}
+
+static vector<string> segments( const string& loc )
+{
+	vector<string> ret;
+	size_t start = 0, pos;
+	do
+	{
+		pos = loc.find( LocationTrie::SEPARATOR, start );
+		ret.push_back( loc.substr( start, pos - start ) );
+		start = pos + 1;
+	} while( pos != string::npos );
+	return ret;
+}
+
+/*
+ * Every location a Component is filed under, in tree order.
+ */
+struct Filed
+{
+	vector<string> loc;
+	Component* comp;
+
+	bool operator<( const Filed& rhs ) const { return loc < rhs.loc; }
+};
+
+/*
+ * The Components filed where match says, in location code order, each
+ * once.
+ */
+template<class Pred>
+static Matches expect( const vector<Filed>& filed, Pred match )
+{
+	vector<Filed> hits;
+	Matches ret;
+
+	for( size_t i = 0; i < filed.size( ); i++ )
+		if( match( filed[ i ].loc ) )
+			hits.push_back( filed[ i ] );
+	stable_sort( hits.begin( ), hits.end( ) );
+	for( size_t i = 0; i < hits.size( ); i++ )
+		if( find( ret.begin( ), ret.end( ), hits[ i ].comp ) == ret.end( ) )
+			ret.push_back( hits[ i ].comp );
+	return ret;
+}
+
+static Matches within( const vector<Filed>& filed, const string& loc )
+{
+	vector<string> want = segments( loc );
+	return expect( filed, [ & ]( const vector<string>& l ) {
+		return l.size( ) >= want.size( ) &&
+			equal( want.begin( ), want.end( ), l.begin( ) );
+	} );
+}
+
+static Matches byPrefix( const vector<Filed>& filed, const string& prefix )
+{
+	vector<string> want = segments( prefix );
+	return expect( filed, [ & ]( const vector<string>& l ) {
+		return l.size( ) >= want.size( ) &&
+			equal( want.begin( ), want.end( ) - 1, l.begin( ) ) &&
+			l[ want.size( ) - 1 ].compare( 0, want.back( ).length( ),
+				want.back( ) ) == 0;
+	} );
+}
+
+static Component* nearest( const vector<Filed>& filed, const string& loc,
+	const ComponentFilter* filter )
+{
+	vector<string> want = segments( loc );
+	for( size_t n = want.size( ) - 1; n > 0; n-- )
+	{
+		for( size_t i = 0; i < filed.size( ); i++ )
+		{
+			const vector<string>& l = filed[ i ].loc;
+			if( l.size( ) == n && equal( l.begin( ), l.end( ), want.begin( ) ) &&
+				( filter == NULL || filter->matches( *filed[ i ].comp ) ) )
+				return filed[ i ].comp;
+		}
+	}
+	return NULL;
+}
+
+int main( )
+{
+	TempDir dir;
+	vector<string> ids;
+
+	{
+		VpdDbEnv db( dir.path, "vpd.db", false );
+		ids = buildTree( db, 4, 3 );
+	}
+	VpdRetriever r( dir.path, "vpd.db" );
+	System* sys = r.getComponentTree( );
+	vector<Walked> all;
+	walk( sys->getLeaves( ), NULL, all );
+	CHECK( all.size( ) == ids.size( ) );
+
+	// Keys shared between Components, and bus addresses left empty.
+	for( size_t i = 0; i < all.size( ); i++ )
+	{
+		Component* c = all[ i ].comp;
+		Gatherer::setBusAddr( c, i % 10 == 0 ? "" : "0000:0" +
+			to_string( i % 5 ) );
+		if( i % 7 == 0 )
+			Gatherer::setSerial( c, "SHARED" );
+	}
+
+	{
+		TreeIndex index( sys );
+		map<string, Matches> bus, serial, location;
+		map<pair<int, int>, Matches> device;
+		size_t sysfs = 0;
+
+		CHECK( index.size( ) == all.size( ) );
+		for( size_t i = 0; i < all.size( ); i++ )
+		{
+			Component* c = all[ i ].comp;
+			CHECK( c->getParentComponent( ) == all[ i ].parent );
+			CHECK( index.findByID( c->getID( ) ) == c );
+			if( !c->getSysFsNode( ).empty( ) )
+			{
+				CHECK( index.findBySysFsNode( c->getSysFsNode( ) ) == c );
+				sysfs++;
+			}
+			if( !c->getDevBusAddr( ).empty( ) )
+				bus[ c->getDevBusAddr( ) ].push_back( c );
+			if( !c->getSerialNumber( ).empty( ) )
+				serial[ c->getSerialNumber( ) ].push_back( c );
+			if( !c->getPhysicalLocation( ).empty( ) )
+				location[ c->getPhysicalLocation( ) ].push_back( c );
+			if( c->getMajor( ) != 0 || c->getMinor( ) != 0 )
+				device[ make_pair( c->getMajor( ), c->getMinor( ) ) ]
+					.push_back( c );
+		}
+		CHECK( sysfs == all.size( ) );
+		CHECK( bus.size( ) == 5 && serial[ "SHARED" ].size( ) > 1 );
+		for( map<string, Matches>::iterator i = bus.begin( ); i != bus.end( );
+			++i )
+			CHECK( index.findByDevBusAddr( i->first ) == i->second );
+		for( map<string, Matches>::iterator i = serial.begin( );
+			i != serial.end( ); ++i )
+			CHECK( index.findBySerialNumber( i->first ) == i->second );
+		for( map<string, Matches>::iterator i = location.begin( );
+			i != location.end( ); ++i )
+			CHECK( index.findByLocation( i->first ) == i->second );
+		for( map<pair<int, int>, Matches>::iterator i = device.begin( );
+			i != device.end( ); ++i )
+			CHECK( index.findByDevice( i->first.first, i->first.second ) ==
+				i->second );
+
+		// Empty keys and 0:0 are not indexed.
+		CHECK( index.findByID( "" ) == NULL );
+		CHECK( index.findByID( "/sys/devices/none" ) == NULL );
+		CHECK( index.findBySerialNumber( "" ).empty( ) );
+		CHECK( index.findByDevBusAddr( "" ).empty( ) );
+		CHECK( index.findByDevice( 0, 0 ).empty( ) );
+		CHECK( all[ 0 ].comp->getMajor( ) == 0 );
+	}
+
+	// Locations that nest the way the tree does: the four top Components
+	// are cards in C1, C10, C12 and C2, with ports T0 to T3 on them and
+	// devices L0 to L3 on those.  The cards have a FRU number.
+	const char* const cards[ ] = { "C1", "C10", "C12", "C2" };
+	for( size_t i = 0; i < all.size( ); i++ )
+	{
+		Component* c = all[ i ].comp;
+		Component* p = all[ i ].parent;
+		string loc;
+		if( p == NULL )
+		{
+			loc = string( "U78D2.001.WZS0ABC-P1-" ) + cards[ c->getID( )[ 14 ] -
+				'0' ];
+			Gatherer::setFRU( c, "FRU" + loc.substr( 21 ) );
+		}
+		else
+			loc = p->getPhysicalLocation( ) +
+				( count( c->getID( ).begin( ), c->getID( ).end( ), '/' ) == 4 ?
+				"-T" : "-L" ) + c->getID( ).substr( c->getID( ).length( ) - 1 );
+		Gatherer::setLocation( c, loc, "" );
+	}
+	// A second location nothing else is at, one that is the same as the
+	// physical one and one in another card's subtree.
+	Gatherer::setLocation( all[ 2 ].comp, all[ 2 ].comp->getPhysicalLocation( ),
+		"U78D2.001.WZS0ABC-P1-C10-T9" );
+	Gatherer::setLocation( all[ 3 ].comp, all[ 3 ].comp->getPhysicalLocation( ),
+		all[ 3 ].comp->getPhysicalLocation( ) );
+	Gatherer::setLocation( all[ 4 ].comp, all[ 4 ].comp->getPhysicalLocation( ),
+		"U78D2.001.WZS0ABC-P1-C12-T0-L7" );
+
+	{
+		LocationTrie trie( sys );
+		vector<Filed> filed;
+
+		for( size_t i = 0; i < all.size( ); i++ )
+		{
+			Component* c = all[ i ].comp;
+			if( !c->getPhysicalLocation( ).empty( ) )
+				filed.push_back( Filed{ segments( c->getPhysicalLocation( ) ),
+					c } );
+			if( !c->getSecondLocation( ).empty( ) &&
+				c->getSecondLocation( ) != c->getPhysicalLocation( ) )
+				filed.push_back( Filed{ segments( c->getSecondLocation( ) ),
+					c } );
+		}
+		CHECK( trie.size( ) == filed.size( ) );
+		CHECK( trie.size( ) == all.size( ) + 2 );
+
+		const string U = "U78D2.001.WZS0ABC";
+		const string prefixes[ ] = { U, U + "-P", U + "-P1-C", U + "-P1-C1",
+			U + "-P1-C10", U + "-P1-C10-T", U + "-P1-C10-T9", U + "-P1-C12-T0-",
+			U + "-P1-C3", "U78", "X", "" };
+		for( size_t i = 0; i < sizeof( prefixes ) / sizeof( prefixes[ 0 ] );
+			i++ )
+		{
+			CHECK( trie.findByPrefix( prefixes[ i ] ) ==
+				byPrefix( filed, prefixes[ i ] ) );
+			CHECK( trie.findWithin( prefixes[ i ] ) ==
+				within( filed, prefixes[ i ] ) );
+		}
+		// C1 cut mid-segment takes in C10 and C12, findWithin does not.
+		// all[ 2 ] and all[ 4 ] are only reported once.
+		CHECK( trie.findByPrefix( U + "-P1-C1" ).size( ) == 3 * 21 );
+		CHECK( trie.findWithin( U + "-P1-C1" ).size( ) == 21 );
+		CHECK( trie.findByPrefix( U ).size( ) == all.size( ) );
+		// all[ 2 ] is also at C10-T9, where nothing else is.
+		CHECK( trie.findExact( U + "-P1-C10-T9" ) ==
+			Matches( 1, all[ 2 ].comp ) );
+		CHECK( trie.findWithin( U + "-P1-C10" ).size( ) == 21 + 1 );
+		CHECK( trie.findExact( all[ 3 ].comp->getPhysicalLocation( ) ) ==
+			Matches( 1, all[ 3 ].comp ) );
+		CHECK( trie.findExact( U + "-P1-C3" ).empty( ) );
+
+		FieldFilter fru( Component::FIELD_FRU );
+		const string near[ ] = { U + "-P1-C10-T2-L1", U + "-P1-C10-T2-L9",
+			U + "-P1-C10-T2", U + "-P1-C10", U + "-P1-C10-T9-L1",
+			U + "-P1-C12-T0-L7", U + "-P1-C3-T1", U, "X-Y" };
+		for( size_t i = 0; i < sizeof( near ) / sizeof( near[ 0 ] ); i++ )
+		{
+			CHECK( trie.findNearest( near[ i ] ) ==
+				nearest( filed, near[ i ], NULL ) );
+			CHECK( trie.findNearest( near[ i ], &fru ) ==
+				nearest( filed, near[ i ], &fru ) );
+		}
+		Component* port = trie.findNearest( U + "-P1-C10-T2-L9" );
+		CHECK( port != NULL && port->getPhysicalLocation( ) ==
+			U + "-P1-C10-T2" );
+		Component* card = trie.findNearest( U + "-P1-C10-T2-L9", &fru );
+		CHECK( card != NULL && card->getFRU( ) == "FRUC10" );
+		CHECK( trie.findNearest( U + "-P1-C10" ) == NULL );
+	}
+
+	delete sys;
+	return 0;
+}
@@ -0,0 +1,144 @@
+/***************************************************************************
+ *   Copyright (C) 2006, IBM                                               *
+ *                                                                         *
+ *   Maintained By:                                                        *
+ *   Eric Munson and Brad Peters                                           *
+ *   munsone@us.ibm.com, bpeters@us.ibm.com                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the Lesser GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of the  *
+ *   License, or at your option) any later version.                        *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Lesser General Public License for more details.                   *
+ *                                                                         *
+ *   You should have received a copy of the Lesser GNU General Public      *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+ * The C tree built on the heap and in an arena, and the C++ tree, hold
+ * the same Components, and a child that cannot be loaded fails the whole
+ * tree without leaking the part already built.
+ */
+
+#include "testutil.hpp"
+
+#include <libvpd-2/vpdretriever.hpp>
+
+extern "C" {
+#include <libvpd-2/component.h>
+#include <libvpd-2/system.h>
+#include <libvpd-2/vpdretriever.h>
+}
+
+#include <algorithm>
+
+using namespace vpdtest;
+
+static string describe( const struct component* c )
+{
+	string ret = string( c->id->dataValue ) + "|" +
+		c->serialNumber->dataValue + "|" + c->physicalLocation->dataValue;
+	for( struct dataitem* d = c->deviceSpecific; d; d = d->next )
+		ret += string( "|" ) + d->ac + "=" + d->dataValue;
+	return ret;
+}
+
+static string describe( const Component* c )
+{
+	string ret = c->getID( ) + "|" + c->getSerialNumber( ) + "|" +
+		c->getPhysicalLocation( );
+	for( size_t i = 0; i < c->getDeviceSpecific( ).size( ); i++ )
+		ret += "|" + c->getDeviceSpecific( )[ i ]->getAC( ) + "=" +
+			c->getDeviceSpecific( )[ i ]->getValue( );
+	return ret;
+}
+
+static void walk( const struct component* c, vector<string>& out )
+{
+	for( ; c; c = c->next )
+	{
+		out.push_back( describe( c ) );
+		walk( c->children, out );
+	}
+}
+
+static void walk( const vector<Component*>& leaves, vector<string>& out )
+{
+	for( size_t i = 0; i < leaves.size( ); i++ )
+	{
+		out.push_back( describe( leaves[ i ] ) );
+		walk( leaves[ i ]->getLeaves( ), out );
+	}
+}
+
+int main( )
+{
+	TempDir dir;
+	vector<string> ids, heap, arena, cxx;
+
+	{
+		VpdDbEnv db( dir.path, "vpd.db", false );
+		ids = buildTree( db, 6, 4 );
+	}
+
+	{
+		struct vpdretriever* r = new_vpdretriever( dir.path.c_str( ),
+			"vpd.db" );
+		CHECK( r != NULL );
+
+		struct system* s = get_component_tree( r );
+		CHECK( s != NULL );
+		walk( s->children, heap );
+		free_system( s );
+
+		struct component_tree* t = load_component_tree( r, COMP_ALL_FIELDS );
+		CHECK( t != NULL && t->root != NULL );
+		walk( t->root->children, arena );
+		free_component_tree( t );
+		free_vpdretriever( r );
+	}
+
+	{
+		VpdRetriever r( dir.path, "vpd.db" );
+		System* s = r.getComponentTree( );
+		walk( s->getLeaves( ), cxx );
+		delete s;
+	}
+
+	CHECK( heap.size( ) == ids.size( ) );
+	CHECK( heap == arena );
+	sort( heap.begin( ), heap.end( ) );
+	sort( cxx.begin( ), cxx.end( ) );
+	CHECK( heap == cxx );
+
+	// A child named by its parent but not stored, deep in the tree.
+	dropRow( dir.path + "/vpd.db", ids.back( ) );
+
+	{
+		VpdRetriever r( dir.path, "vpd.db" );
+		bool threw = false;
+		try {
+			delete r.getComponentTree( );
+		}
+		catch( VpdException& ) {
+			threw = true;
+		}
+		CHECK( threw );
+	}
+
+	{
+		struct vpdretriever* r = new_vpdretriever( dir.path.c_str( ),
+			"vpd.db" );
+		CHECK( get_component_tree( r ) == NULL );
+		CHECK( load_component_tree( r, COMP_ALL_FIELDS ) == NULL );
+		free_vpdretriever( r );
+	}
+	return 0;
+}
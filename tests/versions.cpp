@@ -0,0 +1,222 @@
+/***************************************************************************
+ *   Copyright (C) 2006, IBM                                               *
+ *                                                                         *
+ *   Maintained By:                                                        *
+ *   Eric Munson and Brad Peters                                           *
+ *   munsone@us.ibm.com, bpeters@us.ibm.com                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the Lesser GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of the  *
+ *   License, or at your option) any later version.                        *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Lesser General Public License for more details.                   *
+ *                                                                         *
+ *   You should have received a copy of the Lesser GNU General Public      *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+ * HelperFunctions::versionKey orders levels the way the header says, and
+ * findVersionRange finds the same Components as reading every row and
+ * comparing its levels, after upserts, removals and rebuildVersions.
+ */
+
+#include "testutil.hpp"
+
+#include <libvpd-2/helper_functions.hpp>
+
+using namespace vpdtest;
+
+static int sign( int n )
+{
+	return n < 0 ? -1 : n > 0;
+}
+
+/*
+ * Each level is older than the next one, or the same where equal says
+ * so.
+ */
+static void checkOrder( const char* const* levels, size_t count,
+	const bool* equal )
+{
+	for( size_t i = 0; i < count; i++ )
+	{
+		for( size_t j = 0; j < count; j++ )
+		{
+			int want = sign( (int)i - (int)j );
+			for( size_t k = min( i, j ); want != 0 && k < max( i, j ); k++ )
+				if( !equal[ k ] )
+					goto DIFFERENT;
+			want = 0;
+DIFFERENT:
+			CHECK( sign( HelperFunctions::compareVersions( levels[ i ],
+				levels[ j ] ) ) == want );
+		}
+	}
+}
+
+static const char* const POOL[ ] = {
+	"1.0", "1.0.1", "1.0-rc1", "1.0rc2", "1.0a", "1.10", "1.9", "v1.9",
+	"FW860.10 (61)", "FW950.50 (105)", "fw950.50", "2.0beta", "2.0", "10",
+	"9", "100", "--", ""
+};
+static const size_t POOL_SIZE = sizeof( POOL ) / sizeof( POOL[ 0 ] );
+
+static Component* device( const string& id, int n, int shift )
+{
+	Component* c = Gatherer::make( id, System::ID, n );
+	Gatherer::setFirmware( c, POOL[ ( n + shift ) % POOL_SIZE ],
+		POOL[ ( n * 3 + 1 + shift ) % POOL_SIZE ] );
+	Gatherer::updateDeviceSpecific( c, "ML",
+		POOL[ ( n * 5 + 2 + shift ) % POOL_SIZE ], 60 );
+	return c;
+}
+
+static bool inRange( const string& level, const string& from,
+	const string& to )
+{
+	string key = HelperFunctions::versionKey( level );
+	string fromKey = HelperFunctions::versionKey( from );
+	string toKey = HelperFunctions::versionKey( to );
+
+	return !key.empty( ) && ( fromKey.empty( ) || key >= fromKey ) &&
+		( toKey.empty( ) || key < toKey );
+}
+
+/*
+ * findVersionRange against a scan of every row, for every pair of levels
+ * in POOL and each field on its own and all together.
+ */
+static void crossCheck( VpdDbEnv& db )
+{
+	const int masks[ ] = { VpdDbEnv::VERSION_FIRMWARE_LEVEL,
+		VpdDbEnv::VERSION_FIRMWARE_VERSION, VpdDbEnv::VERSION_MICROCODE_LEVEL,
+		VpdDbEnv::ALL_VERSION_FIELDS };
+	vector<Component*> rows;
+	VpdDbEnv::Cursor* cur = db.scanPrefix( "" );
+
+	CHECK( cur != NULL );
+	while( cur->next( ) )
+		rows.push_back( cur->getComponent( ) );
+	CHECK( !cur->failed( ) );
+	delete cur;
+
+	size_t found = 0;
+	for( size_t f = 0; f < POOL_SIZE; f++ )
+	{
+		for( size_t t = 0; t < POOL_SIZE; t++ )
+		{
+			for( size_t m = 0; m < sizeof( masks ) / sizeof( masks[ 0 ] ); m++ )
+			{
+				vector<string> want;
+				for( size_t r = 0; r < rows.size( ); r++ )
+				{
+					Component* c = rows[ r ];
+					const string* ml = c->getMicroCodeLevel( );
+					if( ( ( masks[ m ] & VpdDbEnv::VERSION_FIRMWARE_LEVEL ) &&
+						inRange( c->getFirmwareLevel( ), POOL[ f ],
+						POOL[ t ] ) ) ||
+						( ( masks[ m ] & VpdDbEnv::VERSION_FIRMWARE_VERSION ) &&
+						inRange( c->getFirmwareVersion( ), POOL[ f ],
+						POOL[ t ] ) ) ||
+						( ( masks[ m ] & VpdDbEnv::VERSION_MICROCODE_LEVEL ) &&
+						ml != NULL && inRange( *ml, POOL[ f ], POOL[ t ] ) ) )
+						want.push_back( c->getID( ) );
+				}
+				CHECK( db.findVersionRange( POOL[ f ], POOL[ t ],
+					masks[ m ] ) == want );
+				found += want.size( );
+			}
+		}
+	}
+	// Not every range is empty.
+	CHECK( found > 0 );
+
+	for( size_t r = 0; r < rows.size( ); r++ )
+		delete rows[ r ];
+}
+
+int main( )
+{
+	// Numbers compare by length first, then digit by digit.
+	const char* const numbers[ ] = { "0", "9", "09", "10", "010", "99",
+		"100", "1000000000000000000000" };
+	const bool numbersEqual[ ] = { false, true, false, true, false, false,
+		false };
+	checkOrder( numbers, 8, numbersEqual );
+
+	// Pre-releases before the release, which ends before anything that
+	// carries on, letters before numbers.
+	const char* const releases[ ] = { "2.0-alpha", "2.0beta2", "2.0dev",
+		"2.0pre", "2.0-rc1", "2.0rc2", "2.0", "2.0a", "2.0ab", "2.0.0",
+		"2.0.1", "2.1" };
+	const bool releasesEqual[ ] = { false, false, false, false, false,
+		false, false, false, false, false, false };
+	checkOrder( releases, 12, releasesEqual );
+
+	// Case, a leading v and the separators do not matter.
+	const char* const same[ ] = { "FW860.10", "fw860.10", "Fw860-10",
+		"FW 860 10", "FW860.010" };
+	const bool sameEqual[ ] = { true, true, true, true };
+	checkOrder( same, 5, sameEqual );
+	CHECK( HelperFunctions::compareVersions( "v1.2", "1.2" ) == 0 );
+	CHECK( HelperFunctions::compareVersions( "2.0RC1", "2.0rc1" ) == 0 );
+	CHECK( HelperFunctions::compareVersions( "3.5.1", "3.10.0" ) < 0 );
+	CHECK( HelperFunctions::compareVersions( "FW860.10 (61)",
+		"FW950.50 (105)" ) < 0 );
+
+	// Every key ends with the END marker, a level of no letters or digits
+	// has none.
+	string key = HelperFunctions::versionKey( "1.2" );
+	string longer = HelperFunctions::versionKey( "1.2.0" );
+	CHECK( key.length( ) < longer.length( ) && key < longer );
+	CHECK( longer.compare( 0, key.length( ) - 1, key, 0,
+		key.length( ) - 1 ) == 0 );
+	CHECK( HelperFunctions::versionKey( "" ).empty( ) );
+	CHECK( HelperFunctions::versionKey( "--" ).empty( ) );
+	CHECK( HelperFunctions::versionKey( "v" ) ==
+		HelperFunctions::versionKey( "V" ) );
+	CHECK( !HelperFunctions::versionKey( "v" ).empty( ) );
+
+	TempDir dir;
+	vector<string> ids;
+	VpdDbEnv db( dir.path, "vpd.db", false );
+	System* sys = Gatherer::makeSystem( );
+
+	for( int n = 0; n < 60; n++ )
+	{
+		Component* c = device( "/sys/devices/d" + to_string( n ), n, 0 );
+		Gatherer::addChild( sys, c->getID( ) );
+		CHECK( db.store( c ) );
+		ids.push_back( c->getID( ) );
+		delete c;
+	}
+	CHECK( db.store( sys ) );
+	delete sys;
+	crossCheck( db );
+
+	// Other levels for some, none left for others.
+	for( int n = 0; n < 60; n += 3 )
+	{
+		Component* c = device( ids[ n ], n, 7 );
+		CHECK( db.upsert( c ) );
+		delete c;
+	}
+	for( int n = 1; n < 60; n += 5 )
+		CHECK( db.remove( ids[ n ] ) );
+	crossCheck( db );
+
+	// Rebuilt from the rows, after the table was emptied behind the
+	// VpdDbEnv's back.
+	execute( dir.path + "/vpd.db", "DELETE FROM version_keys;" );
+	CHECK( db.findAtLeast( "" ).empty( ) );
+	CHECK( db.rebuildVersions( ) );
+	crossCheck( db );
+	return 0;
+}